@@ -27,8 +27,31 @@
 #include <sstream>  // Convert uint to hex string
 
 DTCLib::DTC::DTC(DTC_SimMode mode, int dtc, unsigned rocMask, std::string expectedDesignVersion, bool skipInit, std::string simMemoryFile)
-	: DTC_Registers(mode, dtc, simMemoryFile, rocMask, expectedDesignVersion, skipInit), daqDMAInfo_(), dcsDMAInfo_()
+	: DTC_Registers(mode, dtc, simMemoryFile, rocMask, expectedDesignVersion, skipInit), daqDMAInfo_(), dcsDMAInfo_(), streamSegments_(), streamView_(), filteredSubEvents_(), lookahead_(), numaNode_(-1), lazyParsing_(false), filter_(), filterStats_(), releasePolicy_(DTC_ReleasePolicy_Eager), releaseParameter_(0)
 {
+	auto policyE = getenv("DTCLIB_RELEASE_POLICY");
+	if (policyE != nullptr)
+	{
+		// "policy[:parameter]"
+		std::string setting(policyE);
+		auto colon = setting.find(':');
+		auto policy = DTC_ReleasePolicyConverter::ConvertToReleasePolicy(setting.substr(0, colon));
+		unsigned parameter = colon != std::string::npos ? strtoul(setting.c_str() + colon + 1, nullptr, 0) : 0;
+		if (colon == std::string::npos)
+		{
+			if (policy == DTC_ReleasePolicy_Count) parameter = 8;
+			if (policy == DTC_ReleasePolicy_Age) parameter = 1000;
+			if (policy == DTC_ReleasePolicy_Watermark) parameter = 50;
+		}
+		SetReleasePolicy(policy, parameter);
+	}
+
+	auto lazyE = getenv("DTCLIB_LAZY_PARSING");
+	if (lazyE != nullptr) lazyParsing_ = strtol(lazyE, nullptr, 0) != 0;
+
+	numaNode_ = mu2eaffinity::buffer_numa_node(device_.getDTCID());
+	mu2eaffinity::pin_reader_thread(device_.getDTCID());
+	TLOG(TLVL_DEBUG) << "Event buffers for DTC " << device_.getDTCID() << " are allocated on NUMA node " << numaNode_;
 	// ELF, 05/18/2016: Rick reports that 3.125 Gbp
 	// SetSERDESOscillatorClock(DTC_SerdesClockSpeed_25Gbps); // We're going to 2.5Gbps for now
 	TLOG(TLVL_INFO) << "CONSTRUCTOR";
@@ -43,100 +66,323 @@ DTCLib::DTC::~DTC()
 //
 // DMA Functions
 //
-std::vector<std::unique_ptr<DTCLib::DTC_Event>> DTCLib::DTC::GetData(DTC_EventWindowTag when)
+template<class EventType>
+DTCLib::DTC_ReadStatus DTCLib::DTC::GetEvents(std::vector<std::unique_ptr<EventType>>& output, DTC_EventWindowTag when,
+											  DTC_ReadStatus (DTC::*readNext)(std::unique_ptr<EventType>&, int))
 {
 	TLOG(TLVL_GetData) << "GetData begin";
-	std::vector<std::unique_ptr<DTC_Event>> output;
-	std::unique_ptr<DTC_Event> packet = nullptr;
+	output.clear();
+	std::unique_ptr<EventType> packet = nullptr;
 	ReleaseBuffers(DTC_DMA_Engine_DAQ);
 
-	try
+	// Read the next DTC_Event
+	auto tries = 0;
+	auto sts = DTC_ReadStatus_Timeout;
+	while (sts == DTC_ReadStatus_Timeout && tries < 3)
 	{
-		// Read the next DTC_Event
-		auto tries = 0;
-		while (packet == nullptr && tries < 3)
+		TLOG(TLVL_GetData) << "GetData before ReadNextDAQPacket, tries=" << tries;
+		sts = (this->*readNext)(packet, 100);
+		if (sts == DTC_ReadStatus_OK)
 		{
-			TLOG(TLVL_GetData) << "GetData before ReadNextDAQPacket, tries=" << tries;
-			packet = ReadNextDAQDMA(100);
-			if (packet != nullptr)
-			{
-				TLOG(TLVL_GetData) << "GetData after ReadDMADAQPacket, ts=0x" << std::hex
-								   << packet->GetEventWindowTag().GetEventWindowTag(true);
-			}
-			tries++;
-			// if (packet == nullptr) usleep(5000);
+			TLOG(TLVL_GetData) << "GetData after ReadDMADAQPacket, ts=0x" << std::hex
+							   << packet->GetEventWindowTag().GetEventWindowTag(true);
 		}
-		if (packet == nullptr)
+		tries++;
+	}
+	if (sts != DTC_ReadStatus_OK)
+	{
+		TLOG(TLVL_GetData) << "GetData: No DTC_Event after " << tries << " tries: " << DTC_ReadStatusConverter(sts).toString();
+		return sts;
+	}
+
+	if (packet->GetEventWindowTag() != when && when.GetEventWindowTag(true) != 0)
+	{
+		TLOG(TLVL_ERROR) << "GetData: Error: DTC_Event has wrong Event Window Tag! 0x" << std::hex << when.GetEventWindowTag(true)
+						 << "(expected) != 0x" << std::hex << packet->GetEventWindowTag().GetEventWindowTag(true);
+		packet.reset(nullptr);
+		daqDMAInfo_.current = daqDMAInfo_.last;
+		return daqDMAInfo_.readStats.Count(DTC_ReadStatus_NotFound);
+	}
+
+	when = packet->GetEventWindowTag();
+
+	TLOG(TLVL_GetData) << "GetData: Adding DTC_Event " << (void*)daqDMAInfo_.Pointer(daqDMAInfo_.last) << " to the list (first)";
+	output.push_back(std::move(packet));
+
+	// Errors after the first event end the list, and are only seen in the read stats
+	auto done = false;
+	while (!done)
+	{
+		TLOG(TLVL_GetData) << "GetData: Reading next DAQ Packet";
+		sts = (this->*readNext)(packet, 0);
+		if (sts != DTC_ReadStatus_OK)  // End of Data
+		{
+			TLOG(TLVL_GetData) << "GetData: Next read returned " << DTC_ReadStatusConverter(sts).toString() << "; we're done";
+			done = true;
+			daqDMAInfo_.current.valid = false;
+		}
+		else if (packet->GetEventWindowTag() != when)
+		{
+			TLOG(TLVL_GetData) << "GetData: Next packet has ts=0x" << std::hex << packet->GetEventWindowTag().GetEventWindowTag(true)
+							   << ", not 0x" << std::hex << when.GetEventWindowTag(true) << "; we're done";
+			done = true;
+			daqDMAInfo_.current = daqDMAInfo_.last;
+		}
+		else
+		{
+			TLOG(TLVL_GetData) << "GetData: Next packet has same ts=0x" << std::hex
+							   << packet->GetEventWindowTag().GetEventWindowTag(true) << ", continuing (bc=0x" << std::hex
+							   << packet->GetEventByteCount() << ")";
+		}
+
+		if (!done)
 		{
-			TLOG(TLVL_GetData) << "GetData: Timeout Occurred! (DTC_Event is nullptr after retries)";
-			return output;
+			TLOG(TLVL_GetData) << "GetData: Adding pointer " << (void*)daqDMAInfo_.Pointer(daqDMAInfo_.last) << " to the list";
+			output.push_back(std::move(packet));
 		}
+	}
+
+	TLOG(TLVL_GetData) << "GetData RETURN";
+	return DTC_ReadStatus_OK;
+}  // GetEvents
+
+std::vector<std::unique_ptr<DTCLib::DTC_Event>> DTCLib::DTC::GetData(DTC_EventWindowTag when)
+{
+	std::vector<std::unique_ptr<DTC_Event>> output;
+	auto sts = TryGetData(output, when);
+	if (sts != DTC_ReadStatus_OK && sts != DTC_ReadStatus_Timeout && sts != DTC_ReadStatus_NotFound)
+	{
+		TLOG(TLVL_WARNING) << "GetData: " << DTC_ReadStatusConverter(sts).toString() << " while reading data";
+	}
+	return output;
+}
+
+std::vector<std::unique_ptr<DTCLib::DTC_EventView>> DTCLib::DTC::GetDataViews(DTC_EventWindowTag when)
+{
+	std::vector<std::unique_ptr<DTC_EventView>> output;
+	auto sts = TryGetDataViews(output, when);
+	if (sts != DTC_ReadStatus_OK && sts != DTC_ReadStatus_Timeout && sts != DTC_ReadStatus_NotFound)
+	{
+		TLOG(TLVL_WARNING) << "GetDataViews: " << DTC_ReadStatusConverter(sts).toString() << " while reading data";
+	}
+	return output;
+}
 
-		if (packet->GetEventWindowTag() != when && when.GetEventWindowTag(true) != 0)
+DTCLib::DTC_ReadStatus DTCLib::DTC::TryGetData(std::vector<std::unique_ptr<DTC_Event>>& events, DTC_EventWindowTag when)
+{
+	auto tag = when.GetEventWindowTag(true);
+	events.clear();
+	if (lookahead_.Take(tag, events))
+	{
+		TLOG(TLVL_GetData) << "GetData: Returning " << events.size() << " events for ts=0x" << std::hex
+						   << events[0]->GetEventWindowTag().GetEventWindowTag(true) << " from the lookahead store";
+		return DTC_ReadStatus_OK;
+	}
+	if (tag == 0 || !lookahead_.Enabled()) return GetEvents(events, when, &DTC::TryReadNextDAQDMA);
+
+	// Keep the events of other tags until the requested one turns up, no more data is ready, or the store is full
+	auto start = std::chrono::steady_clock::now();
+	while (true)
+	{
+		auto sts = GetEvents(events, DTC_EventWindowTag(), &DTC::TryReadNextDAQDMA);
+		if (sts != DTC_ReadStatus_OK || events[0]->GetEventWindowTag() == when) return sts;
+
+		auto found = events[0]->GetEventWindowTag().GetEventWindowTag(true);
+		TLOG(TLVL_GetData) << "GetData: Got ts=0x" << std::hex << found << " while looking for ts=0x" << tag << ", storing it";
+		CopyOutOfDMABuffers(events);
+		if (lookahead_.Store(found, events) > 0 || std::chrono::steady_clock::now() - start > lookahead_.GetMaxAge())
 		{
-			TLOG(TLVL_ERROR) << "GetData: Error: DTC_Event has wrong Event Window Tag! 0x" << std::hex << when.GetEventWindowTag(true)
-							 << "(expected) != 0x" << std::hex << packet->GetEventWindowTag().GetEventWindowTag(true);
-			packet.reset(nullptr);
-			daqDMAInfo_.currentReadPtr = daqDMAInfo_.lastReadPtr;
-			return output;
+			TLOG(TLVL_WARNING) << "GetData: Gave up looking for ts=0x" << std::hex << tag << ", the lookahead store is at its limits";
+			return daqDMAInfo_.readStats.Count(DTC_ReadStatus_NotFound);
 		}
+	}
+}
 
-		when = packet->GetEventWindowTag();
+DTCLib::DTC_ReadStatus DTCLib::DTC::TryGetDataViews(std::vector<std::unique_ptr<DTC_EventView>>& views, DTC_EventWindowTag when)
+{
+	return GetEvents(views, when, &DTC::TryReadNextDAQEventView);
+}
 
-		TLOG(TLVL_GetData) << "GetData: Adding DTC_Event " << (void*)daqDMAInfo_.lastReadPtr << " to the list (first)";
-		output.push_back(std::move(packet));
+DTCLib::DTC_ReadStatus DTCLib::DTC::GetDataUntil(std::vector<std::unique_ptr<DTC_Event>>& events, DTC_EventWindowTag when, DTC_Contributors const& expected,
+												 std::chrono::steady_clock::time_point deadline, DTC_Contributors& missing)
+{
+	TLOG(TLVL_GetData) << "GetDataUntil BEGIN, ts=0x" << std::hex << when.GetEventWindowTag(true) << std::dec << ", " << expected.Count() << " links expected";
+	events.clear();
+	missing = expected;
+	ReleaseBuffers(DTC_DMA_Engine_DAQ);
 
-		auto done = false;
-		while (!done)
+	if (lookahead_.Take(when.GetEventWindowTag(true), events))
+	{
+		when = events[0]->GetEventWindowTag();
+		for (auto& event : events) missing.Remove(*event);
+	}
+
+	auto first = true;
+	while (events.empty() || !missing.Empty())
+	{
+		auto now = std::chrono::steady_clock::now();
+		if (now >= deadline && !first) break;
+		first = false;
+		auto tmo_ms = now < deadline ? static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count()) : 0;
+		std::unique_ptr<DTC_Event> event;
+		auto sts = TryReadNextDAQDMA(event, tmo_ms);
+		if (sts == DTC_ReadStatus_IOError) return sts;
+		if (sts != DTC_ReadStatus_OK) continue;  // Timeouts and skipped bad data: keep trying until the deadline
+
+		if (events.empty() && when.GetEventWindowTag(true) == 0) when = event->GetEventWindowTag();
+		if (event->GetEventWindowTag() == when)
 		{
-			TLOG(TLVL_GetData) << "GetData: Reading next DAQ Packet";
-			packet = ReadNextDAQDMA(0);
-			if (packet == nullptr)  // End of Data
-			{
-				TLOG(TLVL_GetData) << "GetData: Next packet is nullptr; we're done";
-				done = true;
-				daqDMAInfo_.currentReadPtr = nullptr;
-			}
-			else if (packet->GetEventWindowTag() != when)
-			{
-				TLOG(TLVL_GetData) << "GetData: Next packet has ts=0x" << std::hex << packet->GetEventWindowTag().GetEventWindowTag(true)
-								   << ", not 0x" << std::hex << when.GetEventWindowTag(true) << "; we're done";
-				done = true;
-				daqDMAInfo_.currentReadPtr = daqDMAInfo_.lastReadPtr;
-			}
-			else
-			{
-				TLOG(TLVL_GetData) << "GetData: Next packet has same ts=0x" << std::hex
-								   << packet->GetEventWindowTag().GetEventWindowTag(true) << ", continuing (bc=0x" << std::hex
-								   << packet->GetEventByteCount() << ")";
-			}
+			missing.Remove(*event);
+			events.push_back(std::move(event));
+			continue;
+		}
 
-			if (!done)
-			{
-				TLOG(TLVL_GetData) << "GetData: Adding pointer " << (void*)daqDMAInfo_.lastReadPtr << " to the list";
-				output.push_back(std::move(packet));
-			}
+		// An event of another window
+		auto found = event->GetEventWindowTag().GetEventWindowTag(true);
+		if (!lookahead_.Enabled())
+		{
+			TLOG(TLVL_GetData) << "GetDataUntil: Got ts=0x" << std::hex << found << ", the lookahead store is disabled; we're done";
+			daqDMAInfo_.current = daqDMAInfo_.last;
+			break;
+		}
+		TLOG(TLVL_GetData) << "GetDataUntil: Got ts=0x" << std::hex << found << " while looking for ts=0x" << when.GetEventWindowTag(true) << ", storing it";
+		std::vector<std::unique_ptr<DTC_Event>> other;
+		other.push_back(std::move(event));
+		CopyOutOfDMABuffers(other);
+		if (lookahead_.Store(found, other) > 0)
+		{
+			TLOG(TLVL_WARNING) << "GetDataUntil: Gave up looking for ts=0x" << std::hex << when.GetEventWindowTag(true) << ", the lookahead store is at its limits";
+			break;
 		}
 	}
-	catch (DTC_WrongPacketTypeException& ex)
+
+	if (events.empty()) return DTC_ReadStatus_Timeout;
+	if (!missing.Empty())
 	{
-		TLOG(TLVL_WARNING) << "GetData: Bad omen: Wrong packet type at the current read position";
-		daqDMAInfo_.currentReadPtr = nullptr;
+		TLOG(TLVL_GetData) << "GetDataUntil: ts=0x" << std::hex << when.GetEventWindowTag(true) << std::dec << " is missing " << missing.Count() << " links";
+		return daqDMAInfo_.readStats.Count(DTC_ReadStatus_Incomplete);
 	}
-	catch (DTC_IOErrorException& ex)
+	TLOG(TLVL_GetData) << "GetDataUntil: ts=0x" << std::hex << when.GetEventWindowTag(true) << " is complete with " << std::dec << events.size() << " events";
+	return DTC_ReadStatus_OK;
+}
+
+size_t DTCLib::DTC::ReadEvents(EventHandler const& handler, size_t maxEvents, int tmo_ms)
+{
+	TLOG(TLVL_GetData) << "ReadEvents BEGIN, maxEvents=" << maxEvents << ", tmo_ms=" << tmo_ms;
+	size_t count = 0;
+	while (maxEvents == 0 || count < maxEvents)
 	{
-		daqDMAInfo_.currentReadPtr = nullptr;
-		TLOG(TLVL_WARNING) << "GetData: IO Exception Occurred!";
+		// The handler is done with the previous event
+		ReleaseBuffers(DTC_DMA_Engine_DAQ);
+
+		uint64_t firstBuffer;
+		auto sts = ReadNextDAQSegments(streamSegments_, firstBuffer, count == 0 ? tmo_ms : 0);
+		if (sts == DTC_ReadStatus_BadByteCount) continue;  // The rest of the buffer was skipped
+		if (sts != DTC_ReadStatus_OK)
+		{
+			TLOG(TLVL_GetData) << "ReadEvents: " << DTC_ReadStatusConverter(sts).toString() << " after " << count << " events";
+			break;
+		}
+		streamView_.Reset(streamSegments_);
+		++count;
+		if (!handler(streamView_)) break;
 	}
-	catch (DTC_DataCorruptionException& ex)
+
+	TLOG(TLVL_GetData) << "ReadEvents RETURN " << count;
+	return count;
+}
+
+DTCLib::DTC_ReadStatus DTCLib::DTC::ReadNextDAQEventInto(EventAllocator const& allocate, DTC_EventLayout& layout, int tmo_ms)
+{
+	TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQEventInto BEGIN";
+	layout.data = nullptr;
+	layout.byteCount = 0;
+
+	// The previous event was copied out, its buffers are no longer needed
+	ReleaseBuffers(DTC_DMA_Engine_DAQ);
+
+	auto filtered = !filter_.AcceptsAll();
+	size_t byteCount;
+	while (true)
 	{
-		daqDMAInfo_.currentReadPtr = nullptr;
-		TLOG(TLVL_WARNING) << "GetData: Data Corruption Exception Occurred!";
+		uint64_t firstBuffer;
+		auto sts = ReadNextDAQSegments(streamSegments_, firstBuffer, tmo_ms);
+		if (sts != DTC_ReadStatus_OK) return sts;
+		streamView_.Reset(streamSegments_);
+		if (!filtered)
+		{
+			byteCount = streamView_.GetEventByteCount();
+			break;
+		}
+		byteCount = streamView_.SelectFiltered(filter_, filterStats_, filteredSubEvents_);
+		if (!filter_.dropEmptyEvents || !filteredSubEvents_.empty()) break;
+		TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQEventInto: Nothing kept of ts=0x" << std::hex << streamView_.GetEventWindowTag().GetEventWindowTag(true) << ", skipping it";
+		filterStats_.eventsDropped++;
+		ReleaseBuffers(DTC_DMA_Engine_DAQ);
 	}
 
-	TLOG(TLVL_GetData) << "GetData RETURN";
-	return output;
-}  // GetData
+	auto dest = static_cast<uint8_t*>(allocate(streamView_.GetHeader(), byteCount));
+	if (dest == nullptr)
+	{
+		// Read the same event again next time
+		TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQEventInto: No memory for " << byteCount << " bytes, leaving the event in the DMA buffers";
+		daqDMAInfo_.current = daqDMAInfo_.last;
+		return daqDMAInfo_.readStats.Count(DTC_ReadStatus_NoMemory);
+	}
+
+	if (filtered)
+		streamView_.CopyFiltered(filteredSubEvents_, byteCount, dest);
+	else
+		streamView_.CopyBytes(0, dest, byteCount);
+
+	layout.data = dest;
+	layout.byteCount = byteCount;
+	layout.dmaBufferCount = streamView_.GetSegmentCount();
+	memcpy(&layout.header, dest, sizeof(DTC_EventHeader));
+	DescribeEvent(layout);
+	TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQEventInto RETURN, " << byteCount << " bytes from " << layout.dmaBufferCount << " DMA buffers";
+	return DTC_ReadStatus_OK;
+}
+
+void DTCLib::DTC::DescribeEvent(DTC_EventLayout& layout)
+{
+	// Sub-Event slots are reused, so that their block vectors keep their memory
+	size_t count = 0;
+	size_t offset = sizeof(DTC_EventHeader);
+	while (offset + sizeof(DTC_SubEventHeader) <= layout.byteCount)
+	{
+		DTC_SubEventHeader header;
+		memcpy(&header, layout.data + offset, sizeof(header));
+		auto subEventEnd = offset + header.inclusive_subevent_byte_count;
+		if (header.inclusive_subevent_byte_count < sizeof(header) || subEventEnd > layout.byteCount)
+		{
+			TLOG(TLVL_ERROR) << "Invalid sub event header at location 0x" << std::hex << offset << ", this event has been truncated.";
+			break;
+		}
+		if (layout.subEvents.size() <= count) layout.subEvents.emplace_back();
+		auto& subEvent = layout.subEvents[count++];
+		subEvent.offset = offset;
+		subEvent.header = header;
+		subEvent.blocks.clear();
+
+		// Byte count and packet type are in the first three bytes of the Data Header packet
+		auto blockOffset = offset + sizeof(DTC_SubEventHeader);
+		while (blockOffset + 16 <= subEventEnd)
+		{
+			auto word = layout.data + blockOffset;
+			size_t blockByteCount = word[0] + (word[1] << 8);
+			if ((word[2] >> 4) != DTC_PacketType_DataHeader || blockByteCount < 16 || blockOffset + blockByteCount > subEventEnd)
+			{
+				TLOG(TLVL_ERROR) << "Invalid Data Header packet at location 0x" << std::hex << blockOffset << ", this sub event has been truncated.";
+				break;
+			}
+			subEvent.blocks.push_back(DTC_DataBlockRef{blockOffset, blockByteCount});
+			blockOffset += blockByteCount;
+		}
+		offset = subEventEnd;
+	}
+	layout.subEvents.resize(count);
+}
 
 void DTCLib::DTC::WriteSimFileToDTC(std::string file, bool /*goForever*/, bool overwriteEnvironment,
 									std::string outputFileName, bool skipVerify)
@@ -179,15 +425,37 @@ void DTCLib::DTC::WriteSimFileToDTC(std::string file, bool /*goForever*/, bool o
 		while (is && is.good() && sizeCheck)
 		{
 			TLOG(TLVL_WriteSimFileToDTC2) << "WriteSimFileToDTC Reading a DMA from file..." << file;
-			auto buf = reinterpret_cast<mu2e_databuff_t*>(new char[0x10000]);
+			// Read each DMA straight into the device's send buffer
+			auto reservation = device_.write_acquire(DTC_DMA_Engine_DAQ, 1000);
+			auto buf = reinterpret_cast<mu2e_databuff_t*>(reservation.data());
+			if (buf == nullptr)
+			{
+				TLOG(TLVL_ERROR) << "WriteSimFileToDTC: no free DMA buffer, throwing DTC_IOErrorException!";
+				throw DTC_IOErrorException(-1);
+			}
 			is.read(reinterpret_cast<char*>(buf), sizeof(uint64_t));
 			if (is.eof())
 			{
 				TLOG(TLVL_WriteSimFileToDTC2) << "WriteSimFileToDTC End of file reached.";
-				delete[] buf;
+				reservation.commit(0);
 				break;
 			}
 			auto sz = *reinterpret_cast<uint64_t*>(buf);
+			if (sz == 0)
+			{
+				TLOG(TLVL_WriteSimFileToDTC2) << "WriteSimFileToDTC End of records reached.";
+				reservation.commit(0);
+				break;
+			}
+			// The record must hold its own size word, and fit in the DMA buffer it is read into
+			if (sz < sizeof(uint64_t) || sz > sizeof(mu2e_databuff_t))
+			{
+				TLOG(TLVL_ERROR) << "WriteSimFileToDTC: Record of " << sz << " bytes at 0x" << std::hex << totalSize
+								 << " does not fit in a DMA buffer, stopping";
+				reservation.commit(0);
+				sizeCheck = false;
+				break;
+			}
 			is.read(reinterpret_cast<char*>(buf) + 8, sz - sizeof(uint64_t));
 			if (sz < 80 && sz > 0)
 			{
@@ -223,14 +491,22 @@ void DTCLib::DTC::WriteSimFileToDTC(std::string file, bool /*goForever*/, bool o
 				totalSize += sz - 8;
 				n++;
 				TLOG(TLVL_WriteSimFileToDTC3) << "WriteSimFileToDTC: totalSize is now " << totalSize << ", n is now " << n;
-				WriteDetectorEmulatorData(buf, static_cast<size_t>(sz));
+				if (sz < dmaSize_) sz = dmaSize_;
+				TLOG(TLVL_WriteDetectorEmulatorData) << "WriteSimFileToDTC: Writing buffer of size " << sz;
+				auto errorCode = reservation.commit(static_cast<size_t>(sz));
+				if (errorCode != 0)
+				{
+					TLOG(TLVL_ERROR) << "WriteSimFileToDTC: write_commit returned " << errorCode
+									 << ", throwing DTC_IOErrorException!";
+					throw DTC_IOErrorException(errorCode);
+				}
 			}
-			else if (sz > 0)
+			else
 			{
+				reservation.commit(0);
 				TLOG(TLVL_WriteSimFileToDTC2) << "WriteSimFileToDTC DTC memory is now full. Closing file.";
 				sizeCheck = false;
 			}
-			delete[] buf;
 		}
 
 		TLOG(TLVL_WriteSimFileToDTC) << "WriteSimFileToDTC Closing file. sizecheck=" << sizeCheck << ", eof=" << is.eof()
@@ -409,7 +685,7 @@ bool DTCLib::DTC::VerifySimFileInDTC(std::string file, std::string rawOutputFile
 // ROC Register Functions
 uint16_t DTCLib::DTC::ReadROCRegister(const DTC_Link_ID& link, const uint16_t address, int tmo_ms)
 {
-	dcsDMAInfo_.currentReadPtr = nullptr;
+	dcsDMAInfo_.current.valid = false;
 	ReleaseBuffers(DTC_DMA_Engine_DCS);
 	SendDCSRequestPacket(link, DTC_DCSOperationType_Read, address,
 						 0x0 /*data*/, 0x0 /*address2*/, 0x0 /*data2*/,
@@ -463,7 +739,7 @@ bool DTCLib::DTC::WriteROCRegister(const DTC_Link_ID& link, const uint16_t addre
 {
 	if (requestAck)
 	{
-		dcsDMAInfo_.currentReadPtr = nullptr;
+		dcsDMAInfo_.current.valid = false;
 		ReleaseBuffers(DTC_DMA_Engine_DCS);
 	}
 
@@ -504,7 +780,7 @@ bool DTCLib::DTC::WriteROCRegister(const DTC_Link_ID& link, const uint16_t addre
 std::pair<uint16_t, uint16_t> DTCLib::DTC::ReadROCRegisters(const DTC_Link_ID& link, const uint16_t address1,
 															const uint16_t address2, int tmo_ms)
 {
-	dcsDMAInfo_.currentReadPtr = nullptr;
+	dcsDMAInfo_.current.valid = false;
 	ReleaseBuffers(DTC_DMA_Engine_DCS);
 	SendDCSRequestPacket(link, DTC_DCSOperationType_Read, address1, 0, address2);
 	usleep(2500);
@@ -552,7 +828,7 @@ bool DTCLib::DTC::WriteROCRegisters(const DTC_Link_ID& link, const uint16_t addr
 {
 	if (requestAck)
 	{
-		dcsDMAInfo_.currentReadPtr = nullptr;
+		dcsDMAInfo_.current.valid = false;
 		ReleaseBuffers(DTC_DMA_Engine_DCS);
 	}
 	SendDCSRequestPacket(link, DTC_DCSOperationType_Write, address1, data1, address2, data2, false /*quiet*/, requestAck);
@@ -600,7 +876,7 @@ void DTCLib::DTC::ReadROCBlock(
 
 	TLOG(TLVL_SendDCSRequestPacket) << "ReadROCBlock before WriteDMADCSPacket - DTC_DCSRequestPacket";
 
-	dcsDMAInfo_.currentReadPtr = nullptr;
+	dcsDMAInfo_.current.valid = false;
 	ReleaseBuffers(DTC_DMA_Engine_DCS);
 
 	if (!ReadDCSReception()) EnableDCSReception();
@@ -636,8 +912,8 @@ void DTCLib::DTC::ReadROCBlock(
 
 		while (packetCount > 0)
 		{
-			dcsDMAInfo_.lastReadPtr = reinterpret_cast<uint8_t*>(dcsDMAInfo_.lastReadPtr) + 16;
-			auto dataPacket = new DTC_DataPacket(dcsDMAInfo_.lastReadPtr);
+			dcsDMAInfo_.last.offset += 16;
+			auto dataPacket = new DTC_DataPacket(dcsDMAInfo_.Pointer(dcsDMAInfo_.last));
 			if (dataPacket == nullptr) break;
 
 			TLOG(TLVL_TRACE) << "ReadROCBlock: next data packet: " << dataPacket->toJSON();
@@ -664,7 +940,7 @@ bool DTCLib::DTC::WriteROCBlock(const DTC_Link_ID& link, const uint16_t address,
 {
 	if (requestAck)
 	{
-		dcsDMAInfo_.currentReadPtr = nullptr;
+		dcsDMAInfo_.current.valid = false;
 		ReleaseBuffers(DTC_DMA_Engine_DCS);
 	}
 	DTC_DCSRequestPacket req(link, DTC_DCSOperationType_BlockWrite, requestAck, incrementAddress, address);
@@ -785,144 +1061,180 @@ void DTCLib::DTC::SendDCSRequestPacket(const DTC_Link_ID& link, const DTC_DCSOpe
 }
 
 std::unique_ptr<DTCLib::DTC_Event> DTCLib::DTC::ReadNextDAQDMA(int tmo_ms)
+{
+	std::unique_ptr<DTC_Event> event;
+	ThrowReadError(TryReadNextDAQDMA(event, tmo_ms), DTC_DMA_Engine_DAQ);
+	return event;
+}
+
+DTCLib::DTC_ReadStatus DTCLib::DTC::TryReadNextDAQDMA(std::unique_ptr<DTC_Event>& event, int tmo_ms)
 {
 	TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQDMA BEGIN";
+	event.reset();
+	std::vector<DTC_EventSegment> segments;
+	uint64_t firstBuffer;
+	auto sts = ReadNextDAQSegments(segments, firstBuffer, tmo_ms);
+	if (sts != DTC_ReadStatus_OK) return sts;
 
-	if (daqDMAInfo_.currentReadPtr != nullptr)
+	if (!filter_.AcceptsAll())
 	{
-		TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQDMA BEFORE BUFFER CHECK daqDMAInfo_.currentReadPtr="
-									 << (void*)daqDMAInfo_.currentReadPtr << " *nextReadPtr_=0x" << std::hex
-									 << *(uint16_t*)daqDMAInfo_.currentReadPtr;
+		// Only the selected parts are copied, so the DMA buffers are not used by the event
+		event = DTC_EventView(std::move(segments)).ToFilteredEvent(filter_, filterStats_, numaNode_, lazyParsing_);
+		while (filter_.dropEmptyEvents && event->GetHeader()->num_dtcs == 0)
+		{
+			TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQDMA: Nothing kept of ts=0x" << std::hex << event->GetEventWindowTag().GetEventWindowTag(true) << ", skipping it";
+			filterStats_.eventsDropped++;
+			event.reset();
+			ReleaseBuffers(DTC_DMA_Engine_DAQ);
+			sts = ReadNextDAQSegments(segments, firstBuffer, tmo_ms);
+			if (sts != DTC_ReadStatus_OK) return sts;
+			event = DTC_EventView(std::move(segments)).ToFilteredEvent(filter_, filterStats_, numaNode_, lazyParsing_);
+		}
+		return DTC_ReadStatus_OK;
+	}
+
+	if (segments.size() > 1)
+	{
+		// Continued DMA: gather the pieces into one event. Their buffers are released by the next GetData call.
+		TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQDMA: Copying DTC_Event from " << segments.size() << " DMA Buffers";
+		event = DTC_EventView(std::move(segments)).ToEvent(numaNode_, lazyParsing_);
+		return DTC_ReadStatus_OK;
+	}
+
+	TLOG(TLVL_ReadNextDAQPacket) << "Creating DTC_Event from current DMA Buffer";
+	event = std::make_unique<DTC_Event>(segments[0].data);
+	event->SetupEvent(lazyParsing_);
+
+	TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQDMA: RETURN";
+	return DTC_ReadStatus_OK;
+}
+
+std::unique_ptr<DTCLib::DTC_EventView> DTCLib::DTC::ReadNextDAQEventView(int tmo_ms)
+{
+	std::unique_ptr<DTC_EventView> view;
+	ThrowReadError(TryReadNextDAQEventView(view, tmo_ms), DTC_DMA_Engine_DAQ);
+	return view;
+}
+
+DTCLib::DTC_ReadStatus DTCLib::DTC::TryReadNextDAQEventView(std::unique_ptr<DTC_EventView>& view, int tmo_ms)
+{
+	TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQEventView BEGIN";
+	view.reset();
+	std::vector<DTC_EventSegment> segments;
+	uint64_t firstBuffer;
+	auto sts = ReadNextDAQSegments(segments, firstBuffer, tmo_ms);
+	if (sts != DTC_ReadStatus_OK) return sts;
+
+	// Keep ReleaseBuffers from giving the event's buffers back to the DTC while the view exists
+	auto hold = std::make_shared<uint64_t>(firstBuffer);
+	daqDMAInfo_.holds.emplace_back(hold, firstBuffer);
+
+	TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQEventView: RETURN, " << segments.size() << " segments";
+	view = std::make_unique<DTC_EventView>(std::move(segments), hold);
+	return DTC_ReadStatus_OK;
+}
+
+DTCLib::DTC_ReadStatus DTCLib::DTC::ReadNextDAQSegments(std::vector<DTC_EventSegment>& segments, uint64_t& firstBuffer, int tmo_ms)
+{
+	TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQSegments BEGIN";
+	segments.clear();
+	auto& info = daqDMAInfo_;
+
+	if (info.current.valid)
+	{
+		TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQSegments BEFORE BUFFER CHECK buffer " << info.current.buffer << " offset " << info.current.offset
+									 << " *nextReadPtr_=0x" << std::hex << *reinterpret_cast<uint16_t*>(info.Pointer(info.current));
 	}
 	else
 	{
-		TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQDMA BEFORE BUFFER CHECK daqDMAInfo_.currentReadPtr=nullptr";
+		TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQSegments BEFORE BUFFER CHECK not reading a buffer";
 	}
 
-	auto index = GetCurrentBuffer(&daqDMAInfo_);
+	auto index = GetCurrentBuffer(&info);
 
 	// Need new buffer if GetCurrentBuffer returns -1 (no buffers) or -2 (done with all held buffers)
 	if (index < 0)
 	{
-		TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQDMA Obtaining new DAQ Buffer";
-
-		void* oldBufferPtr = nullptr;
-		if (daqDMAInfo_.buffer.size() > 0) oldBufferPtr = &daqDMAInfo_.buffer.back()[0];
-		auto sts = ReadBuffer(DTC_DMA_Engine_DAQ, tmo_ms);  // does return code
+		TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQSegments Obtaining new DAQ Buffer";
+		auto sts = ReadNextBuffer(DTC_DMA_Engine_DAQ, tmo_ms);
 		if (sts <= 0)
 		{
-			TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQDMA: ReadBuffer returned " << sts << ", returning nullptr";
-			return nullptr;
+			TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQSegments: ReadNextBuffer returned " << sts;
+			return info.readStats.Count(sts < 0 ? DTC_ReadStatus_IOError : DTC_ReadStatus_Timeout);
 		}
-		// MUST BE ABLE TO HANDLE daqbuffer_==nullptr OR retry forever?
-		daqDMAInfo_.currentReadPtr = &daqDMAInfo_.buffer.back()[0];
-		TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQDMA daqDMAInfo_.currentReadPtr=" << (void*)daqDMAInfo_.currentReadPtr
-									 << " *daqDMAInfo_.currentReadPtr=0x" << std::hex << *(unsigned*)daqDMAInfo_.currentReadPtr
-									 << " lastReadPtr_=" << (void*)daqDMAInfo_.lastReadPtr;
-		void* bufferIndexPointer = static_cast<uint8_t*>(daqDMAInfo_.currentReadPtr) + 2;
-		if (daqDMAInfo_.currentReadPtr == oldBufferPtr && daqDMAInfo_.bufferIndex == *static_cast<uint32_t*>(bufferIndexPointer))
-		{
-			TLOG(TLVL_ReadNextDAQPacket)
-				<< "ReadNextDAQDMA: New buffer is the same as old. Releasing buffer and returning nullptr";
-			daqDMAInfo_.currentReadPtr = nullptr;
-			// We didn't actually get a new buffer...this probably means there's no more data
-			// Try and see if we're merely stuck...hopefully, all the data is out of the buffers...
-			device_.read_release(DTC_DMA_Engine_DAQ, 1);
-			return nullptr;
-		}
-		daqDMAInfo_.bufferIndex++;
-
-		daqDMAInfo_.currentReadPtr = static_cast<uint8_t*>(daqDMAInfo_.currentReadPtr) + 2;
-		*static_cast<uint32_t*>(daqDMAInfo_.currentReadPtr) = daqDMAInfo_.bufferIndex;
-		daqDMAInfo_.currentReadPtr = static_cast<uint8_t*>(daqDMAInfo_.currentReadPtr) + 6;
-
-		index = daqDMAInfo_.buffer.size() - 1;
 	}
 
-	TLOG(TLVL_ReadNextDAQPacket) << "Creating DTC_Event from current DMA Buffer";
-	//Utilities::PrintBuffer(daqDMAInfo_.currentReadPtr, 128, TLVL_ReadNextDAQPacket);
-	auto res = std::make_unique<DTC_Event>(daqDMAInfo_.currentReadPtr);
+	firstBuffer = info.current.buffer;
+	auto start = info.Pointer(info.current);
+	//Utilities::PrintBuffer(start, 128, TLVL_ReadNextDAQPacket);
+	DTC_EventHeader header;
+	memcpy(&header, start, sizeof(header));
 
-	auto eventByteCount = res->GetEventByteCount();
-	if (eventByteCount == 0) {
-		throw std::runtime_error("Event inclusive byte count cannot be zero!");
+	size_t eventByteCount = header.inclusive_event_byte_count;
+	if (eventByteCount < sizeof(header))
+	{
+		// Nothing after this in the buffer can be trusted
+		TLOG(TLVL_WARNING) << "ReadNextDAQSegments: Event inclusive byte count " << eventByteCount << " is too small, skipping the rest of buffer " << firstBuffer;
+		info.current.valid = false;
+		return info.readStats.Count(DTC_ReadStatus_BadByteCount);
 	}
-	size_t remainingBufferSize = GetBufferByteCount(&daqDMAInfo_, index) - sizeof(uint64_t);
+	size_t remainingBufferSize = info.Descriptor(firstBuffer).byteCount - info.current.offset;
 	TLOG(TLVL_ReadNextDAQPacket) << "eventByteCount: " << eventByteCount << ", remainingBufferSize: " << remainingBufferSize;
+
+	// If GetData does not use this event, it starts at the beginning of this event next time. The continuation
+	// buffers of a continued event are then taken from the held buffers again.
+	info.last = info.current;
+
 	// Check for continued DMA
 	if (eventByteCount > remainingBufferSize)
 	{
-		// We're going to set lastReadPtr here, so that if this buffer isn't used by GetData, we start at the beginning of this event next time
-		daqDMAInfo_.lastReadPtr = static_cast<uint8_t*>(daqDMAInfo_.currentReadPtr) - 8;
-
-		auto inmem = std::make_unique<DTC_Event>(eventByteCount);
-		memcpy(const_cast<void*>(inmem->GetRawBufferPointer()), res->GetRawBufferPointer(), remainingBufferSize);
+		segments.push_back({start, remainingBufferSize});
 
 		auto bytes_read = remainingBufferSize;
 		while (bytes_read < eventByteCount)
 		{
-			TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQDMA Obtaining new DAQ Buffer, bytes_read=" << bytes_read << ", eventByteCount=" << eventByteCount;
-
-			void* oldBufferPtr = nullptr;
-			if (daqDMAInfo_.buffer.size() > 0) oldBufferPtr = &daqDMAInfo_.buffer.back()[0];
-			auto sts = ReadBuffer(DTC_DMA_Engine_DAQ, tmo_ms);  // does return code
-			if (sts <= 0)
+			if (info.current.buffer + 1 < info.next)
 			{
-				TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQDMA: ReadBuffer returned " << sts << ", returning nullptr";
-				return nullptr;
+				TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQSegments Using held DAQ Buffer " << info.current.buffer + 1 - info.first
+											 << ", bytes_read=" << bytes_read << ", eventByteCount=" << eventByteCount;
+				info.current = {info.current.buffer + 1, 8, true};
 			}
-			// MUST BE ABLE TO HANDLE daqbuffer_==nullptr OR retry forever?
-			daqDMAInfo_.currentReadPtr = &daqDMAInfo_.buffer.back()[0];
-			TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQDMA daqDMAInfo_.currentReadPtr=" << (void*)daqDMAInfo_.currentReadPtr
-										 << " *daqDMAInfo_.currentReadPtr=0x" << std::hex << *(unsigned*)daqDMAInfo_.currentReadPtr
-										 << " lastReadPtr_=" << (void*)daqDMAInfo_.lastReadPtr;
-			void* bufferIndexPointer = static_cast<uint8_t*>(daqDMAInfo_.currentReadPtr) + 2;
-			if (daqDMAInfo_.currentReadPtr == oldBufferPtr && daqDMAInfo_.bufferIndex == *static_cast<uint32_t*>(bufferIndexPointer))
+			else
 			{
-				TLOG(TLVL_ReadNextDAQPacket)
-					<< "ReadNextDAQDMA: New buffer is the same as old. Releasing buffer and returning nullptr";
-				daqDMAInfo_.currentReadPtr = nullptr;
-				// We didn't actually get a new buffer...this probably means there's no more data
-				// Try and see if we're merely stuck...hopefully, all the data is out of the buffers...
-				device_.read_release(DTC_DMA_Engine_DAQ, 1);
-				return nullptr;
+				TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQSegments Obtaining new DAQ Buffer, bytes_read=" << bytes_read << ", eventByteCount=" << eventByteCount;
+				auto sts = ReadNextBuffer(DTC_DMA_Engine_DAQ, tmo_ms);
+				if (sts <= 0)
+				{
+					TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQSegments: ReadNextBuffer returned " << sts;
+					return info.readStats.Count(sts < 0 ? DTC_ReadStatus_IOError : DTC_ReadStatus_Timeout);
+				}
 			}
-			daqDMAInfo_.bufferIndex++;
-
-			size_t buffer_size = *static_cast<uint16_t*>(daqDMAInfo_.currentReadPtr);
-			daqDMAInfo_.currentReadPtr = static_cast<uint8_t*>(daqDMAInfo_.currentReadPtr) + 2;
-			*static_cast<uint32_t*>(daqDMAInfo_.currentReadPtr) = daqDMAInfo_.bufferIndex;
-			daqDMAInfo_.currentReadPtr = static_cast<uint8_t*>(daqDMAInfo_.currentReadPtr) + 6;
 
+			size_t buffer_size = info.Descriptor(info.current.buffer).byteCount;
 			size_t remainingEventSize = eventByteCount - bytes_read;
 			size_t copySize = remainingEventSize < buffer_size - 8 ? remainingEventSize : buffer_size - 8;
-			memcpy(const_cast<uint8_t*>(static_cast<const uint8_t*>(inmem->GetRawBufferPointer()) + bytes_read), daqDMAInfo_.currentReadPtr, copySize);
+			segments.push_back({info.Pointer(info.current), copySize});
 			bytes_read += buffer_size - 8;
 
 			// Increment by the size of the data block
-			daqDMAInfo_.currentReadPtr = reinterpret_cast<char*>(daqDMAInfo_.currentReadPtr) + copySize;
+			info.current.offset += copySize;
 		}
-
-		res.swap(inmem);
 	}
 	else {
-		// Update the packet pointers
-
-		// lastReadPtr_ is easy...
-		daqDMAInfo_.lastReadPtr = daqDMAInfo_.currentReadPtr;
+		segments.push_back({start, eventByteCount});
 
 		// Increment by the size of the data block
-		daqDMAInfo_.currentReadPtr = reinterpret_cast<char*>(daqDMAInfo_.currentReadPtr) + res->GetEventByteCount();
+		info.current.offset += eventByteCount;
 	}
-	res->SetupEvent();
-	
-	TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQDMA: RETURN";
-	return res;
+	TLOG(TLVL_ReadNextDAQPacket) << "ReadNextDAQSegments: RETURN, " << segments.size() << " segments";
+	return info.readStats.Count(DTC_ReadStatus_OK);
 }
 
 std::unique_ptr<DTCLib::DTC_DCSReplyPacket> DTCLib::DTC::ReadNextDCSPacket(int tmo_ms)
 {
-	auto test = ReadNextPacket(DTC_DMA_Engine_DCS, tmo_ms);
+	std::unique_ptr<DTC_DataPacket> test;
+	auto sts = dcsDMAInfo_.readStats.Count(ReadNextPacket(DTC_DMA_Engine_DCS, test, tmo_ms));
+	ThrowReadError(sts, DTC_DMA_Engine_DCS);
 	if (test == nullptr) return nullptr;  // Couldn't read new block
 	auto output = std::make_unique<DTC_DCSReplyPacket>(*test.get());
 	TLOG(TLVL_ReadNextDAQPacket) << output->toJSON();
@@ -930,9 +1242,28 @@ std::unique_ptr<DTCLib::DTC_DCSReplyPacket> DTCLib::DTC::ReadNextDCSPacket(int t
 	return output;
 }
 
-std::unique_ptr<DTCLib::DTC_DataPacket> DTCLib::DTC::ReadNextPacket(const DTC_DMA_Engine& engine, int tmo_ms)
+DTCLib::DTC_ReadStatus DTCLib::DTC::TryReadNextDCSPacket(std::unique_ptr<DTC_DCSReplyPacket>& packet, int tmo_ms)
+{
+	packet.reset();
+	std::unique_ptr<DTC_DataPacket> test;
+	auto sts = ReadNextPacket(DTC_DMA_Engine_DCS, test, tmo_ms);
+	if (sts != DTC_ReadStatus_OK) return dcsDMAInfo_.readStats.Count(sts);
+
+	// Check the type before DTC_DCSReplyPacket would throw on it
+	auto packetType = test->GetData()[2] >> 4;
+	if (packetType != DTC_PacketType_DCSReply)
+	{
+		TLOG(TLVL_ReadNextDCSPacket) << "ReadNextDCSPacket: Skipping packet of type " << packetType;
+		return dcsDMAInfo_.readStats.Count(DTC_ReadStatus_WrongPacketType);
+	}
+	packet = std::make_unique<DTC_DCSReplyPacket>(*test.get());
+	return dcsDMAInfo_.readStats.Count(DTC_ReadStatus_OK);
+}
+
+DTCLib::DTC_ReadStatus DTCLib::DTC::ReadNextPacket(const DTC_DMA_Engine& engine, std::unique_ptr<DTC_DataPacket>& packet, int tmo_ms)
 {
 	TLOG(TLVL_ReadNextDAQPacket) << "ReadNextPacket BEGIN";
+	packet.reset();
 	DMAInfo* info;
 	if (engine == DTC_DMA_Engine_DAQ)
 		info = &daqDMAInfo_;
@@ -941,18 +1272,17 @@ std::unique_ptr<DTCLib::DTC_DataPacket> DTCLib::DTC::ReadNextPacket(const DTC_DM
 	else
 	{
 		TLOG(TLVL_ERROR) << "ReadNextPacket: Invalid DMA Engine specified!";
-		throw new DTC_DataCorruptionException();
+		return DTC_ReadStatus_InvalidChannel;
 	}
 
-	if (info->currentReadPtr != nullptr)
+	if (info->current.valid)
 	{
-		TLOG(TLVL_ReadNextDAQPacket) << "ReadNextPacket BEFORE BUFFER CHECK info->currentReadPtr="
-									 << (void*)info->currentReadPtr << " *nextReadPtr_=0x" << std::hex
-									 << *(uint16_t*)info->currentReadPtr;
+		TLOG(TLVL_ReadNextDAQPacket) << "ReadNextPacket BEFORE BUFFER CHECK buffer " << info->current.buffer << " offset " << info->current.offset
+									 << " *nextReadPtr_=0x" << std::hex << *reinterpret_cast<uint16_t*>(info->Pointer(info->current));
 	}
 	else
 	{
-		TLOG(TLVL_ReadNextDAQPacket) << "ReadNextPacket BEFORE BUFFER CHECK info->currentReadPtr=nullptr";
+		TLOG(TLVL_ReadNextDAQPacket) << "ReadNextPacket BEFORE BUFFER CHECK not reading a buffer";
 	}
 
 	auto index = GetCurrentBuffer(info);
@@ -962,81 +1292,46 @@ std::unique_ptr<DTCLib::DTC_DataPacket> DTCLib::DTC::ReadNextPacket(const DTC_DM
 	{
 		TLOG(TLVL_ReadNextDAQPacket) << "ReadNextPacket Obtaining new " << (engine == DTC_DMA_Engine_DAQ ? "DAQ" : "DCS")
 									 << " Buffer";
-
-		void* oldBufferPtr = nullptr;
-		if (info->buffer.size() > 0) oldBufferPtr = &info->buffer.back()[0];
-		auto sts = ReadBuffer(engine, tmo_ms);  // does return code
+		auto sts = ReadNextBuffer(engine, tmo_ms);
 		if (sts <= 0)
 		{
-			TLOG(TLVL_ReadNextDAQPacket) << "ReadNextPacket: ReadBuffer returned " << sts << ", returning nullptr";
-			return nullptr;
+			TLOG(TLVL_ReadNextDAQPacket) << "ReadNextPacket: ReadNextBuffer returned " << sts << ", returning nullptr";
+			return sts < 0 ? DTC_ReadStatus_IOError : DTC_ReadStatus_Timeout;
 		}
-		// MUST BE ABLE TO HANDLE daqbuffer_==nullptr OR retry forever?
-		info->currentReadPtr = &info->buffer.back()[0];
-		TLOG(TLVL_ReadNextDAQPacket) << "ReadNextPacket info->currentReadPtr=" << (void*)info->currentReadPtr
-									 << " *info->currentReadPtr=0x" << std::hex << *(unsigned*)info->currentReadPtr
-									 << " lastReadPtr_=" << (void*)info->lastReadPtr;
-		void* bufferIndexPointer = static_cast<uint8_t*>(info->currentReadPtr) + 2;
-		if (info->currentReadPtr == oldBufferPtr && info->bufferIndex == *static_cast<uint32_t*>(bufferIndexPointer))
-		{
-			TLOG(TLVL_ReadNextDAQPacket)
-				<< "ReadNextPacket: New buffer is the same as old. Releasing buffer and returning nullptr";
-			info->currentReadPtr = nullptr;
-			// We didn't actually get a new buffer...this probably means there's no more data
-			// Try and see if we're merely stuck...hopefully, all the data is out of the buffers...
-			device_.read_release(engine, 1);
-			return nullptr;
-		}
-		info->bufferIndex++;
-
-		info->currentReadPtr = reinterpret_cast<uint8_t*>(info->currentReadPtr) + 2;
-		*static_cast<uint32_t*>(info->currentReadPtr) = info->bufferIndex;
-		info->currentReadPtr = reinterpret_cast<uint8_t*>(info->currentReadPtr) + 6;
-
-		index = info->buffer.size() - 1;
 	}
 
 	// Read the next packet
-	TLOG(TLVL_ReadNextDAQPacket) << "ReadNextPacket reading next packet from buffer: info->currentReadPtr="
-								 << (void*)info->currentReadPtr;
-
-	auto blockByteCount = *reinterpret_cast<uint16_t*>(info->currentReadPtr);
-	TLOG(TLVL_ReadNextDAQPacket) << "ReadNextPacket: blockByteCount=" << blockByteCount
-								 << ", info->currentReadPtr=" << (void*)info->currentReadPtr
-								 << ", *nextReadPtr=" << (int)*((uint16_t*)info->currentReadPtr);
+	auto readPtr = info->Pointer(info->current);
+	auto blockByteCount = *reinterpret_cast<uint16_t*>(readPtr);
+	TLOG(TLVL_ReadNextDAQPacket) << "ReadNextPacket: blockByteCount=" << blockByteCount << ", buffer " << info->current.buffer
+								 << ", offset " << info->current.offset;
 	if (blockByteCount == 0 || blockByteCount == 0xcafe)
 	{
-		if (static_cast<size_t>(index) < info->buffer.size() - 1)
+		if (info->current.buffer + 1 < info->next)
 		{
 			TLOG(TLVL_ReadNextDAQPacket) << "ReadNextPacket: blockByteCount is invalid, moving to next buffer";
-			auto nextBufferPtr = *info->buffer[index + 1];
-			info->currentReadPtr = nextBufferPtr + 8;  // Offset past DMA header
-			return ReadNextPacket(engine, tmo_ms);     // Recursion
+			info->current = {info->current.buffer + 1, 8, true};  // Offset past DMA header
+			return ReadNextPacket(engine, packet, tmo_ms);        // Recursion
 		}
 		else
 		{
 			TLOG(TLVL_ReadNextDAQPacket)
 				<< "ReadNextPacket: blockByteCount is invalid, and this is the last buffer! Returning nullptr!";
-			info->currentReadPtr = nullptr;
-			// This buffer is invalid, release it!
-			// Try and see if we're merely stuck...hopefully, all the data is out of the buffers...
-			device_.read_release(engine, 1);
-			return nullptr;
+			info->current.valid = false;
+			// This buffer is invalid, release it (and the finished ones before it) through the ring, so that first
+			// stays in step with the device. Try and see if we're merely stuck...hopefully, all the data is out of the buffers...
+			ReleaseBuffers(engine);
+			return DTC_ReadStatus_Timeout;
 		}
 	}
 
-	auto test = std::make_unique<DTC_DataPacket>(info->currentReadPtr);
-	TLOG(TLVL_ReadNextDAQPacket) << "ReadNextPacket: current+blockByteCount="
-								 << (void*)(reinterpret_cast<uint8_t*>(info->currentReadPtr) + blockByteCount)
-								 << ", end of dma buffer="
-								 << (void*)(info->buffer[index][0] + GetBufferByteCount(info, index) +
-											8);  // +8 because first 8 bytes are not included in byte count
-	if (reinterpret_cast<uint8_t*>(info->currentReadPtr) + blockByteCount >
-		info->buffer[index][0] + GetBufferByteCount(info, index) + 8)
+	auto test = std::make_unique<DTC_DataPacket>(readPtr);
+	size_t bufferEnd = info->Descriptor(info->current.buffer).byteCount + 8;  // +8 because first 8 bytes are not included in byte count
+	TLOG(TLVL_ReadNextDAQPacket) << "ReadNextPacket: current+blockByteCount=" << info->current.offset + blockByteCount
+								 << ", end of dma buffer=" << bufferEnd;
+	if (info->current.offset + blockByteCount > bufferEnd)
 	{
-		blockByteCount = static_cast<uint16_t>(
-			info->buffer[index][0] + GetBufferByteCount(info, index) + 8 -
-			reinterpret_cast<uint8_t*>(info->currentReadPtr));  // +8 because first 8 bytes are not included in byte count
+		blockByteCount = static_cast<uint16_t>(bufferEnd - info->current.offset);
 		TLOG(TLVL_ReadNextDAQPacket) << "ReadNextPacket: Adjusting blockByteCount to " << blockByteCount
 									 << " due to end-of-DMA condition";
 		test->SetWord(0, blockByteCount & 0xFF);
@@ -1048,13 +1343,14 @@ std::unique_ptr<DTCLib::DTC_DataPacket> DTCLib::DTC::ReadNextPacket(const DTC_DM
 	// Update the packet pointers
 
 	// lastReadPtr_ is easy...
-	info->lastReadPtr = info->currentReadPtr;
+	info->last = info->current;
 
 	// Increment by the size of the data block
-	info->currentReadPtr = reinterpret_cast<char*>(info->currentReadPtr) + blockByteCount;
+	info->current.offset += blockByteCount;
 
 	TLOG(TLVL_ReadNextDAQPacket) << "ReadNextPacket: RETURN";
-	return test;
+	packet = std::move(test);
+	return DTC_ReadStatus_OK;
 }
 
 void DTCLib::DTC::WriteDetectorEmulatorData(mu2e_databuff_t* buf, size_t sz)
@@ -1084,53 +1380,154 @@ void DTCLib::DTC::WriteDetectorEmulatorData(mu2e_databuff_t* buf, size_t sz)
 //
 int DTCLib::DTC::ReadBuffer(const DTC_DMA_Engine& channel, int tmo_ms)
 {
-	mu2e_databuff_t* buffer;
-
-	int retry = 1;
+	DMAInfo* info;
+	if (channel == DTC_DMA_Engine_DAQ)
+		info = &daqDMAInfo_;
+	else
+		info = &dcsDMAInfo_;
 
-	// Break long timeouts into multiple 10 ms retries
-	if (tmo_ms > 10)
+	int errorCode = 1;
+	if (info->next == info->end)
 	{
-		retry = tmo_ms / 10;
-		tmo_ms = 10;
-	}
+		mu2e_databuff_t* buffers[MAX_READ_BATCH];
+		int byteCounts[MAX_READ_BATCH];
 
-	int errorCode;
-	do
-	{
-		TLOG(TLVL_ReadBuffer) << "ReadBuffer before device_.read_data tmo=" << tmo_ms << " retry=" << retry;
-		errorCode = device_.read_data(channel, reinterpret_cast<void**>(&buffer), 1);
-		// if (errorCode == 0) usleep(1000);
+		// The driver cannot hand out more buffers than its ring holds, so this only allocates on the first read
+		if (info->ring.size() < info->Held() + MAX_READ_BATCH)
+		{
+			info->deviceRingSize = device_.get_ring_size(channel);
+			info->Reserve(info->deviceRingSize + info->Held() + MAX_READ_BATCH);
+		}
+
+		int retry = 1;
+
+		// Break long timeouts into multiple 10 ms retries
+		if (tmo_ms > 10)
+		{
+			retry = tmo_ms / 10;
+			tmo_ms = 10;
+		}
+
+		do
+		{
+			TLOG(TLVL_ReadBuffer) << "ReadBuffer before device_.read_data_batch tmo=" << tmo_ms << " retry=" << retry;
+			errorCode = device_.read_data_batch(channel, reinterpret_cast<void**>(buffers), byteCounts, MAX_READ_BATCH, 1);
+		} while (retry-- > 0 && errorCode == 0);  //error code of 0 is timeout
 
-	} while (retry-- > 0 && errorCode == 0);  //error code of 0 is timeout
+		for (int ii = 0; ii < errorCode; ++ii)
+		{
+			auto& descriptor = info->Descriptor(info->end++);
+			descriptor.data = buffers[ii];
+			descriptor.byteCount = *reinterpret_cast<uint16_t*>(buffers[ii]);
+			descriptor.readBytes = byteCounts[ii];
+		}
+		info->releaseStats.held = info->Held();
+		if (info->releaseStats.held > info->releaseStats.maxHeld) info->releaseStats.maxHeld = info->releaseStats.held;
+		TLOG(TLVL_ReadBuffer) << "ReadBuffer: read_data_batch returned " << errorCode << " buffers";
+	}
 
 	if (errorCode == 0)
 	{
-		TLOG(TLVL_ReadBuffer) << "ReadBuffer: Device timeout occurred! ec=" << errorCode << ", rt=" << retry;
+		TLOG(TLVL_ReadBuffer) << "ReadBuffer: Device timeout occurred! ec=" << errorCode;
 	}
 	else if (errorCode < 0)
 	{
-		TLOG(TLVL_ERROR) << "ReadBuffer: read_data returned " << errorCode << ", throwing DTC_IOErrorException!";
-		throw DTC_IOErrorException(errorCode);
+		TLOG(TLVL_ERROR) << "ReadBuffer: read_data_batch returned " << errorCode;
+		info->readStats.lastIOError = errorCode;
 	}
 	else
 	{
-		TLOG(TLVL_ReadBuffer) << "ReadBuffer buffer_=" << (void*)buffer << " errorCode=" << errorCode << " *buffer_=0x"
-							  << std::hex << *(unsigned*)buffer;
-		if (channel == DTC_DMA_Engine_DAQ)
-		{
-			daqDMAInfo_.buffer.push_back(buffer);
-			TLOG(TLVL_ReadBuffer) << "ReadBuffer: There are now " << daqDMAInfo_.buffer.size()
-								  << " DAQ buffers held in the DTC Library";
-		}
-		else if (channel == DTC_DMA_Engine_DCS)
+		auto& descriptor = info->Descriptor(info->next++);
+		errorCode = descriptor.readBytes;
+		TLOG(TLVL_ReadBuffer) << "ReadBuffer buffer_=" << (void*)descriptor.data << " errorCode=" << errorCode << " *buffer_=0x"
+							  << std::hex << *(unsigned*)descriptor.data;
+		TLOG(TLVL_ReadBuffer) << "ReadBuffer: There are now " << info->InUse() << " "
+							  << (channel == DTC_DMA_Engine_DAQ ? "DAQ" : "DCS") << " buffers held in the DTC Library, "
+							  << info->end - info->next << " waiting";
+	}
+	return errorCode;
+}
+
+int DTCLib::DTC::ReadNextBuffer(const DTC_DMA_Engine& channel, int tmo_ms)
+{
+	auto info = channel == DTC_DMA_Engine_DAQ ? &daqDMAInfo_ : &dcsDMAInfo_;
+
+	auto sts = ReadBuffer(channel, tmo_ms);  // does return code
+	if (sts <= 0) return sts;
+
+	auto sequence = info->next - 1;
+	auto buffer = info->Descriptor(sequence).data;
+	TLOG(TLVL_ReadNextDAQPacket) << "ReadNextBuffer buffer " << sequence << "=" << (void*)buffer << " *buffer=0x" << std::hex << *(unsigned*)buffer;
+	if (IsRepeatedBuffer(info, sequence))
+	{
+		TLOG(TLVL_ReadNextDAQPacket) << "ReadNextBuffer: New buffer is one already held. Releasing buffer and returning 0";
+		info->readStats.repeatedBuffers++;
+		info->current.valid = false;
+		// We didn't actually get a new buffer...this probably means there's no more data. The device still counts it
+		// as held, so give it back in ring order with the finished buffers before it.
+		// Try and see if we're merely stuck...hopefully, all the data is out of the buffers...
+		ReleaseBuffers(channel);
+		return 0;
+	}
+
+	info->current = {sequence, 8, true};  // Past the DMA header
+	return sts;
+}
+
+bool DTCLib::DTC::IsRepeatedBuffer(DMAInfo* info, uint64_t sequence)
+{
+	// The device hands out the slots of its ring in order: sequence number s is slot s % ringSize in its
+	// (s / ringSize)-th pass over the ring. A slot can only be handed out again once it has been released, so a buffer
+	// seen in the previous sequence number, or one ring earlier, while that one is still held, is a re-read.
+	auto buffer = info->Descriptor(sequence).data;
+	if (sequence > info->first && info->Descriptor(sequence - 1).data == buffer) return true;
+	return info->deviceRingSize > 1 && sequence >= info->first + info->deviceRingSize &&
+		   info->Descriptor(sequence - info->deviceRingSize).data == buffer;
+}
+
+void DTCLib::DTC::ThrowReadError(DTC_ReadStatus status, const DTC_DMA_Engine& channel) const
+{
+	switch (status)
+	{
+		case DTC_ReadStatus_OK:
+		case DTC_ReadStatus_Timeout:
+		case DTC_ReadStatus_NotFound:
+		case DTC_ReadStatus_Incomplete:
+		case DTC_ReadStatus_NoMemory:
+			return;
+		case DTC_ReadStatus_IOError:
+			throw DTC_IOErrorException(GetReadStats(channel).lastIOError);
+		case DTC_ReadStatus_WrongPacketType:
+		case DTC_ReadStatus_BadByteCount:
+		case DTC_ReadStatus_InvalidChannel:
+			throw DTC_DataCorruptionException();
+	}
+}
+
+void DTCLib::DTC::CopyOutOfDMABuffers(std::vector<std::unique_ptr<DTC_Event>>& events)
+{
+	for (auto& event : events)
+	{
+		if (event == nullptr || event->OwnsMemory()) continue;
+		auto copy = std::make_unique<DTC_Event>(event->GetEventByteCount(), numaNode_, false);
+		memcpy(const_cast<void*>(copy->GetRawBufferPointer()), event->GetRawBufferPointer(), event->GetEventByteCount());
+		copy->SetupEvent(lazyParsing_);
+		event = std::move(copy);
+	}
+}
+
+void DTCLib::DTC_Contributors::Remove(DTC_Event& event)
+{
+	for (size_t ii = 0; ii < event.GetSubEventCount(); ++ii)
+	{
+		auto subEvent = event.GetSubEvent(ii);
+		auto& mask = links[subEvent->GetDTCID() & 0xF];
+		if (mask == 0) continue;
+		for (auto& block : subEvent->GetDataBlockViews())
 		{
-			dcsDMAInfo_.buffer.push_back(buffer);
-			TLOG(TLVL_ReadBuffer) << "ReadBuffer: There are now " << dcsDMAInfo_.buffer.size()
-								  << " DCS buffers held in the DTC Library";
+			mask &= ~(1 << block.GetLinkID());
 		}
 	}
-	return errorCode;
 }
 
 void DTCLib::DTC::ReleaseBuffers(const DTC_DMA_Engine& channel)
@@ -1143,82 +1540,158 @@ void DTCLib::DTC::ReleaseBuffers(const DTC_DMA_Engine& channel)
 		info = &dcsDMAInfo_;
 	else
 	{
-		TLOG(TLVL_ERROR) << "ReadNextPacket: Invalid DMA Engine specified!";
-		throw new DTC_DataCorruptionException();
+		TLOG(TLVL_ERROR) << "ReleaseBuffers: Invalid DMA Engine specified!";
+		throw DTC_DataCorruptionException();
 	}
 
-	auto releaseBufferCount = GetCurrentBuffer(info);
-	if (releaseBufferCount > 0)
+	// Buffers before the one being read are finished. If none is being read, all of them are; the buffers read ahead
+	// by the last batch are not, and stay held.
+	auto currentBuffer = GetCurrentBuffer(info);
+	size_t done = currentBuffer >= 0 ? currentBuffer : info->InUse();
+
+	auto firstHeld = GetFirstHeldBuffer(info);
+	if (firstHeld < done)
 	{
-		TLOG(TLVL_ReleaseBuffers) << "ReleaseBuffers releasing " << releaseBufferCount << " "
-								  << (channel == DTC_DMA_Engine_DAQ ? "DAQ" : "DCS") << " buffers.";
-		device_.read_release(channel, releaseBufferCount);
+		TLOG(TLVL_ReleaseBuffers) << "ReleaseBuffers: Buffer " << firstHeld << " is used by a DTC_EventView, keeping it and later buffers";
+		done = firstHeld;
+	}
 
-		for (int ii = 0; ii < releaseBufferCount; ++ii)
-		{
-			info->buffer.pop_front();
-		}
+	auto& stats = info->releaseStats;
+	stats.held = info->Held();
+	if (stats.held > stats.maxHeld) stats.maxHeld = stats.held;
+	stats.occupancySum += stats.held;
+	stats.occupancySamples++;
+
+	if (done > 0 && info->doneCount == 0) info->doneSince = std::chrono::steady_clock::now();
+	info->doneCount = done;
+
+	if (done > 0 && ShouldRelease(info, channel, done))
+	{
+		TLOG(TLVL_ReleaseBuffers) << "ReleaseBuffers releasing " << done << " " << (channel == DTC_DMA_Engine_DAQ ? "DAQ" : "DCS")
+								  << " buffers, " << stats.held << " held.";
+		device_.read_release(channel, done);
+		info->first += done;
+		info->doneCount = 0;
+		stats.releaseCalls++;
+		stats.buffersReleased += done;
+		stats.held -= done;
 	}
-	else
+	else if (done > 0)
 	{
-		TLOG(TLVL_ReleaseBuffers) << "ReleaseBuffers releasing ALL " << (channel == DTC_DMA_Engine_DAQ ? "DAQ" : "DCS")
-								  << " buffers.";
-		ReleaseAllBuffers(channel);
+		stats.deferred++;
 	}
 	TLOG(TLVL_ReleaseBuffers) << "ReleaseBuffers END";
 }
 
+size_t DTCLib::DTC::GetFirstHeldBuffer(DMAInfo* info)
+{
+	// Views are made in read order, so the oldest live one starts in the first held buffer
+	auto& holds = info->holds;
+	while (!holds.empty() && holds.front().first.expired()) holds.pop_front();
+	if (holds.empty() || holds.front().second >= info->next) return info->InUse();
+	return holds.front().second > info->first ? holds.front().second - info->first : 0;
+}
+
+void DTCLib::DTC::DMAInfo::Reserve(size_t capacity)
+{
+	size_t size = 2;
+	while (size < capacity) size <<= 1;
+	if (size <= ring.size()) return;
+
+	std::vector<BufferDescriptor> larger(size);
+	for (auto sequence = first; sequence < end; ++sequence) larger[sequence & (size - 1)] = Descriptor(sequence);
+	ring.swap(larger);
+}
+
+bool DTCLib::DTC::ShouldRelease(DMAInfo* info, const DTC_DMA_Engine& channel, size_t done)
+{
+	// The policy only applies to DAQ readout. DCS replies are released as soon as they are read.
+	if (channel != DTC_DMA_Engine_DAQ || releasePolicy_ == DTC_ReleasePolicy_Eager) return true;
+
+	// Whatever the policy, do not let the ring run out of room
+	auto ringSize = device_.get_ring_size(channel);
+	auto held = info->releaseStats.held;
+	if (held * 4 >= ringSize * 3) return true;
+
+	switch (releasePolicy_)
+	{
+		case DTC_ReleasePolicy_Count:
+			return done >= releaseParameter_;
+		case DTC_ReleasePolicy_Age:
+			return std::chrono::steady_clock::now() - info->doneSince >= std::chrono::microseconds(releaseParameter_);
+		case DTC_ReleasePolicy_Watermark:
+			return held * 100 >= static_cast<size_t>(releaseParameter_) * ringSize;
+		case DTC_ReleasePolicy_Eager:
+		case DTC_ReleasePolicy_Invalid:
+		default:
+			return true;
+	}
+}
+
+void DTCLib::DTC::SetReleasePolicy(DTC_ReleasePolicy policy, unsigned parameter)
+{
+	if (policy == DTC_ReleasePolicy_Invalid)
+	{
+		TLOG(TLVL_WARNING) << "SetReleasePolicy: Invalid policy, using Eager";
+		policy = DTC_ReleasePolicy_Eager;
+	}
+	TLOG(TLVL_DEBUG) << "SetReleasePolicy: " << DTC_ReleasePolicyConverter(policy) << ", parameter " << parameter;
+	releasePolicy_ = policy;
+	releaseParameter_ = parameter;
+}
+
+void DTCLib::DTC::ResetReleaseStats(const DTC_DMA_Engine& channel)
+{
+	auto info = channel == DTC_DMA_Engine_DAQ ? &daqDMAInfo_ : &dcsDMAInfo_;
+	DTC_ReleaseStats stats;
+	stats.held = info->Held();
+	info->releaseStats = stats;
+}
+
 int DTCLib::DTC::GetCurrentBuffer(DMAInfo* info)
 {
 	TLOG(TLVL_GetCurrentBuffer) << "GetCurrentBuffer BEGIN";
-	if (info->currentReadPtr == nullptr || info->buffer.size() == 0)
+	if (!info->current.valid || info->InUse() == 0)
 	{
 		TLOG(TLVL_GetCurrentBuffer) << "GetCurrentBuffer returning -1 because not currently reading a buffer";
 		return -1;
 	}
 
-	for (size_t ii = 0; ii < info->buffer.size(); ++ii)
+	auto sequence = info->current.buffer;
+	if (sequence >= info->first && sequence < info->next && info->current.offset < info->Descriptor(sequence).byteCount)
 	{
-		auto bufferptr = *info->buffer[ii];
-		uint16_t bufferSize = *reinterpret_cast<uint16_t*>(bufferptr);
-		if (info->currentReadPtr > bufferptr &&
-			info->currentReadPtr < bufferptr + bufferSize)
-		{
-			TLOG(TLVL_GetCurrentBuffer) << "Found matching buffer at index " << ii << ".";
-			return ii;
-		}
+		TLOG(TLVL_GetCurrentBuffer) << "Found matching buffer at index " << sequence - info->first << ".";
+		return sequence - info->first;
 	}
 	TLOG(TLVL_GetCurrentBuffer) << "GetCurrentBuffer returning -2: Have buffers but none match, need new";
 	return -2;
 }
 
-uint16_t DTCLib::DTC::GetBufferByteCount(DMAInfo* info, size_t index)
+template<typename Encoder>
+void DTCLib::DTC::WriteDCSBuffer(uint64_t packetSize, Encoder const& encode)
 {
-	if (index >= info->buffer.size()) return 0;
-	auto bufferptr = *info->buffer[index];
-	uint16_t bufferSize = *reinterpret_cast<uint16_t*>(bufferptr);
-	return bufferSize;
-}
-
-void DTCLib::DTC::WriteDataPacket(const DTC_DataPacket& packet)
-{
-	TLOG(TLVL_WriteDataPacket) << "WriteDataPacket: Writing packet: " << packet.toJSON();
-	mu2e_databuff_t buf;
-	uint64_t size = packet.GetSize() + sizeof(uint64_t);
-	//	uint64_t packetSize = packet.GetSize();
+	uint64_t size = packetSize + sizeof(uint64_t);
 	if (size < static_cast<uint64_t>(dmaSize_)) size = dmaSize_;
 
-	memcpy(&buf[0], &size, sizeof(uint64_t));
-	memcpy(&buf[8], packet.GetData(), packet.GetSize() * sizeof(uint8_t));
-
-	Utilities::PrintBuffer(buf, size, 0, TLVL_TRACE + 30);
-
 	auto retry = 3;
 	int errorCode;
 	do
 	{
 		TLOG(TLVL_WriteDataPacket) << "Attempting to write data...";
-		errorCode = device_.write_data(DTC_DMA_Engine_DCS, &buf, size);
+		// Serialize straight into the DMA buffer
+		auto reservation = device_.write_acquire(DTC_DMA_Engine_DCS, 1000);
+		auto buf = reinterpret_cast<uint8_t*>(reservation.data());
+		if (buf == nullptr)
+		{
+			errorCode = -1;
+		}
+		else
+		{
+			memcpy(buf, &size, sizeof(uint64_t));
+			encode(buf + 8);
+			Utilities::PrintBuffer(buf, size, 0, TLVL_TRACE + 30);
+			errorCode = reservation.commit(size);
+		}
 		TLOG(TLVL_WriteDataPacket) << "Attempted to write data, errorCode=" << errorCode << ", retries=" << retry;
 		retry--;
 	} while (retry > 0 && errorCode != 0);
@@ -1229,7 +1702,27 @@ void DTCLib::DTC::WriteDataPacket(const DTC_DataPacket& packet)
 	}
 }
 
+template<typename Packet>
+void DTCLib::DTC::WriteEncodedPacket(const Packet& packet)
+{
+	auto packetSize = packet.GetEncodedSize();
+	TLOG(TLVL_WriteDataPacket) << "WriteEncodedPacket: Writing " << packetSize << " byte packet of type " << static_cast<int>(packet.GetPacketType());
+	WriteDCSBuffer(packetSize, [&packet, packetSize](uint8_t* dest) { packet.EncodeTo(dest, packetSize); });
+}
+
+void DTCLib::DTC::WriteDataPacket(const DTC_DataPacket& packet)
+{
+	TLOG(TLVL_WriteDataPacket) << "WriteDataPacket: Writing packet: " << packet.toJSON();
+	WriteDCSBuffer(packet.GetSize(), [&packet](uint8_t* dest) { memcpy(dest, packet.GetData(), packet.GetSize()); });
+}
+
 void DTCLib::DTC::WriteDMAPacket(const DTC_DMAPacket& packet)
 {
 	WriteDataPacket(packet.ConvertToDataPacket());
 }
+
+void DTCLib::DTC::WriteDMAPacket(const DTC_DCSRequestPacket& packet) { WriteEncodedPacket(packet); }
+
+void DTCLib::DTC::WriteDMAPacket(const DTC_HeartbeatPacket& packet) { WriteEncodedPacket(packet); }
+
+void DTCLib::DTC::WriteDMAPacket(const DTC_DataRequestPacket& packet) { WriteEncodedPacket(packet); }
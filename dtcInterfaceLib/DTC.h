@@ -1,15 +1,158 @@
 #ifndef DTC_H
 #define DTC_H
 
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <deque>
+#include <functional>
 #include <list>
 #include <memory>
 #include <vector>
 
+#include "DTC_LookaheadStore.h"
 #include "DTC_Packets.h"
 #include "DTC_Registers.h"
 #include "DTC_Types.h"
+#include "mu2eaffinity.h"
 
 namespace DTCLib {
+/// <summary>
+/// Buffer release counters of a DMA channel of the DTC class
+/// </summary>
+struct DTC_ReleaseStats
+{
+	uint64_t releaseCalls{0};      ///< read_release calls issued
+	uint64_t buffersReleased{0};   ///< Buffers given back to the DTC
+	uint64_t deferred{0};          ///< Times finished buffers were kept back by the release policy
+	size_t held{0};                ///< Buffers currently held (in use, finished or read ahead)
+	size_t maxHeld{0};             ///< Largest number of buffers held at once
+	uint64_t occupancySum{0};      ///< Sum of the held-buffer samples, taken on each release decision
+	uint64_t occupancySamples{0};  ///< Number of held-buffer samples
+
+	/// <summary>
+	/// Get the mean number of held buffers seen by the release decisions
+	/// </summary>
+	/// <returns>Mean held-buffer count</returns>
+	double MeanHeld() const { return occupancySamples > 0 ? static_cast<double>(occupancySum) / occupancySamples : 0.0; }
+};
+
+/// <summary>
+/// Read outcome counters of a DMA channel of the DTC class
+/// </summary>
+struct DTC_ReadStats
+{
+	uint64_t ok{0};                ///< Reads that returned data
+	uint64_t timeouts{0};          ///< Reads that found no data
+	uint64_t ioErrors{0};          ///< Reads where the device returned an error
+	uint64_t badByteCounts{0};     ///< Events skipped because of an impossible byte count
+	uint64_t wrongPacketTypes{0};  ///< Packets skipped because they were not of the expected type
+	uint64_t notFound{0};          ///< GetData calls that did not find the requested event window tag
+	uint64_t repeatedBuffers{0};   ///< Buffers the device handed out again while they were still held
+	uint64_t incomplete{0};        ///< GetDataUntil calls that returned an event window with contributors missing
+	uint64_t noMemory{0};          ///< ReadNextDAQEventInto calls whose allocator returned no memory
+	int lastIOError{0};            ///< Return code of the last failed device read
+
+	/// <summary>
+	/// Count a read outcome
+	/// </summary>
+	/// <param name="status">Outcome of the read</param>
+	/// <returns>The status, so that it can be counted as it is returned</returns>
+	DTC_ReadStatus Count(DTC_ReadStatus status)
+	{
+		switch (status)
+		{
+			case DTC_ReadStatus_OK:
+				ok++;
+				break;
+			case DTC_ReadStatus_Timeout:
+				timeouts++;
+				break;
+			case DTC_ReadStatus_IOError:
+				ioErrors++;
+				break;
+			case DTC_ReadStatus_BadByteCount:
+				badByteCounts++;
+				break;
+			case DTC_ReadStatus_WrongPacketType:
+				wrongPacketTypes++;
+				break;
+			case DTC_ReadStatus_NotFound:
+				notFound++;
+				break;
+			case DTC_ReadStatus_Incomplete:
+				incomplete++;
+				break;
+			case DTC_ReadStatus_NoMemory:
+				noMemory++;
+				break;
+			case DTC_ReadStatus_InvalidChannel:
+				break;
+		}
+		return status;
+	}
+	/// <summary>
+	/// Get the number of reads that failed on bad data or a device error
+	/// </summary>
+	/// <returns>Error count</returns>
+	uint64_t Errors() const { return ioErrors + badByteCounts + wrongPacketTypes; }
+};
+
+/// <summary>
+/// Set of DTC links contributing to an event window, see DTC::GetDataUntil. Contributions are the Data Blocks of the
+/// Sub-Events, identified by the DTC ID of the Sub-Event and the link ID of the Data Header packet.
+/// </summary>
+struct DTC_Contributors
+{
+	std::array<uint8_t, 16> links{};  ///< Bit per DTC_Link_ID, by DTC ID
+
+	/// <summary>
+	/// Add links of a DTC to the set
+	/// </summary>
+	/// <param name="dtc">DTC ID</param>
+	/// <param name="linkMask">Bit per DTC_Link_ID (Default: 0x3F, the six ROC links)</param>
+	void Add(uint8_t dtc, uint8_t linkMask = 0x3F) { links[dtc & 0xF] |= linkMask; }
+	/// <summary>
+	/// Whether a link of a DTC is in the set
+	/// </summary>
+	/// <param name="dtc">DTC ID</param>
+	/// <param name="link">Link ID</param>
+	/// <returns>True if it is</returns>
+	bool Contains(uint8_t dtc, DTC_Link_ID link) const { return (links[dtc & 0xF] >> link) & 1; }
+	/// <summary>
+	/// Remove the links which contributed Data Blocks to an event
+	/// </summary>
+	/// <param name="event">Event</param>
+	void Remove(DTC_Event& event);
+	/// <summary>
+	/// Get the number of links in the set
+	/// </summary>
+	/// <returns>Number of DTC links</returns>
+	size_t Count() const
+	{
+		size_t count = 0;
+		for (auto mask : links) count += std::bitset<8>(mask).count();
+		return count;
+	}
+	/// <summary>
+	/// Whether the set is empty
+	/// </summary>
+	/// <returns>True if no links are in the set</returns>
+	bool Empty() const { return Count() == 0; }
+};
+
+/// <summary>
+/// Where DTC::ReadNextDAQEventInto put an event, and how it is laid out
+/// </summary>
+struct DTC_EventLayout
+{
+	uint8_t* data{nullptr};                  ///< Memory returned by the allocator, starting with the event header
+	size_t byteCount{0};                     ///< Bytes written, the inclusive event byte count
+	DTC_EventHeader header;                  ///< Event header as written (updated by the readout filter, if any)
+	size_t dmaBufferCount{0};                ///< Number of DMA buffers the event was gathered from
+	std::vector<DTC_SubEventRef> subEvents;  ///< Sub-Events and Data Blocks, with offsets from data
+};
+
 /// <summary>
 /// The DTC class implements the data transfers to the DTC card. It derives from DTC_Registers, the class representing
 /// the DTC register space.
@@ -37,11 +180,86 @@ public:
 	// Data read-out
 	/// <summary>
 	/// Reads data from the DTC, and returns all data blocks with the same event window tag. If event window tag is specified, will look
-	/// for data with that event window tag.
+	/// for data with that event window tag: events of other tags read on the way are kept in the lookahead store, and
+	/// returned by later calls asking for them (or for whatever is next). See SetLookaheadLimits.
 	/// </summary>
 	/// <param name="when">Desired event window tag for readout. Default means use whatever event window tag is next</param>
 	/// <returns>A vector of DTC_Event objects</returns>
 	std::vector<std::unique_ptr<DTC_Event>> GetData(DTC_EventWindowTag when = DTC_EventWindowTag());
+	/// <summary>
+	/// Like GetData, but events are left in the DMA buffers instead of being copied when they are larger than one buffer.
+	/// The buffers of each event are held until its DTC_EventView is destroyed, and later buffers are held with them,
+	/// so views should not be kept longer than needed. Views are invalidated by ReleaseAllBuffers.
+	/// </summary>
+	/// <param name="when">Desired event window tag for readout. Default means use whatever event window tag is next</param>
+	/// <returns>A vector of DTC_EventView objects</returns>
+	std::vector<std::unique_ptr<DTC_EventView>> GetDataViews(DTC_EventWindowTag when = DTC_EventWindowTag());
+	/// <summary>
+	/// Like GetData, but reports what happened instead of logging it. No exception is thrown for read errors, so bad
+	/// data can be skipped at full rate; the outcomes are counted in GetReadStats.
+	/// </summary>
+	/// <param name="events">Output: the events, empty unless DTC_ReadStatus_OK is returned</param>
+	/// <param name="when">Desired event window tag for readout. Default means use whatever event window tag is next</param>
+	/// <returns>DTC_ReadStatus_OK, or why no events were returned</returns>
+	DTC_ReadStatus TryGetData(std::vector<std::unique_ptr<DTC_Event>>& events, DTC_EventWindowTag when = DTC_EventWindowTag());
+	/// <summary>
+	/// Like GetDataViews, but returns a status instead of logging read errors (see TryGetData)
+	/// </summary>
+	/// <param name="views">Output: the events, empty unless DTC_ReadStatus_OK is returned</param>
+	/// <param name="when">Desired event window tag for readout. Default means use whatever event window tag is next</param>
+	/// <returns>DTC_ReadStatus_OK, or why no events were returned</returns>
+	DTC_ReadStatus TryGetDataViews(std::vector<std::unique_ptr<DTC_EventView>>& views, DTC_EventWindowTag when = DTC_EventWindowTag());
+	/// <summary>
+	/// Read the events of an event window until every expected contributor has sent data, or the deadline passes.
+	/// Returns as soon as the window is complete; otherwise waits no longer than the deadline, and reports what is missing.
+	/// Events of other windows read on the way are kept in the lookahead store (see SetLookaheadLimits); if it is
+	/// disabled, the first such event ends the read and is read again by the next call.
+	/// The deadline is approximate: each read is given the time left, rounded up to the millisecond, but a read that
+	/// has started can run past it, e.g. waiting for the rest of a continued DMA or for the event after one the readout
+	/// filter dropped.
+	/// </summary>
+	/// <param name="events">Output: the events of the window, possibly incomplete</param>
+	/// <param name="when">Desired event window tag. Default means use whatever event window tag is next</param>
+	/// <param name="expected">DTC links expected to contribute. If empty, the first event of the window completes it</param>
+	/// <param name="deadline">Time after which the read returns whatever it has</param>
+	/// <param name="missing">Output: the expected DTC links that did not contribute</param>
+	/// <returns>DTC_ReadStatus_OK if the window is complete, DTC_ReadStatus_Incomplete if events are returned with
+	/// contributors missing, DTC_ReadStatus_Timeout if no event of the window was read, or the read error</returns>
+	DTC_ReadStatus GetDataUntil(std::vector<std::unique_ptr<DTC_Event>>& events, DTC_EventWindowTag when, DTC_Contributors const& expected,
+								std::chrono::steady_clock::time_point deadline, DTC_Contributors& missing);
+
+	/// <summary>
+	/// Function called by ReadEvents for each event. The event is only valid during the call; use
+	/// DTC_EventView::ToEvent to keep a copy. Return false to stop reading.
+	/// </summary>
+	typedef std::function<bool(DTC_EventView const& event)> EventHandler;
+	/// <summary>
+	/// Read events from the DAQ channel as they arrive, and pass each one to a handler. Events are not grouped by event
+	/// window tag, and no memory is allocated per event. Buffers are given back to the DTC as the handler finishes with them.
+	/// </summary>
+	/// <param name="handler">Function called for each event</param>
+	/// <param name="maxEvents">Maximum number of events to read, 0 to read until no more data is ready</param>
+	/// <param name="tmo_ms">Time to wait for the first event, in milliseconds. Later events are only read if already there.</param>
+	/// <returns>Number of events passed to the handler</returns>
+	size_t ReadEvents(EventHandler const& handler, size_t maxEvents, int tmo_ms);
+
+	/// <summary>
+	/// Function called by ReadNextDAQEventInto with the header and byte count of the next event. It returns memory for
+	/// at least byteCount bytes, or nullptr to leave the event to a later call.
+	/// </summary>
+	typedef std::function<void*(DTC_EventHeader const& header, size_t byteCount)> EventAllocator;
+	/// <summary>
+	/// Read the next event from the DAQ channel directly into memory from an allocator, such as the payload of a
+	/// downstream fragment. Events continued over several DMA buffers are reassembled there, and the readout filter is
+	/// applied while copying, so no DTC_Event is made. The DMA buffers of the event are given back to the DTC on the
+	/// next call, or by ReleaseDAQBuffers. Events are not grouped by event window tag, and the lookahead store is not used.
+	/// </summary>
+	/// <param name="allocate">Function returning memory for the event</param>
+	/// <param name="layout">Output: where the event was written. Its vectors are reused from call to call</param>
+	/// <param name="tmo_ms">Time to wait for the event, in milliseconds</param>
+	/// <returns>DTC_ReadStatus_OK if an event was written, DTC_ReadStatus_NoMemory if the allocator returned nullptr, or
+	/// the read error</returns>
+	DTC_ReadStatus ReadNextDAQEventInto(EventAllocator const& allocate, DTC_EventLayout& layout, int tmo_ms);
 
 	/// <summary>
 	/// Read a file into the DTC memory. Will truncate the file so that it fits in the DTC memory.
@@ -189,6 +407,22 @@ public:
 	/// <param name="packet">Packet to write</param>
 	void WriteDMAPacket(const DTC_DMAPacket& packet);
 	/// <summary>
+	/// Writes a DCS Request packet to the DTC on the DCS channel. The packet is encoded directly into the DMA buffer,
+	/// without making a DTC_DataPacket.
+	/// </summary>
+	/// <param name="packet">Packet to write</param>
+	void WriteDMAPacket(const DTC_DCSRequestPacket& packet);
+	/// <summary>
+	/// Writes a Heartbeat packet to the DTC on the DCS channel, encoded directly into the DMA buffer
+	/// </summary>
+	/// <param name="packet">Packet to write</param>
+	void WriteDMAPacket(const DTC_HeartbeatPacket& packet);
+	/// <summary>
+	/// Writes a Data Request packet to the DTC on the DCS channel, encoded directly into the DMA buffer
+	/// </summary>
+	/// <param name="packet">Packet to write</param>
+	void WriteDMAPacket(const DTC_DataRequestPacket& packet);
+	/// <summary>
 	/// Writes the given data buffer to the DTC's DDR memory, via the DAQ channel.
 	/// </summary>
 	/// <param name="buf">DMA buffer to write. Must have an inclusive 64-bit byte count at the beginning, followed by an
@@ -200,12 +434,161 @@ public:
 	 * @return A DTC_Event representing the data in a single DMA, or nullptr if no data/timeout
 	*/
 	std::unique_ptr<DTC_Event> ReadNextDAQDMA(int tmo_ms );
+	/**
+	 * @brief Read the next DMA from the DAQ channel, without throwing on read errors
+	 * @param event Output: A DTC_Event representing the data in a single DMA, nullptr unless DTC_ReadStatus_OK is returned
+	 * @param tmo_ms Timeout
+	 * @return DTC_ReadStatus_OK, DTC_ReadStatus_Timeout, or the error; the rest of the DMA buffer is skipped after bad data
+	*/
+	DTC_ReadStatus TryReadNextDAQDMA(std::unique_ptr<DTC_Event>& event, int tmo_ms);
+	/**
+	 * @brief Read the next event from the DAQ channel without copying it. If no data is present, will return nullptr
+	 * @param tmo_ms Timeout
+	 * @return A DTC_EventView of the event in the DMA buffers, or nullptr if no data/timeout
+	*/
+	std::unique_ptr<DTC_EventView> ReadNextDAQEventView(int tmo_ms);
+	/**
+	 * @brief Read the next event from the DAQ channel without copying it, and without throwing on read errors
+	 * @param view Output: A DTC_EventView of the event in the DMA buffers, nullptr unless DTC_ReadStatus_OK is returned
+	 * @param tmo_ms Timeout
+	 * @return DTC_ReadStatus_OK, DTC_ReadStatus_Timeout, or the error; the rest of the DMA buffer is skipped after bad data
+	*/
+	DTC_ReadStatus TryReadNextDAQEventView(std::unique_ptr<DTC_EventView>& view, int tmo_ms);
+	/// <summary>
+	/// Give finished DAQ buffers back to the DTC, according to the release policy. Readers calling ReadNextDAQEventView
+	/// in a loop call this before each read; buffers of live DTC_EventViews are kept.
+	/// </summary>
+	void ReleaseDAQBuffers() { ReleaseBuffers(DTC_DMA_Engine_DAQ); }
 	/// <summary>
 	/// DCS packets are read one-at-a-time, this function reads the next one from the DTC
 	/// </summary>
 	/// <param name="tmo_ms">Timeout, in milliseconds, for read (will retry until timeout is expired or data received)</param>
 	/// <returns>Pointer to read DCSReplyPacket. Will be nullptr if no data available.</returns>
 	std::unique_ptr<DTC_DCSReplyPacket> ReadNextDCSPacket(int tmo_ms );
+	/// <summary>
+	/// Read the next DCS packet from the DTC, without throwing on read errors. Packets that are not DCS replies are skipped.
+	/// </summary>
+	/// <param name="packet">Output: the DCSReplyPacket, nullptr unless DTC_ReadStatus_OK is returned</param>
+	/// <param name="tmo_ms">Timeout, in milliseconds, for read (will retry until timeout is expired or data received)</param>
+	/// <returns>DTC_ReadStatus_OK, DTC_ReadStatus_Timeout, or the error</returns>
+	DTC_ReadStatus TryReadNextDCSPacket(std::unique_ptr<DTC_DCSReplyPacket>& packet, int tmo_ms);
+
+	/// <summary>
+	/// Pin the calling thread, which should be the thread reading from this DTC, to a set of CPUs.
+	/// The constructor already does this for the constructing thread if DTCLIB_READER_CPUS is set.
+	/// </summary>
+	/// <param name="cpulist">CPU list ("0-3,8"), or "numa" for the CPUs of the DTC's NUMA node (Default: DTCLIB_READER_CPUS)</param>
+	/// <returns>0 on success or when there is nothing to do, -1 on error</returns>
+	int SetReaderAffinity(std::string cpulist = "") { return mu2eaffinity::pin_reader_thread(device_.getDTCID(), cpulist); }
+	/// <summary>
+	/// Get the NUMA node on which event and copy buffers are allocated. It is found from sysfs in the constructor
+	/// (see DTCLIB_NUMA_NODE in mu2eaffinity).
+	/// </summary>
+	/// <returns>NUMA node, or -1 for no placement</returns>
+	int GetNumaNode() const { return numaNode_; }
+	/// <summary>
+	/// Set the NUMA node on which event and copy buffers are allocated
+	/// </summary>
+	/// <param name="node">NUMA node, or -1 for no placement</param>
+	void SetNumaNode(int node) { numaNode_ = node; }
+	/// <summary>
+	/// Set whether the events returned by GetData and ReadNextDAQDMA are set up in lazy mode: only the event header is
+	/// decoded, and the Sub-Events are decoded when first used (see DTC_Event::SetupEvent). Saves the decoding of
+	/// events that are only forwarded or filtered on their header. The default comes from DTCLIB_LAZY_PARSING.
+	/// </summary>
+	/// <param name="lazy">Whether to defer decoding the Sub-Events</param>
+	void SetLazyParsing(bool lazy) { lazyParsing_ = lazy; }
+	/// <summary>
+	/// Get whether events are set up in lazy mode
+	/// </summary>
+	/// <returns>True if the Sub-Events are decoded on first use</returns>
+	bool GetLazyParsing() const { return lazyParsing_; }
+	/// <summary>
+	/// Set which Sub-Events and Data Blocks the events returned by GetData and ReadNextDAQDMA keep. When the filter
+	/// does not accept everything, each event is copied from the DMA buffers with only the selected parts, decided from
+	/// the Sub-Event and Data Header packet headers; the rest is never copied or parsed. Event views and ReadEvents
+	/// are not filtered.
+	/// </summary>
+	/// <param name="filter">Readout filter</param>
+	void SetReadoutFilter(DTC_ReadoutFilter const& filter) { filter_ = filter; }
+	/// <summary>
+	/// Get the readout filter
+	/// </summary>
+	/// <returns>Readout filter</returns>
+	DTC_ReadoutFilter const& GetReadoutFilter() const { return filter_; }
+	/// <summary>
+	/// Get the counters of the readout filter
+	/// </summary>
+	/// <returns>Copy of the counters</returns>
+	DTC_FilterStats GetFilterStats() const { return filterStats_; }
+	/// <summary>
+	/// Reset the counters of the readout filter
+	/// </summary>
+	void ResetFilterStats() { filterStats_ = DTC_FilterStats(); }
+
+	/// <summary>
+	/// Set when finished DAQ buffers are given back to the DTC. The default comes from the DTCLIB_RELEASE_POLICY
+	/// environment variable, "policy[:parameter]" (e.g. "count:8", "watermark:50"), or is Eager.
+	/// Deferring policies still release once the held buffers fill three quarters of the receive ring.
+	/// </summary>
+	/// <param name="policy">Release policy</param>
+	/// <param name="parameter">Buffer count (Count), microseconds (Age) or percentage of the ring size (Watermark)</param>
+	void SetReleasePolicy(DTC_ReleasePolicy policy, unsigned parameter);
+	/// <summary>
+	/// Get the DAQ buffer release policy
+	/// </summary>
+	/// <returns>Release policy</returns>
+	DTC_ReleasePolicy GetReleasePolicy() const { return releasePolicy_; }
+	/// <summary>
+	/// Get the parameter of the DAQ buffer release policy
+	/// </summary>
+	/// <returns>Buffer count, microseconds or percentage, depending on the policy</returns>
+	unsigned GetReleasePolicyParameter() const { return releaseParameter_; }
+	/// <summary>
+	/// Get the buffer release counters of a channel
+	/// </summary>
+	/// <param name="channel">Channel</param>
+	/// <returns>Copy of the counters</returns>
+	DTC_ReleaseStats GetReleaseStats(const DTC_DMA_Engine& channel) const
+	{
+		return channel == DTC_DMA_Engine_DAQ ? daqDMAInfo_.releaseStats : dcsDMAInfo_.releaseStats;
+	}
+	/// <summary>
+	/// Reset the buffer release counters of a channel (the held count is kept)
+	/// </summary>
+	/// <param name="channel">Channel</param>
+	void ResetReleaseStats(const DTC_DMA_Engine& channel);
+	/// <summary>
+	/// Get the read outcome counters of a channel
+	/// </summary>
+	/// <param name="channel">Channel</param>
+	/// <returns>Copy of the counters</returns>
+	DTC_ReadStats GetReadStats(const DTC_DMA_Engine& channel) const
+	{
+		return channel == DTC_DMA_Engine_DAQ ? daqDMAInfo_.readStats : dcsDMAInfo_.readStats;
+	}
+	/// <summary>
+	/// Reset the read outcome counters of a channel
+	/// </summary>
+	/// <param name="channel">Channel</param>
+	void ResetReadStats(const DTC_DMA_Engine& channel) { (channel == DTC_DMA_Engine_DAQ ? daqDMAInfo_ : dcsDMAInfo_).readStats = DTC_ReadStats(); }
+
+	/// <summary>
+	/// Set the limits of the lookahead store, which keeps the events GetData reads ahead of the event window tag it
+	/// was asked for. GetData stops reading ahead once the store has to drop events to make room.
+	/// </summary>
+	/// <param name="maxBytes">Limit on the bytes of the stored events, 0 to disable reading ahead (Default: 32 MB)</param>
+	/// <param name="maxAge">Time after which stored events are dropped (Default: 1 s)</param>
+	void SetLookaheadLimits(size_t maxBytes, std::chrono::microseconds maxAge) { lookahead_.SetLimits(maxBytes, maxAge); }
+	/// <summary>
+	/// Get the counters of the lookahead store
+	/// </summary>
+	/// <returns>Copy of the counters</returns>
+	DTC_LookaheadStats GetLookaheadStats() const { return lookahead_.GetStats(); }
+	/// <summary>
+	/// Drop the events in the lookahead store
+	/// </summary>
+	void ClearLookahead() { lookahead_.Clear(); }
 
 	/// <summary>
 	/// Releases all buffers to the hardware, from both the DAQ and DCS channels
@@ -222,43 +605,180 @@ public:
 	/// <param name="channel">Channel to release</param>
 	void ReleaseAllBuffers(const DTC_DMA_Engine& channel)
 	{
+		DMAInfo* info = nullptr;
 		if (channel == DTC_DMA_Engine_DAQ)
-			daqDMAInfo_.buffer.clear();
+			info = &daqDMAInfo_;
 		else if (channel == DTC_DMA_Engine_DCS)
-			dcsDMAInfo_.buffer.clear();
+			info = &dcsDMAInfo_;
+		if (info != nullptr)
+		{
+			info->releaseStats.releaseCalls++;
+			info->releaseStats.buffersReleased += info->Held();
+			info->releaseStats.held = 0;
+			info->Clear();
+		}
 		device_.release_all(channel);
 	}
 
 private:
-	std::unique_ptr<DTC_DataPacket> ReadNextPacket(const DTC_DMA_Engine& channel, int tmo_ms);
+	template<class EventType>
+	DTC_ReadStatus GetEvents(std::vector<std::unique_ptr<EventType>>& output, DTC_EventWindowTag when,
+							 DTC_ReadStatus (DTC::*readNext)(std::unique_ptr<EventType>&, int));
+	/// <summary>
+	/// Find the next event on the DAQ channel, reading further buffers if it is continued
+	/// </summary>
+	/// <param name="segments">Output: pieces of the event in the DMA buffers</param>
+	/// <param name="firstBuffer">Output: sequence number of the buffer the event starts in</param>
+	/// <param name="tmo_ms">Timeout</param>
+	/// <returns>DTC_ReadStatus_OK, DTC_ReadStatus_Timeout or the error, counted in the DAQ read stats</returns>
+	DTC_ReadStatus ReadNextDAQSegments(std::vector<DTC_EventSegment>& segments, uint64_t& firstBuffer, int tmo_ms);
+	DTC_ReadStatus ReadNextPacket(const DTC_DMA_Engine& channel, std::unique_ptr<DTC_DataPacket>& packet, int tmo_ms);
+	/// <summary>
+	/// Obtain the next buffer of a channel from the device
+	/// </summary>
+	/// <param name="channel">Channel</param>
+	/// <param name="tmo_ms">Timeout</param>
+	/// <returns>Size of the buffer, 0 on timeout, or the negative error code of the device</returns>
 	int ReadBuffer(const DTC_DMA_Engine& channel, int tmo_ms);
 	/// <summary>
+	/// Throw the exception the exception-throwing readout functions use for a read error
+	/// </summary>
+	/// <param name="status">Read status; nothing is thrown for DTC_ReadStatus_OK and DTC_ReadStatus_Timeout</param>
+	/// <param name="channel">Channel that was read</param>
+	void ThrowReadError(DTC_ReadStatus status, const DTC_DMA_Engine& channel) const;
+	/// <summary>
+	/// Replace the events which point into DMA buffers by copies, so that they stay valid after the buffers are released
+	/// </summary>
+	/// <param name="events">Events</param>
+	void CopyOutOfDMABuffers(std::vector<std::unique_ptr<DTC_Event>>& events);
+	/// <summary>
+	/// Fill in the Sub-Events and Data Blocks of an event written by ReadNextDAQEventInto, from its headers
+	/// </summary>
+	/// <param name="layout">Layout with data and byteCount set</param>
+	static void DescribeEvent(DTC_EventLayout& layout);
+	/// <summary>
 	/// This function releases all buffers except for the one containing currentReadPtr. Should only be called when done
 	/// with data in other buffers!
 	/// </summary>
 	/// <param name="channel">Channel to release</param>
 	void ReleaseBuffers(const DTC_DMA_Engine& channel);
 	void WriteDataPacket(const DTC_DataPacket& packet);
+	/// <summary>
+	/// Write one packet to a DMA buffer of the DCS channel, retrying on failure
+	/// </summary>
+	/// <param name="packetSize">Size of the packet, in bytes</param>
+	/// <param name="encode">Called with the start of the packet in the DMA buffer, to write it there</param>
+	template<typename Encoder>
+	void WriteDCSBuffer(uint64_t packetSize, Encoder const& encode);
+	/// <summary>
+	/// Write a packet with an EncodeTo function (see DTC_HeartbeatPacket::EncodeTo) to the DCS channel
+	/// </summary>
+	/// <param name="packet">Packet to write</param>
+	template<typename Packet>
+	void WriteEncodedPacket(const Packet& packet);
 
+	/// <summary>
+	/// Maximum number of buffers obtained from the device by a single ReadBuffer batch
+	/// </summary>
+	static const unsigned MAX_READ_BATCH = 32;
+
+	/// <summary>
+	/// Position in the buffers held for a DMA channel
+	/// </summary>
+	struct ReadPosition
+	{
+		uint64_t buffer;  // Sequence number of the buffer
+		size_t offset;    // Byte offset from the start of the buffer
+		bool valid;       // False when no buffer is being read
+	};
+
+	/// <summary>
+	/// A DMA buffer held by the library
+	/// </summary>
+	struct BufferDescriptor
+	{
+		mu2e_databuff_t* data;  // Buffer in the DMA ring
+		uint16_t byteCount;     // DMA byte count from the buffer header, read once when the buffer is obtained
+		int readBytes;          // Size returned by the driver
+	};
+
+	/// <summary>
+	/// Buffers obtained from a channel are numbered in order, and their descriptors are kept in a ring indexed by
+	/// that sequence number. Buffers [first, next) are in use, [next, end) were read ahead by the last batch.
+	/// </summary>
 	struct DMAInfo
 	{
-		std::deque<mu2e_databuff_t*> buffer;
-		uint32_t bufferIndex;
-		void* currentReadPtr;
-		void* lastReadPtr;
+		std::vector<BufferDescriptor> ring;  // Power-of-two size, larger than the DMA ring
+		uint64_t first;
+		uint64_t next;
+		uint64_t end;
+		std::deque<std::pair<std::weak_ptr<const void>, uint64_t>> holds;  // Live DTC_EventViews and their first buffer, oldest first
+		size_t deviceRingSize;  // Buffers in the device's receive ring, to recognize buffers handed out twice
+		ReadPosition current;  // Where the next packet or event starts
+		ReadPosition last;     // Start of the last packet or event read
+		size_t doneCount;                                   // Finished buffers from first on, kept by the release policy
+		std::chrono::steady_clock::time_point doneSince;    // When the oldest of them was finished
+		DTC_ReleaseStats releaseStats;
+		DTC_ReadStats readStats;
 		DMAInfo()
-			: buffer(), bufferIndex(0), currentReadPtr(nullptr), lastReadPtr(nullptr) {}
+			: ring(), first(0), next(0), end(0), holds(), deviceRingSize(0), current{0, 0, false}, last{0, 0, false}, doneCount(0), doneSince(), releaseStats(), readStats() {}
 		~DMAInfo()
 		{
-			buffer.clear();
-			currentReadPtr = nullptr;
-			lastReadPtr = nullptr;
+			ring.clear();
+			holds.clear();
+		}
+
+		size_t InUse() const { return next - first; }
+		size_t Held() const { return end - first; }
+		BufferDescriptor& Descriptor(uint64_t sequence) { return ring[sequence & (ring.size() - 1)]; }
+		uint8_t* Pointer(ReadPosition const& position) { return position.valid ? *Descriptor(position.buffer).data + position.offset : nullptr; }
+		/// <summary>
+		/// Forget all buffers, after they have been given back to the DTC
+		/// </summary>
+		void Clear()
+		{
+			first = next = end;
+			holds.clear();
+			current.valid = false;
+			last.valid = false;
+			doneCount = 0;
 		}
+		/// <summary>
+		/// Make room for at least capacity descriptors, keeping the held buffers
+		/// </summary>
+		/// <param name="capacity">Number of descriptors</param>
+		void Reserve(size_t capacity);
 	};
 	int GetCurrentBuffer(DMAInfo* info);
-	uint16_t GetBufferByteCount(DMAInfo* info, size_t index);
+	bool ShouldRelease(DMAInfo* info, const DTC_DMA_Engine& channel, size_t done);
+	size_t GetFirstHeldBuffer(DMAInfo* info);
+	/// <summary>
+	/// Obtain the next buffer of a channel and start reading it
+	/// </summary>
+	/// <param name="channel">Channel</param>
+	/// <param name="tmo_ms">Timeout</param>
+	/// <returns>Size of the buffer, 0 if no new buffer was obtained, or the negative error code of the device</returns>
+	int ReadNextBuffer(const DTC_DMA_Engine& channel, int tmo_ms);
+	/// <summary>
+	/// Whether the buffer obtained with a sequence number is one which is already held, from its ring position.
+	/// The DMA buffers are only read, never marked, so that the receive ring can be mapped read-only.
+	/// </summary>
+	/// <param name="info">DMAInfo of the channel</param>
+	/// <param name="sequence">Sequence number of the new buffer</param>
+	/// <returns>True if the buffer was handed out twice</returns>
+	bool IsRepeatedBuffer(DMAInfo* info, uint64_t sequence);
 	DMAInfo daqDMAInfo_;
 	DMAInfo dcsDMAInfo_;
+	std::vector<DTC_EventSegment> streamSegments_;  // Reused by ReadEvents
+	DTC_EventView streamView_;
+	std::vector<DTC_SubEventRef> filteredSubEvents_;  // Reused by ReadNextDAQEventInto
+	DTC_LookaheadStore lookahead_;  // Events read by GetData ahead of the requested event window tag
+	int numaNode_;
+	bool lazyParsing_;
+	DTC_ReadoutFilter filter_;
+	DTC_FilterStats filterStats_;
+	DTC_ReleasePolicy releasePolicy_;
+	unsigned releaseParameter_;
 };
 }  // namespace DTCLib
 #endif
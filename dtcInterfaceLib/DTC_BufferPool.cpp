@@ -0,0 +1,183 @@
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "DTC_BufferPool"
+
+#include "DTC_BufferPool.h"
+
+#include <cstdlib>
+#include <new>
+
+#include "mu2eaffinity.h"
+
+DTCLib::DTC_PooledBuffer::DTC_PooledBuffer(const DTC_PooledBuffer& other)
+	: block_(other.block_)
+{
+	if (block_ != nullptr) block_->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+DTCLib::DTC_PooledBuffer::~DTC_PooledBuffer()
+{
+	if (block_ != nullptr && block_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) block_->pool->Return(block_);
+}
+
+DTCLib::DTC_BufferPool::DTC_BufferPool(size_t maxCachedBytes)
+	: maxCachedBytes_(maxCachedBytes)
+	, cachedBytes_(0)
+	, footprint_(0)
+	, peakFootprint_(0)
+	, hits_(0)
+	, misses_(0)
+	, unpooled_(0)
+	, trimmed_(0)
+{
+}
+
+DTCLib::DTC_BufferPool::~DTC_BufferPool()
+{
+	TrimTo(0);
+	if (footprint_ > 0) TLOG(TLVL_WARNING) << "~DTC_BufferPool: " << footprint_ << " bytes of buffers are still in use";
+}
+
+DTCLib::DTC_BufferPool& DTCLib::DTC_BufferPool::Instance()
+{
+	// Not destroyed at exit, so that events released by static destructors can still go back to it
+	static auto instance = [] {
+		size_t megabytes = 256;
+		auto sizeE = getenv("DTCLIB_EVENT_POOL_MB");
+		if (sizeE != nullptr) megabytes = strtoul(sizeE, nullptr, 0);
+		TLOG(TLVL_DEBUG) << "Instance: Caching up to " << megabytes << " MB of event buffers";
+		return new DTC_BufferPool(megabytes << 20);
+	}();
+	return *instance;
+}
+
+int DTCLib::DTC_BufferPool::SizeClass(size_t bytes)
+{
+	int sizeClass = 0;
+	for (size_t classSize = MIN_CLASS_SIZE; classSize < bytes; classSize <<= 1)
+	{
+		if (++sizeClass == SIZE_CLASSES) return -1;
+	}
+	return sizeClass;
+}
+
+DTCLib::DTC_PooledBuffer DTCLib::DTC_BufferPool::Get(size_t bytes, int numaNode)
+{
+	if (numaNode < -1) numaNode = -1;
+	auto sizeClass = numaNode < MAX_NUMA_NODES ? SizeClass(bytes) : -1;
+
+	Block* block = nullptr;
+	if (sizeClass >= 0)
+	{
+		auto& freeList = GetFreeList(numaNode, sizeClass);
+		std::lock_guard<std::mutex> lk(freeList.mutex);
+		if (!freeList.blocks.empty())
+		{
+			block = freeList.blocks.back();
+			freeList.blocks.pop_back();
+		}
+	}
+
+	if (block != nullptr)
+	{
+		cachedBytes_.fetch_sub(block->capacity, std::memory_order_relaxed);
+		hits_.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		auto capacity = sizeClass >= 0 ? MIN_CLASS_SIZE << sizeClass : bytes;
+		auto memory = mu2eaffinity::allocate(DTC_PooledBuffer::HEADER_SIZE + capacity, numaNode);
+		if (memory == nullptr) throw std::bad_alloc();
+		block = new (memory) Block();
+		block->pool = this;
+		block->capacity = capacity;
+		block->numaNode = numaNode;
+		block->sizeClass = sizeClass;
+		(sizeClass >= 0 ? misses_ : unpooled_).fetch_add(1, std::memory_order_relaxed);
+
+		auto footprint = footprint_.fetch_add(DTC_PooledBuffer::HEADER_SIZE + capacity, std::memory_order_relaxed) + DTC_PooledBuffer::HEADER_SIZE + capacity;
+		auto peak = peakFootprint_.load(std::memory_order_relaxed);
+		while (footprint > peak && !peakFootprint_.compare_exchange_weak(peak, footprint, std::memory_order_relaxed))
+		{
+		}
+	}
+	block->refs.store(1, std::memory_order_relaxed);
+	block->size = bytes;
+	return DTC_PooledBuffer(block);
+}
+
+void DTCLib::DTC_BufferPool::Return(Block* block)
+{
+	// Reserve room in the cache before caching the buffer, so that concurrent returns cannot overshoot the limit
+	auto cached = cachedBytes_.load(std::memory_order_relaxed);
+	do
+	{
+		if (block->sizeClass < 0 || cached + block->capacity > maxCachedBytes_.load(std::memory_order_relaxed))
+		{
+			if (block->sizeClass >= 0) trimmed_.fetch_add(1, std::memory_order_relaxed);
+			Free(block);
+			return;
+		}
+	} while (!cachedBytes_.compare_exchange_weak(cached, cached + block->capacity, std::memory_order_relaxed));
+
+	auto& freeList = GetFreeList(block->numaNode, block->sizeClass);
+	std::lock_guard<std::mutex> lk(freeList.mutex);
+	freeList.blocks.push_back(block);
+}
+
+void DTCLib::DTC_BufferPool::Free(Block* block)
+{
+	auto bytes = DTC_PooledBuffer::HEADER_SIZE + block->capacity;
+	auto numaNode = block->numaNode;
+	block->~Block();
+	mu2eaffinity::deallocate(block, bytes, numaNode);
+	footprint_.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void DTCLib::DTC_BufferPool::TrimTo(size_t maxCachedBytes)
+{
+	// Free the largest buffers first
+	for (int sizeClass = SIZE_CLASSES - 1; sizeClass >= 0; --sizeClass)
+	{
+		for (int node = -1; node < MAX_NUMA_NODES; ++node)
+		{
+			auto& freeList = GetFreeList(node, sizeClass);
+			std::lock_guard<std::mutex> lk(freeList.mutex);
+			while (!freeList.blocks.empty() && cachedBytes_.load(std::memory_order_relaxed) > maxCachedBytes)
+			{
+				auto block = freeList.blocks.back();
+				freeList.blocks.pop_back();
+				cachedBytes_.fetch_sub(block->capacity, std::memory_order_relaxed);
+				Free(block);
+			}
+		}
+	}
+}
+
+void DTCLib::DTC_BufferPool::SetMaxCachedBytes(size_t maxCachedBytes)
+{
+	maxCachedBytes_ = maxCachedBytes;
+	TrimTo(maxCachedBytes);
+}
+
+DTCLib::DTC_BufferPoolStats DTCLib::DTC_BufferPool::GetStats() const
+{
+	DTC_BufferPoolStats stats;
+	stats.hits = hits_.load(std::memory_order_relaxed);
+	stats.misses = misses_.load(std::memory_order_relaxed);
+	stats.unpooled = unpooled_.load(std::memory_order_relaxed);
+	stats.trimmed = trimmed_.load(std::memory_order_relaxed);
+	stats.footprint = footprint_.load(std::memory_order_relaxed);
+	stats.peakFootprint = peakFootprint_.load(std::memory_order_relaxed);
+	stats.cachedBytes = cachedBytes_.load(std::memory_order_relaxed);
+	stats.maxCachedBytes = maxCachedBytes_.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void DTCLib::DTC_BufferPool::ResetStats()
+{
+	hits_ = 0;
+	misses_ = 0;
+	unpooled_ = 0;
+	trimmed_ = 0;
+	peakFootprint_ = footprint_.load();
+}
@@ -0,0 +1,174 @@
+#ifndef DTC_BUFFERPOOL_H
+#define DTC_BUFFERPOOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace DTCLib {
+class DTC_BufferPool;
+
+/// <summary>
+/// Counters of a DTC_BufferPool
+/// </summary>
+struct DTC_BufferPoolStats
+{
+	uint64_t hits{0};          ///< Buffers served from a free list
+	uint64_t misses{0};        ///< Buffers that had to be allocated
+	uint64_t unpooled{0};      ///< Requests the pool does not cache (too large, or an unknown NUMA node)
+	uint64_t trimmed{0};       ///< Returned buffers freed because the cache was full
+	size_t footprint{0};       ///< Bytes allocated by the pool, in use or cached
+	size_t peakFootprint{0};   ///< Largest footprint since the last ResetStats
+	size_t cachedBytes{0};     ///< Bytes held in the free lists
+	size_t maxCachedBytes{0};  ///< Limit on cachedBytes
+};
+
+/// <summary>
+/// A buffer from a DTC_BufferPool. Copies share the buffer, which goes back to its pool when the last copy is
+/// destroyed. The reference count is kept in front of the data, so a buffer costs no allocation beyond its own.
+/// The contents of a recycled buffer are not cleared.
+/// </summary>
+class DTC_PooledBuffer
+{
+public:
+	DTC_PooledBuffer()
+		: block_(nullptr) {}
+	DTC_PooledBuffer(const DTC_PooledBuffer& other);
+	DTC_PooledBuffer(DTC_PooledBuffer&& other) noexcept
+		: block_(other.block_) { other.block_ = nullptr; }
+	DTC_PooledBuffer& operator=(DTC_PooledBuffer other) noexcept
+	{
+		std::swap(block_, other.block_);
+		return *this;
+	}
+	~DTC_PooledBuffer();
+
+	/// <summary>
+	/// Get the data of the buffer
+	/// </summary>
+	/// <returns>Pointer to the data, nullptr for an empty handle</returns>
+	uint8_t* data() const { return block_ != nullptr ? reinterpret_cast<uint8_t*>(block_) + HEADER_SIZE : nullptr; }
+	/// <summary>
+	/// Get the size that was requested for the buffer
+	/// </summary>
+	/// <returns>Size in bytes</returns>
+	size_t size() const { return block_ != nullptr ? block_->size : 0; }
+	explicit operator bool() const { return block_ != nullptr; }
+
+private:
+	friend class DTC_BufferPool;
+
+	struct Block
+	{
+		std::atomic<unsigned> refs;
+		DTC_BufferPool* pool;
+		size_t size;      // Requested size
+		size_t capacity;  // Size of the data area
+		int numaNode;
+		int sizeClass;  // -1 if the block is not cached when released
+	};
+	/// Data starts on its own cache line
+	static const size_t HEADER_SIZE = 64;
+	static_assert(sizeof(Block) <= HEADER_SIZE, "DTC_PooledBuffer::Block does not fit in its header");
+
+	explicit DTC_PooledBuffer(Block* block)
+		: block_(block) {}
+
+	Block* block_;
+};
+
+/// <summary>
+/// Thread-safe pool of event buffers, in power-of-two size classes from 256 bytes to 16 MB (the largest event), with
+/// separate free lists per NUMA node. Buffers go back to their free list when their last DTC_PooledBuffer handle is
+/// destroyed; the free lists hold at most a configurable number of bytes.
+/// A pool must outlive the buffers taken from it. Instance() is never destroyed.
+/// </summary>
+class DTC_BufferPool
+{
+public:
+	static const size_t MIN_CLASS_SIZE = 256;
+	static const int SIZE_CLASSES = 17;
+	static const int MAX_NUMA_NODES = 8;
+
+	/// <summary>
+	/// Construct a DTC_BufferPool
+	/// </summary>
+	/// <param name="maxCachedBytes">Most bytes to keep in the free lists, 0 to not cache at all</param>
+	explicit DTC_BufferPool(size_t maxCachedBytes);
+	~DTC_BufferPool();
+
+	DTC_BufferPool(const DTC_BufferPool&) = delete;
+	DTC_BufferPool& operator=(const DTC_BufferPool&) = delete;
+
+	/// <summary>
+	/// Get the process-wide pool used by DTC_Event. Its cache limit is DTCLIB_EVENT_POOL_MB megabytes (Default: 256).
+	/// </summary>
+	/// <returns>Shared DTC_BufferPool</returns>
+	static DTC_BufferPool& Instance();
+
+	/// <summary>
+	/// Get a buffer
+	/// </summary>
+	/// <param name="bytes">Size of the buffer</param>
+	/// <param name="numaNode">NUMA node the buffer should be on, -1 for no placement (Default: -1)</param>
+	/// <returns>Buffer handle. Throws std::bad_alloc if memory cannot be allocated</returns>
+	DTC_PooledBuffer Get(size_t bytes, int numaNode = -1);
+
+	/// <summary>
+	/// Get the counters of the pool
+	/// </summary>
+	/// <returns>Copy of the counters</returns>
+	DTC_BufferPoolStats GetStats() const;
+	/// <summary>
+	/// Reset the hit, miss, unpooled and trimmed counters, and set the peak footprint to the current footprint
+	/// </summary>
+	void ResetStats();
+
+	/// <summary>
+	/// Set the most bytes to keep in the free lists. Cached buffers above the new limit are freed.
+	/// </summary>
+	/// <param name="maxCachedBytes">Limit, 0 to not cache at all</param>
+	void SetMaxCachedBytes(size_t maxCachedBytes);
+	/// <summary>
+	/// Free all cached buffers
+	/// </summary>
+	void Trim() { TrimTo(0); }
+
+	/// <summary>
+	/// Find the size class of a buffer size
+	/// </summary>
+	/// <param name="bytes">Buffer size</param>
+	/// <returns>Size class, -1 if the size is larger than the largest class</returns>
+	static int SizeClass(size_t bytes);
+
+private:
+	friend class DTC_PooledBuffer;
+	typedef DTC_PooledBuffer::Block Block;
+
+	struct FreeList
+	{
+		std::mutex mutex;
+		std::vector<Block*> blocks;
+	};
+
+	void Return(Block* block);
+	void Free(Block* block);
+	void TrimTo(size_t maxCachedBytes);
+	FreeList& GetFreeList(int numaNode, int sizeClass) { return freeLists_[numaNode + 1][sizeClass]; }
+
+	FreeList freeLists_[MAX_NUMA_NODES + 1][SIZE_CLASSES];
+	std::atomic<size_t> maxCachedBytes_;
+	std::atomic<size_t> cachedBytes_;
+	std::atomic<size_t> footprint_;
+	std::atomic<size_t> peakFootprint_;
+	std::atomic<uint64_t> hits_;
+	std::atomic<uint64_t> misses_;
+	std::atomic<uint64_t> unpooled_;
+	std::atomic<uint64_t> trimmed_;
+};
+}  // namespace DTCLib
+
+#endif  // DTC_BUFFERPOOL_H
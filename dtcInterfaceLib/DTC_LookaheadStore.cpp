@@ -0,0 +1,124 @@
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "DTC_LookaheadStore"
+
+#define TLVL_Store TLVL_DEBUG + 5
+
+#include "DTC_LookaheadStore.h"
+
+DTCLib::DTC_LookaheadStore::DTC_LookaheadStore(size_t maxBytes, std::chrono::microseconds maxAge)
+	: maxBytes_(maxBytes), maxAge_(maxAge), entries_(), index_(), bytes_(0), stats_() {}
+
+void DTCLib::DTC_LookaheadStore::SetLimits(size_t maxBytes, std::chrono::microseconds maxAge)
+{
+	TLOG(TLVL_DEBUG) << "SetLimits: " << maxBytes << " bytes, " << maxAge.count() << " us";
+	maxBytes_ = maxBytes;
+	maxAge_ = maxAge;
+	Expire(std::chrono::steady_clock::now());
+	while (bytes_ > maxBytes_ && !entries_.empty())
+	{
+		stats_.evictedForSize++;
+		Drop(entries_.begin());
+	}
+}
+
+size_t DTCLib::DTC_LookaheadStore::Store(uint64_t tag, std::vector<std::unique_ptr<DTC_Event>>& events)
+{
+	auto now = std::chrono::steady_clock::now();
+	auto evicted = stats_.evictedForSize + stats_.evictedForAge;
+	Expire(now);
+
+	auto it = index_.find(tag);
+	if (it == index_.end())
+	{
+		entries_.push_back(Entry{tag, {}, 0, now});
+		it = index_.emplace(tag, std::prev(entries_.end())).first;
+	}
+	auto& entry = *it->second;
+	for (auto& event : events)
+	{
+		if (event == nullptr) continue;
+		entry.bytes += event->GetEventByteCount();
+		bytes_ += event->GetEventByteCount();
+		entry.events.push_back(std::move(event));
+		stats_.stored++;
+	}
+	events.clear();
+	TLOG(TLVL_Store) << "Store: tag 0x" << std::hex << tag << std::dec << " now has " << entry.events.size() << " events, "
+					 << bytes_ << " bytes in " << entries_.size() << " tags";
+	if (bytes_ > stats_.maxBytesHeld) stats_.maxBytesHeld = bytes_;
+
+	while (bytes_ > maxBytes_ && !entries_.empty())
+	{
+		TLOG(TLVL_DEBUG) << "Store: Over " << maxBytes_ << " bytes, dropping tag 0x" << std::hex << entries_.front().tag;
+		stats_.evictedForSize++;
+		Drop(entries_.begin());
+	}
+	return stats_.evictedForSize + stats_.evictedForAge - evicted;
+}
+
+bool DTCLib::DTC_LookaheadStore::Take(uint64_t tag, std::vector<std::unique_ptr<DTC_Event>>& events)
+{
+	if (entries_.empty()) return false;
+	Expire(std::chrono::steady_clock::now());
+
+	EntryIter entry;
+	if (tag == 0)
+	{
+		if (entries_.empty()) return false;
+		entry = entries_.begin();
+	}
+	else
+	{
+		auto it = index_.find(tag);
+		if (it == index_.end()) return false;
+		entry = it->second;
+	}
+
+	TLOG(TLVL_Store) << "Take: tag 0x" << std::hex << entry->tag << std::dec << ", " << entry->events.size() << " events";
+	for (auto& event : entry->events) events.push_back(std::move(event));
+	bytes_ -= entry->bytes;
+	index_.erase(entry->tag);
+	entries_.erase(entry);
+	stats_.hits++;
+	return true;
+}
+
+void DTCLib::DTC_LookaheadStore::Clear()
+{
+	entries_.clear();
+	index_.clear();
+	bytes_ = 0;
+}
+
+DTCLib::DTC_LookaheadStats DTCLib::DTC_LookaheadStore::GetStats() const
+{
+	auto stats = stats_;
+	stats.tags = entries_.size();
+	stats.bytes = bytes_;
+	return stats;
+}
+
+void DTCLib::DTC_LookaheadStore::ResetStats()
+{
+	stats_ = DTC_LookaheadStats();
+	stats_.maxBytesHeld = bytes_;
+}
+
+void DTCLib::DTC_LookaheadStore::Expire(std::chrono::steady_clock::time_point now)
+{
+	// Entries are in storage order, so the expired ones are at the front
+	while (!entries_.empty() && now - entries_.front().stored > maxAge_)
+	{
+		TLOG(TLVL_DEBUG) << "Expire: Dropping tag 0x" << std::hex << entries_.front().tag << ", stored too long ago";
+		stats_.evictedForAge++;
+		Drop(entries_.begin());
+	}
+}
+
+void DTCLib::DTC_LookaheadStore::Drop(EntryIter entry)
+{
+	stats_.eventsEvicted += entry->events.size();
+	bytes_ -= entry->bytes;
+	index_.erase(entry->tag);
+	entries_.erase(entry);
+}
@@ -0,0 +1,129 @@
+#ifndef DTC_LOOKAHEADSTORE_H
+#define DTC_LOOKAHEADSTORE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "DTC_Packets.h"
+
+namespace DTCLib {
+/// <summary>
+/// Counters of a DTC_LookaheadStore
+/// </summary>
+struct DTC_LookaheadStats
+{
+	uint64_t stored{0};          ///< Events put in the store
+	uint64_t hits{0};            ///< Requests answered from the store
+	uint64_t evictedForSize{0};  ///< Event window tags dropped to stay within the memory limit
+	uint64_t evictedForAge{0};   ///< Event window tags dropped because they were older than the age limit
+	uint64_t eventsEvicted{0};   ///< Events dropped by either kind of eviction
+	size_t tags{0};              ///< Event window tags currently stored
+	size_t bytes{0};             ///< Bytes of the events currently stored
+	size_t maxBytesHeld{0};      ///< Largest number of bytes stored at once
+};
+
+/// <summary>
+/// Holds events read ahead of the one asked for, so that they can be returned later by event window tag.
+/// Lookup by tag is a hash table access; the tags are also kept in the order they were stored, so the oldest can be
+/// dropped first when the memory or age limit is reached.
+/// Not thread-safe: it belongs to the thread reading the DTC.
+/// </summary>
+class DTC_LookaheadStore
+{
+public:
+	/// <summary>
+	/// Construct a DTC_LookaheadStore
+	/// </summary>
+	/// <param name="maxBytes">Limit on the bytes of the stored events, 0 to disable the store (Default: 32 MB)</param>
+	/// <param name="maxAge">Time after which stored events are dropped (Default: 1 s)</param>
+	explicit DTC_LookaheadStore(size_t maxBytes = 32 * 1024 * 1024, std::chrono::microseconds maxAge = std::chrono::seconds(1));
+
+	DTC_LookaheadStore(const DTC_LookaheadStore&) = delete;
+	DTC_LookaheadStore& operator=(const DTC_LookaheadStore&) = delete;
+
+	/// <summary>
+	/// Set the memory and age limits, dropping the events beyond them
+	/// </summary>
+	/// <param name="maxBytes">Limit on the bytes of the stored events, 0 to disable the store</param>
+	/// <param name="maxAge">Time after which stored events are dropped</param>
+	void SetLimits(size_t maxBytes, std::chrono::microseconds maxAge);
+	/// <summary>
+	/// Get the memory limit
+	/// </summary>
+	/// <returns>Limit in bytes, 0 if the store is disabled</returns>
+	size_t GetMaxBytes() const { return maxBytes_; }
+	/// <summary>
+	/// Get the age limit
+	/// </summary>
+	/// <returns>Age limit</returns>
+	std::chrono::microseconds GetMaxAge() const { return maxAge_; }
+	/// <summary>
+	/// Whether events may be stored
+	/// </summary>
+	/// <returns>True if the memory limit is not 0</returns>
+	bool Enabled() const { return maxBytes_ > 0; }
+
+	/// <summary>
+	/// Store events of one event window tag, after any already stored for it. The oldest tags are then dropped
+	/// until the store is within its limits, which may include these events if they alone are over the memory limit.
+	/// </summary>
+	/// <param name="tag">Event window tag of the events</param>
+	/// <param name="events">Events, moved from</param>
+	/// <returns>Number of event window tags dropped</returns>
+	size_t Store(uint64_t tag, std::vector<std::unique_ptr<DTC_Event>>& events);
+	/// <summary>
+	/// Take the events of an event window tag out of the store
+	/// </summary>
+	/// <param name="tag">Event window tag, 0 for the oldest tag in the store</param>
+	/// <param name="events">Output: the events, appended</param>
+	/// <returns>True if events were found</returns>
+	bool Take(uint64_t tag, std::vector<std::unique_ptr<DTC_Event>>& events);
+	/// <summary>
+	/// Whether events of an event window tag are stored
+	/// </summary>
+	/// <param name="tag">Event window tag</param>
+	/// <returns>True if found</returns>
+	bool Contains(uint64_t tag) const { return index_.count(tag) > 0; }
+	/// <summary>
+	/// Drop all stored events, without counting them as evictions
+	/// </summary>
+	void Clear();
+
+	/// <summary>
+	/// Get the counters of the store
+	/// </summary>
+	/// <returns>Copy of the counters</returns>
+	DTC_LookaheadStats GetStats() const;
+	/// <summary>
+	/// Reset the counters (the stored tags and bytes are kept)
+	/// </summary>
+	void ResetStats();
+
+private:
+	struct Entry
+	{
+		uint64_t tag;
+		std::vector<std::unique_ptr<DTC_Event>> events;
+		size_t bytes;
+		std::chrono::steady_clock::time_point stored;
+	};
+	typedef std::list<Entry>::iterator EntryIter;
+
+	void Expire(std::chrono::steady_clock::time_point now);
+	void Drop(EntryIter entry);
+
+	size_t maxBytes_;
+	std::chrono::microseconds maxAge_;
+	std::list<Entry> entries_;  // Oldest first
+	std::unordered_map<uint64_t, EntryIter> index_;
+	size_t bytes_;
+	DTC_LookaheadStats stats_;
+};
+}  // namespace DTCLib
+
+#endif  // DTC_LOOKAHEADSTORE_H
@@ -7,27 +7,69 @@
 DTCLib::DTC_DataPacket::DTC_DataPacket()
 {
 	memPacket_ = false;
-	vals_ = std::vector<uint8_t>(16);
-	dataPtr_ = &vals_[0];
+	memset(inline_, 0, 16);
+	dataPtr_ = inline_;
 	dataSize_ = 16;
 }
 
 DTCLib::DTC_DataPacket::DTC_DataPacket(const DTC_DataPacket& in)
+{
+	CopyFrom(in);
+}
+
+DTCLib::DTC_DataPacket::DTC_DataPacket(DTC_DataPacket&& in) noexcept
+{
+	MoveFrom(in);
+}
+
+DTCLib::DTC_DataPacket& DTCLib::DTC_DataPacket::operator=(const DTC_DataPacket& in)
+{
+	if (this != &in) CopyFrom(in);
+	return *this;
+}
+
+DTCLib::DTC_DataPacket& DTCLib::DTC_DataPacket::operator=(DTC_DataPacket&& in) noexcept
+{
+	if (this != &in) MoveFrom(in);
+	return *this;
+}
+
+void DTCLib::DTC_DataPacket::CopyFrom(const DTC_DataPacket& in)
 {
 	dataSize_ = in.GetSize();
 	memPacket_ = in.IsMemoryPacket();
-	if (!memPacket_)
+	if (memPacket_)
 	{
-		vals_ = std::vector<uint8_t>(dataSize_);
-		dataPtr_ = &vals_[0];
-		memcpy(const_cast<uint8_t*>(dataPtr_), in.GetData(), in.GetSize() * sizeof(uint8_t));
+		dataPtr_ = in.GetData();
+	}
+	else if (dataSize_ <= InlineSize)
+	{
+		memcpy(inline_, in.GetData(), dataSize_);
+		dataPtr_ = inline_;
 	}
 	else
 	{
-		dataPtr_ = in.GetData();
+		vals_.assign(in.GetData(), in.GetData() + dataSize_);
+		dataPtr_ = &vals_[0];
 	}
 }
 
+void DTCLib::DTC_DataPacket::MoveFrom(DTC_DataPacket& in)
+{
+	if (in.memPacket_ || in.dataPtr_ == in.inline_)
+	{
+		CopyFrom(in);
+		return;
+	}
+	dataSize_ = in.dataSize_;
+	memPacket_ = false;
+	vals_ = std::move(in.vals_);
+	dataPtr_ = &vals_[0];
+	// Leave the input an empty owner-mode packet
+	in.dataSize_ = 0;
+	in.dataPtr_ = in.inline_;
+}
+
 DTCLib::DTC_DataPacket::~DTC_DataPacket()
 {
 	if (!memPacket_ && dataPtr_ != nullptr)
@@ -54,8 +96,20 @@ bool DTCLib::DTC_DataPacket::Resize(const uint16_t dmaSize)
 {
 	if (!memPacket_ && dmaSize > dataSize_)
 	{
-		vals_.resize(dmaSize);
-		dataPtr_ = &vals_[0];
+		if (dmaSize <= InlineSize)
+		{
+			memset(inline_ + dataSize_, 0, dmaSize - dataSize_);
+		}
+		else
+		{
+			if (dataPtr_ == inline_)
+			{
+				vals_.reserve(dmaSize);
+				vals_.assign(inline_, inline_ + dataSize_);
+			}
+			vals_.resize(dmaSize);
+			dataPtr_ = &vals_[0];
+		}
 		dataSize_ = dmaSize;
 		return true;
 	}
@@ -113,6 +167,15 @@ bool DTCLib::DTC_DataPacket::Equals(const DTC_DataPacket& other) const
 DTCLib::DTC_DMAPacket::DTC_DMAPacket(DTC_PacketType type, DTC_Link_ID link, uint16_t byteCount, bool valid, uint8_t subsystemID, uint8_t hopCount)
 	: byteCount_(byteCount), valid_(valid), subsystemID_(subsystemID), linkID_(link), packetType_(type), hopCount_(hopCount) {}
 
+void DTCLib::DTC_DMAPacket::EncodeHeader(uint8_t* dest, uint16_t size) const
+{
+	dest[0] = static_cast<uint8_t>(byteCount_);
+	dest[1] = static_cast<uint8_t>(byteCount_ >> 8);
+	dest[2] = static_cast<uint8_t>((hopCount_ & 0xF) + (static_cast<uint8_t>(packetType_) << 4));
+	dest[3] = static_cast<uint8_t>((linkID_ & 0x7) + (valid_ ? 0x80 : 0x0) + ((subsystemID_ & 0x7) << 4));
+	memset(dest + 4, 0, size - 4);
+}
+
 DTCLib::DTC_DataPacket DTCLib::DTC_DMAPacket::ConvertToDataPacket() const
 {
 	DTC_DataPacket output;
@@ -406,6 +469,53 @@ DTCLib::DTC_DataPacket DTCLib::DTC_DCSRequestPacket::ConvertToDataPacket() const
 	return output;
 }
 
+uint16_t DTCLib::DTC_DCSRequestPacket::GetEncodedSize() const
+{
+	uint16_t size = byteCount_ > 16 ? byteCount_ : 16;
+	if (type_ == DTC_DCSOperationType_BlockWrite && (1 + packetCount_) * 16 > size) size = (1 + packetCount_) * 16;
+	return size;
+}
+
+size_t DTCLib::DTC_DCSRequestPacket::EncodeTo(uint8_t* dest, size_t size) const
+{
+	auto packetSize = GetEncodedSize();
+	if (size < packetSize) return 0;
+	EncodeHeader(dest, packetSize);
+
+	auto type = type_;
+	if (address2_ == 0 && data2_ == 0 && (type_ == DTC_DCSOperationType_DoubleRead || type_ == DTC_DCSOperationType_DoubleWrite))
+	{
+		type = static_cast<DTC_DCSOperationType>(type_ & 0x1);
+	}
+	dest[4] = static_cast<uint8_t>(((packetCount_ & 0x3) << 6) + (incrementAddress_ ? 0x10 : 0) + (requestAck_ ? 0x8 : 0) + (static_cast<int>(type) & 0x7));
+	dest[5] = static_cast<uint8_t>((packetCount_ & 0x3FC) >> 2);
+	dest[6] = static_cast<uint8_t>(address1_ & 0xFF);
+	dest[7] = static_cast<uint8_t>(address1_ >> 8);
+	dest[8] = static_cast<uint8_t>(data1_ & 0xFF);
+	dest[9] = static_cast<uint8_t>(data1_ >> 8);
+
+	if (type != DTC_DCSOperationType_BlockWrite)
+	{
+		dest[10] = static_cast<uint8_t>(address2_ & 0xFF);
+		dest[11] = static_cast<uint8_t>(address2_ >> 8);
+		dest[12] = static_cast<uint8_t>(data2_ & 0xFF);
+		dest[13] = static_cast<uint8_t>(data2_ >> 8);
+	}
+	else
+	{
+		// Words which do not fit in the packet count are dropped, as in ConvertToDataPacket
+		size_t wordCounter = 10;
+		for (auto word : blockWriteData_)
+		{
+			if (wordCounter + 1 >= packetSize) break;
+			dest[wordCounter] = static_cast<uint8_t>(word & 0xFF);
+			dest[wordCounter + 1] = static_cast<uint8_t>(word >> 8);
+			wordCounter += 2;
+		}
+	}
+	return packetSize;
+}
+
 DTCLib::DTC_HeartbeatPacket::DTC_HeartbeatPacket(DTC_Link_ID link)
 	: DTC_DMAPacket(DTC_PacketType_Heartbeat, link), event_tag_(), eventMode_(), deliveryRingTDC_()
 {
@@ -478,6 +588,22 @@ DTCLib::DTC_DataPacket DTCLib::DTC_HeartbeatPacket::ConvertToDataPacket() const
 	return output;
 }
 
+uint16_t DTCLib::DTC_HeartbeatPacket::GetEncodedSize() const
+{
+	return byteCount_ > 16 ? byteCount_ : 16;
+}
+
+size_t DTCLib::DTC_HeartbeatPacket::EncodeTo(uint8_t* dest, size_t size) const
+{
+	auto packetSize = GetEncodedSize();
+	if (size < packetSize) return 0;
+	EncodeHeader(dest, packetSize);
+	event_tag_.GetEventWindowTag(dest, 4);
+	eventMode_.GetEventMode(dest, 10);
+	dest[15] = deliveryRingTDC_;
+	return packetSize;
+}
+
 DTCLib::DTC_DataRequestPacket::DTC_DataRequestPacket(DTC_Link_ID link, bool debug, uint16_t debugPacketCount,
 	DTC_DebugType type)
 	: DTC_DMAPacket(DTC_PacketType_DataRequest, link), event_tag_(), debug_(debug), debugPacketCount_(debugPacketCount), type_(type) {}
@@ -537,6 +663,23 @@ DTCLib::DTC_DataPacket DTCLib::DTC_DataRequestPacket::ConvertToDataPacket() cons
 	return output;
 }
 
+uint16_t DTCLib::DTC_DataRequestPacket::GetEncodedSize() const
+{
+	return byteCount_ > 16 ? byteCount_ : 16;
+}
+
+size_t DTCLib::DTC_DataRequestPacket::EncodeTo(uint8_t* dest, size_t size) const
+{
+	auto packetSize = GetEncodedSize();
+	if (size < packetSize) return 0;
+	EncodeHeader(dest, packetSize);
+	event_tag_.GetEventWindowTag(dest, 4);
+	dest[12] = static_cast<uint8_t>((static_cast<uint8_t>(type_) << 4) + (debug_ ? 1 : 0));
+	dest[14] = static_cast<uint8_t>(debugPacketCount_ & 0xFF);
+	dest[15] = static_cast<uint8_t>((debugPacketCount_ >> 8) & 0xFF);
+	return packetSize;
+}
+
 void DTCLib::DTC_DataRequestPacket::SetDebugPacketCount(uint16_t count)
 {
 	if (count > 0)
@@ -800,7 +943,7 @@ bool DTCLib::DTC_DataHeaderPacket::Equals(const DTC_DataHeaderPacket& other) con
 }
 
 DTCLib::DTC_SubEvent::DTC_SubEvent(const uint8_t*& ptr)
-	: header_(), data_blocks_()
+	: header_(), data_blocks_(), block_views_(), blocksMaterialized_(false)
 {
 	memcpy(&header_, ptr, sizeof(header_));
 	ptr += sizeof(header_);
@@ -810,8 +953,8 @@ DTCLib::DTC_SubEvent::DTC_SubEvent(const uint8_t*& ptr)
 	{
 		TLOG(TLVL_TRACE + 5) << "Current byte_count is " << byte_count << " / " << header_.inclusive_subevent_byte_count << ", creating block";
 		try {
-			data_blocks_.emplace_back(static_cast<const void*>(ptr));
-			auto data_block_byte_count = data_blocks_.back().byteSize;
+			block_views_.emplace_back(static_cast<const void*>(ptr));
+			auto data_block_byte_count = block_views_.back().byteSize;
 			byte_count += data_block_byte_count;
 			ptr += data_block_byte_count;
 		}
@@ -858,31 +1001,49 @@ void DTCLib::DTC_SubEvent::UpdateHeader()
 {
 	header_.inclusive_subevent_byte_count = sizeof(DTC_SubEventHeader);
 
-	for (auto& block : data_blocks_)
+	for (auto& block : block_views_)
 	{
 		header_.inclusive_subevent_byte_count += block.byteSize;
 	}
 	TLOG(TLVL_TRACE) << "Inclusive SubEvent Byte Count is now " << header_.inclusive_subevent_byte_count;
 }
 
+void DTCLib::DTC_SubEvent::MaterializeDataBlocks() const
+{
+	if (blocksMaterialized_) return;
+	data_blocks_.reserve(block_views_.size());
+	for (auto& view : block_views_)
+	{
+		data_blocks_.push_back(view.ToDataBlock());
+	}
+	blocksMaterialized_ = true;
+}
+
 DTCLib::DTC_Event::DTC_Event(const void* data)
-	: header_(), sub_events_(), buffer_ptr_(data)
+	: header_(), sub_events_(), buffer_ptr_(data), subEventOffsets_(), materialized_(), remaining_(0), indexed_(true)
 {
 	memcpy(&header_, data, sizeof(header_));
 }
 
-DTCLib::DTC_Event::DTC_Event(size_t data_size)
-	: allocBytes(new std::vector<uint8_t>(data_size)), header_(), sub_events_(), buffer_ptr_(allocBytes->data())
+DTCLib::DTC_Event::DTC_Event(size_t data_size, int numaNode, bool zeroFill)
+	: allocBytes(DTC_BufferPool::Instance().Get(data_size, numaNode)), header_(), sub_events_(), buffer_ptr_(allocBytes.data()), subEventOffsets_(), materialized_(), remaining_(0), indexed_(true)
 {
+	if (zeroFill) memset(allocBytes.data(), 0, data_size);
 	TLOG(TLVL_TRACE) << "Empty DTC_Event created, copy in data and call SetupEvent to finalize";
 }
 
-void DTCLib::DTC_Event::SetupEvent()
+void DTCLib::DTC_Event::SetupEvent(bool lazy)
 {
 	auto ptr = reinterpret_cast<const uint8_t*>(buffer_ptr_);
 
 	memcpy(&header_, ptr, sizeof(header_));
 	ptr += sizeof(header_);
+	sub_events_.clear();
+	subEventOffsets_.clear();
+	materialized_.clear();
+	remaining_ = 0;
+	indexed_ = !lazy;
+	if (lazy) return;
 
 	size_t byte_count = sizeof(header_);
 	while (byte_count < header_.inclusive_event_byte_count)
@@ -905,6 +1066,76 @@ void DTCLib::DTC_Event::SetupEvent()
 	}
 }
 
+void DTCLib::DTC_Event::IndexSubEvents() const
+{
+	if (indexed_) return;
+	indexed_ = true;
+
+	// Only the Sub-Event headers are read; a Sub-Event that does not fit in the event ends it, as in SetupEvent
+	auto base = reinterpret_cast<const uint8_t*>(buffer_ptr_);
+	size_t byte_count = sizeof(DTC_EventHeader);
+	while (byte_count + sizeof(DTC_SubEventHeader) <= header_.inclusive_event_byte_count)
+	{
+		DTC_SubEventHeader header;
+		memcpy(&header, base + byte_count, sizeof(header));
+		if (header.inclusive_subevent_byte_count < sizeof(header) || byte_count + header.inclusive_subevent_byte_count > header_.inclusive_event_byte_count)
+		{
+			TLOG(TLVL_ERROR) << "Sub-Event at location 0x" << std::hex << byte_count << " has byte count 0x" << header.inclusive_subevent_byte_count
+							 << ", which does not fit in the event. This event has been truncated.";
+			break;
+		}
+		subEventOffsets_.push_back(static_cast<uint32_t>(byte_count));
+		byte_count += header.inclusive_subevent_byte_count;
+	}
+	TLOG(TLVL_TRACE + 5) << "Indexed " << subEventOffsets_.size() << " Sub-Events";
+
+	sub_events_.resize(subEventOffsets_.size());
+	materialized_.assign(subEventOffsets_.size(), 0);
+	remaining_ = subEventOffsets_.size();
+	if (remaining_ == 0) materialized_.clear();
+}
+
+DTCLib::DTC_SubEventHeader DTCLib::DTC_Event::GetSubEventHeader(size_t idx) const
+{
+	IndexSubEvents();
+	if (remaining_ == 0 || materialized_[idx]) return *sub_events_[idx].GetHeader();
+
+	DTC_SubEventHeader header;
+	memcpy(&header, reinterpret_cast<const uint8_t*>(buffer_ptr_) + subEventOffsets_[idx], sizeof(header));
+	return header;
+}
+
+void DTCLib::DTC_Event::Materialize(size_t idx) const
+{
+	IndexSubEvents();
+	if (remaining_ == 0 || materialized_[idx]) return;
+
+	auto ptr = reinterpret_cast<const uint8_t*>(buffer_ptr_) + subEventOffsets_[idx];
+	try
+	{
+		sub_events_[idx] = DTC_SubEvent(ptr);
+	}
+	catch (std::exception const& ex)
+	{
+		// SetupEvent would drop this Sub-Event and the ones after it; here only its Data Blocks are lost
+		TLOG(TLVL_ERROR) << "Sub-Event " << idx << " could not be decoded, keeping only its header: " << ex.what();
+		sub_events_[idx] = DTC_SubEvent();
+		memcpy(sub_events_[idx].GetHeader(), reinterpret_cast<const uint8_t*>(buffer_ptr_) + subEventOffsets_[idx], sizeof(DTC_SubEventHeader));
+	}
+	materialized_[idx] = 1;
+	if (--remaining_ == 0)
+	{
+		subEventOffsets_.clear();
+		materialized_.clear();
+	}
+}
+
+void DTCLib::DTC_Event::MaterializeAll() const
+{
+	IndexSubEvents();
+	for (size_t ii = 0; ii < sub_events_.size() && remaining_ > 0; ++ii) Materialize(ii);
+}
+
 DTCLib::DTC_EventWindowTag DTCLib::DTC_Event::GetEventWindowTag() const
 {
 	return DTC_EventWindowTag(header_.event_tag_low, header_.event_tag_high);
@@ -930,6 +1161,7 @@ void DTCLib::DTC_Event::SetEventMode(DTC_EventMode const& mode)
 
 void DTCLib::DTC_Event::UpdateHeader()
 {
+	MaterializeAll();
 	header_.inclusive_event_byte_count = sizeof(DTC_EventHeader);
 	for (auto& sub_evt : sub_events_)
 	{
@@ -974,9 +1206,9 @@ void DTCLib::DTC_Event::WriteEvent(std::ostream& o, bool includeDMAWriteSize)
 		for (auto& subevt : sub_events_)
 		{
 			o.write(reinterpret_cast<const char*>(subevt.GetHeader()), sizeof(DTC_SubEventHeader));
-			for (auto& blk : subevt.GetDataBlocks())
+			for (auto& blk : subevt.GetDataBlockViews())
 			{
-				o.write(static_cast<const char*>(blk.blockPointer), blk.byteSize);
+				o.write(static_cast<const char*>(blk.GetPointer()), blk.byteSize);
 			}
 		}
 	}
@@ -1002,7 +1234,7 @@ void DTCLib::DTC_Event::WriteEvent(std::ostream& o, bool includeDMAWriteSize)
 			}
 			o.write(reinterpret_cast<const char*>(subevt.GetHeader()), sizeof(DTC_SubEventHeader));
 			buffer_data_size += sizeof(DTC_SubEventHeader);
-			for (auto& blk : subevt.GetDataBlocks())
+			for (auto& blk : subevt.GetDataBlockViews())
 			{
 				if (bytes_written + buffer_data_size + blk.byteSize > MAX_DMA_SIZE) {
 					TLOG(TLVL_TRACE) << "Starting new buffer, writing size words " << buffer_data_size << " to old buffer";
@@ -1013,13 +1245,258 @@ void DTCLib::DTC_Event::WriteEvent(std::ostream& o, bool includeDMAWriteSize)
 					bytes_written = WriteDMABufferSizeWords(o, includeDMAWriteSize, header_.inclusive_event_byte_count - total_data_size, buffer_start, false);
 					buffer_data_size = 0;
 				}
-				o.write(static_cast<const char*>(blk.blockPointer), blk.byteSize);
+				o.write(static_cast<const char*>(blk.GetPointer()), blk.byteSize);
 				buffer_data_size += blk.byteSize;
 			}
 		}
 	}
 }
 
+DTCLib::DTC_EventView::DTC_EventView(std::vector<DTC_EventSegment> segments, std::shared_ptr<const void> hold)
+	: segments_(std::move(segments)), hold_(hold), header_(), sub_events_(), parsed_(false)
+{
+	CopyBytes(0, &header_, sizeof(header_));
+}
+
+void DTCLib::DTC_EventView::Reset(std::vector<DTC_EventSegment>& segments, std::shared_ptr<const void> hold)
+{
+	segments_.swap(segments);
+	hold_ = hold;
+	header_ = DTC_EventHeader();
+	CopyBytes(0, &header_, sizeof(header_));
+	sub_events_.clear();
+	parsed_ = false;
+}
+
+DTCLib::DTC_EventWindowTag DTCLib::DTC_EventView::GetEventWindowTag() const
+{
+	return DTC_EventWindowTag(header_.event_tag_low, header_.event_tag_high);
+}
+
+std::vector<DTCLib::DTC_EventSegment> DTCLib::DTC_EventView::GetSegments(size_t offset, size_t size) const
+{
+	std::vector<DTC_EventSegment> output;
+	for (auto& segment : segments_)
+	{
+		if (size == 0) break;
+		if (offset >= segment.size)
+		{
+			offset -= segment.size;
+			continue;
+		}
+		auto piece = segment.size - offset < size ? segment.size - offset : size;
+		output.push_back({segment.data + offset, piece});
+		size -= piece;
+		offset = 0;
+	}
+	return output;
+}
+
+size_t DTCLib::DTC_EventView::CopyBytes(size_t offset, void* dest, size_t size) const
+{
+	size_t copied = 0;
+	for (auto& segment : segments_)
+	{
+		if (copied == size) break;
+		if (offset >= segment.size)
+		{
+			offset -= segment.size;
+			continue;
+		}
+		auto piece = segment.size - offset < size - copied ? segment.size - offset : size - copied;
+		memcpy(static_cast<uint8_t*>(dest) + copied, segment.data + offset, piece);
+		copied += piece;
+		offset = 0;
+	}
+	return copied;
+}
+
+std::vector<DTCLib::DTC_SubEventRef> const& DTCLib::DTC_EventView::GetSubEvents() const
+{
+	if (!parsed_) ParseSubEvents();
+	return sub_events_;
+}
+
+void DTCLib::DTC_EventView::ParseSubEvents() const
+{
+	parsed_ = true;
+	auto eventByteCount = GetEventByteCount();
+	size_t offset = sizeof(header_);
+	while (offset < eventByteCount)
+	{
+		TLOG(TLVL_TRACE + 5) << "Current byte_count is " << offset << " / " << eventByteCount << ", creating sub event";
+		DTC_SubEventRef subEvent{offset, DTC_SubEventHeader(), {}};
+		if (CopyBytes(offset, &subEvent.header, sizeof(DTC_SubEventHeader)) < sizeof(DTC_SubEventHeader) ||
+			subEvent.header.inclusive_subevent_byte_count < sizeof(DTC_SubEventHeader))
+		{
+			TLOG(TLVL_ERROR) << "Invalid sub event header at location 0x" << std::hex << offset << ", this event has been truncated.";
+			break;
+		}
+
+		auto subEventEnd = offset + subEvent.header.inclusive_subevent_byte_count;
+		auto blockOffset = offset + sizeof(DTC_SubEventHeader);
+		try
+		{
+			while (blockOffset < subEventEnd)
+			{
+				auto blockByteCount = GetDataBlockHeader(DTC_DataBlockRef{blockOffset, 16}).GetByteCount();
+				subEvent.blocks.push_back(DTC_DataBlockRef{blockOffset, blockByteCount});
+				blockOffset += blockByteCount;
+			}
+		}
+		catch (DTC_WrongPacketTypeException const& ex)
+		{
+			TLOG(TLVL_ERROR) << "A DTC_WrongPacketTypeException occurred while setting up the event at location 0x" << std::hex << blockOffset;
+			TLOG(TLVL_ERROR) << "This event has been truncated.";
+			break;
+		}
+		catch (DTC_WrongPacketSizeException const& ex)
+		{
+			TLOG(TLVL_ERROR) << "A DTC_WrongPacketSizeException occurred while setting up the event at location 0x" << std::hex << blockOffset;
+			TLOG(TLVL_ERROR) << "This event has been truncated.";
+			break;
+		}
+		sub_events_.push_back(std::move(subEvent));
+		offset = subEventEnd;
+	}
+}
+
+DTCLib::DTC_DataHeaderPacket DTCLib::DTC_EventView::GetDataBlockHeader(DTC_DataBlockRef const& block) const
+{
+	uint8_t packet[16];
+	if (CopyBytes(block.offset, packet, sizeof(packet)) < sizeof(packet)) throw DTC_WrongPacketSizeException(16, 0);
+	return DTC_DataHeaderPacket(DTC_DataPacket(packet));
+}
+
+DTCLib::DTC_DataBlock DTCLib::DTC_EventView::GetDataBlock(DTC_DataBlockRef const& block) const
+{
+	auto pieces = GetSegments(block.offset, block.byteSize);
+	if (pieces.size() == 1) return DTC_DataBlock(pieces[0].data, pieces[0].size);
+
+	TLOG(TLVL_TRACE + 5) << "Data block at 0x" << std::hex << block.offset << " spans " << std::dec << pieces.size() << " DMA buffers, copying it";
+	DTC_DataBlock output(block.byteSize);
+	CopyBytes(block.offset, output.allocBytes->data(), block.byteSize);
+	return output;
+}
+
+std::unique_ptr<DTCLib::DTC_Event> DTCLib::DTC_EventView::ToEvent(int numaNode, bool lazy) const
+{
+	auto output = std::make_unique<DTC_Event>(GetEventByteCount(), numaNode, false);
+	CopyBytes(0, const_cast<void*>(output->GetRawBufferPointer()), GetEventByteCount());
+	output->SetupEvent(lazy);
+	return output;
+}
+
+std::unique_ptr<DTCLib::DTC_Event> DTCLib::DTC_EventView::ToFilteredEvent(DTC_ReadoutFilter const& filter, DTC_FilterStats& stats, int numaNode, bool lazy) const
+{
+	// Find what is kept from the headers first, so that the copy can be allocated at its final size
+	std::vector<DTC_SubEventRef> kept;
+	auto outputSize = SelectFiltered(filter, stats, kept);
+	auto output = std::make_unique<DTC_Event>(outputSize, numaNode, false);
+	CopyFiltered(kept, outputSize, const_cast<void*>(output->GetRawBufferPointer()));
+	output->SetupEvent(lazy);
+	return output;
+}
+
+size_t DTCLib::DTC_EventView::SelectFiltered(DTC_ReadoutFilter const& filter, DTC_FilterStats& stats, std::vector<DTC_SubEventRef>& kept) const
+{
+	kept.clear();
+	auto eventByteCount = GetEventByteCount();
+	size_t outputSize = sizeof(DTC_EventHeader);
+	size_t offset = sizeof(DTC_EventHeader);
+	while (offset < eventByteCount)
+	{
+		DTC_SubEventHeader header;
+		if (CopyBytes(offset, &header, sizeof(header)) < sizeof(header) || header.inclusive_subevent_byte_count < sizeof(header) ||
+			offset + header.inclusive_subevent_byte_count > eventByteCount)
+		{
+			TLOG(TLVL_ERROR) << "Invalid sub event header at location 0x" << std::hex << offset << ", this event has been truncated.";
+			break;
+		}
+		auto subEventEnd = offset + header.inclusive_subevent_byte_count;
+		if (!filter.AcceptSubEvent(header))
+		{
+			TLOG(TLVL_TRACE + 5) << "Skipping sub event from DTC 0x" << std::hex << header.source_dtc_id << " at location 0x" << offset;
+			stats.subEventsRejected++;
+			stats.blocksRejected += header.num_rocs;
+			offset = subEventEnd;
+			continue;
+		}
+
+		DTC_SubEventRef subEvent{offset, header, {}};
+		auto blockOffset = offset + sizeof(DTC_SubEventHeader);
+		if (filter.linkMask == 0xFFFF)
+		{
+			// All the blocks are kept, copy them in one piece
+			if (subEventEnd > blockOffset) subEvent.blocks.push_back(DTC_DataBlockRef{blockOffset, subEventEnd - blockOffset});
+			stats.blocksAccepted += header.num_rocs;
+		}
+		else
+		{
+			size_t blockCount = 0;
+			size_t subEventByteCount = sizeof(DTC_SubEventHeader);
+			while (blockOffset < subEventEnd)
+			{
+				// Byte count, packet type and link ID are in the first four bytes of the Data Header packet
+				uint8_t word[4];
+				if (CopyBytes(blockOffset, word, sizeof(word)) < sizeof(word))
+				{
+					TLOG(TLVL_ERROR) << "Data Header packet at location 0x" << std::hex << blockOffset << " is past the end of the event, this sub event has been truncated.";
+					break;
+				}
+				size_t blockByteCount = word[0] + (word[1] << 8);
+				if ((word[2] >> 4) != DTC_PacketType_DataHeader || blockByteCount < 16 || blockOffset + blockByteCount > subEventEnd)
+				{
+					TLOG(TLVL_ERROR) << "Invalid Data Header packet at location 0x" << std::hex << blockOffset << ", this sub event has been truncated.";
+					break;
+				}
+				if (filter.AcceptLink(word[3] & 0xF))
+				{
+					if (!subEvent.blocks.empty() && subEvent.blocks.back().offset + subEvent.blocks.back().byteSize == blockOffset)
+						subEvent.blocks.back().byteSize += blockByteCount;
+					else
+						subEvent.blocks.push_back(DTC_DataBlockRef{blockOffset, blockByteCount});
+					subEventByteCount += blockByteCount;
+					blockCount++;
+					stats.blocksAccepted++;
+				}
+				else
+				{
+					stats.blocksRejected++;
+				}
+				blockOffset += blockByteCount;
+			}
+			subEvent.header.inclusive_subevent_byte_count = subEventByteCount;
+			subEvent.header.num_rocs = blockCount;
+		}
+		outputSize += subEvent.header.inclusive_subevent_byte_count;
+		stats.subEventsAccepted++;
+		kept.push_back(std::move(subEvent));
+		offset = subEventEnd;
+	}
+
+	stats.events++;
+	stats.bytesAccepted += outputSize;
+	stats.bytesRejected += eventByteCount - outputSize;
+	return outputSize;
+}
+
+void DTCLib::DTC_EventView::CopyFiltered(std::vector<DTC_SubEventRef> const& kept, size_t byteCount, void* dest) const
+{
+	auto output = static_cast<uint8_t*>(dest);
+	auto header = header_;
+	header.inclusive_event_byte_count = byteCount;
+	header.num_dtcs = kept.size();
+	memcpy(output, &header, sizeof(header));
+	size_t pos = sizeof(header);
+	for (auto& subEvent : kept)
+	{
+		memcpy(output + pos, &subEvent.header, sizeof(DTC_SubEventHeader));
+		pos += sizeof(DTC_SubEventHeader);
+		for (auto& range : subEvent.blocks) pos += CopyBytes(range.offset, output + pos, range.byteSize);
+	}
+}
+
 std::string DTCLib::DTC_SubEventHeader::toJson() const
 {
 	std::ostringstream oss;
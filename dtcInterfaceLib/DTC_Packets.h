@@ -3,9 +3,12 @@
 
 #include <bitset>
 #include <cstdint>  // uint8_t, uint16_t
+#include <memory>
+#include <type_traits>
 #include <vector>
 #include <cassert>
 
+#include "DTC_BufferPool.h"
 #include "DTC_Types.h"
 
 #include "mu2e_driver/mu2e_mmap_ioctl.h"
@@ -153,25 +156,25 @@ public:
 	/// <param name="in">Input DTC_DataPacket</param>
 	DTC_DataPacket(const DTC_DataPacket& in);
 	/// <summary>
-	/// Default move constructor
+	/// Move constructor. Packets stored inline are copied, larger ones take over the memory of the input.
 	/// </summary>
 	/// <param name="in">DTC_DataPacket rvalue</param>
-	DTC_DataPacket(DTC_DataPacket&& in) = default;
+	DTC_DataPacket(DTC_DataPacket&& in) noexcept;
 
 	virtual ~DTC_DataPacket();
 
 	/// <summary>
-	/// Default copy-assignment operator
+	/// Copy-assignment operator, with the same semantics as the copy constructor
 	/// </summary>
 	/// <param name="in">DTC_DataPacket lvalue</param>
 	/// <returns>DTC_DataPacket reference</returns>
-	DTC_DataPacket& operator=(const DTC_DataPacket& in) = default;
+	DTC_DataPacket& operator=(const DTC_DataPacket& in);
 	/// <summary>
-	/// Default move-assignment operator
+	/// Move-assignment operator, with the same semantics as the move constructor
 	/// </summary>
 	/// <param name="in">DTC_DataPacket rvalue</param>
 	/// <returns>DTC_DataPacket reference</returns>
-	DTC_DataPacket& operator=(DTC_DataPacket&& in) = default;
+	DTC_DataPacket& operator=(DTC_DataPacket&& in) noexcept;
 
 	/// <summary>
 	/// Set the given word of the DataPacket.
@@ -198,7 +201,8 @@ public:
 	/// <returns>"packet format" string representation of the DTC_DataPacket</returns>
 	std::string toPacketFormat() const;
 	/// <summary>
-	/// Resize a DTC_DataPacket in "owner" mode. New size must be larger than current.
+	/// Resize a DTC_DataPacket in "owner" mode. New size must be larger than current. Packets of up to InlineSize bytes
+	/// are stored in the DTC_DataPacket itself; larger ones are moved to the heap.
 	/// </summary>
 	/// <param name="dmaSize">Size in bytes of the new packet</param>
 	/// <returns>If the resize operation was successful</returns>
@@ -272,11 +276,21 @@ public:
 		return s.write(reinterpret_cast<const char*>(p.dataPtr_), p.dataSize_);
 	}
 
+	/// <summary>
+	/// Largest "owner" mode packet stored without heap memory. Covers the DMA packets the DTC sends (16 bytes) and the
+	/// double and short block DCS operations.
+	/// </summary>
+	static constexpr uint16_t InlineSize = 64;
+
 private:
+	void CopyFrom(const DTC_DataPacket& in);
+	void MoveFrom(DTC_DataPacket& in);
+
 	const uint8_t* dataPtr_;
 	uint16_t dataSize_;
 	bool memPacket_;
-	std::vector<uint8_t> vals_;
+	alignas(8) uint8_t inline_[InlineSize];
+	std::vector<uint8_t> vals_;  // Storage of packets larger than InlineSize
 };
 
 /// <summary>
@@ -352,6 +366,17 @@ public:
 	/// <returns>Packet Type of DMA Packet</returns>
 	DTC_PacketType GetPacketType() const { return packetType_; }
 
+protected:
+	/// <summary>
+	/// Write the DMA Header bytes of the packet, and zero the rest of it. Used by the EncodeTo functions of the derived
+	/// packets, which then fill in their fields.
+	/// </summary>
+	/// <param name="dest">Start of the packet</param>
+	/// <param name="size">Size of the packet, in bytes</param>
+	void EncodeHeader(uint8_t* dest, uint16_t size) const;
+
+public:
+
 	/// <summary>
 	/// Gets the DMA Header in JSON
 	/// </summary>
@@ -546,6 +571,18 @@ public:
 		type_ = type;
 	}
 
+	/// <summary>
+	/// Get the size of the DCS Request Packet as written by EncodeTo and ConvertToDataPacket
+	/// </summary>
+	/// <returns>Size in bytes</returns>
+	uint16_t GetEncodedSize() const;
+	/// <summary>
+	/// Write the DCS Request Packet in its wire format, with the same bytes as ConvertToDataPacket, without allocating memory
+	/// </summary>
+	/// <param name="dest">Destination, e.g. a DMA buffer after its 8-byte header</param>
+	/// <param name="size">Space at the destination, in bytes</param>
+	/// <returns>Number of bytes written, 0 if GetEncodedSize bytes do not fit</returns>
+	size_t EncodeTo(uint8_t* dest, size_t size) const;
 	/// <summary>
 	/// Convert a DTC_DCSRequestPacket to DTC_DataPacket in "owner" mode
 	/// </summary>
@@ -626,6 +663,18 @@ public:
 	/// <returns>5-byte array containing mode bytes</returns>
 	virtual DTC_EventMode GetData() { return eventMode_; }
 
+	/// <summary>
+	/// Get the size of the DTC_HeartbeatPacket as written by EncodeTo and ConvertToDataPacket
+	/// </summary>
+	/// <returns>Size in bytes</returns>
+	uint16_t GetEncodedSize() const;
+	/// <summary>
+	/// Write the DTC_HeartbeatPacket in its wire format, with the same bytes as ConvertToDataPacket, without allocating memory
+	/// </summary>
+	/// <param name="dest">Destination, e.g. a DMA buffer after its 8-byte header</param>
+	/// <param name="size">Space at the destination, in bytes</param>
+	/// <returns>Number of bytes written, 0 if GetEncodedSize bytes do not fit</returns>
+	size_t EncodeTo(uint8_t* dest, size_t size) const;
 	/// <summary>
 	/// Convert a DTC_HeartbeatPacket to DTC_DataPacket in "owner" mode
 	/// </summary>
@@ -719,6 +768,18 @@ public:
 	/// <returns>DTC_EventWindowTag of reqeust</returns>
 	DTC_EventWindowTag GetEventWindowTag() const { return event_tag_; }
 
+	/// <summary>
+	/// Get the size of the DTC_DataRequestPacket as written by EncodeTo and ConvertToDataPacket
+	/// </summary>
+	/// <returns>Size in bytes</returns>
+	uint16_t GetEncodedSize() const;
+	/// <summary>
+	/// Write the DTC_DataRequestPacket in its wire format, with the same bytes as ConvertToDataPacket, without allocating memory
+	/// </summary>
+	/// <param name="dest">Destination, e.g. a DMA buffer after its 8-byte header</param>
+	/// <param name="size">Space at the destination, in bytes</param>
+	/// <returns>Number of bytes written, 0 if GetEncodedSize bytes do not fit</returns>
+	size_t EncodeTo(uint8_t* dest, size_t size) const;
 	/// <summary>
 	/// Convert a DTC_DataRequestPacket to DTC_DataPacket in "owner" mode
 	/// </summary>
@@ -1024,6 +1085,76 @@ struct DTC_DataBlock
 	}
 };
 
+/// <summary>
+/// A non-owning view of a Data Block in memory. Unlike DTC_DataBlock::GetHeader, nothing is copied or allocated: each
+/// header field is decoded from the DataHeaderPacket hardware view when it is asked for. The memory must outlive the view.
+/// </summary>
+struct DTC_DataBlockView
+{
+	const DataHeaderPacket* header{nullptr};  ///< Data Header Packet at the start of the block
+	size_t byteSize{0};                       ///< Size of DataBlock
+
+	DTC_DataBlockView() = default;
+
+	/// <summary>
+	/// Construct a DTC_DataBlockView of the Data Block at the given location, checking its Data Header Packet
+	/// Throws DTC_WrongPacketTypeException if it is not a Data Header, and DTC_WrongPacketSizeException if the byte count
+	/// does not match the packet count
+	/// </summary>
+	/// <param name="ptr">Pointer to Data Block</param>
+	explicit DTC_DataBlockView(const void* ptr)
+		: header(static_cast<const DataHeaderPacket*>(ptr)), byteSize(header->s.TransferByteCount)
+	{
+		if (GetPacketType() != DTC_PacketType_DataHeader) throw DTC_WrongPacketTypeException(DTC_PacketType_DataHeader, GetPacketType());
+		if ((GetPacketCount() + 1u) * 16u != byteSize) throw DTC_WrongPacketSizeException((GetPacketCount() + 1) * 16, static_cast<int>(byteSize));
+	}
+
+	/// <summary>
+	/// Construct a DTC_DataBlockView of the given location in memory with the given size, without checking it
+	/// </summary>
+	/// <param name="ptr">Pointer to DataBlock in memory</param>
+	/// <param name="sz">Size of DataBlock</param>
+	DTC_DataBlockView(const void* ptr, size_t sz)
+		: header(static_cast<const DataHeaderPacket*>(ptr)), byteSize(sz) {}
+
+	/// <summary>
+	/// Construct a DTC_DataBlockView of the memory of a DTC_DataBlock, which must outlive the view
+	/// </summary>
+	/// <param name="blk">Data Block</param>
+	explicit DTC_DataBlockView(DTC_DataBlock const& blk)
+		: DTC_DataBlockView(blk.blockPointer, blk.byteSize) {}
+
+	uint16_t GetByteCount() const { return header->s.TransferByteCount; }
+	DTC_PacketType GetPacketType() const { return static_cast<DTC_PacketType>(header->s.PacketType); }
+	DTC_Link_ID GetLinkID() const { return static_cast<DTC_Link_ID>(header->s.LinkID); }
+	DTC_Subsystem GetSubsystem() const { return static_cast<DTC_Subsystem>(header->s.SubsystemID); }
+	bool IsValid() const { return header->s.Valid; }
+	uint16_t GetPacketCount() const { return header->s.PacketCount; }
+	DTC_EventWindowTag GetEventWindowTag() const
+	{
+		return DTC_EventWindowTag(static_cast<uint64_t>(header->s.ts10) + (static_cast<uint64_t>(header->s.ts32) << 16) +
+								  (static_cast<uint64_t>(header->s.ts54) << 32));
+	}
+	DTC_DataStatus GetStatus() const { return static_cast<DTC_DataStatus>(header->s.Status); }
+	uint8_t GetVersion() const { return header->s.Version; }
+	uint8_t GetID() const { return header->s.DTCID; }
+	uint8_t GetEVBMode() const { return header->s.EventWindowMode; }
+
+	const void* GetPointer() const { return header; }
+	inline const void* GetData() const
+	{
+		assert(byteSize > 16);
+		return static_cast<const void*>(header + 1);
+	}
+
+	/// <summary>
+	/// Make a DTC_DataBlock pointing to the same memory
+	/// </summary>
+	/// <returns>DTC_DataBlock of the viewed memory</returns>
+	DTC_DataBlock ToDataBlock() const { return DTC_DataBlock(GetPointer(), byteSize); }
+};
+static_assert(std::is_trivially_copyable<DTC_DataBlockView>::value, "DTC_DataBlockView must stay a plain pointer and size");
+
 struct DTC_SubEventHeader
 {
 	uint64_t inclusive_subevent_byte_count : 25;
@@ -1084,7 +1215,7 @@ public:
 	explicit DTC_SubEvent(const uint8_t*& ptr);
 
 	DTC_SubEvent()
-		: header_(), data_blocks_() {}
+		: header_(), data_blocks_(), block_views_(), blocksMaterialized_(true) {}
 
 	size_t GetSubEventByteCount() { return header_.inclusive_subevent_byte_count; }
 
@@ -1093,19 +1224,50 @@ public:
 	void SetEventMode(DTC_EventMode const& mode);
 	uint8_t GetDTCID() const;
 
+	/// <summary>
+	/// Get the Data Blocks of the Sub-Event. A Sub-Event decoded from memory only holds DTC_DataBlockViews; the
+	/// DTC_DataBlocks are made from them on the first call.
+	/// </summary>
+	/// <returns>Data Blocks</returns>
 	std::vector<DTC_DataBlock> const& GetDataBlocks() const
 	{
+		MaterializeDataBlocks();
 		return data_blocks_;
 	}
-	size_t GetDataBlockCount() const { return data_blocks_.size(); }
-	DTC_DataBlock* GetDataBlock(size_t idx)
+	/// <summary>
+	/// Get non-owning views of the Data Blocks of the Sub-Event, which decode their headers without allocating
+	/// </summary>
+	/// <returns>Data Block views</returns>
+	std::vector<DTC_DataBlockView> const& GetDataBlockViews() const { return block_views_; }
+	size_t GetDataBlockCount() const { return block_views_.size(); }
+	/// <summary>
+	/// Get a Data Block of the Sub-Event. It is read-only: the block views are not rebuilt from it, so a change to it
+	/// would not be seen by GetDataBlockViews. Use AddDataBlock to change the Sub-Event.
+	/// </summary>
+	/// <param name="idx">Index of the Data Block</param>
+	/// <returns>Pointer to the Data Block</returns>
+	const DTC_DataBlock* GetDataBlock(size_t idx) const
 	{
-		if (idx >= data_blocks_.size()) throw std::out_of_range("Index " + std::to_string(idx) + " is out of range (max: " + std::to_string(data_blocks_.size() - 1) + ")");
+		if (idx >= block_views_.size()) throw std::out_of_range("Index " + std::to_string(idx) + " is out of range (max: " + std::to_string(block_views_.size() - 1) + ")");
+		MaterializeDataBlocks();
 		return &data_blocks_[idx];
 	}
 	void AddDataBlock(DTC_DataBlock blk)
 	{
+		MaterializeDataBlocks();
 		data_blocks_.push_back(blk);
+		block_views_.emplace_back(blk);
+		header_.num_rocs++;
+		UpdateHeader();
+	}
+	/// <summary>
+	/// Add a Data Block by view. The Sub-Event does not own the viewed memory, which must outlive it.
+	/// </summary>
+	/// <param name="view">View of the Data Block</param>
+	void AddDataBlock(DTC_DataBlockView view)
+	{
+		if (blocksMaterialized_) data_blocks_.push_back(view.ToDataBlock());
+		block_views_.push_back(view);
 		header_.num_rocs++;
 		UpdateHeader();
 	}
@@ -1119,8 +1281,12 @@ public:
 	void UpdateHeader();
 
 private:
+	void MaterializeDataBlocks() const;
+
 	DTC_SubEventHeader header_;
-	std::vector<DTC_DataBlock> data_blocks_;
+	mutable std::vector<DTC_DataBlock> data_blocks_;
+	std::vector<DTC_DataBlockView> block_views_;
+	mutable bool blocksMaterialized_;
 };
 
 struct DTC_EventHeader
@@ -1170,32 +1336,58 @@ public:
 	/// <param name="data">Pointer data</param>
 	explicit DTC_Event(const void* data);
 
-	explicit DTC_Event(size_t data_size);
+	/// <summary>
+	/// Construct a DTC_Event which owns a buffer of the given size, taken from DTC_BufferPool::Instance()
+	/// </summary>
+	/// <param name="data_size">Size of the buffer</param>
+	/// <param name="numaNode">NUMA node to allocate the buffer on (Default: -1, no placement)</param>
+	/// <param name="zeroFill">Clear the buffer. Not needed when it is about to be overwritten (Default: true)</param>
+	explicit DTC_Event(size_t data_size, int numaNode = -1, bool zeroFill = true);
 
 	DTC_Event()
-		: header_(), sub_events_(), buffer_ptr_(nullptr) {}
+		: header_(), sub_events_(), buffer_ptr_(nullptr), subEventOffsets_(), materialized_(), remaining_(0), indexed_(true) {}
 
 	static const int MAX_DMA_SIZE = 0x8000;
 
-	void SetupEvent();
+	/// <summary>
+	/// Decode the event in the buffer. In lazy mode, only the event header is decoded here; the Sub-Events are found
+	/// in one pass over their headers on first access, and each is decoded (with its Data Blocks) when it is first used.
+	/// </summary>
+	/// <param name="lazy">Defer decoding the Sub-Events (Default: false)</param>
+	void SetupEvent(bool lazy = false);
 	size_t GetEventByteCount() const { return header_.inclusive_event_byte_count; }
 	DTC_EventWindowTag GetEventWindowTag() const;
 	void SetEventWindowTag(DTC_EventWindowTag const& tag);
 	void SetEventMode(DTC_EventMode const& mode);
 	const void* GetRawBufferPointer() const { return buffer_ptr_; }
+	/// <summary>
+	/// Whether the event owns its memory, or points into memory it does not manage (e.g. a DMA buffer)
+	/// </summary>
+	/// <returns>True if the event owns its memory</returns>
+	bool OwnsMemory() const { return static_cast<bool>(allocBytes); }
+	/// <summary>
+	/// Whether some Sub-Events have not been decoded yet
+	/// </summary>
+	/// <returns>True for an event set up in lazy mode until all its Sub-Events have been used</returns>
+	bool IsLazy() const { return !indexed_ || remaining_ > 0; }
 
 	std::vector<DTC_SubEvent> const& GetSubEvents() const
 	{
+		MaterializeAll();
 		return sub_events_;
 	}
-	size_t GetSubEventCount() const { return sub_events_.size(); }
+	size_t GetSubEventCount() const
+	{
+		IndexSubEvents();
+		return sub_events_.size();
+	}
 
 	size_t GetSubEventCount(DTC_Subsystem subsys) const
 	{
 		size_t count = 0;
-		for (size_t ii = 0; ii < sub_events_.size(); ++ii)
+		for (size_t ii = 0; ii < GetSubEventCount(); ++ii)
 		{
-			if (sub_events_[ii].GetSubsystem() == subsys) ++count;
+			if (((GetSubEventHeader(ii).source_dtc_id & 0x70) >> 4) == subsys) ++count;
 		}
 		return count;
 	}
@@ -1203,10 +1395,11 @@ public:
 	size_t GetBlockCount(DTC_Subsystem subsys) const
 	{
 		size_t count = 0;
-		for (size_t ii = 0; ii < sub_events_.size(); ++ii)
+		for (size_t ii = 0; ii < GetSubEventCount(); ++ii)
 		{
-			if (sub_events_[ii].GetSubsystem() == subsys)
+			if (((GetSubEventHeader(ii).source_dtc_id & 0x70) >> 4) == subsys)
 			{
+				Materialize(ii);
 				count += sub_events_[ii].GetDataBlockCount();
 			}
 		}
@@ -1215,11 +1408,13 @@ public:
 
 	DTC_SubEvent* GetSubEvent(size_t idx)
 	{
-		if (idx >= sub_events_.size()) throw std::out_of_range("Index " + std::to_string(idx) + " is out of range (max: " + std::to_string(sub_events_.size() - 1) + ")");
+		if (idx >= GetSubEventCount()) throw std::out_of_range("Index " + std::to_string(idx) + " is out of range (max: " + std::to_string(sub_events_.size() - 1) + ")");
+		Materialize(idx);
 		return &sub_events_[idx];
 	}
 	void AddSubEvent(DTC_SubEvent subEvt)
 	{
+		MaterializeAll();
 		sub_events_.push_back(subEvt);
 		header_.num_dtcs++;
 		UpdateHeader();
@@ -1227,9 +1422,13 @@ public:
 	DTC_SubEvent* GetSubEventByDTCID(uint8_t dtc, DTC_Subsystem subsys)
 	{
 		auto dtcid = (dtc & 0xF) + ((static_cast<uint8_t>(subsys) & 0x7) << 4);
-		for (size_t ii = 0; ii < sub_events_.size(); ++ii)
+		for (size_t ii = 0; ii < GetSubEventCount(); ++ii)
 		{
-			if (sub_events_[ii].GetDTCID() == dtcid) return &sub_events_[ii];
+			if (GetSubEventHeader(ii).source_dtc_id == dtcid)
+			{
+				Materialize(ii);
+				return &sub_events_[ii];
+			}
 		}
 		return nullptr;
 	}
@@ -1240,10 +1439,213 @@ public:
 	void WriteEvent(std::ostream& output, bool includeDMAWriteSize = true);
 
 private:
-	std::shared_ptr<std::vector<uint8_t>> allocBytes{nullptr};  ///< Used if the block owns its memory
+	// Header of a Sub-Event, read from the buffer if the Sub-Event has not been decoded
+	DTC_SubEventHeader GetSubEventHeader(size_t idx) const;
+	void IndexSubEvents() const;
+	void Materialize(size_t idx) const;
+	void MaterializeAll() const;
+
+	DTC_PooledBuffer allocBytes;  ///< Used if the event owns its memory
 	DTC_EventHeader header_;
-	std::vector<DTC_SubEvent> sub_events_;
+	mutable std::vector<DTC_SubEvent> sub_events_;
 	const void* buffer_ptr_;
+	// Lazy mode: offsets of the Sub-Event headers from the start of the event, found by IndexSubEvents, and which
+	// entries of sub_events_ have been decoded. Both are empty once every Sub-Event is.
+	mutable std::vector<uint32_t> subEventOffsets_;
+	mutable std::vector<uint8_t> materialized_;
+	mutable size_t remaining_;  // Sub-Events not decoded yet
+	mutable bool indexed_;      // False until IndexSubEvents has run on a lazy event
+};
+
+/// <summary>
+/// A contiguous piece of an event
+/// </summary>
+struct DTC_EventSegment
+{
+	const uint8_t* data;  ///< Start of the piece
+	size_t size;          ///< Size of the piece, in bytes
+};
+
+/// <summary>
+/// Location of a Data Block in a DTC_EventView
+/// </summary>
+struct DTC_DataBlockRef
+{
+	size_t offset;    ///< Offset of the Data Header packet from the start of the event
+	size_t byteSize;  ///< Size of the Data Block, including the Data Header packet
+};
+
+/// <summary>
+/// Location and header of a Sub-Event in a DTC_EventView
+/// </summary>
+struct DTC_SubEventRef
+{
+	size_t offset;                         ///< Offset of the Sub-Event header from the start of the event
+	DTC_SubEventHeader header;             ///< Copy of the Sub-Event header
+	std::vector<DTC_DataBlockRef> blocks;  ///< Data Blocks of the Sub-Event
+};
+
+/// <summary>
+/// Selects the Sub-Events and Data Blocks kept by the DTC readout, see DTC::SetReadoutFilter.
+/// Each mask has one bit per value, e.g. subsystemMask = (1 << DTC_Subsystem_Calorimeter) | (1 << DTC_Subsystem_CRV).
+/// A Sub-Event is kept if both its subsystem and its DTC ID are selected; of a kept Sub-Event, only the Data Blocks
+/// from selected links are kept.
+/// </summary>
+struct DTC_ReadoutFilter
+{
+	uint8_t subsystemMask{0xFF};  ///< Bit per DTC_Subsystem
+	uint16_t dtcMask{0xFFFF};     ///< Bit per DTC ID
+	uint16_t linkMask{0xFFFF};    ///< Bit per DTC_Link_ID of the Data Header packet
+	bool dropEmptyEvents{false};  ///< Skip events left without Sub-Events instead of returning only their header
+
+	/// <summary>
+	/// Whether the filter keeps everything
+	/// </summary>
+	/// <returns>True if all masks are full</returns>
+	bool AcceptsAll() const { return subsystemMask == 0xFF && dtcMask == 0xFFFF && linkMask == 0xFFFF; }
+	/// <summary>
+	/// Whether a Sub-Event is kept
+	/// </summary>
+	/// <param name="header">Sub-Event header</param>
+	/// <returns>True if its subsystem and DTC ID are selected</returns>
+	bool AcceptSubEvent(DTC_SubEventHeader const& header) const
+	{
+		return ((subsystemMask >> ((header.source_dtc_id >> 4) & 0x7)) & 1) && ((dtcMask >> (header.source_dtc_id & 0xF)) & 1);
+	}
+	/// <summary>
+	/// Whether a Data Block is kept
+	/// </summary>
+	/// <param name="link">Link ID from the Data Header packet</param>
+	/// <returns>True if the link is selected</returns>
+	bool AcceptLink(uint8_t link) const { return (linkMask >> (link & 0xF)) & 1; }
+};
+
+/// <summary>
+/// Counters of the readout filter. GetData reads the event after the last one it returns to check its event window
+/// tag; that event is filtered again by the next call, and counted again.
+/// </summary>
+struct DTC_FilterStats
+{
+	uint64_t events{0};             ///< Events filtered
+	uint64_t eventsDropped{0};      ///< Events skipped because nothing in them was kept
+	uint64_t subEventsAccepted{0};  ///< Sub-Events kept
+	uint64_t subEventsRejected{0};  ///< Sub-Events not copied
+	uint64_t blocksAccepted{0};     ///< Data Blocks kept
+	uint64_t blocksRejected{0};     ///< Data Blocks not copied, including those of rejected Sub-Events
+	uint64_t bytesAccepted{0};      ///< Bytes of the filtered events
+	uint64_t bytesRejected{0};      ///< Bytes not copied
+};
+
+/// <summary>
+/// An event left in the DMA buffers it was received in. An event larger than a DMA buffer is continued in the
+/// following buffers; the view refers to each piece (segment) in place instead of gathering them into one block of
+/// memory. The buffers are held by the DTC until the view is destroyed.
+/// Data is only copied by CopyBytes and ToEvent, and by GetDataBlock for a block split between two buffers.
+/// </summary>
+class DTC_EventView
+{
+public:
+	/// <summary>
+	/// Construct a DTC_EventView over the given pieces of an event
+	/// </summary>
+	/// <param name="segments">Pieces of the event, in order. Their sizes add up to the event byte count</param>
+	/// <param name="hold">Keeps the memory of the segments valid while the view exists (Default: nullptr)</param>
+	explicit DTC_EventView(std::vector<DTC_EventSegment> segments = {}, std::shared_ptr<const void> hold = nullptr);
+
+	/// <summary>
+	/// Point the view at another event, reusing its memory
+	/// </summary>
+	/// <param name="segments">Pieces of the new event. Swapped with the old segments, so that their storage can be reused</param>
+	/// <param name="hold">Keeps the memory of the segments valid while the view refers to them (Default: nullptr)</param>
+	void Reset(std::vector<DTC_EventSegment>& segments, std::shared_ptr<const void> hold = nullptr);
+
+	size_t GetEventByteCount() const { return header_.inclusive_event_byte_count; }
+	DTC_EventWindowTag GetEventWindowTag() const;
+	DTC_EventHeader const& GetHeader() const { return header_; }
+
+	std::vector<DTC_EventSegment> const& GetSegments() const { return segments_; }
+	size_t GetSegmentCount() const { return segments_.size(); }
+	bool IsContiguous() const { return segments_.size() == 1; }
+
+	/// <summary>
+	/// Get the pieces of a byte range of the event, without copying
+	/// </summary>
+	/// <param name="offset">Offset from the start of the event</param>
+	/// <param name="size">Size of the range</param>
+	/// <returns>Segments covering the range, truncated at the end of the event</returns>
+	std::vector<DTC_EventSegment> GetSegments(size_t offset, size_t size) const;
+	/// <summary>
+	/// Copy a byte range of the event into contiguous memory
+	/// </summary>
+	/// <param name="offset">Offset from the start of the event</param>
+	/// <param name="dest">Destination</param>
+	/// <param name="size">Number of bytes to copy</param>
+	/// <returns>Number of bytes copied, less than size at the end of the event</returns>
+	size_t CopyBytes(size_t offset, void* dest, size_t size) const;
+
+	/// <summary>
+	/// Get the Sub-Events of the event. The headers are parsed on the first call.
+	/// </summary>
+	/// <returns>Locations and headers of the Sub-Events</returns>
+	std::vector<DTC_SubEventRef> const& GetSubEvents() const;
+	size_t GetSubEventCount() const { return GetSubEvents().size(); }
+	/// <summary>
+	/// Get the Data Header packet of a Data Block
+	/// </summary>
+	/// <param name="block">Data Block from GetSubEvents</param>
+	/// <returns>Data Header packet</returns>
+	DTC_DataHeaderPacket GetDataBlockHeader(DTC_DataBlockRef const& block) const;
+	/// <summary>
+	/// Get a Data Block. It points into the DMA buffer unless the block is split between two buffers, in which case it
+	/// owns a copy.
+	/// </summary>
+	/// <param name="block">Data Block from GetSubEvents</param>
+	/// <returns>DTC_DataBlock</returns>
+	DTC_DataBlock GetDataBlock(DTC_DataBlockRef const& block) const;
+
+	/// <summary>
+	/// Copy the event into a DTC_Event which owns its memory
+	/// </summary>
+	/// <param name="numaNode">NUMA node to allocate the copy on (Default: -1, no placement)</param>
+	/// <param name="lazy">Set up the copy in lazy mode, see DTC_Event::SetupEvent (Default: false)</param>
+	/// <returns>DTC_Event</returns>
+	std::unique_ptr<DTC_Event> ToEvent(int numaNode = -1, bool lazy = false) const;
+	/// <summary>
+	/// Copy the Sub-Events and Data Blocks selected by a filter into a DTC_Event which owns its memory. Only the headers
+	/// are read to decide; the rest of the event is not copied. The byte counts, Sub-Event count and ROC counts in the
+	/// headers of the copy are updated.
+	/// </summary>
+	/// <param name="filter">Readout filter</param>
+	/// <param name="stats">Filter counters to update</param>
+	/// <param name="numaNode">NUMA node to allocate the copy on (Default: -1, no placement)</param>
+	/// <param name="lazy">Set up the copy in lazy mode, see DTC_Event::SetupEvent (Default: false)</param>
+	/// <returns>DTC_Event, without Sub-Events if none were selected</returns>
+	std::unique_ptr<DTC_Event> ToFilteredEvent(DTC_ReadoutFilter const& filter, DTC_FilterStats& stats, int numaNode = -1, bool lazy = false) const;
+	/// <summary>
+	/// First half of ToFilteredEvent: find the Sub-Events and Data Blocks selected by a filter, from their headers.
+	/// The filter counters are updated as if the selection was copied.
+	/// </summary>
+	/// <param name="filter">Readout filter</param>
+	/// <param name="stats">Filter counters to update</param>
+	/// <param name="kept">Output: the kept Sub-Events, with updated headers and the byte ranges to copy as blocks</param>
+	/// <returns>Byte count of the filtered event</returns>
+	size_t SelectFiltered(DTC_ReadoutFilter const& filter, DTC_FilterStats& stats, std::vector<DTC_SubEventRef>& kept) const;
+	/// <summary>
+	/// Second half of ToFilteredEvent: write the selection made by SelectFiltered to contiguous memory
+	/// </summary>
+	/// <param name="kept">Sub-Events from SelectFiltered</param>
+	/// <param name="byteCount">Byte count returned by SelectFiltered</param>
+	/// <param name="dest">Destination, at least byteCount bytes</param>
+	void CopyFiltered(std::vector<DTC_SubEventRef> const& kept, size_t byteCount, void* dest) const;
+
+private:
+	void ParseSubEvents() const;
+
+	std::vector<DTC_EventSegment> segments_;
+	std::shared_ptr<const void> hold_;
+	DTC_EventHeader header_;
+	mutable std::vector<DTC_SubEventRef> sub_events_;
+	mutable bool parsed_;
 };
 
 }  // namespace DTCLib
@@ -0,0 +1,242 @@
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "DTC_Pipeline"
+
+#define TLVL_Reader TLVL_DEBUG + 5
+#define TLVL_Output TLVL_DEBUG + 6
+
+#include "DTC_Pipeline.h"
+
+DTCLib::DTC_Pipeline::DTC_Pipeline(DTC* dtc, WorkerFunction worker, OutputFunction output, DTC_PipelineConfig config)
+	: dtc_(dtc)
+	, workFunction_(worker)
+	, outputFunction_(output)
+	, config_(config)
+	, window_(0)
+	, inputQueue_(config.inputDepth > 0 ? config.inputDepth : 1)
+	, outputQueue_(config.outputDepth > 0 ? config.outputDepth : 1)
+	, stop_(false)
+	, abort_(false)
+	, readerDone_(false)
+	, workersRunning_(0)
+	, running_(false)
+	, read_(0)
+	, bad_(0)
+	, delivered_(0)
+	, readerWaits_(0)
+	, outOfOrder_(0)
+	, readErrors_(0)
+	, maxReordered_(0)
+	, readerThread_()
+	, workerThreads_()
+	, outputThread_()
+{
+	if (config_.workers == 0) config_.workers = 1;
+	window_ = inputQueue_.Capacity() + outputQueue_.Capacity();
+}
+
+DTCLib::DTC_Pipeline::~DTC_Pipeline()
+{
+	Stop();
+	Wait();
+}
+
+void DTCLib::DTC_Pipeline::Start()
+{
+	if (readerThread_.joinable())
+	{
+		TLOG(TLVL_WARNING) << "Start: The pipeline is already running";
+		return;
+	}
+	TLOG(TLVL_DEBUG) << "Start: " << config_.workers << " workers, queue depths " << inputQueue_.Capacity() << " and "
+					 << outputQueue_.Capacity() << (config_.copyEvents ? ", copying events" : "");
+	running_ = true;
+	workersRunning_ = config_.workers;
+	outputThread_ = std::thread(&DTC_Pipeline::OutputLoop, this);
+	for (unsigned worker = 0; worker < config_.workers; ++worker) workerThreads_.emplace_back(&DTC_Pipeline::WorkLoop, this, worker);
+	readerThread_ = std::thread(&DTC_Pipeline::ReadLoop, this);
+}
+
+void DTCLib::DTC_Pipeline::Wait()
+{
+	if (readerThread_.joinable()) readerThread_.join();
+	for (auto& thread : workerThreads_)
+		if (thread.joinable()) thread.join();
+	workerThreads_.clear();
+	if (outputThread_.joinable()) outputThread_.join();
+}
+
+void DTCLib::DTC_Pipeline::ReadLoop()
+{
+	dtc_->SetReaderAffinity(config_.readerCpus);
+
+	uint64_t sequence = 0;
+	unsigned idle_us = 1;
+	while (!stop_ && !abort_)
+	{
+		// Events in flight may hold the whole DMA ring, and their buffers can only be given back from this thread:
+		// do not sit in a blocking read while any are out
+		auto inFlight = sequence > delivered_.load(std::memory_order_acquire);
+		DTC_PipelineEvent event;
+		auto sts = DTC_ReadStatus_OK;
+		try
+		{
+			dtc_->ReleaseDAQBuffers();
+			sts = dtc_->TryReadNextDAQEventView(event.view, inFlight ? 0 : config_.readTimeoutMs);
+		}
+		catch (std::exception& ex)
+		{
+			TLOG(TLVL_ERROR) << "ReadLoop: Reading event " << sequence << " failed, stopping: " << ex.what();
+			readErrors_++;
+			break;
+		}
+		if (sts == DTC_ReadStatus_IOError)
+		{
+			TLOG(TLVL_ERROR) << "ReadLoop: I/O error reading event " << sequence << ", stopping";
+			readErrors_++;
+			break;
+		}
+		if (sts != DTC_ReadStatus_OK)
+		{
+			// Bad data has been skipped by the DTC; just go on
+			if (sts != DTC_ReadStatus_Timeout) readErrors_++;
+			if (inFlight) mu2e_wait_step(config_.wait, idle_us);
+			continue;
+		}
+		idle_us = 1;
+
+		TLOG(TLVL_Reader) << "ReadLoop: Event " << sequence << ", tag 0x" << std::hex << event.view->GetEventWindowTag().GetEventWindowTag(true);
+		event.sequence = sequence++;
+		read_.store(sequence, std::memory_order_relaxed);
+
+		// The output stage has room for window_ events beyond the last one delivered
+		unsigned backoff_us = 1;
+		auto waited = false;
+		while (event.sequence - delivered_.load(std::memory_order_acquire) >= window_ || !inputQueue_.TryPush(event))
+		{
+			if (abort_) break;
+			if (!waited) readerWaits_++;
+			waited = true;
+			mu2e_wait_step(config_.wait, backoff_us);
+		}
+	}
+	TLOG(TLVL_DEBUG) << "ReadLoop: Done after " << sequence << " events";
+	readerDone_ = true;
+}
+
+void DTCLib::DTC_Pipeline::WorkLoop(unsigned worker)
+{
+	DTC_PipelineEvent event;
+	unsigned backoff_us = 1;
+	while (!abort_)
+	{
+		// Once the reader is done, an empty queue stays empty
+		auto readerDone = readerDone_.load();
+		if (!inputQueue_.TryPop(event))
+		{
+			if (readerDone) break;
+			mu2e_wait_step(config_.wait, backoff_us);
+			continue;
+		}
+		backoff_us = 1;
+
+		try
+		{
+			if (config_.copyEvents)
+			{
+				event.event = event.view->ToEvent(dtc_->GetNumaNode());
+				event.view.reset();
+			}
+			else
+			{
+				event.view->GetSubEvents();
+			}
+			if (workFunction_) event.good = workFunction_(event, worker);
+		}
+		catch (std::exception& ex)
+		{
+			TLOG(TLVL_WARNING) << "WorkLoop: Worker " << worker << " failed on event " << event.sequence << ": " << ex.what();
+			event.good = false;
+		}
+		if (!event.good) bad_++;
+
+		while (!outputQueue_.TryPush(event) && !abort_) mu2e_wait_step(config_.wait, backoff_us);
+		backoff_us = 1;
+	}
+	workersRunning_--;
+}
+
+void DTCLib::DTC_Pipeline::OutputLoop()
+{
+	// Events that arrived before an earlier one, indexed by sequence number; the reader keeps them within window_
+	std::vector<DTC_PipelineEvent> reordered(window_);
+	std::vector<bool> present(window_, false);
+	uint64_t next = 0;
+	size_t held = 0;
+
+	DTC_PipelineEvent event;
+	unsigned backoff_us = 1;
+	while (!abort_)
+	{
+		auto workersDone = workersRunning_.load() == 0;
+		if (!outputQueue_.TryPop(event))
+		{
+			if (workersDone) break;
+			mu2e_wait_step(config_.wait, backoff_us);
+			continue;
+		}
+		backoff_us = 1;
+
+		auto slot = event.sequence % window_;
+		reordered[slot] = std::move(event);
+		present[slot] = true;
+		++held;
+
+		while (present[next % window_])
+		{
+			slot = next % window_;
+			present[slot] = false;
+			--held;
+
+			auto keepGoing = false;
+			try
+			{
+				keepGoing = outputFunction_(reordered[slot]);
+			}
+			catch (std::exception& ex)
+			{
+				TLOG(TLVL_ERROR) << "OutputLoop: Output function failed on event " << next << ": " << ex.what();
+			}
+			reordered[slot] = DTC_PipelineEvent();  // Lets the DTC have the event's buffers back
+			delivered_.store(++next, std::memory_order_release);
+
+			if (!keepGoing)
+			{
+				TLOG(TLVL_DEBUG) << "OutputLoop: Stopping the pipeline after event " << next - 1;
+				stop_ = true;
+				abort_ = true;
+				break;
+			}
+		}
+		if (held > 0)
+		{
+			outOfOrder_++;
+			TLOG(TLVL_Output) << "OutputLoop: Waiting for event " << next << ", " << held << " later events held";
+			if (held > maxReordered_) maxReordered_ = held;
+		}
+	}
+	if (held > 0 && !abort_) TLOG(TLVL_WARNING) << "OutputLoop: " << held << " events were never delivered, event " << next << " is missing";
+	running_ = false;
+}
+
+DTCLib::DTC_PipelineStats DTCLib::DTC_Pipeline::GetStats() const
+{
+	DTC_PipelineStats stats;
+	stats.read = read_.load(std::memory_order_relaxed);
+	stats.bad = bad_.load(std::memory_order_relaxed);
+	stats.delivered = delivered_.load(std::memory_order_relaxed);
+	stats.readerWaits = readerWaits_.load(std::memory_order_relaxed);
+	stats.outOfOrder = outOfOrder_.load(std::memory_order_relaxed);
+	stats.readErrors = readErrors_.load(std::memory_order_relaxed);
+	stats.maxReordered = maxReordered_.load(std::memory_order_relaxed);
+	return stats;
+}
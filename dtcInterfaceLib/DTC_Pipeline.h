@@ -0,0 +1,159 @@
+#ifndef DTC_PIPELINE_H
+#define DTC_PIPELINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DTC.h"
+#include "DTC_RingQueue.h"
+#include "mu2ewait.h"
+
+namespace DTCLib {
+/// <summary>
+/// An event travelling through a DTC_Pipeline
+/// </summary>
+struct DTC_PipelineEvent
+{
+	uint64_t sequence{0};                 ///< Position of the event in readout order
+	std::unique_ptr<DTC_EventView> view;  ///< Event in the DMA buffers. Dropped by the workers when copyEvents is set.
+	std::unique_ptr<DTC_Event> event;     ///< Copy of the event, made by the workers when copyEvents is set
+	bool good{true};                      ///< Verdict of the worker function
+};
+
+/// <summary>
+/// Thread counts and queue depths of a DTC_Pipeline
+/// </summary>
+struct DTC_PipelineConfig
+{
+	unsigned workers{2};                       ///< Number of parse/verify threads
+	size_t inputDepth{64};                     ///< Slots in the queue from the reader to the workers
+	size_t outputDepth{64};                    ///< Slots in the queue from the workers to the output stage
+	bool copyEvents{false};                    ///< Have the workers copy each event into a DTC_Event, giving its DMA buffers back early
+	int readTimeoutMs{10};                     ///< Timeout of reads while no event is in flight; the reader checks for Stop() this often
+	mu2e_wait_strategy wait{MU2E_WAIT_BLOCK};  ///< How the stages wait on an empty or full queue
+	std::string readerCpus{""};                ///< CPUs for the reader thread, see DTC::SetReaderAffinity (Default: DTCLIB_READER_CPUS)
+};
+
+/// <summary>
+/// Counters of a DTC_Pipeline
+/// </summary>
+struct DTC_PipelineStats
+{
+	uint64_t read{0};          ///< Events read from the DTC
+	uint64_t bad{0};           ///< Events rejected by the worker function
+	uint64_t delivered{0};     ///< Events passed to the output function
+	uint64_t readerWaits{0};   ///< Times the reader waited for room in the pipeline
+	uint64_t outOfOrder{0};    ///< Events that reached the output stage before an earlier one, and were held back
+	uint64_t readErrors{0};    ///< Failed reads. Bad data is skipped; an I/O error or exception stops the reader.
+	size_t maxReordered{0};    ///< Most events held back at once by the output stage
+};
+
+/// <summary>
+/// Reads the DAQ channel of a DTC with one dedicated thread, parses and checks the events on a pool of worker
+/// threads, and hands them to an output function in readout order (which is event window tag order) on a last thread.
+/// The stages are connected by bounded DTC_RingQueues; at most inputDepth + outputDepth events are in the pipeline,
+/// so a slow worker holds the reader back instead of letting the output stage buffer without limit.
+///
+/// Events stay in the DMA buffers as DTC_EventViews until they are delivered, unless copyEvents is set. The DMA ring
+/// must then have room for the events in flight: with small rings, use shallow queues or copyEvents.
+/// While the pipeline runs, the DTC's DAQ channel must not be read by any other thread.
+/// </summary>
+class DTC_Pipeline
+{
+public:
+	/// <summary>
+	/// Called on a worker thread for each event, after its Sub-Events have been parsed (or it has been copied).
+	/// Returns the verdict stored in event.good.
+	/// </summary>
+	typedef std::function<bool(DTC_PipelineEvent& event, unsigned worker)> WorkerFunction;
+	/// <summary>
+	/// Called on the output thread for each event, in readout order. Return false to stop the pipeline; events not
+	/// yet delivered are then dropped.
+	/// </summary>
+	typedef std::function<bool(DTC_PipelineEvent& event)> OutputFunction;
+
+	/// <summary>
+	/// Construct a DTC_Pipeline. No thread is started until Start().
+	/// </summary>
+	/// <param name="dtc">DTC to read, which must outlive the pipeline</param>
+	/// <param name="worker">Parse/verify function, may be empty</param>
+	/// <param name="output">Function receiving the events in order</param>
+	/// <param name="config">Thread counts and queue depths</param>
+	DTC_Pipeline(DTC* dtc, WorkerFunction worker, OutputFunction output, DTC_PipelineConfig config = DTC_PipelineConfig());
+	/// <summary>
+	/// Stops the pipeline, delivering the events already read, and waits for its threads
+	/// </summary>
+	~DTC_Pipeline();
+
+	DTC_Pipeline(const DTC_Pipeline&) = delete;
+	DTC_Pipeline& operator=(const DTC_Pipeline&) = delete;
+
+	/// <summary>
+	/// Start the reader, worker and output threads
+	/// </summary>
+	void Start();
+	/// <summary>
+	/// Stop reading. The events already read still go through the workers and the output function.
+	/// May be called from any thread, including from the worker and output functions.
+	/// </summary>
+	void Stop() { stop_ = true; }
+	/// <summary>
+	/// Wait until the threads have finished, after Stop(), a read error, or the output function returning false
+	/// </summary>
+	void Wait();
+	/// <summary>
+	/// Whether the output stage is still running
+	/// </summary>
+	/// <returns>True between Start() and the delivery of the last event</returns>
+	bool IsRunning() const { return running_; }
+
+	/// <summary>
+	/// Get the counters of the pipeline
+	/// </summary>
+	/// <returns>Copy of the counters</returns>
+	DTC_PipelineStats GetStats() const;
+	/// <summary>
+	/// Get the configuration of the pipeline
+	/// </summary>
+	/// <returns>Configuration</returns>
+	DTC_PipelineConfig const& GetConfig() const { return config_; }
+
+private:
+	void ReadLoop();
+	void WorkLoop(unsigned worker);
+	void OutputLoop();
+
+	DTC* dtc_;
+	WorkerFunction workFunction_;
+	OutputFunction outputFunction_;
+	DTC_PipelineConfig config_;
+	size_t window_;  // Most events in the pipeline at once
+	DTC_RingQueue<DTC_PipelineEvent> inputQueue_;
+	DTC_RingQueue<DTC_PipelineEvent> outputQueue_;
+
+	std::atomic<bool> stop_;
+	std::atomic<bool> abort_;
+	std::atomic<bool> readerDone_;
+	std::atomic<unsigned> workersRunning_;
+	std::atomic<bool> running_;
+
+	std::atomic<uint64_t> read_;
+	std::atomic<uint64_t> bad_;
+	std::atomic<uint64_t> delivered_;
+	std::atomic<uint64_t> readerWaits_;
+	std::atomic<uint64_t> outOfOrder_;
+	std::atomic<uint64_t> readErrors_;
+	std::atomic<size_t> maxReordered_;
+
+	std::thread readerThread_;
+	std::vector<std::thread> workerThreads_;
+	std::thread outputThread_;
+};
+}  // namespace DTCLib
+
+#endif  // DTC_PIPELINE_H
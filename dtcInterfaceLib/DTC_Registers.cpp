@@ -91,7 +91,7 @@ DTCLib::DTC_SimMode DTCLib::DTC_Registers::SetSimMode(std::string expectedDesign
 	device_.init(simMode_, dtc, simMemoryFile);
 	if (expectedDesignVersion != "" && expectedDesignVersion != ReadDesignVersion())
 	{
-		throw new DTC_WrongVersionException(expectedDesignVersion, ReadDesignVersion());
+		throw DTC_WrongVersionException(expectedDesignVersion, ReadDesignVersion());
 	}
 
 	if (skipInit) return simMode_;
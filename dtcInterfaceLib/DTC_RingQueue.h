@@ -0,0 +1,122 @@
+#ifndef DTC_RINGQUEUE_H
+#define DTC_RINGQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace DTCLib {
+/// <summary>
+/// Bounded lock-free queue for handing items from one thread to another. Any number of threads may push and pop,
+/// so the same queue serves single-producer/single-consumer and many-to-many stages.
+/// Each slot carries a sequence number saying whether it is ready to be written or read in the current lap of the
+/// ring, so a push or a pop is a single compare-and-swap on the shared position. Items are moved in and out.
+/// </summary>
+template<class T>
+class DTC_RingQueue
+{
+public:
+	/// <summary>
+	/// Construct a DTC_RingQueue
+	/// </summary>
+	/// <param name="capacity">Number of slots, rounded up to a power of two</param>
+	explicit DTC_RingQueue(size_t capacity)
+		: cells_(), mask_(0), pushPos_(0), popPos_(0)
+	{
+		size_t size = 2;
+		while (size < capacity) size <<= 1;
+		mask_ = size - 1;
+		cells_.reset(new Cell[size]);
+		for (size_t ii = 0; ii < size; ++ii) cells_[ii].sequence.store(ii, std::memory_order_relaxed);
+	}
+
+	DTC_RingQueue(const DTC_RingQueue&) = delete;
+	DTC_RingQueue& operator=(const DTC_RingQueue&) = delete;
+
+	/// <summary>
+	/// Add an item at the back of the queue
+	/// </summary>
+	/// <param name="item">Item, moved from on success</param>
+	/// <returns>False if the queue is full</returns>
+	bool TryPush(T& item)
+	{
+		auto pos = pushPos_.load(std::memory_order_relaxed);
+		while (true)
+		{
+			auto& cell = cells_[pos & mask_];
+			auto diff = static_cast<intptr_t>(cell.sequence.load(std::memory_order_acquire)) - static_cast<intptr_t>(pos);
+			if (diff == 0)
+			{
+				if (pushPos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					cell.value = std::move(item);
+					cell.sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = pushPos_.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Take the item at the front of the queue
+	/// </summary>
+	/// <param name="item">Output: the item</param>
+	/// <returns>False if the queue is empty</returns>
+	bool TryPop(T& item)
+	{
+		auto pos = popPos_.load(std::memory_order_relaxed);
+		while (true)
+		{
+			auto& cell = cells_[pos & mask_];
+			auto diff = static_cast<intptr_t>(cell.sequence.load(std::memory_order_acquire)) - static_cast<intptr_t>(pos + 1);
+			if (diff == 0)
+			{
+				if (popPos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					item = std::move(cell.value);
+					cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = popPos_.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Get the number of slots
+	/// </summary>
+	/// <returns>Capacity of the queue</returns>
+	size_t Capacity() const { return mask_ + 1; }
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	std::unique_ptr<Cell[]> cells_;
+	size_t mask_;
+	alignas(64) std::atomic<size_t> pushPos_;  // Producers and consumers on separate cache lines
+	alignas(64) std::atomic<size_t> popPos_;
+};
+}  // namespace DTCLib
+
+#endif  // DTC_RINGQUEUE_H
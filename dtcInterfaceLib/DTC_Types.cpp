@@ -1,5 +1,6 @@
 #include "DTC_Types.h"
 
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
 #include <cmath>
@@ -48,6 +49,8 @@ DTCLib::DTC_SimMode DTCLib::DTC_SimModeConverter::ConvertToSimMode(std::string m
 				{
 					case '0':
 						return DTC_SimMode_Event;
+					case '1':
+						return DTC_SimMode_SharedMemory;
 					default:
 						break;
 				}
@@ -92,6 +95,9 @@ DTCLib::DTC_SimMode DTCLib::DTC_SimModeConverter::ConvertToSimMode(std::string m
 		case 'e':
 		case 'E':
 			return DTC_SimMode_Event;
+		case 's':
+		case 'S':
+			return DTC_SimMode_SharedMemory;
 
 		case '0':
 			return DTC_SimMode_Disabled;
@@ -110,6 +116,18 @@ DTCLib::DTC_SimMode DTCLib::DTC_SimModeConverter::ConvertToSimMode(std::string m
 	}
 }
 
+DTCLib::DTC_ReleasePolicy DTCLib::DTC_ReleasePolicyConverter::ConvertToReleasePolicy(std::string policyName)
+{
+	std::transform(policyName.begin(), policyName.end(), policyName.begin(), ::tolower);
+	for (auto policy = 0; policy < DTC_ReleasePolicy_Invalid; ++policy)
+	{
+		auto name = DTC_ReleasePolicyConverter(static_cast<DTC_ReleasePolicy>(policy)).toString();
+		std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+		if (name == policyName) return static_cast<DTC_ReleasePolicy>(policy);
+	}
+	return DTC_ReleasePolicy_Invalid;
+}
+
 DTCLib::DTC_EventWindowTag::DTC_EventWindowTag()
 	: event_tag_(0) {}
 
@@ -397,6 +397,7 @@ struct DTC_SERDESLoopbackModeConverter
 /// DTC_SimMode_NoCFO enables the DTC CFO Emulator to send ReadoutRequest and DataRequest packets.
 /// DTC_SimMode_ROCEmulator enables the DTC ROC Emulator
 /// DTC_SimMode_Loopback enables the SERDES loopback on the DTC
+/// DTC_SimMode_SharedMemory replaces the device with the mu2eshm shared-memory rings, filled by another process
 /// </summary>
 enum DTC_SimMode
 {
@@ -411,6 +412,7 @@ enum DTC_SimMode
 	DTC_SimMode_LargeFile = 8,
 	DTC_SimMode_Timeout = 9,
 	DTC_SimMode_Event = 10,
+	DTC_SimMode_SharedMemory = 11,
 	DTC_SimMode_Invalid,
 };
 
@@ -466,6 +468,8 @@ struct DTC_SimModeConverter
 				return "Timeout";
 			case DTC_SimMode_Event:
 				return "Event";
+			case DTC_SimMode_SharedMemory:
+				return "SharedMemory";
 			case DTC_SimMode_Disabled:
 			default:
 				return "Disabled";
@@ -485,6 +489,163 @@ struct DTC_SimModeConverter
 	}
 };
 
+/// <summary>
+/// The DTC_ReleasePolicy enumeration controls when the DTC class gives finished DAQ buffers back to the DTC.
+///
+/// DTC_ReleasePolicy_Eager releases finished buffers on every GetData call (one read_release per call)
+/// DTC_ReleasePolicy_Count waits until the given number of buffers are finished
+/// DTC_ReleasePolicy_Age waits until the oldest finished buffer has waited for the given number of microseconds
+/// DTC_ReleasePolicy_Watermark waits until the held buffers fill the given percentage of the receive ring
+/// </summary>
+enum DTC_ReleasePolicy
+{
+	DTC_ReleasePolicy_Eager = 0,
+	DTC_ReleasePolicy_Count = 1,
+	DTC_ReleasePolicy_Age = 2,
+	DTC_ReleasePolicy_Watermark = 3,
+	DTC_ReleasePolicy_Invalid,
+};
+
+/// <summary>
+/// The DTC_ReleasePolicyConverter converts a DTC_ReleasePolicy enumeration value to string or JSON representation
+/// </summary>
+struct DTC_ReleasePolicyConverter
+{
+	DTC_ReleasePolicy policy_;  ///< DTC_ReleasePolicy to convert to string
+
+	/// <summary>
+	/// Construct a DTC_ReleasePolicyConverter instance using the given DTC_ReleasePolicy
+	/// </summary>
+	/// <param name="policy">DTC_ReleasePolicy to convert</param>
+	explicit DTC_ReleasePolicyConverter(DTC_ReleasePolicy policy)
+		: policy_(policy) {}
+
+	/// <summary>
+	/// Parse a string and return the DTC_ReleasePolicy which corresponds to it (see toString(), case-insensitive)
+	/// </summary>
+	/// <param name="s">String to parse</param>
+	/// <returns>DTC_ReleasePolicy corresponding to string, DTC_ReleasePolicy_Invalid if there is none</returns>
+	static DTC_ReleasePolicy ConvertToReleasePolicy(std::string s);
+
+	/// <summary>
+	/// Convert the DTC_ReleasePolicy to its string representation
+	/// </summary>
+	/// <returns>String representation of DTC_ReleasePolicy</returns>
+	std::string toString() const
+	{
+		switch (policy_)
+		{
+			case DTC_ReleasePolicy_Eager:
+				return "Eager";
+			case DTC_ReleasePolicy_Count:
+				return "Count";
+			case DTC_ReleasePolicy_Age:
+				return "Age";
+			case DTC_ReleasePolicy_Watermark:
+				return "Watermark";
+			case DTC_ReleasePolicy_Invalid:
+			default:
+				return "Invalid";
+		}
+	}
+
+	/// <summary>
+	/// Write a DTC_ReleasePolicyConverter in JSON format to the given stream
+	/// </summary>
+	/// <param name="stream">Stream to write</param>
+	/// <param name="policy">DTC_ReleasePolicyConverter to serialize</param>
+	/// <returns>Stream reference for continued streaming</returns>
+	friend std::ostream& operator<<(std::ostream& stream, const DTC_ReleasePolicyConverter& policy)
+	{
+		stream << "\"DTC_ReleasePolicy\":\"" << policy.toString() << "\"";
+		return stream;
+	}
+};
+
+/// <summary>
+/// The DTC_ReadStatus enumeration is the result of the status-returning readout functions of the DTC class
+/// (TryGetData, TryReadNextDAQEventView, ...), which report errors without throwing.
+///
+/// DTC_ReadStatus_OK: Data was returned
+/// DTC_ReadStatus_Timeout: No data arrived within the timeout
+/// DTC_ReadStatus_IOError: The device returned an error; the exception-throwing functions throw DTC_IOErrorException
+/// DTC_ReadStatus_BadByteCount: An event had an impossible byte count; the rest of its DMA buffer was skipped
+/// DTC_ReadStatus_WrongPacketType: A packet was not of the expected type, and was skipped
+/// DTC_ReadStatus_NotFound: The next event did not have the requested event window tag
+/// DTC_ReadStatus_InvalidChannel: The DMA channel does not exist
+/// DTC_ReadStatus_Incomplete: The deadline passed before all expected contributors of an event window were read
+/// DTC_ReadStatus_NoMemory: The allocator given to DTC::ReadNextDAQEventInto returned no memory; the event is read again next time
+/// </summary>
+enum DTC_ReadStatus
+{
+	DTC_ReadStatus_OK = 0,
+	DTC_ReadStatus_Timeout = 1,
+	DTC_ReadStatus_IOError = 2,
+	DTC_ReadStatus_BadByteCount = 3,
+	DTC_ReadStatus_WrongPacketType = 4,
+	DTC_ReadStatus_NotFound = 5,
+	DTC_ReadStatus_InvalidChannel = 6,
+	DTC_ReadStatus_Incomplete = 7,
+	DTC_ReadStatus_NoMemory = 8,
+};
+
+/// <summary>
+/// The DTC_ReadStatusConverter converts a DTC_ReadStatus enumeration value to string or JSON representation
+/// </summary>
+struct DTC_ReadStatusConverter
+{
+	DTC_ReadStatus status_;  ///< DTC_ReadStatus to convert to string
+
+	/// <summary>
+	/// Construct a DTC_ReadStatusConverter instance using the given DTC_ReadStatus
+	/// </summary>
+	/// <param name="status">DTC_ReadStatus to convert</param>
+	explicit DTC_ReadStatusConverter(DTC_ReadStatus status)
+		: status_(status) {}
+
+	/// <summary>
+	/// Convert the DTC_ReadStatus to its string representation
+	/// </summary>
+	/// <returns>String representation of DTC_ReadStatus</returns>
+	std::string toString() const
+	{
+		switch (status_)
+		{
+			case DTC_ReadStatus_OK:
+				return "OK";
+			case DTC_ReadStatus_Timeout:
+				return "Timeout";
+			case DTC_ReadStatus_IOError:
+				return "IOError";
+			case DTC_ReadStatus_BadByteCount:
+				return "BadByteCount";
+			case DTC_ReadStatus_WrongPacketType:
+				return "WrongPacketType";
+			case DTC_ReadStatus_NotFound:
+				return "NotFound";
+			case DTC_ReadStatus_Incomplete:
+				return "Incomplete";
+			case DTC_ReadStatus_NoMemory:
+				return "NoMemory";
+			case DTC_ReadStatus_InvalidChannel:
+			default:
+				return "InvalidChannel";
+		}
+	}
+
+	/// <summary>
+	/// Write a DTC_ReadStatusConverter in JSON format to the given stream
+	/// </summary>
+	/// <param name="stream">Stream to write</param>
+	/// <param name="status">DTC_ReadStatusConverter to serialize</param>
+	/// <returns>Stream reference for continued streaming</returns>
+	friend std::ostream& operator<<(std::ostream& stream, const DTC_ReadStatusConverter& status)
+	{
+		stream << "\"DTC_ReadStatus\":\"" << status.toString() << "\"";
+		return stream;
+	}
+};
+
 /// <summary>
 /// A DTC_WrongVersionException is thrown when an attempt to initialize a DTC is made with a certain firmware version
 /// expected, and the firmware does not match that version
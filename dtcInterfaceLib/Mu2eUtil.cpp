@@ -148,6 +148,10 @@ void DTCLib::Mu2eUtil::parse_arguments(int argc, char** argv)
 				{
 					extraReads = DTCLib::Utilities::getLongOptionValue(&optind, &argv);
 				}
+				else if (option == "--latency")
+				{
+					printLatency = true;
+				}
 				else if (option == "--help")
 				{
 					printHelpMsg();
@@ -226,6 +230,7 @@ void DTCLib::Mu2eUtil::read_data()
 		device->read_release(DTC_DMA_Engine_DAQ, 1);
 		if (delay > 0) usleep(delay);
 	}
+	printLatencyHistograms(device);
 	delete thisDTC;
 }
 
@@ -525,6 +530,7 @@ void DTCLib::Mu2eUtil::verify_stream()
 		<< Utilities::FormatByteString((totalBytesWritten + totalBytesRead) / totalTime, "/s") << std::endl
 		<< "Read Rate: " << Utilities::FormatByteString(totalBytesRead / totalReadTime, "/s") << std::endl
 		<< "Device Read Rate: " << Utilities::FormatByteString(totalBytesRead / readDevTime, "/s") << std::endl;
+	printLatencyHistograms(device);
 }
 
 void DTCLib::Mu2eUtil::buffer_test()
@@ -654,6 +660,7 @@ void DTCLib::Mu2eUtil::buffer_test()
 		<< Utilities::FormatByteString((totalBytesWritten + totalBytesRead) / totalTime, "/s") << std::endl
 		<< "Read Rate: " << Utilities::FormatByteString(totalBytesRead / totalReadTime, "/s") << std::endl
 		<< "Device Read Rate: " << Utilities::FormatByteString(totalBytesRead / readDevTime, "/s") << std::endl;
+	printLatencyHistograms(device);
 }
 
 void DTCLib::Mu2eUtil::read_release()
@@ -670,6 +677,7 @@ void DTCLib::Mu2eUtil::read_release()
 		TLOG(TLVL_TRACE + 10) << "util - release/read for DAQ and DCS ii=" << ii << ", stsRD=" << stsRD << ", stsRL=" << stsRL << ", buffer=" << buffer;
 		if (delay > 0) usleep(delay);
 	}
+	printLatencyHistograms(&device);
 }
 
 void DTCLib::Mu2eUtil::program_clock()
@@ -807,11 +815,39 @@ void DTCLib::Mu2eUtil::printHelpMsg()
 		<< "    --binary-file-mode: Write DMA sizes to <file> along with read data, to generate a new binary file for detector emulator mode (not compatible with -f)" << std::endl
 		<< "    --stop-verify: If a verify_stream mode error occurs, stop processing" << std::endl
 		<< "    --stop-on-timeout: Stop verify_stream or buffer_test mode if a timeout is detected (0xCAFE in first packet of buffer)" << std::endl
-		<< "    --extra-reads: Number of extra DMA reads to attempt in verify_stream and buffer_test modes (Default: 1)" << std::endl;
+		<< "    --extra-reads: Number of extra DMA reads to attempt in verify_stream and buffer_test modes (Default: 1)" << std::endl
+		<< "    --latency: Print per-operation device latency percentiles (p50, p99, p99.9) at the end of read_data, verify_stream, buffer_test and read_release" << std::endl;
 
 	exit(0);
 }
 
+void DTCLib::Mu2eUtil::printLatencyHistograms(mu2edev* device)
+{
+	if (!printLatency) return;
+
+	std::ostringstream ss;
+	ss << "Device call latency:" << std::endl
+	   << std::left << std::setw(16) << "operation" << std::setw(5) << "chn" << std::right << std::setw(10) << "count"
+	   << std::setw(12) << "mean" << std::setw(12) << "p50" << std::setw(12) << "p99" << std::setw(12) << "p99.9"
+	   << std::setw(12) << "max" << std::endl;
+	for (int op = 0; op < MU2E_OP_COUNT; ++op)
+	{
+		for (int chn = 0; chn < MU2E_MAX_CHANNELS; ++chn)
+		{
+			auto histogram = device->GetLatencyHistogram(static_cast<mu2e_dev_operation>(op), chn);
+			if (histogram.count == 0) continue;
+			ss << std::left << std::setw(16) << mu2edev::GetOperationName(static_cast<mu2e_dev_operation>(op)) << std::setw(5)
+			   << chn << std::right << std::setw(10) << histogram.count << std::setw(12)
+			   << Utilities::FormatTimeString(histogram.mean() / 1e9) << std::setw(12)
+			   << Utilities::FormatTimeString(histogram.percentile(0.5) / 1e9) << std::setw(12)
+			   << Utilities::FormatTimeString(histogram.percentile(0.99) / 1e9) << std::setw(12)
+			   << Utilities::FormatTimeString(histogram.percentile(0.999) / 1e9) << std::setw(12)
+			   << Utilities::FormatTimeString(histogram.max_ns / 1e9) << std::endl;
+		}
+	}
+	TLOG(TLVL_INFO) << ss.str();
+}
+
 mu2e_databuff_t* DTCLib::Mu2eUtil::readDTCBuffer(mu2edev* device, bool& readSuccess, bool& timeout, size_t& sts, bool continuedMode)
 {
 	mu2e_databuff_t* buffer;
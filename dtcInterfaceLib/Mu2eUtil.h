@@ -10,6 +10,7 @@
 #include <iomanip>
 #include <iostream>
 #include <set>
+#include <sstream>
 #include <string>
 
 #include "TRACE/tracemf.h"
@@ -51,6 +52,8 @@ namespace DTCLib {
 
 		void printHelpMsg();
 
+		void printLatencyHistograms(mu2edev* device);
+
 		mu2e_databuff_t* readDTCBuffer(mu2edev* device, bool& readSuccess, bool& timeout, size_t& sts, bool continuedMode);
 
 		bool incrementTimestamp = true;
@@ -92,6 +95,7 @@ namespace DTCLib {
 		unsigned targetFrequency = 166666667;
 		int clockToProgram = 0;
 		bool useCFODRP = false;
+		bool printLatency = false;
 
 
 		int dtc = -1;
@@ -99,7 +99,7 @@ int main(int argc, char* argv[])
 			// Check for continued DMA
 			if (eventByteCount > dmaReadSize)
 			{
-				auto inmem = std::make_unique<DTCLib::DTC_Event>(eventByteCount);
+				auto inmem = std::make_unique<DTCLib::DTC_Event>(eventByteCount, -1, false);
 				memcpy(const_cast<void*>(inmem->GetRawBufferPointer()), thisEvent->GetRawBufferPointer(), dmaReadSize);
 
 				auto bytes_read = dmaReadSize;
@@ -0,0 +1,209 @@
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "mu2eaffinity"
+
+#include "mu2eaffinity.h"
+
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "mu2e_driver/mu2e_mmap_ioctl.h"  // MU2E_DEV_FILE
+
+// PCI IDs matched by the driver (mu2e_driver/mu2e_pci.h, which is a kernel header)
+#define MU2E_PCI_VENDOR_ID 0x10EE
+#define MU2E_PCI_DEVICE_ID 0x7042
+#define MU2E_PCI_DEVICE_ID_2 0x7043
+// From <numaif.h>, so that libnuma is not needed
+#define MU2E_MPOL_PREFERRED 1
+
+namespace {
+// Read the first line of a sysfs attribute, "" if it does not exist
+std::string read_attribute(std::string const& path)
+{
+	std::ifstream file(path);
+	std::string line;
+	if (!file || !std::getline(file, line)) return "";
+	return line;
+}
+
+int read_node(std::string const& path)
+{
+	auto value = read_attribute(path);
+	if (value == "") return -1;
+	auto node = strtol(value.c_str(), nullptr, 0);
+	return node >= 0 ? node : -1;  // The kernel reports -1 on non-NUMA machines
+}
+
+bool is_mu2e_function(std::string const& dir)
+{
+	auto vendor = strtoul(read_attribute(dir + "/vendor").c_str(), nullptr, 0);
+	auto device = strtoul(read_attribute(dir + "/device").c_str(), nullptr, 0);
+	return vendor == MU2E_PCI_VENDOR_ID && (device == MU2E_PCI_DEVICE_ID || device == MU2E_PCI_DEVICE_ID_2);
+}
+
+size_t page_size() { return sysconf(_SC_PAGE_SIZE); }
+}  // namespace
+
+std::string mu2eaffinity::sysfs_root()
+{
+	auto rootE = getenv("DTCLIB_SYSFS_ROOT");
+	return rootE != nullptr ? rootE : "/sys";
+}
+
+int mu2eaffinity::dtc_numa_node(int dtc)
+{
+	auto root = sysfs_root();
+
+	char devname[16];
+	snprintf(devname, sizeof(devname), MU2E_DEV_FILE, dtc);
+	auto node = read_node(root + "/class/mu2e_dev/" + devname + "/device/numa_node");
+	if (node >= 0)
+	{
+		TLOG(TLVL_DEBUG) << "dtc_numa_node: DTC " << dtc << " is on node " << node << " (from " << devname << ")";
+		return node;
+	}
+
+	// Older drivers do not link the device to its PCI function. The driver numbers the DTCs in probe order,
+	// which is the PCI bus order.
+	auto pciDir = root + "/bus/pci/devices";
+	std::vector<std::string> functions;
+	auto dir = opendir(pciDir.c_str());
+	if (dir == nullptr)
+	{
+		TLOG(TLVL_DEBUG) << "dtc_numa_node: Cannot open " << pciDir << ", NUMA node of DTC " << dtc << " is unknown";
+		return -1;
+	}
+	while (auto entry = readdir(dir))
+	{
+		if (entry->d_name[0] == '.') continue;
+		if (is_mu2e_function(pciDir + "/" + entry->d_name)) functions.push_back(entry->d_name);
+	}
+	closedir(dir);
+	std::sort(functions.begin(), functions.end());
+	if (dtc < 0 || static_cast<size_t>(dtc) >= functions.size())
+	{
+		TLOG(TLVL_DEBUG) << "dtc_numa_node: Found " << functions.size() << " mu2e PCI functions, NUMA node of DTC " << dtc << " is unknown";
+		return -1;
+	}
+	node = read_node(pciDir + "/" + functions[dtc] + "/numa_node");
+	TLOG(TLVL_DEBUG) << "dtc_numa_node: DTC " << dtc << " is PCI function " << functions[dtc] << ", node " << node;
+	return node;
+}
+
+int mu2eaffinity::buffer_numa_node(int dtc)
+{
+	auto nodeE = getenv("DTCLIB_NUMA_NODE");
+	std::string setting = nodeE != nullptr ? nodeE : "auto";
+	if (setting == "auto") return dtc_numa_node(dtc);
+	if (setting == "none") return -1;
+	char* end;
+	auto node = strtol(setting.c_str(), &end, 0);
+	if (*end != '\0' || node < 0)
+	{
+		TLOG(TLVL_WARNING) << "buffer_numa_node: Invalid DTCLIB_NUMA_NODE value \"" << setting << "\", using auto";
+		return dtc_numa_node(dtc);
+	}
+	return node;
+}
+
+std::string mu2eaffinity::node_cpulist(int node)
+{
+	if (node < 0) return "";
+	return read_attribute(sysfs_root() + "/devices/system/node/node" + std::to_string(node) + "/cpulist");
+}
+
+int mu2eaffinity::parse_cpulist(std::string const& cpulist, cpu_set_t* cpus)
+{
+	CPU_ZERO(cpus);
+	size_t pos = 0;
+	while (pos < cpulist.size())
+	{
+		auto comma = cpulist.find(',', pos);
+		if (comma == std::string::npos) comma = cpulist.size();
+		auto range = cpulist.substr(pos, comma - pos);
+		pos = comma + 1;
+		if (range == "") continue;
+
+		char* end;
+		auto first = strtol(range.c_str(), &end, 10);
+		auto last = first;
+		if (*end == '-') last = strtol(end + 1, &end, 10);
+		if (*end != '\0' || end == range.c_str() || first < 0 || last < first || last >= CPU_SETSIZE) return -1;
+		for (auto cpu = first; cpu <= last; ++cpu) CPU_SET(cpu, cpus);
+	}
+	return CPU_COUNT(cpus);
+}
+
+int mu2eaffinity::pin_thread(std::string const& cpulist)
+{
+	cpu_set_t cpus;
+	if (parse_cpulist(cpulist, &cpus) <= 0)
+	{
+		TLOG(TLVL_WARNING) << "pin_thread: Invalid CPU list \"" << cpulist << "\"";
+		return -1;
+	}
+	auto sts = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+	if (sts != 0)
+	{
+		TLOG(TLVL_WARNING) << "pin_thread: Cannot pin thread to CPUs " << cpulist << ": " << strerror(sts);
+		return -1;
+	}
+	TLOG(TLVL_DEBUG) << "pin_thread: Pinned thread to CPUs " << cpulist;
+	return 0;
+}
+
+int mu2eaffinity::pin_reader_thread(int dtc, std::string cpulist)
+{
+	if (cpulist == "")
+	{
+		auto cpusE = getenv("DTCLIB_READER_CPUS");
+		if (cpusE == nullptr) return 0;
+		cpulist = cpusE;
+	}
+	if (cpulist == "numa")
+	{
+		cpulist = node_cpulist(dtc_numa_node(dtc));
+		if (cpulist == "")
+		{
+			TLOG(TLVL_DEBUG) << "pin_reader_thread: NUMA node of DTC " << dtc << " is unknown, not pinning";
+			return 0;
+		}
+	}
+	return pin_thread(cpulist);
+}
+
+void* mu2eaffinity::allocate(size_t bytes, int node)
+{
+	// Node placement works on whole pages, so small allocations are left to the heap
+	if (node < 0 || bytes < page_size()) return ::operator new(bytes, std::nothrow);
+
+	auto ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ptr == MAP_FAILED) return nullptr;
+	if (node < static_cast<int>(sizeof(unsigned long) * 8))
+	{
+		// Preferred rather than bound: the kernel falls back to other nodes instead of failing
+		unsigned long nodemask = 1UL << node;
+		if (syscall(SYS_mbind, ptr, bytes, MU2E_MPOL_PREFERRED, &nodemask, sizeof(nodemask) * 8, 0) != 0)
+		{
+			TLOG(TLVL_DEBUG + 5) << "allocate: mbind to node " << node << " failed: " << strerror(errno);
+		}
+	}
+	return ptr;
+}
+
+void mu2eaffinity::deallocate(void* ptr, size_t bytes, int node)
+{
+	if (ptr == nullptr) return;
+	if (node < 0 || bytes < page_size())
+		::operator delete(ptr);
+	else
+		munmap(ptr, bytes);
+}
@@ -0,0 +1,135 @@
+#ifndef MU2EAFFINITY_H
+#define MU2EAFFINITY_H
+
+#include <sched.h>
+#include <cstddef>
+#include <new>
+#include <string>
+
+/// <summary>
+/// CPU and NUMA placement for DTC readout.
+///
+/// The NUMA node of a DTC is read from sysfs: /sys/class/mu2e_dev/mu2eX/device/numa_node when the driver links the
+/// device to its PCI function, otherwise the numa_node of the X-th mu2e PCI function in /sys/bus/pci/devices.
+/// The sysfs root can be moved with the DTCLIB_SYSFS_ROOT environment variable (e.g. to a fake tree for testing).
+///
+/// Environment variables:
+/// DTCLIB_NUMA_NODE: node for readout buffers, "auto" (default, the DTC's node), "none", or a node number
+/// DTCLIB_READER_CPUS: CPU list ("0-3,8") for reader threads, or "numa" for the CPUs of the DTC's node
+///
+/// Everything falls back to the unconstrained default (no pinning, normal allocation) when the information is
+/// missing or the kernel refuses the request.
+/// </summary>
+class mu2eaffinity
+{
+public:
+	/// <summary>
+	/// Get the sysfs root, DTCLIB_SYSFS_ROOT or "/sys"
+	/// </summary>
+	/// <returns>sysfs root directory</returns>
+	static std::string sysfs_root();
+
+	/// <summary>
+	/// Find the NUMA node of a DTC's PCI device
+	/// </summary>
+	/// <param name="dtc">DTC index (/dev/mu2eX)</param>
+	/// <returns>NUMA node, or -1 if unknown</returns>
+	static int dtc_numa_node(int dtc);
+
+	/// <summary>
+	/// Get the node readout buffers for a DTC should be allocated on, following DTCLIB_NUMA_NODE
+	/// </summary>
+	/// <param name="dtc">DTC index (/dev/mu2eX)</param>
+	/// <returns>NUMA node, or -1 for no placement</returns>
+	static int buffer_numa_node(int dtc);
+
+	/// <summary>
+	/// Get the CPU list of a NUMA node from sysfs
+	/// </summary>
+	/// <param name="node">NUMA node</param>
+	/// <returns>CPU list (e.g. "0-7,16-23"), or "" if unknown</returns>
+	static std::string node_cpulist(int node);
+
+	/// <summary>
+	/// Parse a CPU list in the kernel's format ("0-3,8,10-11")
+	/// </summary>
+	/// <param name="cpulist">CPU list</param>
+	/// <param name="cpus">Output CPU set</param>
+	/// <returns>Number of CPUs in the set, or -1 if the list cannot be parsed</returns>
+	static int parse_cpulist(std::string const& cpulist, cpu_set_t* cpus);
+
+	/// <summary>
+	/// Pin the calling thread to a CPU list
+	/// </summary>
+	/// <param name="cpulist">CPU list, as for parse_cpulist</param>
+	/// <returns>0 on success, -1 on error</returns>
+	static int pin_thread(std::string const& cpulist);
+
+	/// <summary>
+	/// Pin the calling thread as a reader thread of the given DTC.
+	/// </summary>
+	/// <param name="dtc">DTC index (/dev/mu2eX)</param>
+	/// <param name="cpulist">CPU list, or "numa" for the CPUs of the DTC's node (Default: DTCLIB_READER_CPUS)</param>
+	/// <returns>0 on success or when there is nothing to do, -1 on error</returns>
+	static int pin_reader_thread(int dtc, std::string cpulist = "");
+
+	/// <summary>
+	/// Allocate memory, preferably on the given NUMA node
+	/// </summary>
+	/// <param name="bytes">Size of the allocation</param>
+	/// <param name="node">NUMA node, or -1 for a normal allocation</param>
+	/// <returns>Pointer to the memory, nullptr on failure</returns>
+	static void* allocate(size_t bytes, int node);
+
+	/// <summary>
+	/// Free memory obtained from allocate
+	/// </summary>
+	/// <param name="ptr">Pointer returned by allocate</param>
+	/// <param name="bytes">Size passed to allocate</param>
+	/// <param name="node">Node passed to allocate</param>
+	static void deallocate(void* ptr, size_t bytes, int node);
+};
+
+/// <summary>
+/// Standard allocator placing its memory on a NUMA node with mu2eaffinity::allocate
+/// </summary>
+template<class T>
+class mu2e_numa_allocator
+{
+public:
+	typedef T value_type;
+
+	/// <summary>
+	/// Construct a mu2e_numa_allocator
+	/// </summary>
+	/// <param name="node">NUMA node, or -1 for normal allocations (Default: -1)</param>
+	explicit mu2e_numa_allocator(int node = -1)
+		: node_(node) {}
+	template<class U>
+	mu2e_numa_allocator(mu2e_numa_allocator<U> const& other)
+		: node_(other.node()) {}
+
+	T* allocate(size_t n)
+	{
+		auto ptr = mu2eaffinity::allocate(n * sizeof(T), node_);
+		if (ptr == nullptr) throw std::bad_alloc();
+		return static_cast<T*>(ptr);
+	}
+	void deallocate(T* ptr, size_t n) { mu2eaffinity::deallocate(ptr, n * sizeof(T), node_); }
+
+	/// <summary>
+	/// Get the NUMA node of this allocator
+	/// </summary>
+	/// <returns>NUMA node, or -1</returns>
+	int node() const { return node_; }
+
+	template<class U>
+	bool operator==(mu2e_numa_allocator<U> const& other) const { return node_ == other.node(); }
+	template<class U>
+	bool operator!=(mu2e_numa_allocator<U> const& other) const { return node_ != other.node(); }
+
+private:
+	int node_;
+};
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef MU2EBACKEND_H
+#define MU2EBACKEND_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "mu2ewait.h"
+
+/// <summary>
+/// Send-side counters of a channel
+/// </summary>
+struct mu2e_write_stats
+{
+	uint64_t writes;        ///< Buffers sent
+	uint64_t stalls;        ///< Times a write had to wait for a free buffer
+	uint64_t stall_ns;      ///< Total time spent waiting for free buffers, in nanoseconds
+	uint64_t retries;       ///< Transmit attempts refused by the DTC and retried
+	uint64_t backpressure;  ///< Writes given up with EAGAIN because the wait timed out
+};
+
+/// <summary>
+/// Interface for the device backends used by mu2edev. mu2edev selects a backend in init and forwards every device
+/// call to it. Implementations are mu2edriver (the mu2e kernel driver), mu2esim (the software DTC emulator) and
+/// mu2eshm (a shared-memory loopback with the same ring layout as the driver).
+/// </summary>
+class mu2ebackend
+{
+public:
+	virtual ~mu2ebackend() = default;
+
+	/// <summary>
+	/// Reads every completed buffer on the given channel, up to maxBuffers, in ring order.
+	/// Buffers returned are held until released with read_release.
+	/// </summary>
+	/// <param name="chn">Channel to read</param>
+	/// <param name="buffers">Output array of buffer pointers (at least maxBuffers entries)</param>
+	/// <param name="byteCounts">Output array of buffer byte counts (at least maxBuffers entries)</param>
+	/// <param name="maxBuffers">Maximum number of buffers to return</param>
+	/// <param name="tmo_ms">Timeout for read</param>
+	/// <returns>Number of buffers returned, 0 on timeout. Negative value indicates error.</returns>
+	virtual int read_data_batch(int chn, void** buffers, int* byteCounts, unsigned maxBuffers, int tmo_ms) = 0;
+	/// <summary>
+	/// Release a number of buffers held by the software on the given channel, oldest first
+	/// </summary>
+	/// <param name="chn">Channel to release</param>
+	/// <param name="num">Number of buffers to release</param>
+	/// <returns>0 on success</returns>
+	virtual int read_release(int chn, unsigned num) = 0;
+	/// <summary>
+	/// Release all buffers held by the software on the given channel
+	/// </summary>
+	/// <param name="chn">Channel to release</param>
+	/// <returns>0 on success</returns>
+	virtual int release_all(int chn) = 0;
+	/// <summary>
+	/// Get the number of buffers in the receive (C2S) ring of the given channel
+	/// </summary>
+	/// <param name="chn">Channel</param>
+	/// <returns>Ring size, in buffers</returns>
+	virtual unsigned get_ring_size(int chn) const = 0;
+	/// <summary>
+	/// Write data to the given channel
+	/// </summary>
+	/// <param name="chn">Channel to write</param>
+	/// <param name="buffer">Buffer containing data to write</param>
+	/// <param name="bytes">Size of the buffer, in bytes</param>
+	/// <returns>0 on success, -EAGAIN if no send buffer became free in time</returns>
+	virtual int write_data(int chn, void* buffer, size_t bytes) = 0;
+	/// <summary>
+	/// Get a writable buffer for the next transfer on the given channel. The caller fills it in place and passes it
+	/// to the DTC with write_commit. The channel is reserved for the calling thread until write_commit is called;
+	/// mu2edev::write_acquire wraps the pair in a mu2e_write_reservation so that it is always called.
+	/// </summary>
+	/// <param name="chn">Channel to write</param>
+	/// <param name="tmo_ms">How long to wait for a free buffer</param>
+	/// <returns>Pointer to a buffer of sizeof(mu2e_databuff_t) bytes, or nullptr with errno set (EAGAIN on timeout)</returns>
+	virtual void* write_acquire(int chn, int tmo_ms) = 0;
+	/// <summary>
+	/// Send the buffer obtained from write_acquire
+	/// </summary>
+	/// <param name="chn">Channel to write</param>
+	/// <param name="bytes">Number of bytes to send. 0 gives the buffer back without sending anything.</param>
+	/// <returns>0 on success, -EAGAIN if the DTC did not accept the buffer in time (it is given back unsent)</returns>
+	virtual int write_commit(int chn, size_t bytes) = 0;
+	/// <summary>
+	/// Set how write_data and write_commit wait when the send ring is full
+	/// </summary>
+	/// <param name="strategy">Wait strategy</param>
+	/// <param name="tmo_ms">How long to wait before returning -EAGAIN</param>
+	virtual void set_write_wait(mu2e_wait_strategy /*strategy*/, int /*tmo_ms*/) {}
+	/// <summary>
+	/// Get the send-side counters of a channel
+	/// </summary>
+	/// <param name="chn">Channel</param>
+	/// <returns>Copy of the counters</returns>
+	virtual mu2e_write_stats get_write_stats(int /*chn*/) const { return mu2e_write_stats(); }
+	/// <summary>
+	/// Reset the send-side counters of a channel
+	/// </summary>
+	/// <param name="chn">Channel</param>
+	virtual void reset_write_stats(int /*chn*/) {}
+	/// <summary>
+	/// Read a DTC register
+	/// </summary>
+	/// <param name="address">Address to read</param>
+	/// <param name="tmo_ms">Timeout for read</param>
+	/// <param name="output">Pointer to output word</param>
+	/// <returns>0 on success</returns>
+	virtual int read_register(uint16_t address, int tmo_ms, uint32_t* output) = 0;
+	/// <summary>
+	/// Write to a DTC register
+	/// </summary>
+	/// <param name="address">Address to write</param>
+	/// <param name="tmo_ms">Timeout for write</param>
+	/// <param name="data">Data to write</param>
+	/// <returns>0 on success</returns>
+	virtual int write_register(uint16_t address, int tmo_ms, uint32_t data) = 0;
+	/// <summary>
+	/// Set how long read_data_batch may poll the ring metadata for new completions before waiting in the kernel.
+	/// Backends without mmapped rings ignore this.
+	/// </summary>
+	/// <param name="spin_us">Spin budget, in microseconds. 0 disables polling.</param>
+	virtual void set_poll_spin_us(unsigned /*spin_us*/) {}
+	/// <summary>
+	/// Write out the DMA metadata to screen, if the backend has any
+	/// </summary>
+	virtual void meta_dump() {}
+	/// <summary>
+	/// Gets the file descriptor for the mu2e block device (/dev/mu2eX), if the backend uses one
+	/// </summary>
+	/// <returns>File descriptor, or -1 if the backend does not use a device file</returns>
+	virtual int get_devfd() const { return -1; }
+};
+
+#endif
@@ -11,11 +11,67 @@
 #include "mu2e_driver/mu2e_mmap_ioctl.h"  //
 
 #include <atomic>
+#include <chrono>
+#include <memory>
+#include "mu2ebackend.h"
+#include "mu2ehistogram.h"
 #include "mu2esim.h"
 
 /// <summary>
-/// This class handles the raw interaction with the mu2e device driver
-/// It also will pass through device commands to the mu2esim class if it is active.
+/// Device operations with their own latency histograms in mu2edev
+/// </summary>
+enum mu2e_dev_operation
+{
+	MU2E_OP_READ_DATA = 0,       ///< read_data and read_data_batch
+	MU2E_OP_READ_RELEASE = 1,    ///< read_release and release_all
+	MU2E_OP_WRITE_DATA = 2,      ///< write_data, or write_acquire + write_commit
+	MU2E_OP_READ_REGISTER = 3,   ///< read_register (recorded on channel 0)
+	MU2E_OP_WRITE_REGISTER = 4,  ///< write_register (recorded on channel 0)
+	MU2E_OP_COUNT = 5,
+};
+
+class mu2edev;
+
+/// <summary>
+/// A send buffer reserved by mu2edev::write_acquire. The channel stays reserved for the calling thread until commit
+/// is called; if the reservation is destroyed first (e.g. by an exception while the buffer is filled), the buffer is
+/// given back unsent, so the channel is never left locked.
+/// </summary>
+class mu2e_write_reservation
+{
+public:
+	mu2e_write_reservation(mu2edev* dev, DTC_DMA_Engine chn, void* data)
+		: dev_(dev), chn_(chn), data_(data) {}
+	~mu2e_write_reservation() { commit(0); }
+
+	mu2e_write_reservation(mu2e_write_reservation&& other) noexcept
+		: dev_(other.dev_), chn_(other.chn_), data_(other.data_) { other.data_ = nullptr; }
+	mu2e_write_reservation(const mu2e_write_reservation&) = delete;
+	mu2e_write_reservation& operator=(const mu2e_write_reservation&) = delete;
+	mu2e_write_reservation& operator=(mu2e_write_reservation&&) = delete;
+
+	/// <summary>
+	/// Get the reserved buffer
+	/// </summary>
+	/// <returns>Pointer to a buffer of sizeof(mu2e_databuff_t) bytes, or nullptr if no buffer was reserved (errno is set)</returns>
+	void* data() const { return data_; }
+	/// <summary>
+	/// Send the reserved buffer to the DTC, and end the reservation. Calling it again does nothing.
+	/// </summary>
+	/// <param name="bytes">Number of bytes to send. 0 gives the buffer back without sending anything.</param>
+	/// <returns>0 on success, -EAGAIN if the DTC did not accept the buffer in time (it is given back unsent)</returns>
+	int commit(size_t bytes);
+
+private:
+	mu2edev* dev_;
+	DTC_DMA_Engine chn_;
+	void* data_;
+};
+
+/// <summary>
+/// This class handles the raw interaction with the mu2e device.
+/// Device commands are passed to a backend chosen in init: the mu2e device driver (mu2edriver), the mu2esim
+/// DTC emulator, or the mu2eshm shared-memory loopback.
 /// </summary>
 class mu2edev
 {
@@ -63,7 +119,33 @@ public:
 	void ResetReadSize() { readSize_ = 0; }
 
 	/// <summary>
-	/// Initialize the simulator if simMode requires it, otherwise set up DMA engines
+	/// Get a copy of the latency histogram of one operation on one channel.
+	/// Every call through mu2edev is timed; a read_data_batch call is one sample however many buffers it returns.
+	/// </summary>
+	/// <param name="op">Operation</param>
+	/// <param name="chn">Channel (register operations are recorded on channel 0)</param>
+	/// <returns>Copy of the histogram, empty if op or chn is out of range</returns>
+	mu2ehistogram_snapshot GetLatencyHistogram(mu2e_dev_operation op, int chn) const
+	{
+		if (static_cast<int>(op) < 0 || op >= MU2E_OP_COUNT || chn < 0 || chn >= MU2E_MAX_CHANNELS) return mu2ehistogram_snapshot();
+		return latency_[op][chn].snapshot();
+	}
+
+	/// <summary>
+	/// Get the name of an operation, as used when printing latency histograms
+	/// </summary>
+	/// <param name="op">Operation</param>
+	/// <returns>Name of the operation</returns>
+	static const char* GetOperationName(mu2e_dev_operation op);
+
+	/// <summary>
+	/// Clear the latency histograms of all operations and channels
+	/// </summary>
+	void ResetLatencyHistograms();
+
+	/// <summary>
+	/// Initialize the simulator if simMode requires it, the shared-memory loopback if simMode is
+	/// DTC_SimMode_SharedMemory, otherwise set up DMA engines
 	/// </summary>
 	/// <param name="simMode">Desired simulation mode</param>
 	/// <param name="dtc">Desired DTC card to use (/dev/mu2eX)</param>
@@ -81,7 +163,20 @@ public:
 	/// <returns>Byte count of data read into buffer. Negative value indicates error.</returns>
 	int read_data(DTC_DMA_Engine const& chn, void** buffer, int tmo_ms);
 	/// <summary>
-	/// Release a number of buffers held by the software on the given channel
+	/// Reads every completed buffer on the given channel (up to maxBuffers) at once, in ring order.
+	/// M_IOC_GET_INFO is only issued when the cached channel info shows no unread buffers.
+	/// The returned buffers are held until released with read_release(chn, count).
+	/// </summary>
+	/// <param name="chn">Channel to read</param>
+	/// <param name="buffers">Output array of buffer pointers (at least maxBuffers entries)</param>
+	/// <param name="byteCounts">Output array of buffer byte counts (at least maxBuffers entries)</param>
+	/// <param name="maxBuffers">Maximum number of buffers to return</param>
+	/// <param name="tmo_ms">Timeout for read</param>
+	/// <returns>Number of buffers returned, 0 on timeout. Negative value indicates error.</returns>
+	int read_data_batch(DTC_DMA_Engine const& chn, void** buffers, int* byteCounts, unsigned maxBuffers, int tmo_ms);
+	/// <summary>
+	/// Release a number of buffers held by the software on the given channel, oldest first.
+	/// All num buffers are returned to the hardware with a single M_IOC_BUF_GIVE.
 	/// </summary>
 	/// <param name="chn">Channel to release</param>
 	/// <param name="num">Number of buffers to release</param>
@@ -94,6 +189,13 @@ public:
 	/// <returns>0 on success</returns>
 	int release_all(DTC_DMA_Engine const& chn);
 	/// <summary>
+	/// Get the number of buffers in the receive ring of the given channel (MU2E_NUM_RECV_BUFFS for the driver).
+	/// At most one less than this can be held at once.
+	/// </summary>
+	/// <param name="chn">Channel</param>
+	/// <returns>Ring size, in buffers</returns>
+	unsigned get_ring_size(DTC_DMA_Engine const& chn) { return backend()->get_ring_size(chn); }
+	/// <summary>
 	/// Read a DTC register
 	/// </summary>
 	/// <param name="address">Address to read</param>
@@ -110,6 +212,13 @@ public:
 	/// <returns>0 on success</returns>
 	int write_register(uint16_t address, int tmo_ms, uint32_t data);
 	/// <summary>
+	/// Set how long read_data waits for new DMA completions by polling the ring metadata in user space, before
+	/// falling back to a blocking wait in the driver. The default is taken from the DTCLIB_POLL_SPIN_US environment
+	/// variable (0, polling disabled, if unset).
+	/// </summary>
+	/// <param name="spin_us">Spin budget, in microseconds. 0 disables polling.</param>
+	void set_poll_spin_us(unsigned spin_us) { backend()->set_poll_spin_us(spin_us); }
+	/// <summary>
 	/// Write out the DMA metadata to screen
 	/// </summary>
 	void meta_dump();
@@ -119,9 +228,37 @@ public:
 	/// <param name="chn">Channel to write</param>
 	/// <param name="buffer">Buffer containing data to write</param>
 	/// <param name="bytes">Size of the buffer, in bytes</param>
-	/// <returns>0 on success</returns>
+	/// <returns>0 on success, -EAGAIN if the send ring stayed full for the write timeout (see set_write_wait)</returns>
 	int write_data(DTC_DMA_Engine const& chn, void* buffer, size_t bytes);
 	/// <summary>
+	/// Get a writable DMA buffer for the next transfer on the given channel, so that data can be serialized directly
+	/// into DMA memory instead of being copied by write_data. The buffer is sent with commit on the returned
+	/// reservation, from the same thread, and given back unsent if the reservation goes out of scope before that.
+	/// </summary>
+	/// <param name="chn">Channel to write</param>
+	/// <param name="tmo_ms">How long to wait for a free buffer</param>
+	/// <returns>Reservation of a buffer of sizeof(mu2e_databuff_t) bytes; its data() is nullptr with errno set (EAGAIN on timeout) if none was free</returns>
+	mu2e_write_reservation write_acquire(DTC_DMA_Engine const& chn, int tmo_ms);
+	/// <summary>
+	/// Set how writes wait when the send ring is full, and for how long before they fail with EAGAIN.
+	/// The defaults come from DTCLIB_WRITE_WAIT (spin, yield or block; default block) and DTCLIB_WRITE_TMO_MS
+	/// (default 1000).
+	/// </summary>
+	/// <param name="strategy">Wait strategy</param>
+	/// <param name="tmo_ms">Write timeout, in milliseconds</param>
+	void set_write_wait(mu2e_wait_strategy strategy, int tmo_ms) { backend()->set_write_wait(strategy, tmo_ms); }
+	/// <summary>
+	/// Get the send-side counters (buffers sent, stalls, retries, backpressure) of a channel
+	/// </summary>
+	/// <param name="chn">Channel</param>
+	/// <returns>Copy of the counters</returns>
+	mu2e_write_stats get_write_stats(DTC_DMA_Engine const& chn) { return backend()->get_write_stats(chn); }
+	/// <summary>
+	/// Reset the send-side counters of a channel
+	/// </summary>
+	/// <param name="chn">Channel</param>
+	void reset_write_stats(DTC_DMA_Engine const& chn) { backend()->reset_write_stats(chn); }
+	/// <summary>
 	/// Close the connection to the DTC
 	/// </summary>
 	void close();
@@ -130,7 +267,7 @@ public:
 	/// Gets the file descriptor for the mu2e block device (/dev/mu2eX)
 	/// </summary>
 	/// <returns>File descriptor for the mu2e block device</returns>
-	int get_devfd_() const { return devfd_; }
+	int get_devfd_() const { return backend_ ? backend_->get_devfd() : -1; }
 
 	/// <summary>
 	/// Get the current DTC ID for this instance
@@ -145,17 +282,18 @@ public:
 	// int  write_test_command(m_ioc_cmd_t input, bool start);
 
 private:
-	// unsigned delta_(int chn, int dir);
+	friend class mu2e_write_reservation;
+	int write_commit(DTC_DMA_Engine const& chn, size_t bytes);
+	mu2ebackend* backend();
+	void record_(mu2e_dev_operation op, int chn, std::chrono::steady_clock::time_point start);
 
-	int devfd_;
-	volatile void* mu2e_mmap_ptrs_[MU2E_MAX_NUM_DTCS][MU2E_MAX_CHANNELS][2][2];
-	m_ioc_get_info_t mu2e_channel_info_[MU2E_MAX_NUM_DTCS][MU2E_MAX_CHANNELS][2];
-	unsigned buffers_held_;
-	mu2esim* simulator_;
+	std::unique_ptr<mu2ebackend> backend_;
 	int activeDTC_;
 	std::atomic<long long> deviceTime_;
 	std::atomic<size_t> writeSize_;
 	std::atomic<size_t> readSize_;
+	mu2ehistogram latency_[MU2E_OP_COUNT][MU2E_MAX_CHANNELS];
+	std::atomic<long long> acquireTime_[MU2E_MAX_CHANNELS];  // write_acquire time, added to the write_commit sample
 };
 
 #endif
@@ -0,0 +1,453 @@
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <string>
+
+#include "TRACE/tracemf.h"
+
+#include "mu2edriver.h"
+
+mu2edriver::mu2edriver()
+	: devfd_(-1), activeDTC_(0), mu2e_mmap_ptrs_(), mu2e_mmap_lengths_(), mu2e_channel_info_(), buffers_held_(), poll_spin_us_(0), write_wait_(MU2E_WAIT_BLOCK), write_tmo_ms_(1000), c2s_read_only_(false)
+{
+	auto spinE = getenv("DTCLIB_POLL_SPIN_US");
+	if (spinE != nullptr) poll_spin_us_ = strtoul(spinE, nullptr, 0);
+	auto readOnlyE = getenv("DTCLIB_C2S_READONLY");
+	if (readOnlyE != nullptr) c2s_read_only_ = strtol(readOnlyE, nullptr, 0) != 0;
+	auto waitE = getenv("DTCLIB_WRITE_WAIT");
+	if (waitE != nullptr)
+	{
+		std::string wait(waitE);
+		if (wait == "spin")
+			write_wait_ = MU2E_WAIT_SPIN;
+		else if (wait == "yield")
+			write_wait_ = MU2E_WAIT_YIELD;
+		else if (wait == "block")
+			write_wait_ = MU2E_WAIT_BLOCK;
+		else
+			TRACE(TLVL_WARNING, "mu2edriver: unknown DTCLIB_WRITE_WAIT value \"%s\", using block", waitE);
+	}
+	auto tmoE = getenv("DTCLIB_WRITE_TMO_MS");
+	if (tmoE != nullptr) write_tmo_ms_ = strtol(tmoE, nullptr, 0);
+}
+
+mu2edriver::~mu2edriver() { close_(); }
+
+int mu2edriver::init(int dtc)
+{
+	activeDTC_ = dtc;
+	int sts;
+	if (open_(activeDTC_) != 0)
+	{
+		TRACE(TLVL_WARNING, "mu2e Device file not found and DTCLIB_SIM_ENABLE not set! Exiting.");
+		throw std::runtime_error("mu2e Device file not found and DTCLIB_SIM_ENABLE not set! Exiting.");
+		//exit(1);
+	}
+	for (unsigned chn = 0; chn < MU2E_MAX_CHANNELS; ++chn)
+		for (unsigned dir = 0; dir < 2; ++dir)
+		{
+			m_ioc_get_info_t get_info;
+			get_info.chn = chn;
+			get_info.dir = dir;
+			get_info.tmo_ms = 0;
+			TRACE(TLVL_DEBUG + 10, "mu2edriver::init before ioctl( devfd_, M_IOC_GET_INFO, &get_info ) chn=%u dir=%u", chn, dir);
+			sts = ioctl_(M_IOC_GET_INFO, reinterpret_cast<unsigned long>(&get_info));
+			if (sts != 0)
+			{
+				perror("M_IOC_GET_INFO");
+
+				throw std::runtime_error("Failed mu2edriver::init before ioctl( devfd_, M_IOC_GET_INFO, &get_info)");
+				//exit(1);
+			}
+			mu2e_channel_info_[activeDTC_][chn][dir] = get_info;
+			TRACE(TLVL_DEBUG, "mu2edriver::init %d %u:%u - num=%u size=%u hwIdx=%u, swIdx=%u delta=%u", activeDTC_, chn, dir,
+				  get_info.num_buffs, get_info.buff_size, get_info.hwIdx, get_info.swIdx,
+				  mu2e_chn_info_delta_(activeDTC_, chn, dir, &mu2e_channel_info_));
+			for (unsigned map = 0; map < 2; ++map)
+			{
+				size_t length = get_info.num_buffs * ((map == MU2E_MAP_BUFF) ? get_info.buff_size : sizeof(int));
+				// Received data is only read, unless the C2S buffers are to stay writable
+				int prot = (map == MU2E_MAP_BUFF && (dir == S2C || !c2s_read_only_)) ? PROT_WRITE : PROT_READ;
+				off_t offset = chnDirMap2offset(chn, dir, map);
+				mu2e_mmap_ptrs_[activeDTC_][chn][dir][map] = mmap_(length, prot, offset);
+				if (mu2e_mmap_ptrs_[activeDTC_][chn][dir][map] == MAP_FAILED)
+				{
+					mu2e_mmap_ptrs_[activeDTC_][chn][dir][map] = nullptr;
+					perror("mmap");
+					throw std::runtime_error("mmap");
+					//exit(1);
+				}
+				mu2e_mmap_lengths_[activeDTC_][chn][dir][map] = length;
+				TRACE(TLVL_DEBUG, "mu2edriver::init chnDirMap2offset=%lu mu2e_mmap_ptrs_[%d][%d][%d][%d]=%p p=%c l=%lu", offset, dtc, chn,
+					  dir, map, mu2e_mmap_ptrs_[activeDTC_][chn][dir][map], prot == PROT_READ ? 'R' : 'W', length);
+			}
+			if (dir == DTC_DMA_Direction_C2S)
+			{
+				release_all(static_cast<DTC_DMA_Engine>(chn));
+			}
+
+			// Reset the DTC
+			//{
+			//	write_register(0x9100, 0, 0xa0000000);
+			//	write_register(0x9118, 0, 0x0000003f);
+			//	write_register(0x9100, 0, 0x00000000);
+			//	write_register(0x9100, 0, 0x10000000);
+			//	write_register(0x9100, 0, 0x30000000);
+			//	write_register(0x9100, 0, 0x10000000);
+			//	write_register(0x9118, 0, 0x00000000);
+			//}
+
+			// Enable DMA Engines
+			{
+				// uint16_t addr = DTC_Register_Engine_Control(chn, dir);
+				// TRACE(17, "mu2edriver::init write Engine_Control reg 0x%x", addr);
+				// write_register(addr, 0, 0x100);//bit 8 enable=1
+			}
+		}
+	return 0;
+}
+
+int mu2edriver::open_(int dtc)
+{
+	char devfile[11];
+	snprintf(devfile, 11, "/dev/" MU2E_DEV_FILE, dtc);
+	devfd_ = open(devfile, O_RDWR);
+	if (devfd_ == -1 || devfd_ == 0)
+	{
+		perror(("open " + std::string(devfile)).c_str());
+		return -1;
+	}
+	return 0;
+}
+
+int mu2edriver::ioctl_(unsigned long request, unsigned long arg) { return ioctl(devfd_, request, arg); }
+
+void* mu2edriver::mmap_(size_t length, int prot, off_t offset)
+{
+	return mmap(0 /* hint address */, length, prot, MAP_SHARED, devfd_, offset);
+}
+
+void mu2edriver::close_()
+{
+	for (unsigned chn = 0; chn < MU2E_MAX_CHANNELS; ++chn)
+		for (unsigned dir = 0; dir < 2; ++dir)
+			for (unsigned map = 0; map < 2; ++map)
+			{
+				if (mu2e_mmap_ptrs_[activeDTC_][chn][dir][map] != nullptr)
+				{
+					munmap(const_cast<void*>(mu2e_mmap_ptrs_[activeDTC_][chn][dir][map]), mu2e_mmap_lengths_[activeDTC_][chn][dir][map]);
+					mu2e_mmap_ptrs_[activeDTC_][chn][dir][map] = nullptr;
+				}
+			}
+	if (devfd_ > 0) close(devfd_);
+	devfd_ = -1;
+}
+
+/*****************************
+   read_data_batch
+   returns number of buffers read; negative value indicates an error
+   */
+int mu2edriver::read_data_batch(int chn, void** buffers, int* byteCounts, unsigned maxBuffers, int tmo_ms)
+{
+	std::lock_guard<std::mutex> lk(channel_mutex_[activeDTC_][chn][C2S]);
+	auto& buffers_held = buffers_held_[activeDTC_][chn];
+	auto retsts = 0;
+	unsigned has_recv_data = mu2e_chn_info_delta_(activeDTC_, chn, C2S, &mu2e_channel_info_);
+	TRACE(TLVL_DEBUG + 11, "mu2edriver::read_data_batch after %u=has_recv_data = delta_( chn, C2S )", has_recv_data);
+	if (has_recv_data <= buffers_held && poll_spin_us_ > 0)
+	{
+		has_recv_data = poll_completions_(chn, buffers_held);
+	}
+	if (has_recv_data <= buffers_held)
+	{
+		mu2e_channel_info_[activeDTC_][chn][C2S].tmo_ms = tmo_ms;
+		if (ioctl_(M_IOC_GET_INFO, reinterpret_cast<unsigned long>(&mu2e_channel_info_[activeDTC_][chn][C2S])) != 0)
+		{
+			perror("M_IOC_GET_INFO");
+			retsts = -1;
+		}
+		else
+		{
+			has_recv_data = mu2e_chn_info_delta_(activeDTC_, chn, C2S, &mu2e_channel_info_);
+		}
+	}
+
+	int* BC_p = (int*)mu2e_mmap_ptrs_[activeDTC_][chn][C2S][MU2E_MAP_META];
+	while (retsts >= 0 && has_recv_data > buffers_held && static_cast<unsigned>(retsts) < maxBuffers)
+	{  // have data
+		// get byte count from new/next
+		unsigned newNxtIdx =
+			idx_add(mu2e_channel_info_[activeDTC_][chn][C2S].swIdx, (int)buffers_held + 1, activeDTC_, chn, C2S);
+		byteCounts[retsts] = BC_p[newNxtIdx];
+		buffers[retsts] = ((mu2e_databuff_t*)(mu2e_mmap_ptrs_[activeDTC_][chn][C2S][MU2E_MAP_BUFF]))[newNxtIdx];
+		TRACE(TLVL_TRACE,
+			  "mu2edriver::read_data_batch chn%d hIdx=%u, sIdx=%u "
+			  "%u hasRcvDat=%u %p[newNxtIdx=%d]=byteCount=%d buf(%p)[0]=0x%08x",
+			  chn, mu2e_channel_info_[activeDTC_][chn][C2S].hwIdx, mu2e_channel_info_[activeDTC_][chn][C2S].swIdx,
+			  mu2e_channel_info_[activeDTC_][chn][C2S].num_buffs, has_recv_data, (void*)BC_p, newNxtIdx,
+			  byteCounts[retsts], buffers[retsts], *(uint32_t*)buffers[retsts]);
+		++buffers_held;
+		++retsts;
+	}
+	if (retsts == 0)
+	{
+		TRACE(TLVL_DEBUG + 11, "mu2edriver::read_data_batch not error... return 0 status");
+	}
+	return retsts;
+}  // read_data_batch
+
+/*****************************
+   poll_completions_
+   spin on the C2S byte counts for up to poll_spin_us_, advancing the cached hwIdx past every completed buffer
+   returns the new number of completed buffers
+   */
+unsigned mu2edriver::poll_completions_(int chn, unsigned buffers_held)
+{
+	auto& info = mu2e_channel_info_[activeDTC_][chn][C2S];
+	int* BC_p = (int*)mu2e_mmap_ptrs_[activeDTC_][chn][C2S][MU2E_MAP_META];
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(poll_spin_us_);
+	unsigned has_recv_data = mu2e_chn_info_delta_(activeDTC_, chn, C2S, &mu2e_channel_info_);
+	unsigned spins = 0;
+	while (true)
+	{
+		while (has_recv_data < info.num_buffs - 1)
+		{
+			unsigned next = idx_add(info.hwIdx, 1, activeDTC_, chn, C2S);
+			if (__atomic_load_n(&BC_p[next], __ATOMIC_ACQUIRE) == 0) break;
+			info.hwIdx = next;
+			++has_recv_data;
+		}
+		// Only look at the clock every few iterations, it costs more than a cache-line poll
+		if (has_recv_data > buffers_held || ((++spins & 0x3f) == 0 && std::chrono::steady_clock::now() >= deadline)) break;
+	}
+	TRACE(TLVL_DEBUG + 12, "mu2edriver::poll_completions_ chn=%d hwIdx=%u has_recv_data=%u after %u spins", chn, info.hwIdx,
+		  has_recv_data, spins);
+	return has_recv_data;
+}
+
+/* read_release
+   release a number of buffers (usually 1)
+   */
+int mu2edriver::read_release(int chn, unsigned num)
+{
+	std::lock_guard<std::mutex> lk(channel_mutex_[activeDTC_][chn][C2S]);
+	return read_release_(chn, num);
+}
+
+int mu2edriver::read_release_(int chn, unsigned num)
+{
+	auto retsts = 0;
+	unsigned long arg;
+	unsigned has_recv_data;
+	has_recv_data = mu2e_chn_info_delta_(activeDTC_, chn, C2S, &mu2e_channel_info_);
+	if (num <= has_recv_data)
+	{
+		arg = (chn << 24) | (C2S << 16) | (num & 0xffff);  // THIS OBIVOUSLY SHOULD BE A MACRO
+		retsts = ioctl_(M_IOC_BUF_GIVE, arg);
+		if (retsts != 0)
+		{
+			perror("M_IOC_BUF_GIVE");
+		}  // exit(1); } // Don't exit for now
+
+		// increment our cached info
+		mu2e_channel_info_[activeDTC_][chn][C2S].swIdx =
+			idx_add(mu2e_channel_info_[activeDTC_][chn][C2S].swIdx, (int)num, activeDTC_, chn, C2S);
+		auto& buffers_held = buffers_held_[activeDTC_][chn];
+		if (num <= buffers_held)
+			buffers_held -= num;
+		else
+			buffers_held = 0;
+	}
+	return retsts;
+}
+
+int mu2edriver::read_register(uint16_t address, int tmo_ms, uint32_t* output)
+{
+	m_ioc_reg_access_t reg;
+	reg.reg_offset = address;
+	reg.access_type = 0;
+
+	int counter = 0;
+	int errorCode = -99;
+
+	while (counter < 5 && errorCode < 0)
+	{
+		errorCode = ioctl_(M_IOC_REG_ACCESS, reinterpret_cast<unsigned long>(&reg));
+		counter++;
+		if (errorCode < 0) usleep(10000);
+	}
+	*output = reg.val;
+	TRACE(TLVL_DEBUG + 15, "Read value 0x%x from register 0x%x errorcode %d", reg.val, address, errorCode);
+	return errorCode;
+}
+
+int mu2edriver::write_register(uint16_t address, int tmo_ms, uint32_t data)
+{
+	m_ioc_reg_access_t reg;
+	reg.reg_offset = address;
+	reg.access_type = 1;
+	reg.val = data;
+	TRACE(TLVL_DEBUG + 16, "Writing value 0x%x to register 0x%x", data, address);
+	return ioctl_(M_IOC_REG_ACCESS, reinterpret_cast<unsigned long>(&reg));
+}
+
+void mu2edriver::meta_dump()
+{
+	TRACE(TLVL_DEBUG + 5, "mu2edriver::meta_dump");
+	for (int chn = 0; chn < MU2E_MAX_CHANNELS; ++chn)
+		for (int dir = 0; dir < 2; ++dir)
+			if (mu2e_mmap_ptrs_[activeDTC_][chn][dir][MU2E_MAP_META] != NULL)
+			{
+				for (unsigned buf = 0; buf < mu2e_channel_info_[activeDTC_][chn][dir].num_buffs; ++buf)
+				{
+					int* BC_p = (int*)mu2e_mmap_ptrs_[activeDTC_][chn][dir][MU2E_MAP_META];
+					printf("buf_%02d: %u\n", buf, BC_p[buf]);
+				}
+			}
+	ioctl_(M_IOC_DUMP, 0);
+}
+
+int mu2edriver::write_data(int chn, void* buffer, size_t bytes)
+{
+	auto data = write_acquire(chn, write_tmo_ms_);
+	if (data == nullptr)
+	{
+		return -errno;
+	}
+	memcpy(data, buffer, bytes);
+	return write_commit(chn, bytes);
+}  // write_data
+
+/*****************************
+   write_acquire
+   returns the next free S2C buffer, with the channel's S2C lock held until write_commit
+   returns nullptr with errno set (EAGAIN if no buffer became free within tmo_ms)
+   */
+void* mu2edriver::write_acquire(int chn, int tmo_ms)
+{
+	int dir = S2C;
+	std::unique_lock<std::mutex> lk(channel_mutex_[activeDTC_][chn][dir]);
+	auto& info = mu2e_channel_info_[activeDTC_][chn][dir];
+	unsigned delta = mu2e_chn_info_delta_(activeDTC_, chn, dir, &mu2e_channel_info_);  // check cached info
+	TRACE(TLVL_TRACE, "write_acquire delta=%u chn=%d dir=S2C", delta, chn);
+	if (delta <= 1)
+	{
+		// The cache says the ring is full: refresh it, and wait if the hardware really has not caught up
+		auto start = std::chrono::steady_clock::now();
+		auto deadline = start + std::chrono::milliseconds(tmo_ms);
+		unsigned backoff_us = 10;
+		bool stalled = false;
+		while (true)
+		{
+			m_ioc_get_info_t get_info;
+			get_info.chn = chn;
+			get_info.dir = dir;
+			get_info.tmo_ms = 0;
+			if (ioctl_(M_IOC_GET_INFO, reinterpret_cast<unsigned long>(&get_info)) != 0)
+			{
+				auto err = errno;
+				perror("M_IOC_GET_INFO");
+				lk.unlock();
+				errno = err;
+				return nullptr;
+			}
+			info = get_info;  // copy info struct
+			delta = mu2e_chn_info_delta_(activeDTC_, chn, dir, &mu2e_channel_info_);
+			if (delta > 1 || std::chrono::steady_clock::now() >= deadline) break;
+			stalled = true;
+			mu2e_wait_step(write_wait_, backoff_us);
+		}
+		if (stalled)
+		{
+			write_counters_[activeDTC_][chn].stalls++;
+			write_counters_[activeDTC_][chn].stall_ns +=
+				std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		}
+	}
+
+	if (delta <= 1)
+	{
+		TRACE(TLVL_WARNING, "write_acquire chn=%d: no free S2C buffer after %d ms", chn, tmo_ms);
+		write_counters_[activeDTC_][chn].backpressure++;
+		lk.unlock();
+		errno = EAGAIN;
+		return nullptr;
+	}
+
+	lk.release();  // Held until write_commit
+	return ((mu2e_databuff_t*)(mu2e_mmap_ptrs_[activeDTC_][chn][dir][MU2E_MAP_BUFF]))[info.swIdx];
+}  // write_acquire
+
+/*****************************
+   write_commit
+   transmits the buffer from write_acquire and releases the channel's S2C lock
+   */
+int mu2edriver::write_commit(int chn, size_t bytes)
+{
+	int dir = S2C;
+	std::lock_guard<std::mutex> lk(channel_mutex_[activeDTC_][chn][dir], std::adopt_lock);
+	if (bytes == 0) return 0;
+	TRACE(TLVL_TRACE, "write_commit chn=%d dir=S2C, sz=%zu", chn, bytes);
+	unsigned long arg = (chn << 24) | (bytes & 0xffffff);  // THIS OBIVOUSLY SHOULD BE A MACRO
+
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(write_tmo_ms_);
+	unsigned backoff_us = 10;
+	auto retsts = ioctl_(M_IOC_BUF_XMIT, arg);
+	// The DTC has not finished with the descriptor yet; wait for it like for a free buffer
+	while (retsts != 0 && errno == EAGAIN && std::chrono::steady_clock::now() < deadline)
+	{
+		TRACE(TLVL_TRACE, "write_commit ioctl returned %d, errno=%d (%s), retrying.", retsts, errno, strerror(errno));
+		write_counters_[activeDTC_][chn].retries++;
+		mu2e_wait_step(write_wait_, backoff_us);
+		retsts = ioctl_(M_IOC_BUF_XMIT, arg);
+	}
+	if (retsts != 0)
+	{
+		auto err = errno;
+		TRACE(TLVL_WARNING, "write_commit chn=%d: BUF_XMIT failed, errno=%d (%s)", chn, err, strerror(err));
+		if (err == EAGAIN) write_counters_[activeDTC_][chn].backpressure++;
+		return -err;
+	}
+	// increment our cached info
+	mu2e_channel_info_[activeDTC_][chn][dir].swIdx =
+		idx_add(mu2e_channel_info_[activeDTC_][chn][dir].swIdx, 1, activeDTC_, chn, dir);
+	write_counters_[activeDTC_][chn].writes++;
+	return 0;
+}  // write_commit
+
+void mu2edriver::set_write_wait(mu2e_wait_strategy strategy, int tmo_ms)
+{
+	write_wait_ = strategy;
+	write_tmo_ms_ = tmo_ms;
+}
+
+mu2e_write_stats mu2edriver::get_write_stats(int chn) const
+{
+	auto& counters = write_counters_[activeDTC_][chn];
+	mu2e_write_stats stats;
+	stats.writes = counters.writes;
+	stats.stalls = counters.stalls;
+	stats.stall_ns = counters.stall_ns;
+	stats.retries = counters.retries;
+	stats.backpressure = counters.backpressure;
+	return stats;
+}
+
+void mu2edriver::reset_write_stats(int chn)
+{
+	auto& counters = write_counters_[activeDTC_][chn];
+	counters.writes = 0;
+	counters.stalls = 0;
+	counters.stall_ns = 0;
+	counters.retries = 0;
+	counters.backpressure = 0;
+}
+
+// applicable for recv.
+int mu2edriver::release_all(int chn)
+{
+	std::lock_guard<std::mutex> lk(channel_mutex_[activeDTC_][chn][C2S]);
+	auto has_recv_data = mu2e_chn_info_delta_(activeDTC_, chn, C2S, &mu2e_channel_info_);
+	if (has_recv_data) read_release_(chn, has_recv_data);
+	return 0;
+}
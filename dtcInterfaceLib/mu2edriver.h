@@ -0,0 +1,117 @@
+#ifndef MU2EDRIVER_H
+#define MU2EDRIVER_H
+
+#include <sys/types.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#include "mu2e_driver/mu2e_mmap_ioctl.h"  //
+#include "mu2ebackend.h"
+
+/// <summary>
+/// mu2ebackend which talks to the mu2e kernel driver (/dev/mu2eX) through its ioctls and mmapped DMA rings.
+/// The device primitives (open, ioctl, mmap) are virtual, so that the same ring handling can run against
+/// anything that reproduces the driver's ring ABI (see mu2eshm).
+/// Each (DTC, channel, direction) has its own cached ring state and mutex, so DAQ and DCS traffic can be handled
+/// from different threads without contending with each other.
+///
+/// When a poll spin budget is set (set_poll_spin_us or the DTCLIB_POLL_SPIN_US environment variable), read_data_batch
+/// first watches the MU2E_MAP_META byte counts for new completions, and only falls back to the blocking
+/// M_IOC_GET_INFO wait when the budget runs out. This relies on the driver clearing the byte counts of released
+/// buffers (M_IOC_BUF_GIVE), so a non-zero byte count past hwIdx always marks a new completion.
+///
+/// Sends use the cached S2C ring state and only ask the driver for the free count when the cache shows the ring
+/// full. When it is really full, or the DTC refuses a buffer (BUF_XMIT EAGAIN), the write waits with the configured
+/// mu2e_wait_strategy (DTCLIB_WRITE_WAIT=spin|yield|block, DTCLIB_WRITE_TMO_MS) and then fails with EAGAIN.
+///
+/// With DTCLIB_C2S_READONLY=1, the receive (C2S) data buffers are mapped PROT_READ, so that a stray write from user
+/// space faults instead of corrupting data in flight. The library never writes to received buffers.
+/// </summary>
+class mu2edriver : public mu2ebackend
+{
+public:
+	/// <summary>
+	/// Construct the mu2edriver backend. Does not open the device, call init(dtc) to do that.
+	/// </summary>
+	mu2edriver();
+	virtual ~mu2edriver();
+
+	/// <summary>
+	/// Open the device, read the channel info for every channel and direction and map the DMA rings
+	/// </summary>
+	/// <param name="dtc">Desired DTC card to use (/dev/mu2eX)</param>
+	/// <returns>0 on success</returns>
+	int init(int dtc);
+
+	int read_data_batch(int chn, void** buffers, int* byteCounts, unsigned maxBuffers, int tmo_ms) override;
+	int read_release(int chn, unsigned num) override;
+	int release_all(int chn) override;
+	unsigned get_ring_size(int chn) const override { return mu2e_channel_info_[activeDTC_][chn][C2S].num_buffs; }
+	int write_data(int chn, void* buffer, size_t bytes) override;
+	void* write_acquire(int chn, int tmo_ms) override;
+	int write_commit(int chn, size_t bytes) override;
+	int read_register(uint16_t address, int tmo_ms, uint32_t* output) override;
+	int write_register(uint16_t address, int tmo_ms, uint32_t data) override;
+	void meta_dump() override;
+	void set_poll_spin_us(unsigned spin_us) override { poll_spin_us_ = spin_us; }
+	void set_write_wait(mu2e_wait_strategy strategy, int tmo_ms) override;
+	mu2e_write_stats get_write_stats(int chn) const override;
+	void reset_write_stats(int chn) override;
+	int get_devfd() const override { return devfd_; }
+
+protected:
+	/// <summary>
+	/// Open the device for the given DTC, setting devfd_
+	/// </summary>
+	/// <param name="dtc">DTC card index</param>
+	/// <returns>0 on success, -1 on error (errno is set)</returns>
+	virtual int open_(int dtc);
+	/// <summary>
+	/// Issue one of the M_IOC_* requests defined in mu2e_mmap_ioctl.h
+	/// </summary>
+	/// <param name="request">M_IOC_* request code</param>
+	/// <param name="arg">Request argument (pointer or packed integer, as for the driver)</param>
+	/// <returns>0 on success, -1 on error (errno is set)</returns>
+	virtual int ioctl_(unsigned long request, unsigned long arg);
+	/// <summary>
+	/// Map one of the DMA regions, addressed as for the driver with chnDirMap2offset
+	/// </summary>
+	/// <param name="length">Length of the region</param>
+	/// <param name="prot">Memory protection of the mapping</param>
+	/// <param name="offset">chnDirMap2offset(chn, dir, map)</param>
+	/// <returns>Address of the mapping, or MAP_FAILED</returns>
+	virtual void* mmap_(size_t length, int prot, off_t offset);
+	/// <summary>
+	/// Undo mmap_ and open_
+	/// </summary>
+	virtual void close_();
+
+	int devfd_;                                                                    ///< Device file descriptor
+	int activeDTC_;                                                                ///< DTC card index
+	volatile void* mu2e_mmap_ptrs_[MU2E_MAX_NUM_DTCS][MU2E_MAX_CHANNELS][2][2];    ///< Mapped DMA regions
+	size_t mu2e_mmap_lengths_[MU2E_MAX_NUM_DTCS][MU2E_MAX_CHANNELS][2][2];         ///< Lengths of mapped DMA regions
+	m_ioc_get_info_t mu2e_channel_info_[MU2E_MAX_NUM_DTCS][MU2E_MAX_CHANNELS][2];  ///< Cached channel info
+	unsigned buffers_held_[MU2E_MAX_NUM_DTCS][MU2E_MAX_CHANNELS];                  ///< C2S buffers read but not released
+	std::mutex channel_mutex_[MU2E_MAX_NUM_DTCS][MU2E_MAX_CHANNELS][2];            ///< Protects the state of each ring
+	unsigned poll_spin_us_;                                                        ///< Spin budget for polling the C2S metadata
+	mu2e_wait_strategy write_wait_;                                                ///< How sends wait for the S2C ring
+	int write_tmo_ms_;                                                             ///< How long sends wait before EAGAIN
+	bool c2s_read_only_;                                                           ///< Map the C2S data buffers PROT_READ
+
+private:
+	int read_release_(int chn, unsigned num);
+	unsigned poll_completions_(int chn, unsigned buffers_held);
+
+	struct write_counters
+	{
+		std::atomic<uint64_t> writes{0};
+		std::atomic<uint64_t> stalls{0};
+		std::atomic<uint64_t> stall_ns{0};
+		std::atomic<uint64_t> retries{0};
+		std::atomic<uint64_t> backpressure{0};
+	};
+	write_counters write_counters_[MU2E_MAX_NUM_DTCS][MU2E_MAX_CHANNELS];
+};
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef MU2EHISTOGRAM_H
+#define MU2EHISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+
+/// <summary>
+/// Number of buckets in a mu2ehistogram. Bucket 0 counts 0 ns samples, bucket i counts samples in [2^(i-1), 2^i) ns.
+/// </summary>
+#define MU2EHISTOGRAM_BUCKETS 64
+
+/// <summary>
+/// Copy of the contents of a mu2ehistogram, taken with mu2ehistogram::snapshot
+/// </summary>
+struct mu2ehistogram_snapshot
+{
+	uint64_t buckets[MU2EHISTOGRAM_BUCKETS];  ///< Sample count per log2 bucket
+	uint64_t count;                           ///< Total number of samples
+	uint64_t sum_ns;                          ///< Sum of all samples, in nanoseconds
+	uint64_t max_ns;                          ///< Largest sample, in nanoseconds
+
+	/// <summary>
+	/// Get the mean of the samples
+	/// </summary>
+	/// <returns>Mean sample, in nanoseconds (0 if there are no samples)</returns>
+	double mean() const { return count > 0 ? static_cast<double>(sum_ns) / count : 0.0; }
+
+	/// <summary>
+	/// Get an upper bound on the given quantile: the upper edge of the bucket holding it, capped at the largest sample.
+	/// The result is within a factor of 2 of the exact value.
+	/// </summary>
+	/// <param name="quantile">Quantile, between 0 and 1 (e.g. 0.99 for p99)</param>
+	/// <returns>Quantile upper bound, in nanoseconds (0 if there are no samples)</returns>
+	uint64_t percentile(double quantile) const
+	{
+		if (count == 0) return 0;
+		auto rank = static_cast<uint64_t>(quantile * count);
+		if (rank >= count) rank = count - 1;
+		uint64_t seen = 0;
+		for (unsigned bucket = 0; bucket < MU2EHISTOGRAM_BUCKETS; ++bucket)
+		{
+			seen += buckets[bucket];
+			if (seen > rank)
+			{
+				uint64_t upper = bucket == 0 ? 0 : (bucket >= 63 ? UINT64_MAX : (1ULL << bucket) - 1);
+				return upper < max_ns ? upper : max_ns;
+			}
+		}
+		return max_ns;
+	}
+};
+
+/// <summary>
+/// Latency histogram with power-of-two nanosecond buckets. Recording a sample costs a few relaxed atomic
+/// increments, so it can be updated from any thread on every device call.
+/// </summary>
+class mu2ehistogram
+{
+public:
+	mu2ehistogram() { reset(); }
+
+	mu2ehistogram(const mu2ehistogram&) = delete;
+	mu2ehistogram& operator=(const mu2ehistogram&) = delete;
+
+	/// <summary>
+	/// Add a sample to the histogram
+	/// </summary>
+	/// <param name="ns">Sample, in nanoseconds</param>
+	void record(uint64_t ns)
+	{
+		buckets_[bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+		count_.fetch_add(1, std::memory_order_relaxed);
+		sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+		auto max = max_ns_.load(std::memory_order_relaxed);
+		while (ns > max && !max_ns_.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	/// <summary>
+	/// Copy the histogram. Samples recorded concurrently may be partially included.
+	/// </summary>
+	/// <returns>Copy of the histogram</returns>
+	mu2ehistogram_snapshot snapshot() const
+	{
+		mu2ehistogram_snapshot snap;
+		for (unsigned ii = 0; ii < MU2EHISTOGRAM_BUCKETS; ++ii) snap.buckets[ii] = buckets_[ii].load(std::memory_order_relaxed);
+		snap.count = count_.load(std::memory_order_relaxed);
+		snap.sum_ns = sum_ns_.load(std::memory_order_relaxed);
+		snap.max_ns = max_ns_.load(std::memory_order_relaxed);
+		return snap;
+	}
+
+	/// <summary>
+	/// Clear all samples
+	/// </summary>
+	void reset()
+	{
+		for (auto& bucket : buckets_) bucket.store(0, std::memory_order_relaxed);
+		count_.store(0, std::memory_order_relaxed);
+		sum_ns_.store(0, std::memory_order_relaxed);
+		max_ns_.store(0, std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// Get the bucket a sample falls in
+	/// </summary>
+	/// <param name="ns">Sample, in nanoseconds</param>
+	/// <returns>Bucket index: 0 for 0 ns, otherwise one more than the index of the highest set bit</returns>
+	static unsigned bucket(uint64_t ns)
+	{
+		if (ns == 0) return 0;
+		unsigned bucket = 64 - __builtin_clzll(ns);
+		return bucket < MU2EHISTOGRAM_BUCKETS ? bucket : MU2EHISTOGRAM_BUCKETS - 1;
+	}
+
+private:
+	std::atomic<uint64_t> buckets_[MU2EHISTOGRAM_BUCKETS];
+	std::atomic<uint64_t> count_;
+	std::atomic<uint64_t> sum_ns_;
+	std::atomic<uint64_t> max_ns_;
+};
+
+#endif
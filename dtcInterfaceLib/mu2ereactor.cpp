@@ -0,0 +1,132 @@
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "mu2ereactor"
+
+#define TLVL_Sweep TLVL_DEBUG + 5
+#define TLVL_Service TLVL_DEBUG + 6
+
+#include "mu2ereactor.h"
+
+#include <cstring>
+
+mu2ereactor::mu2ereactor(handler_t handler, unsigned batchSize)
+	: handler_(handler)
+	, batchSize_(batchSize > 0 ? batchSize : 1)
+	, buffers_(batchSize_)
+	, byteCounts_(batchSize_)
+	, devices_()
+	, maxHeld_()
+	, stats_()
+	, deviceCount_(0)
+	, next_(0)
+	, idleWait_(MU2E_WAIT_BLOCK)
+	, stop_(false)
+{
+}
+
+int mu2ereactor::add_device(mu2edev* device, unsigned maxHeld)
+{
+	if (deviceCount_ >= MU2E_MAX_NUM_DTCS)
+	{
+		TLOG(TLVL_ERROR) << "mu2ereactor::add_device: Already servicing " << deviceCount_ << " devices";
+		return -1;
+	}
+	device->release_all(DTC_DMA_Engine_DAQ);
+	auto index = deviceCount_++;
+	devices_[index] = device;
+	maxHeld_[index] = maxHeld;
+	memset(&stats_[index], 0, sizeof(mu2ereactor_stats));
+	TLOG(TLVL_DEBUG) << "mu2ereactor::add_device: Device " << index << " is DTC " << device->getDTCID() << ", maxHeld=" << maxHeld;
+	return index;
+}
+
+int mu2ereactor::run_once()
+{
+	if (deviceCount_ == 0) return 0;
+
+	auto first = next_;
+	next_ = (next_ + 1) % deviceCount_;
+	int total = 0;
+	for (int ii = 0; ii < deviceCount_; ++ii)
+	{
+		auto sts = service_((first + ii) % deviceCount_, 0);
+		if (sts < 0) return -1;
+		total += sts;
+	}
+	TLOG(TLVL_Sweep) << "mu2ereactor::run_once: Sweep starting at device " << first << " read " << total << " buffers";
+
+	if (total == 0)
+	{
+		if (idleWait_ == MU2E_WAIT_BLOCK)
+		{
+			// Wait in the next device's read: it returns as soon as that device has data, and after 1 ms at most
+			total = service_(next_, 1);
+		}
+		else
+		{
+			unsigned backoff_us = 1;  // Only MU2E_WAIT_BLOCK sleeps, and it waits in the read above instead
+			mu2e_wait_step(idleWait_, backoff_us);
+		}
+	}
+	return total;
+}
+
+int mu2ereactor::run()
+{
+	stop_ = false;
+	while (!stop_)
+	{
+		if (run_once() < 0) return -1;
+	}
+	return 0;
+}
+
+int mu2ereactor::release(int index, unsigned num)
+{
+	auto& stats = stats_[index];
+	if (num > stats.held) num = stats.held;
+	if (num == 0) return 0;
+	stats.held -= num;
+	stats.released += num;
+	return devices_[index]->read_release(DTC_DMA_Engine_DAQ, num);
+}
+
+int mu2ereactor::service_(int index, int tmo_ms)
+{
+	auto& stats = stats_[index];
+	auto max = batchSize_;
+	if (maxHeld_[index] > 0)
+	{
+		if (stats.held >= maxHeld_[index])
+		{
+			++stats.throttled;
+			return 0;
+		}
+		if (maxHeld_[index] - stats.held < max) max = maxHeld_[index] - stats.held;
+	}
+
+	auto buffers = &buffers_[0];
+	auto byteCounts = &byteCounts_[0];
+	auto count = devices_[index]->read_data_batch(DTC_DMA_Engine_DAQ, buffers, byteCounts, max, tmo_ms);
+	if (count < 0)
+	{
+		TLOG(TLVL_ERROR) << "mu2ereactor::service_: Read from device " << index << " failed: " << count;
+		return count;
+	}
+	if (count == 0)
+	{
+		++stats.empty_polls;
+		return 0;
+	}
+
+	++stats.turns;
+	stats.buffers += count;
+	for (int ii = 0; ii < count; ++ii) stats.bytes += byteCounts[ii];
+	stats.held += count;
+	if (stats.held > stats.max_held) stats.max_held = stats.held;
+
+	auto done = handler_(index, buffers, byteCounts, count);
+	TLOG(TLVL_Service) << "mu2ereactor::service_: Device " << index << " read " << count << " buffers, handler released " << done
+					   << ", " << stats.held - (done < stats.held ? done : stats.held) << " held";
+	if (release(index, done) < 0) return -1;
+	return count;
+}
@@ -0,0 +1,127 @@
+#ifndef MU2EREACTOR_H
+#define MU2EREACTOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "mu2edev.h"
+#include "mu2ewait.h"
+
+/// <summary>
+/// Per-DTC counters of a mu2ereactor
+/// </summary>
+struct mu2ereactor_stats
+{
+	uint64_t buffers;      ///< Buffers read
+	uint64_t bytes;        ///< Bytes read
+	uint64_t released;     ///< Buffers released
+	uint64_t turns;        ///< Scheduling turns in which buffers were read
+	uint64_t empty_polls;  ///< Scheduling turns which found no data
+	uint64_t throttled;    ///< Turns skipped because the DTC held maxHeld buffers
+	unsigned held;         ///< Buffers currently held (read but not released)
+	unsigned max_held;     ///< Largest number of buffers held at once
+};
+
+/// <summary>
+/// Services the DAQ channels of several DTCs (one mu2edev each, up to MU2E_MAX_NUM_DTCS) from a single thread.
+/// Each run_once is a round-robin sweep over the devices, starting one past where the previous sweep started.
+/// Every device gets a non-blocking read of at most batchSize buffers per turn, so a busy DTC cannot starve the others.
+/// When a whole sweep finds no data, the reactor waits with its idle mu2e_wait_strategy; MU2E_WAIT_BLOCK waits in
+/// the next device's read (1 ms at most), so that the others are checked again soon.
+///
+/// Buffers are handed to the handler in ring order. The handler returns how many of them (oldest first) can be
+/// released right away; the others stay held and must be given back later with release(). A device holding
+/// maxHeld buffers is skipped until some are released.
+/// The reactor does not own the devices, and all calls except stop() must come from the reactor thread.
+/// </summary>
+class mu2ereactor
+{
+public:
+	/// <summary>
+	/// Called with the buffers read from one device in one turn
+	/// </summary>
+	/// <param name="index">Index of the device, as returned by add_device</param>
+	/// <param name="buffers">Buffer pointers</param>
+	/// <param name="byteCounts">Buffer byte counts</param>
+	/// <param name="count">Number of buffers</param>
+	/// <returns>Number of buffers to release now, oldest first (at most the number held by the device)</returns>
+	typedef std::function<unsigned(int index, void** buffers, int* byteCounts, unsigned count)> handler_t;
+
+	/// <summary>
+	/// Construct a mu2ereactor
+	/// </summary>
+	/// <param name="handler">Function called with the buffers read</param>
+	/// <param name="batchSize">Maximum number of buffers read from one device per turn (Default: 16)</param>
+	explicit mu2ereactor(handler_t handler, unsigned batchSize = 16);
+
+	/// <summary>
+	/// Add a device to the schedule. Its DAQ channel is released first, so reading starts from a clean ring.
+	/// </summary>
+	/// <param name="device">Initialized mu2edev, which must outlive the reactor</param>
+	/// <param name="maxHeld">Maximum number of buffers the device may hold (Default: 0, no limit)</param>
+	/// <returns>Index of the device, or -1 if MU2E_MAX_NUM_DTCS devices are already scheduled</returns>
+	int add_device(mu2edev* device, unsigned maxHeld = 0);
+
+	/// <summary>
+	/// Run one round-robin sweep over the devices, waiting once if none of them had data
+	/// </summary>
+	/// <returns>Number of buffers read, or -1 if a read failed</returns>
+	int run_once();
+
+	/// <summary>
+	/// Run sweeps until stop() is called or a read fails
+	/// </summary>
+	/// <returns>0 when stopped, -1 on read error</returns>
+	int run();
+
+	/// <summary>
+	/// Make run() return after the current sweep. May be called from any thread, including from the handler.
+	/// </summary>
+	void stop() { stop_ = true; }
+
+	/// <summary>
+	/// Release buffers held by a device, oldest first
+	/// </summary>
+	/// <param name="index">Index of the device</param>
+	/// <param name="num">Number of buffers to release (at most the number held)</param>
+	/// <returns>0 on success</returns>
+	int release(int index, unsigned num);
+
+	/// <summary>
+	/// Set how the reactor waits when a sweep finds no data on any device
+	/// </summary>
+	/// <param name="strategy">Idle wait strategy (Default: MU2E_WAIT_BLOCK)</param>
+	void set_idle_wait(mu2e_wait_strategy strategy) { idleWait_ = strategy; }
+
+	/// <summary>
+	/// Get the counters of a device
+	/// </summary>
+	/// <param name="index">Index of the device</param>
+	/// <returns>Copy of the counters</returns>
+	mu2ereactor_stats get_stats(int index) const { return stats_[index]; }
+
+	/// <summary>
+	/// Get the number of scheduled devices
+	/// </summary>
+	/// <returns>Number of devices</returns>
+	int device_count() const { return deviceCount_; }
+
+private:
+	int service_(int index, int tmo_ms);
+
+	handler_t handler_;
+	unsigned batchSize_;
+	std::vector<void*> buffers_;
+	std::vector<int> byteCounts_;
+	mu2edev* devices_[MU2E_MAX_NUM_DTCS];
+	unsigned maxHeld_[MU2E_MAX_NUM_DTCS];
+	mu2ereactor_stats stats_[MU2E_MAX_NUM_DTCS];
+	int deviceCount_;
+	int next_;
+	mu2e_wait_strategy idleWait_;
+	std::atomic<bool> stop_;
+};
+
+#endif
@@ -0,0 +1,263 @@
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "mu2eshm"
+
+#include "mu2eshm.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+size_t round_up_to_page(size_t size)
+{
+	size_t page = sysconf(_SC_PAGE_SIZE);
+	return ((size + page - 1) / page) * page;
+}
+
+std::string segment_name(int dtc, std::string name)
+{
+	if (name != "") return name;
+	auto prefix = getenv("DTCLIB_SHM_NAME");
+	return std::string(prefix != nullptr ? prefix : "/mu2eshm_dtc") + std::to_string(dtc);
+}
+}  // namespace
+
+mu2eshm_ring::mu2eshm_ring(int dtc, std::string name)
+	: name_(segment_name(dtc, name)), size_(region_offset_(MU2E_MAX_CHANNELS, 0, MU2E_MAP_META)), header_(nullptr)
+{
+	int fd = shm_open(name_.c_str(), O_RDWR | O_CREAT, 0660);
+	if (fd == -1)
+	{
+		throw std::runtime_error("mu2eshm_ring: shm_open " + name_ + " failed: " + strerror(errno));
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (static_cast<size_t>(st.st_size) < size_ && ftruncate(fd, size_) != 0))
+	{
+		auto err = errno;
+		::close(fd);
+		throw std::runtime_error("mu2eshm_ring: sizing " + name_ + " failed: " + strerror(err));
+	}
+	auto ptr = mmap(0, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (ptr == MAP_FAILED)
+	{
+		throw std::runtime_error("mu2eshm_ring: mmap " + name_ + " failed: " + strerror(errno));
+	}
+	header_ = static_cast<mu2eshm_header*>(ptr);
+
+	// Only the process which moves magic to MU2ESHM_INITIALIZING sets up the rings; the others wait for it
+	auto magic = header_->magic.load();
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+	while (magic != MU2ESHM_MAGIC)
+	{
+		if (magic != MU2ESHM_INITIALIZING && header_->magic.compare_exchange_strong(magic, MU2ESHM_INITIALIZING))
+		{
+			TLOG(TLVL_DEBUG) << "mu2eshm_ring: Initializing segment " << name_ << ", size " << size_;
+			header_->num_buffs = MU2ESHM_NUM_BUFFS;
+			header_->buff_size = sizeof(mu2e_databuff_t);
+			for (unsigned chn = 0; chn < MU2E_MAX_CHANNELS; ++chn)
+			{
+				// Same starting indices as the driver's alloc_mem: empty C2S ring, all S2C buffers free
+				header_->hwIdx[chn][C2S] = MU2ESHM_NUM_BUFFS - 1;
+				header_->swIdx[chn][C2S] = MU2ESHM_NUM_BUFFS - 1;
+				header_->hwIdx[chn][S2C] = 0;
+				header_->swIdx[chn][S2C] = 0;
+			}
+			header_->magic.store(MU2ESHM_MAGIC);
+			break;
+		}
+		if (magic != MU2ESHM_INITIALIZING) continue;  // Lost the race; magic now holds the current value
+
+		if (std::chrono::steady_clock::now() > deadline)
+		{
+			munmap(header_, size_);
+			header_ = nullptr;
+			throw std::runtime_error("mu2eshm_ring: segment " + name_ + " was never initialized");
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		magic = header_->magic.load();
+	}
+	TLOG(TLVL_DEBUG) << "mu2eshm_ring: Attached to segment " << name_ << " at " << (void*)header_;
+}
+
+mu2eshm_ring::~mu2eshm_ring()
+{
+	if (header_ != nullptr) munmap(header_, size_);
+}
+
+void mu2eshm_ring::unlink(int dtc, std::string name) { shm_unlink(segment_name(dtc, name).c_str()); }
+
+size_t mu2eshm_ring::region_offset_(int chn, int dir, int map) const
+{
+	size_t metaSize = round_up_to_page(MU2ESHM_NUM_BUFFS * sizeof(int));
+	size_t buffSize = MU2ESHM_NUM_BUFFS * sizeof(mu2e_databuff_t);
+	return round_up_to_page(sizeof(mu2eshm_header)) + (chn * 2 + dir) * (metaSize + buffSize) +
+		   (map == MU2E_MAP_META ? 0 : metaSize);
+}
+
+int* mu2eshm_ring::meta(int chn, int dir) const
+{
+	return reinterpret_cast<int*>(reinterpret_cast<uint8_t*>(header_) + region_offset_(chn, dir, MU2E_MAP_META));
+}
+
+mu2e_databuff_t* mu2eshm_ring::buffers(int chn, int dir) const
+{
+	return reinterpret_cast<mu2e_databuff_t*>(reinterpret_cast<uint8_t*>(header_) + region_offset_(chn, dir, MU2E_MAP_BUFF));
+}
+
+unsigned mu2eshm_ring::c2s_free(int chn) const
+{
+	unsigned hw = header_->hwIdx[chn][C2S].load(std::memory_order_acquire);
+	unsigned sw = header_->swIdx[chn][C2S].load(std::memory_order_acquire);
+	unsigned used = (hw >= sw) ? hw - sw : MU2ESHM_NUM_BUFFS + hw - sw;
+	return MU2ESHM_NUM_BUFFS - 1 - used;
+}
+
+int mu2eshm_ring::write_c2s(int chn, const void* data, size_t bytes)
+{
+	if (bytes > sizeof(mu2e_databuff_t) || c2s_free(chn) == 0) return -1;
+
+	unsigned next = (header_->hwIdx[chn][C2S].load(std::memory_order_relaxed) + 1) % MU2ESHM_NUM_BUFFS;
+	memcpy(buffers(chn, C2S)[next], data, bytes);
+	// Publish the buffer; the consumer sees it once it loads the byte count (polling) or hwIdx (GET_INFO)
+	__atomic_store_n(&meta(chn, C2S)[next], static_cast<int>(bytes), __ATOMIC_RELEASE);
+	header_->hwIdx[chn][C2S].store(next, std::memory_order_release);
+	return 0;
+}
+
+void* mu2eshm_ring::map_region(int chn, int dir, int map, size_t length, int prot) const
+{
+	int fd = shm_open(name_.c_str(), (prot & PROT_WRITE) ? O_RDWR : O_RDONLY, 0);
+	if (fd == -1) return MAP_FAILED;
+	auto ptr = mmap(0, length, prot, MAP_SHARED, fd, region_offset_(chn, dir, map));
+	::close(fd);
+	return ptr;
+}
+
+mu2eshm::mu2eshm()
+	: mu2edriver(), ring_(nullptr), views_() {}
+
+mu2eshm::~mu2eshm() { close_(); }
+
+int mu2eshm::open_(int dtc)
+{
+	ring_ = std::make_unique<mu2eshm_ring>(dtc);
+	return 0;
+}
+
+int mu2eshm::ioctl_(unsigned long request, unsigned long arg)
+{
+	auto header = ring_->header();
+	switch (request)
+	{
+		case M_IOC_GET_INFO: {
+			auto info = reinterpret_cast<m_ioc_get_info_t*>(arg);
+			if (info->chn < 0 || info->chn >= MU2E_MAX_CHANNELS || info->dir < 0 || info->dir > 1) break;
+			if (info->dir == C2S && info->tmo_ms > 0)
+			{
+				// Wait for a new buffer. The driver sleeps on a wait queue that its completion poll wakes; sleeping
+				// between checks gives the same kind of wake-up latency.
+				auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(info->tmo_ms);
+				while (header->hwIdx[info->chn][C2S].load(std::memory_order_acquire) ==
+						   header->swIdx[info->chn][C2S].load(std::memory_order_relaxed) &&
+					   std::chrono::steady_clock::now() < deadline)
+				{
+					std::this_thread::sleep_for(std::chrono::microseconds(10));
+				}
+			}
+			info->buff_size = header->buff_size;
+			info->num_buffs = header->num_buffs;
+			info->hwIdx = header->hwIdx[info->chn][info->dir].load(std::memory_order_acquire);
+			info->swIdx = header->swIdx[info->chn][info->dir].load(std::memory_order_acquire);
+			TLOG(TLVL_DEBUG + 20) << "mu2eshm::ioctl_ GET_INFO chn=" << info->chn << " dir=" << info->dir << " hwIdx=" << info->hwIdx
+								  << " swIdx=" << info->swIdx;
+			return 0;
+		}
+		case M_IOC_BUF_GIVE: {
+			unsigned chn = arg >> 24;
+			unsigned dir = (arg >> 16) & 1;
+			unsigned num = arg & 0xffff;
+			if (chn >= MU2E_MAX_CHANNELS) break;
+			unsigned sw = header->swIdx[chn][dir].load(std::memory_order_relaxed);
+			if (dir == C2S)
+			{
+				// As the driver does: clear the byte counts, so that only new completions are non-zero
+				auto BC_p = ring_->meta(chn, C2S);
+				for (unsigned ii = 1; ii <= num; ++ii) __atomic_store_n(&BC_p[(sw + ii) % header->num_buffs], 0, __ATOMIC_RELAXED);
+			}
+			header->swIdx[chn][dir].store((sw + num) % header->num_buffs, std::memory_order_release);
+			TLOG(TLVL_DEBUG + 21) << "mu2eshm::ioctl_ BUF_GIVE chn=" << chn << " dir=" << dir << " num=" << num;
+			return 0;
+		}
+		case M_IOC_BUF_XMIT: {
+			unsigned chn = arg >> 24;
+			unsigned bytes = arg & 0xffffff;
+			if (chn >= MU2E_MAX_CHANNELS) break;
+			unsigned idx = header->swIdx[chn][S2C].load(std::memory_order_relaxed);
+			ring_->meta(chn, S2C)[idx] = bytes;
+			if (ring_->write_c2s(chn, ring_->buffers(chn, S2C)[idx], bytes) != 0)
+			{
+				// The loopback receive ring is full: refuse the buffer, as the DTC does while the descriptor is busy
+				TLOG(TLVL_DEBUG + 22) << "mu2eshm::ioctl_ BUF_XMIT: C2S ring of channel " << chn << " is full, returning EAGAIN";
+				errno = EAGAIN;
+				return -1;
+			}
+			// The "hardware" consumes the buffer immediately
+			unsigned next = (idx + 1) % header->num_buffs;
+			header->swIdx[chn][S2C].store(next, std::memory_order_release);
+			header->hwIdx[chn][S2C].store(next, std::memory_order_release);
+			TLOG(TLVL_DEBUG + 22) << "mu2eshm::ioctl_ BUF_XMIT chn=" << chn << " idx=" << idx << " bytes=" << bytes;
+			return 0;
+		}
+		case M_IOC_REG_ACCESS: {
+			auto reg = reinterpret_cast<m_ioc_reg_access_t*>(arg);
+			auto& word = header->registers[(reg->reg_offset & 0xFFFF) / sizeof(uint32_t)];
+			if (reg->access_type == 0)
+				reg->val = word.load();
+			else
+				word.store(reg->val);
+			return 0;
+		}
+		case M_IOC_DUMP:
+			return 0;
+		default:
+			break;
+	}
+	errno = EINVAL;
+	return -1;
+}
+
+void* mu2eshm::mmap_(size_t length, int prot, off_t offset)
+{
+	// Undo chnDirMap2offset
+	auto region = offset / sysconf(_SC_PAGE_SIZE);
+	int chn = region / 4;
+	int dir = (region / 2) & 1;
+	int map = region & 1;
+	if (chn >= MU2E_MAX_CHANNELS) return MAP_FAILED;
+	if (!(prot & PROT_WRITE))
+	{
+		// A view into the read-write segment would not fault on a stray write
+		auto ptr = ring_->map_region(chn, dir, map, length, prot);
+		if (ptr != MAP_FAILED) views_.emplace_back(ptr, length);
+		return ptr;
+	}
+	return map == MU2E_MAP_META ? static_cast<void*>(ring_->meta(chn, dir)) : static_cast<void*>(ring_->buffers(chn, dir));
+}
+
+void mu2eshm::close_()
+{
+	// The rings are views into the segment, which is unmapped with it
+	for (unsigned chn = 0; chn < MU2E_MAX_CHANNELS; ++chn)
+		for (unsigned dir = 0; dir < 2; ++dir)
+			for (unsigned map = 0; map < 2; ++map)
+				mu2e_mmap_ptrs_[activeDTC_][chn][dir][map] = nullptr;
+	for (auto& view : views_) munmap(view.first, view.second);
+	views_.clear();
+	ring_.reset(nullptr);
+	devfd_ = -1;
+}
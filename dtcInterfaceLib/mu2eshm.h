@@ -0,0 +1,144 @@
+#ifndef MU2ESHM_H
+#define MU2ESHM_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mu2edriver.h"
+
+/// <summary>
+/// Number of ring buffers per channel and direction in a mu2eshm segment (same as the driver's receive rings)
+/// </summary>
+#define MU2ESHM_NUM_BUFFS 100U
+/// <summary>
+/// Value of mu2eshm_header::magic in an initialized segment
+/// </summary>
+#define MU2ESHM_MAGIC 0x6d753265U
+/// <summary>
+/// Value of mu2eshm_header::magic while the process which claimed the segment initializes it
+/// </summary>
+#define MU2ESHM_INITIALIZING 0x696e6974U
+
+/// <summary>
+/// Header at the start of a mu2eshm segment. The rings follow, laid out as for the mu2e driver:
+/// for each channel and direction, a MU2E_MAP_META array of byte counts and a MU2E_MAP_BUFF array of mu2e_databuff_t.
+/// hwIdx and swIdx follow the driver's conventions (m_ioc_get_info_t).
+/// </summary>
+struct mu2eshm_header
+{
+	std::atomic<uint32_t> magic;                                     ///< MU2ESHM_INITIALIZING, then MU2ESHM_MAGIC once the segment is initialized
+	uint32_t num_buffs;                                              ///< Number of buffers per ring
+	uint32_t buff_size;                                              ///< Size of each buffer
+	std::atomic<unsigned> hwIdx[MU2E_MAX_CHANNELS][2];               ///< Hardware (producer) index per channel/direction
+	std::atomic<unsigned> swIdx[MU2E_MAX_CHANNELS][2];               ///< Software (consumer) index per channel/direction
+	std::atomic<uint32_t> registers[0x10000 / sizeof(uint32_t)];     ///< Simulated register space
+};
+
+/// <summary>
+/// A POSIX shared-memory segment holding DMA rings with the same layout as the mu2e driver's mmapped rings.
+/// The segment is created by whichever side attaches first, readable and writable by its owner and group only. The mu2eshm backend is the consumer of the C2S rings;
+/// a separate producer process fills them with write_c2s, at memory speed.
+/// </summary>
+class mu2eshm_ring
+{
+public:
+	/// <summary>
+	/// Attach to (creating if necessary) the shared-memory segment for the given DTC
+	/// </summary>
+	/// <param name="dtc">DTC index, used to build the default segment name</param>
+	/// <param name="name">Segment name (Default: DTCLIB_SHM_NAME environment variable, or "/mu2eshm_dtcX")</param>
+	explicit mu2eshm_ring(int dtc, std::string name = "");
+	~mu2eshm_ring();
+
+	mu2eshm_ring(const mu2eshm_ring&) = delete;
+	mu2eshm_ring& operator=(const mu2eshm_ring&) = delete;
+
+	/// <summary>
+	/// Remove the named segment from the system. Attached processes keep their mapping.
+	/// </summary>
+	/// <param name="dtc">DTC index, used to build the default segment name</param>
+	/// <param name="name">Segment name (Default: DTCLIB_SHM_NAME environment variable, or "/mu2eshm_dtcX")</param>
+	static void unlink(int dtc, std::string name = "");
+
+	/// <summary>
+	/// Get the segment header
+	/// </summary>
+	/// <returns>Pointer to the segment header</returns>
+	mu2eshm_header* header() const { return header_; }
+	/// <summary>
+	/// Get the byte count (MU2E_MAP_META) array of a ring
+	/// </summary>
+	/// <param name="chn">Channel</param>
+	/// <param name="dir">Direction</param>
+	/// <returns>Pointer to the byte count array</returns>
+	int* meta(int chn, int dir) const;
+	/// <summary>
+	/// Get the buffer (MU2E_MAP_BUFF) array of a ring
+	/// </summary>
+	/// <param name="chn">Channel</param>
+	/// <param name="dir">Direction</param>
+	/// <returns>Pointer to the buffer array</returns>
+	mu2e_databuff_t* buffers(int chn, int dir) const;
+
+	/// <summary>
+	/// Number of C2S buffers the producer may still complete on the given channel
+	/// </summary>
+	/// <param name="chn">Channel</param>
+	/// <returns>Free buffer count</returns>
+	unsigned c2s_free(int chn) const;
+	/// <summary>
+	/// Complete one C2S buffer on the given channel, as the DTC would after a DMA: copy the data into the next ring
+	/// slot, set its byte count and advance hwIdx.
+	/// </summary>
+	/// <param name="chn">Channel</param>
+	/// <param name="data">Data to copy (normally starting with the 64-bit DMA byte count)</param>
+	/// <param name="bytes">Number of bytes to copy</param>
+	/// <returns>0 on success, -1 if the ring is full or bytes is larger than a buffer</returns>
+	int write_c2s(int chn, const void* data, size_t bytes);
+	/// <summary>
+	/// Map a ring region again, separately from the read-write mapping of the segment, e.g. read-only
+	/// </summary>
+	/// <param name="chn">Channel</param>
+	/// <param name="dir">Direction</param>
+	/// <param name="map">MU2E_MAP_BUFF or MU2E_MAP_META</param>
+	/// <param name="length">Number of bytes to map</param>
+	/// <param name="prot">Memory protection, as for mmap</param>
+	/// <returns>Pointer to the new mapping, to be released with munmap, or MAP_FAILED</returns>
+	void* map_region(int chn, int dir, int map, size_t length, int prot) const;
+
+private:
+	size_t region_offset_(int chn, int dir, int map) const;
+
+	std::string name_;
+	size_t size_;
+	mu2eshm_header* header_;
+};
+
+/// <summary>
+/// mu2ebackend which runs the mu2edriver ring handling against a mu2eshm_ring segment instead of /dev/mu2eX.
+/// The driver ioctls are emulated on the shared indices. Data written on an S2C channel is looped back into
+/// the C2S ring of the same channel; while that ring is full, BUF_XMIT fails with EAGAIN.
+/// The loopback writes through the read-write mapping of the segment; rings the driver code maps without PROT_WRITE
+/// get a separate mapping with that protection, so DTCLIB_C2S_READONLY works as with the driver.
+/// </summary>
+class mu2eshm : public mu2edriver
+{
+public:
+	mu2eshm();
+	virtual ~mu2eshm();
+
+protected:
+	int open_(int dtc) override;
+	int ioctl_(unsigned long request, unsigned long arg) override;
+	void* mmap_(size_t length, int prot, off_t offset) override;
+	void close_() override;
+
+private:
+	std::unique_ptr<mu2eshm_ring> ring_;
+	std::vector<std::pair<void*, size_t>> views_;  ///< Separate mappings made by mmap_, unmapped by close_
+};
+
+#endif
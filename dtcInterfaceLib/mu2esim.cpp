@@ -47,7 +47,11 @@
 
 mu2esim::mu2esim(std::string ddrFileName)
 	: registers_()
+	, writeBuffer_()
 	, swIdx_()
+	, hwIdx_()
+	, buffersHeld_()
+	, dmaByteCount_()
 	/*, detSimLoopCount_(0)*/
 	, dmaData_()
 	, ddrFileName_(ddrFileName)
@@ -66,6 +70,10 @@ mu2esim::mu2esim(std::string ddrFileName)
 		dmaData_[0][ii] = reinterpret_cast<mu2e_databuff_t*>(new char[0x10000]);
 		dmaData_[1][ii] = reinterpret_cast<mu2e_databuff_t*>(new char[0x10000]);
 	}
+	for (unsigned chn = 0; chn < MU2E_MAX_CHANNELS; ++chn)
+	{
+		writeBuffer_[chn] = reinterpret_cast<mu2e_databuff_t*>(new char[0x10000]);
+	}
 	release_all(0);
 	release_all(1);
 
@@ -109,6 +117,10 @@ mu2esim::~mu2esim()
 		delete[] dmaData_[0][ii];
 		delete[] dmaData_[1][ii];
 	}
+	for (unsigned chn = 0; chn < MU2E_MAX_CHANNELS; ++chn)
+	{
+		delete[] writeBuffer_[chn];
+	}
 	ddrFile_.reset(nullptr);
 }
 
@@ -118,6 +130,7 @@ int mu2esim::init(DTCLib::DTC_SimMode mode)
 	mode_ = mode;
 
 	TLOG(TLVL_Init) << "Initializing registers";
+	std::lock_guard<std::mutex> lk(registerMutex_);
 	// Set initial register values...
 	registers_[DTCLib::DTC_Register_DesignVersion] = 0x00006363;           // v99.99
 	registers_[DTCLib::DTC_Register_DesignDate] = 0x53494D44;              // SIMD in ASCII
@@ -150,58 +163,83 @@ int mu2esim::init(DTCLib::DTC_SimMode mode)
    returns number of bytes read; negative value indicates an error
    */
 int mu2esim::read_data(int chn, void** buffer, int tmo_ms)
+{
+	int bytesReturned = 0;
+	auto sts = read_data_batch(chn, buffer, &bytesReturned, 1, tmo_ms);
+	if (sts < 0) return sts;
+	return bytesReturned;
+}
+
+/*****************************
+   read_data_batch
+   returns number of buffers read; negative value indicates an error
+   */
+int mu2esim::read_data_batch(int chn, void** buffers, int* byteCounts, unsigned maxBuffers, int tmo_ms)
 {
 	auto start = std::chrono::steady_clock::now();
-	size_t bytesReturned = 0;
-	if (delta_(chn, C2S) == 0)
+	std::lock_guard<std::mutex> lk(channelMutex_[chn]);
+	if (chn == 0 && delta_(chn, C2S) <= buffersHeld_[chn])
 	{
-		TLOG(TLVL_ReadData) << "mu2esim::read_data: Clearing output buffer";
+		TLOG(TLVL_ReadData) << "mu2esim::read_data_batch: Clearing output buffer";
 		clearBuffer_(chn, false);
 
-		if (chn == 0)
+		// Leave one slot empty so that a full ring can be told apart from an empty one
+		while (delta_(chn, C2S) - buffersHeld_[chn] < maxBuffers && delta_(chn, C2S) < SIM_BUFFCOUNT - 1)
 		{
-			TLOG(TLVL_ReadData) << "mu2esim::read_data: Reading size from memory file";
-			uint64_t size;
-			ddrFile_->read(reinterpret_cast<char*>(&size), sizeof(uint64_t) / sizeof(char));
-
-			TLOG(TLVL_ReadData) << "mu2esim::read_data: Size is " << size;
-
-			if (ddrFile_->eof() || size == 0)
-			{
-				TLOG(TLVL_ReadData) << "mu2esim::read_data: End of file reached, looping back to start";
-				ddrFile_->clear();
-				ddrFile_->seekg(std::ios::beg);
-
-				TLOG(TLVL_ReadData) << " mu2esim::read_data: Re-reading size from memory file";
-				ddrFile_->read(reinterpret_cast<char*>(&size), sizeof(uint64_t));
-				TLOG(TLVL_ReadData) << "mu2esim::read_data: Size is " << size;
-				if (ddrFile_->eof())
-				{
-					TLOG(TLVL_ReadData) << "mu2esim::read_data: 0-size file detected!";
-					return -1;
-				}
-			}
-			TLOG(TLVL_ReadData) << "Size of data is " << size - sizeof(uint64_t) << ", reading into buffer " << swIdx_[chn] << ", at "
-								<< (void*)dmaData_[chn][swIdx_[chn]];
-			memcpy(dmaData_[chn][swIdx_[chn]], &size, sizeof(uint64_t));
-			ddrFile_->read(reinterpret_cast<char*>(dmaData_[chn][swIdx_[chn]]) + sizeof(uint64_t), size - sizeof(uint64_t));
-			bytesReturned = size;
-		}
-		else if (chn == 1)
-		{
-			// Data should already be in appropriate buffer
+			auto bytes = readDDRRecord_(hwIdx_[chn]);
+			if (bytes < 0) return -1;
+			dmaByteCount_[chn][hwIdx_[chn]] = bytes;
+			hwIdx_[chn] = (hwIdx_[chn] + 1) % SIM_BUFFCOUNT;
 		}
 	}
+	// On chn 1, data should already be in the appropriate buffers
 
-	*buffer = dmaData_[chn][swIdx_[chn]];
-	TLOG(TLVL_ReadData2) << "mu2esim::read_data: *buffer (" << (void*)*buffer << ") should now be equal to dmaData_[" << chn << "]["
-						 << swIdx_[chn] << "] (" << (void*)dmaData_[chn][swIdx_[chn]] << ")";
-	swIdx_[chn] = (swIdx_[chn] + 1) % SIM_BUFFCOUNT;
+	int count = 0;
+	while (delta_(chn, C2S) > buffersHeld_[chn] && static_cast<unsigned>(count) < maxBuffers)
+	{
+		auto idx = (swIdx_[chn] + buffersHeld_[chn]) % SIM_BUFFCOUNT;
+		buffers[count] = dmaData_[chn][idx];
+		byteCounts[count] = dmaByteCount_[chn][idx];
+		TLOG(TLVL_ReadData2) << "mu2esim::read_data_batch: buffers[" << count << "] (" << buffers[count] << ") should now be equal to dmaData_["
+							 << chn << "][" << idx << "] (" << (void*)dmaData_[chn][idx] << "), byteCount=" << byteCounts[count];
+		++buffersHeld_[chn];
+		++count;
+	}
 
 	auto duration =
 		std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
-	TLOG(TLVL_ReadData2) << "mu2esim::read_data took " << duration << " milliseconds out of tmo_ms=" << tmo_ms;
-	return static_cast<int>(bytesReturned);
+	TLOG(TLVL_ReadData2) << "mu2esim::read_data_batch returning " << count << " buffers, took " << duration << " milliseconds out of tmo_ms=" << tmo_ms;
+	return count;
+}
+
+int mu2esim::readDDRRecord_(unsigned idx)
+{
+	TLOG(TLVL_ReadData) << "mu2esim::readDDRRecord_: Reading size from memory file";
+	uint64_t size;
+	ddrFile_->read(reinterpret_cast<char*>(&size), sizeof(uint64_t) / sizeof(char));
+
+	TLOG(TLVL_ReadData) << "mu2esim::readDDRRecord_: Size is " << size;
+
+	if (ddrFile_->eof() || size == 0)
+	{
+		TLOG(TLVL_ReadData) << "mu2esim::readDDRRecord_: End of file reached, looping back to start";
+		ddrFile_->clear();
+		ddrFile_->seekg(std::ios::beg);
+
+		TLOG(TLVL_ReadData) << " mu2esim::readDDRRecord_: Re-reading size from memory file";
+		ddrFile_->read(reinterpret_cast<char*>(&size), sizeof(uint64_t));
+		TLOG(TLVL_ReadData) << "mu2esim::readDDRRecord_: Size is " << size;
+		if (ddrFile_->eof())
+		{
+			TLOG(TLVL_ReadData) << "mu2esim::readDDRRecord_: 0-size file detected!";
+			return -1;
+		}
+	}
+	TLOG(TLVL_ReadData) << "Size of data is " << size - sizeof(uint64_t) << ", reading into buffer " << idx << ", at "
+						<< (void*)dmaData_[0][idx];
+	memcpy(dmaData_[0][idx], &size, sizeof(uint64_t));
+	ddrFile_->read(reinterpret_cast<char*>(dmaData_[0][idx]) + sizeof(uint64_t), size - sizeof(uint64_t));
+	return static_cast<int>(size);
 }
 
 int mu2esim::write_data(int chn, void* buffer, size_t bytes)
@@ -212,13 +250,17 @@ int mu2esim::write_data(int chn, void* buffer, size_t bytes)
 							 << ", *buffer=" << *((uint64_t*)buffer);
 		if (bytes <= sizeof(mu2e_databuff_t))
 		{
+			std::lock_guard<std::mutex> lk(channelMutex_[0]);
 			if (event_) closeEvent_();
 
 			// Strip off first 64-bit word
 			auto writeBytes = *reinterpret_cast<uint64_t*>(buffer) - sizeof(uint64_t);
 			auto ptr = reinterpret_cast<char*>(buffer) + (sizeof(uint64_t) / sizeof(char));
 			ddrFile_->write(ptr, writeBytes);
-			registers_[DTCLib::DTC_Register_DetEmulation_DataEndAddress] += static_cast<uint32_t>(writeBytes);
+			{
+				std::lock_guard<std::mutex> rlk(registerMutex_);
+				registers_[DTCLib::DTC_Register_DetEmulation_DataEndAddress] += static_cast<uint32_t>(writeBytes);
+			}
 			ddrFile_->flush();
 			return 0;
 		}
@@ -236,12 +278,14 @@ int mu2esim::write_data(int chn, void* buffer, size_t bytes)
 		DTCLib::DTC_EventWindowTag ts(reinterpret_cast<uint8_t*>(buffer) + 6);
 		if ((word & 0x8010) == 0x8010)
 		{
+			std::lock_guard<std::mutex> lk(channelMutex_[0]);
 			TLOG(TLVL_WriteData) << "mu2esim::write_data: Readout Request: activeDAQLink=" << activeLink
 								 << ", ts=" << ts.GetEventWindowTag(true);
 			readoutRequestReceived_[ts.GetEventWindowTag(true)][activeLink] = true;
 		}
 		else if ((word & 0x8020) == 0x8020)
 		{
+			std::lock_guard<std::mutex> lk(channelMutex_[0]);
 			TLOG(TLVL_WriteData) << "mu2esim::write_data: Data Request: activeDAQLink=" << activeLink << ", ts=" << ts.GetEventWindowTag(true);
 			if (activeLink != DTCLib::DTC_Link_Unused)
 			{
@@ -301,34 +345,47 @@ int mu2esim::write_data(int chn, void* buffer, size_t bytes)
 	return 0;
 }
 
+void* mu2esim::write_acquire(int chn, int tmo_ms)
+{
+	std::unique_lock<std::mutex> lk(writeMutex_[chn]);
+	TLOG(TLVL_WriteData) << "mu2esim::write_acquire: chn=" << chn << ", buf=" << (void*)writeBuffer_[chn];
+	lk.release();  // Held until write_commit
+	return writeBuffer_[chn];
+}
+
+int mu2esim::write_commit(int chn, size_t bytes)
+{
+	std::lock_guard<std::mutex> lk(writeMutex_[chn], std::adopt_lock);
+	if (bytes == 0) return 0;
+	return write_data(chn, writeBuffer_[chn], bytes);
+}
+
 int mu2esim::read_release(int chn, unsigned num)
 {
 	// Always succeeds
 	TLOG(TLVL_ReadRelease) << "mu2esim::read_release: Simulating a release of " << num << "u buffers of channel " << chn;
-	for (unsigned ii = 0; ii < num; ++ii)
-	{
-		if (delta_(chn, C2S) != 0) swIdx_[chn] = (swIdx_[chn] + 1) % SIM_BUFFCOUNT;
-	}
+	std::lock_guard<std::mutex> lk(channelMutex_[chn]);
+	auto available = delta_(chn, C2S);
+	if (num > available) num = available;
+	swIdx_[chn] = (swIdx_[chn] + num) % SIM_BUFFCOUNT;
+	buffersHeld_[chn] = num < buffersHeld_[chn] ? buffersHeld_[chn] - num : 0;
 	return 0;
 }
 
 int mu2esim::release_all(int chn)
 {
-	read_release(chn, SIM_BUFFCOUNT);
-	swIdx_[chn] = 0;
+	std::lock_guard<std::mutex> lk(channelMutex_[chn]);
+	swIdx_[chn] = hwIdx_[chn];
+	buffersHeld_[chn] = 0;
 	return 0;
 }
 
 int mu2esim::read_register(uint16_t address, int tmo_ms, uint32_t* output)
 {
 	auto start = std::chrono::steady_clock::now();
-	*output = 0;
-	if (registers_.count(address) > 0)
-	{
-		TLOG(TLVL_ReadRegister) << "mu2esim::read_register: Returning value 0x" << std::hex << registers_[address] << " for address 0x"
-								<< std::hex << address;
-		*output = registers_[address];
-	}
+	*output = registerValue_(address);
+	TLOG(TLVL_ReadRegister) << "mu2esim::read_register: Returning value 0x" << std::hex << *output << " for address 0x" << std::hex
+							<< address;
 	auto duration =
 		std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
 	TLOG(TLVL_ReadRegister2) << "mu2esim::read_register took " << duration << " milliseconds out of tmo_ms=" << tmo_ms;
@@ -341,14 +398,17 @@ int mu2esim::write_register(uint16_t address, int tmo_ms, uint32_t data)
 	// Write the register!!!
 	TLOG(TLVL_WriteRegister) << "mu2esim::write_register: Writing value 0x" << std::hex << data << " into address 0x" << std::hex
 							 << address;
-	registers_[address] = data;
+	{
+		std::lock_guard<std::mutex> lk(registerMutex_);
+		registers_[address] = data;
+	}
 	auto duration =
 		std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
 	TLOG(TLVL_WriteRegister2) << "mu2esim::write_register took " << duration << " milliseconds out of tmo_ms=" << tmo_ms;
 	std::bitset<32> dataBS(data);
 	if (address == DTCLib::DTC_Register_DTCControl)
 	{
-		auto detectorEmulationMode = (registers_[DTCLib::DTC_Register_DetEmulation_Control0] & 0x3) != 0;
+		auto detectorEmulationMode = (registerValue_(DTCLib::DTC_Register_DetEmulation_Control0) & 0x3) != 0;
 		if (dataBS[30] == 1 && !detectorEmulationMode)
 		{
 			TLOG(TLVL_WriteRegister2) << "mu2esim::write_register: CFO Emulator Enable Detected!";
@@ -356,7 +416,7 @@ int mu2esim::write_register(uint16_t address, int tmo_ms, uint32_t data)
 			if (cfoEmulatorThread_.joinable()) cfoEmulatorThread_.join();
 			cancelCFO_ = false;
 #if THREADED_CFO_EMULATOR
-			if (registers_[0x91AC] > 10)
+			if (registerValue_(0x91AC) > 10)
 			{
 				cfoEmulatorThread_ = std::thread(&mu2esim::CFOEmulator_, this);
 			}
@@ -374,6 +434,7 @@ int mu2esim::write_register(uint16_t address, int tmo_ms, uint32_t data)
 		{
 			TLOG(TLVL_WriteRegister2) << "mu2esim::write_register: RESETTING DTC EMULATOR!";
 			init(mode_);
+			std::lock_guard<std::mutex> lk(channelMutex_[0]);
 			reopenDDRFile_();
 		}
 	}
@@ -381,11 +442,13 @@ int mu2esim::write_register(uint16_t address, int tmo_ms, uint32_t data)
 	{
 		if (dataBS[0] == 0)
 		{
+			std::lock_guard<std::mutex> lk(channelMutex_[0]);
 			reopenDDRFile_();
 		}
 	}
 	if (address == DTCLib::DTC_Register_DetEmulation_DataStartAddress)
 	{
+		std::lock_guard<std::mutex> lk(channelMutex_[0]);
 		ddrFile_->seekg(data);
 	}
 	return 0;
@@ -395,21 +458,22 @@ void mu2esim::CFOEmulator_()
 {
 	if (cancelCFO_)
 	{
+		std::lock_guard<std::mutex> lk(registerMutex_);
 		std::bitset<32> ctrlReg(registers_[0x9100]);
 		ctrlReg[30] = 0;
 		registers_[0x9100] = ctrlReg.to_ulong();
 		return;
 	}
-	DTCLib::DTC_EventWindowTag start(registers_[DTCLib::DTC_Register_CFOEmulation_TimestampLow],
-									 static_cast<uint16_t>(registers_[DTCLib::DTC_Register_CFOEmulation_TimestampHigh]));
-	auto count = registers_[DTCLib::DTC_Register_CFOEmulation_NumHeartbeats];
-	auto ticksToWait = static_cast<long long>(registers_[DTCLib::DTC_Register_CFOEmulation_HeartbeatInterval] * 0.0064);
+	DTCLib::DTC_EventWindowTag start(registerValue_(DTCLib::DTC_Register_CFOEmulation_TimestampLow),
+									 static_cast<uint16_t>(registerValue_(DTCLib::DTC_Register_CFOEmulation_TimestampHigh)));
+	auto count = registerValue_(DTCLib::DTC_Register_CFOEmulation_NumHeartbeats);
+	auto ticksToWait = static_cast<long long>(registerValue_(DTCLib::DTC_Register_CFOEmulation_HeartbeatInterval) * 0.0064);
 	TLOG(TLVL_CFOEmulator) << "mu2esim::CFOEmulator_ start timestamp=" << start.GetEventWindowTag(true) << ", count=" << count
 						   << ", delayBetween=" << ticksToWait;
 	bool linkEnabled[6];
 	for (auto link : DTCLib::DTC_Links)
 	{
-		std::bitset<32> linkRocs(registers_[DTCLib::DTC_Register_LinkEnable]);
+		std::bitset<32> linkRocs(registerValue_(DTCLib::DTC_Register_LinkEnable));
 		auto number = linkRocs[link] + linkRocs[link + 8];
 		TLOG(TLVL_CFOEmulator) << "mu2esim::CFOEmulator_ linkRocs[" << static_cast<int>(link) << "]=" << number;
 		linkEnabled[link] = number != 0;
@@ -418,6 +482,7 @@ void mu2esim::CFOEmulator_()
 	unsigned sentCount = 0;
 	while (sentCount < count && !cancelCFO_)
 	{
+		std::unique_lock<std::mutex> lk(channelMutex_[0]);
 		if (mode_ == DTCLib::DTC_SimMode_Event)
 		{
 			TLOG(TLVL_CFOEmulator) << "Event mode enabled, calling eventSimulator_";
@@ -432,22 +497,22 @@ void mu2esim::CFOEmulator_()
 				switch (link)
 				{
 					case DTCLib::DTC_Link_0:
-						packetCount = static_cast<uint16_t>(registers_[DTCLib::DTC_Register_CFOEmulation_NumPacketsLinks10]);
+						packetCount = static_cast<uint16_t>(registerValue_(DTCLib::DTC_Register_CFOEmulation_NumPacketsLinks10));
 						break;
 					case DTCLib::DTC_Link_1:
-						packetCount = static_cast<uint16_t>(registers_[DTCLib::DTC_Register_CFOEmulation_NumPacketsLinks10] >> 16);
+						packetCount = static_cast<uint16_t>(registerValue_(DTCLib::DTC_Register_CFOEmulation_NumPacketsLinks10) >> 16);
 						break;
 					case DTCLib::DTC_Link_2:
-						packetCount = static_cast<uint16_t>(registers_[DTCLib::DTC_Register_CFOEmulation_NumPacketsLinks32]);
+						packetCount = static_cast<uint16_t>(registerValue_(DTCLib::DTC_Register_CFOEmulation_NumPacketsLinks32));
 						break;
 					case DTCLib::DTC_Link_3:
-						packetCount = static_cast<uint16_t>(registers_[DTCLib::DTC_Register_CFOEmulation_NumPacketsLinks32] >> 16);
+						packetCount = static_cast<uint16_t>(registerValue_(DTCLib::DTC_Register_CFOEmulation_NumPacketsLinks32) >> 16);
 						break;
 					case DTCLib::DTC_Link_4:
-						packetCount = static_cast<uint16_t>(registers_[DTCLib::DTC_Register_CFOEmulation_NumPacketsLinks54]);
+						packetCount = static_cast<uint16_t>(registerValue_(DTCLib::DTC_Register_CFOEmulation_NumPacketsLinks54));
 						break;
 					case DTCLib::DTC_Link_5:
-						packetCount = static_cast<uint16_t>(registers_[DTCLib::DTC_Register_CFOEmulation_NumPacketsLinks54] >> 16);
+						packetCount = static_cast<uint16_t>(registerValue_(DTCLib::DTC_Register_CFOEmulation_NumPacketsLinks54) >> 16);
 						break;
 					default:
 						packetCount = 0;
@@ -480,6 +545,7 @@ void mu2esim::CFOEmulator_()
 			}
 			closeEvent_();
 		}
+		lk.unlock();
 
 		if (ticksToWait > 100)
 		{
@@ -487,6 +553,7 @@ void mu2esim::CFOEmulator_()
 		}
 		sentCount++;
 	}
+	std::lock_guard<std::mutex> lk(registerMutex_);
 	std::bitset<32> ctrlReg(registers_[0x9100]);
 	ctrlReg[30] = 0;
 	registers_[0x9100] = ctrlReg.to_ulong();
@@ -494,8 +561,6 @@ void mu2esim::CFOEmulator_()
 
 unsigned mu2esim::delta_(int chn, int dir)
 {
-	if (chn == 0) return 0;
-	TLOG(TLVL_DeltaChn) << "delta_ " << chn << " " << dir << " = 0";
 	unsigned hw = hwIdx_[chn];
 	unsigned sw = swIdx_[chn];
 	TLOG(TLVL_DeltaChn) << "mu2esim::delta_ chn=" << chn << " dir=" << dir << " hw=" << hw << " sw=" << sw
@@ -506,6 +571,13 @@ unsigned mu2esim::delta_(int chn, int dir)
 		return ((sw >= hw) ? SIM_BUFFCOUNT - (sw - hw) : hw - sw);
 }
 
+uint32_t mu2esim::registerValue_(uint16_t address)
+{
+	std::lock_guard<std::mutex> lk(registerMutex_);
+	auto it = registers_.find(address);
+	return it != registers_.end() ? it->second : 0;
+}
+
 void mu2esim::clearBuffer_(int chn, bool increment)
 {
 	TLOG(TLVL_ClearBuffer2) << "mu2esim::clearBuffer_(" << chn << ", " << increment << "): NOP";
@@ -544,11 +616,11 @@ DTCLib::DTC_EventMode mu2esim::getEventMode_()
 {
 	DTCLib::DTC_EventMode event_mode;
 
-	event_mode.mode0 = static_cast<uint8_t>(registers_[DTCLib::DTC_Register_CFOEmulation_EventMode1] & 0xFF);
-	event_mode.mode1 = static_cast<uint8_t>((registers_[DTCLib::DTC_Register_CFOEmulation_EventMode1] & 0xFF00) >> 8);
-	event_mode.mode2 = static_cast<uint8_t>((registers_[DTCLib::DTC_Register_CFOEmulation_EventMode1] & 0xFF0000) >> 16);
-	event_mode.mode3 = static_cast<uint8_t>((registers_[DTCLib::DTC_Register_CFOEmulation_EventMode1] & 0xFF000000) >> 24);
-	event_mode.mode4 = static_cast<uint8_t>(registers_[DTCLib::DTC_Register_CFOEmulation_EventMode2] & 0xFF);
+	event_mode.mode0 = static_cast<uint8_t>(registerValue_(DTCLib::DTC_Register_CFOEmulation_EventMode1) & 0xFF);
+	event_mode.mode1 = static_cast<uint8_t>((registerValue_(DTCLib::DTC_Register_CFOEmulation_EventMode1) & 0xFF00) >> 8);
+	event_mode.mode2 = static_cast<uint8_t>((registerValue_(DTCLib::DTC_Register_CFOEmulation_EventMode1) & 0xFF0000) >> 16);
+	event_mode.mode3 = static_cast<uint8_t>((registerValue_(DTCLib::DTC_Register_CFOEmulation_EventMode1) & 0xFF000000) >> 24);
+	event_mode.mode4 = static_cast<uint8_t>(registerValue_(DTCLib::DTC_Register_CFOEmulation_EventMode2) & 0xFF);
 
 	return event_mode;
 }
@@ -607,9 +679,17 @@ void mu2esim::dcsPacketSimulator_(DTCLib::DTC_DCSRequestPacket in)
 		}
 	}
 
+	std::lock_guard<std::mutex> lk(channelMutex_[1]);
+	if (delta_(1, C2S) >= SIM_BUFFCOUNT - 1)
+	{
+		TLOG(TLVL_DCSPacketSimulator) << "mu2esim::dcsPacketSimulator_: DCS receive ring is full, dropping reply!";
+		return;
+	}
+
 	size_t packetSize = dataPacket.GetSize();
 	*reinterpret_cast<uint64_t*>(dmaData_[1][hwIdx_[1]]) = packetSize;
 	memcpy(reinterpret_cast<uint64_t*>(dmaData_[1][hwIdx_[1]]) + 1, dataPacket.GetData(), packetSize);
+	dmaByteCount_[1][hwIdx_[1]] = static_cast<int>(packetSize + sizeof(uint64_t));
 	hwIdx_[1] = (hwIdx_[1] + 1) % SIM_BUFFCOUNT;
 }
 
@@ -681,7 +761,7 @@ void mu2esim::trackerBlockSimulator_(DTCLib::DTC_EventWindowTag ts, DTCLib::DTC_
 	uint16_t buffer[24];
 
 	size_t nPackets = 2;
-	DTCLib::DTC_DataHeaderPacket header(link, nPackets, DTCLib::DTC_DataStatus_Valid, DTCID, DTCLib::DTC_Subsystem_Tracker, CURRENT_EMULATED_TRACKER_VERSION, ts, static_cast<uint8_t>(registers_[DTCLib::DTC_Register_CFOEmulation_EventMode1] & 0xFF));
+	DTCLib::DTC_DataHeaderPacket header(link, nPackets, DTCLib::DTC_DataStatus_Valid, DTCID, DTCLib::DTC_Subsystem_Tracker, CURRENT_EMULATED_TRACKER_VERSION, ts, static_cast<uint8_t>(registerValue_(DTCLib::DTC_Register_CFOEmulation_EventMode1) & 0xFF));
 	memcpy(&buffer[0], header.ConvertToDataPacket().GetData(), 16);
 
 	uint16_t strawID = ((static_cast<int>(link) + (DTCID * 6)) << 7) + 1;
@@ -757,7 +837,7 @@ void mu2esim::calorimeterBlockSimulator_(DTCLib::DTC_EventWindowTag ts, DTCLib::
 	}
 
 	size_t nPackets = (buffer.size() / 8) - 1;
-	DTCLib::DTC_DataHeaderPacket header(link, nPackets, DTCLib::DTC_DataStatus_Valid, DTCID, DTCLib::DTC_Subsystem_Calorimeter, CURRENT_EMULATED_CALORIMETER_VERSION, ts, static_cast<uint8_t>(registers_[DTCLib::DTC_Register_CFOEmulation_EventMode1] & 0xFF));
+	DTCLib::DTC_DataHeaderPacket header(link, nPackets, DTCLib::DTC_DataStatus_Valid, DTCID, DTCLib::DTC_Subsystem_Calorimeter, CURRENT_EMULATED_CALORIMETER_VERSION, ts, static_cast<uint8_t>(registerValue_(DTCLib::DTC_Register_CFOEmulation_EventMode1) & 0xFF));
 	memcpy(&buffer[0], header.ConvertToDataPacket().GetData(), 16);
 
 	DTCLib::DTC_DataBlock block(buffer.size() * sizeof(uint16_t));
@@ -770,7 +850,7 @@ void mu2esim::crvBlockSimulator_(DTCLib::DTC_EventWindowTag ts, DTCLib::DTC_Link
 	uint16_t buffer[24];
 
 	size_t nPackets = 2;
-	DTCLib::DTC_DataHeaderPacket header(link, nPackets, DTCLib::DTC_DataStatus_Valid, DTCID, DTCLib::DTC_Subsystem_CRV, CURRENT_EMULATED_CRV_VERSION, ts, static_cast<uint8_t>(registers_[DTCLib::DTC_Register_CFOEmulation_EventMode1] & 0xFF));
+	DTCLib::DTC_DataHeaderPacket header(link, nPackets, DTCLib::DTC_DataStatus_Valid, DTCID, DTCLib::DTC_Subsystem_CRV, CURRENT_EMULATED_CRV_VERSION, ts, static_cast<uint8_t>(registerValue_(DTCLib::DTC_Register_CFOEmulation_EventMode1) & 0xFF));
 	memcpy(&buffer[0], header.ConvertToDataPacket().GetData(), 16);
 
 	// ROC Status packet
@@ -782,7 +862,7 @@ void mu2esim::crvBlockSimulator_(DTCLib::DTC_EventWindowTag ts, DTCLib::DTC_Link
 	buffer[12] = 0;
 	buffer[13] = 1;
 	buffer[14] = 0;
-	buffer[15] = static_cast<uint8_t>(registers_[DTCLib::DTC_Register_CFOEmulation_EventMode1] & 0xFF) << 8;
+	buffer[15] = static_cast<uint8_t>(registerValue_(DTCLib::DTC_Register_CFOEmulation_EventMode1) & 0xFF) << 8;
 
 	// Hit Readout
 	buffer[16] = 0;
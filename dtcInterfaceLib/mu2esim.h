@@ -17,14 +17,18 @@
 #include "DTC_Packets.h"
 #include "DTC_Types.h"
 #include "mu2e_driver/mu2e_mmap_ioctl.h"  //
+#include "mu2ebackend.h"
 
 #define SIM_BUFFCOUNT 40U
 
 /// <summary>
 /// The mu2esim class emulates a DTC in software. It can be used for hardware-independent testing of software,
 /// especially higher-level trigger algorithms.
+/// The DAQ and DCS channels each have their own mutex, covering the channel's receive ring and the state that feeds it
+/// (the simulated DDR memory for DAQ, the DCS reply generator for DCS), so the two channels may be used from
+/// separate threads. The register space has its own mutex.
 /// </summary>
-class mu2esim
+class mu2esim : public mu2ebackend
 {
 public:
 	/// <summary>
@@ -32,7 +36,7 @@ public:
 	/// <param name="ddrFileName">Name of the simulated DDR memory file</param>
 	/// </summary>
 	mu2esim(std::string ddrFileName);
-	~mu2esim();
+	virtual ~mu2esim();
 	/// <summary>
 	/// Initialize the simulator using the given simulation mode
 	/// </summary>
@@ -49,6 +53,18 @@ public:
 	/// <returns>Byte count of data read into buffer. Negative value indicates error.</returns>
 	int read_data(int chn, void** buffer, int tmo_ms);
 	/// <summary>
+	/// Reads every completed buffer on the given channel, up to maxBuffers, in ring order. On the DAQ channel, if no
+	/// completed buffers are waiting, the simulator fills as many free ring slots as requested from the simulated DDR
+	/// memory. Buffers returned are held until released with read_release.
+	/// </summary>
+	/// <param name="chn">Channel to read</param>
+	/// <param name="buffers">Output array of buffer pointers (at least maxBuffers entries)</param>
+	/// <param name="byteCounts">Output array of buffer byte counts (at least maxBuffers entries)</param>
+	/// <param name="maxBuffers">Maximum number of buffers to return</param>
+	/// <param name="tmo_ms">Timeout for read</param>
+	/// <returns>Number of buffers returned, 0 if none are available. Negative value indicates error.</returns>
+	int read_data_batch(int chn, void** buffers, int* byteCounts, unsigned maxBuffers, int tmo_ms) override;
+	/// <summary>
 	/// Write data from the given buffer to the requested channel. The simulator will process the packets and enqueue
 	/// appropriate responses.
 	/// </summary>
@@ -56,20 +72,40 @@ public:
 	/// <param name="buffer">Address of buffer to write</param>
 	/// <param name="bytes">Bytes to write</param>
 	/// <returns>0 when successful (always)</returns>
-	int write_data(int chn, void* buffer, size_t bytes);
+	int write_data(int chn, void* buffer, size_t bytes) override;
+	/// <summary>
+	/// Get the simulator's write buffer for the given channel. It is processed as by write_data when committed.
+	/// </summary>
+	/// <param name="chn">Channel to write</param>
+	/// <param name="tmo_ms">Timeout (unused, the buffer is always available)</param>
+	/// <returns>Pointer to the channel's write buffer</returns>
+	void* write_acquire(int chn, int tmo_ms) override;
 	/// <summary>
-	/// Release a number of buffers held by the software on the given channel
+	/// Process the contents of the write buffer obtained from write_acquire
+	/// </summary>
+	/// <param name="chn">Channel to write</param>
+	/// <param name="bytes">Bytes to write. 0 gives the buffer back without processing it.</param>
+	/// <returns>0 when successful (always)</returns>
+	int write_commit(int chn, size_t bytes) override;
+	/// <summary>
+	/// Release a number of buffers held by the software on the given channel, oldest first
 	/// </summary>
 	/// <param name="chn">Channel to release</param>
 	/// <param name="num">Number of buffers to release</param>
 	/// <returns>0 when successful (always)</returns>
-	int read_release(int chn, unsigned num);
+	int read_release(int chn, unsigned num) override;
 	/// <summary>
 	/// Release all buffers held by the software on the given channel
 	/// </summary>
 	/// <param name="chn">Channel to release</param>
 	/// <returns>0 when successful (always)</returns>
-	int release_all(int chn);
+	int release_all(int chn) override;
+	/// <summary>
+	/// Get the number of buffers in the simulated receive ring
+	/// </summary>
+	/// <param name="chn">Channel</param>
+	/// <returns>SIM_BUFFCOUNT</returns>
+	unsigned get_ring_size(int /*chn*/) const override { return SIM_BUFFCOUNT; }
 	/// <summary>
 	/// Read from the simulated register space
 	/// </summary>
@@ -77,7 +113,7 @@ public:
 	/// <param name="tmo_ms">timeout for read</param>
 	/// <param name="output">Output pointer</param>
 	/// <returns>0 when successful (always)</returns>
-	int read_register(uint16_t address, int tmo_ms, uint32_t* output);
+	int read_register(uint16_t address, int tmo_ms, uint32_t* output) override;
 	/// <summary>
 	/// Write to the simulated register space
 	/// </summary>
@@ -85,10 +121,12 @@ public:
 	/// <param name="tmo_ms">Timeout for write</param>
 	/// <param name="data">Data to write</param>
 	/// <returns>0 when successful (always)</returns>
-	int write_register(uint16_t address, int tmo_ms, uint32_t data);
+	int write_register(uint16_t address, int tmo_ms, uint32_t data) override;
 
 private:
 	unsigned delta_(int chn, int dir);
+	uint32_t registerValue_(uint16_t address);
+	int readDDRRecord_(unsigned idx);
 	static void clearBuffer_(int chn, bool increment = true);
 	void openEvent_(DTCLib::DTC_EventWindowTag ts);
 	void closeEvent_();
@@ -106,8 +144,14 @@ private:
 	void reopenDDRFile_();
 
 	std::unordered_map<uint16_t, uint32_t> registers_;
+	std::mutex registerMutex_;
+	std::mutex channelMutex_[MU2E_MAX_CHANNELS];
+	mu2e_databuff_t* writeBuffer_[MU2E_MAX_CHANNELS];
+	std::mutex writeMutex_[MU2E_MAX_CHANNELS];
 	unsigned swIdx_[MU2E_MAX_CHANNELS];
 	unsigned hwIdx_[MU2E_MAX_CHANNELS];
+	unsigned buffersHeld_[MU2E_MAX_CHANNELS];
+	int dmaByteCount_[MU2E_MAX_CHANNELS][SIM_BUFFCOUNT];
 	//uint32_t detSimLoopCount_;
 	mu2e_databuff_t* dmaData_[MU2E_MAX_CHANNELS][SIM_BUFFCOUNT];
 	std::string ddrFileName_;
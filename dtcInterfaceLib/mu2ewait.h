@@ -0,0 +1,39 @@
+#ifndef MU2EWAIT_H
+#define MU2EWAIT_H
+
+#include <sched.h>
+#include <unistd.h>
+
+/// <summary>
+/// How a polling loop waits between checks, e.g. a backend for a free send (S2C) buffer or for the DTC to accept one
+/// </summary>
+enum mu2e_wait_strategy
+{
+	MU2E_WAIT_SPIN = 0,   ///< Re-check continuously
+	MU2E_WAIT_YIELD = 1,  ///< Yield the CPU between checks
+	MU2E_WAIT_BLOCK = 2,  ///< Sleep between checks, with exponential backoff up to 1 ms
+};
+
+/// <summary>
+/// Wait once between two checks, as the strategy says. Callers start backoff_us at their shortest sleep, and reset
+/// it once the condition they wait for is met.
+/// </summary>
+/// <param name="strategy">Wait strategy</param>
+/// <param name="backoff_us">Sleep time for MU2E_WAIT_BLOCK, in microseconds; doubled on each call, up to 1 ms</param>
+inline void mu2e_wait_step(mu2e_wait_strategy strategy, unsigned& backoff_us)
+{
+	switch (strategy)
+	{
+		case MU2E_WAIT_SPIN:
+			break;
+		case MU2E_WAIT_YIELD:
+			sched_yield();
+			break;
+		case MU2E_WAIT_BLOCK:
+			usleep(backoff_us);
+			if (backoff_us < 1000) backoff_us *= 2;
+			break;
+	}
+}
+
+#endif
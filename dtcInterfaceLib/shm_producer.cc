@@ -0,0 +1,117 @@
+#include <unistd.h>  // usleep
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "dtcInterfaceLib/DTC_Types.h"
+#include "dtcInterfaceLib/mu2eshm.h"
+
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "mu2eShmProducer"
+
+void printHelpMsg()
+{
+	std::cout << "Fills the mu2eshm C2S ring of a DTC with the DMA records of a DTC binary file," << std::endl
+			  << "for a reader using DTC_SimMode_SharedMemory (DTCLIB_SIM_ENABLE=S)" << std::endl;
+	std::cout << "Usage: mu2eShmProducer [options] file" << std::endl;
+	std::cout << "Options are:" << std::endl
+			  << "    -h: This message." << std::endl
+			  << "    -d: DTC index (Default: DTCLIB_DTC environment variable, or 0)." << std::endl
+			  << "    -c: DMA channel to fill (Default: 0, DAQ)." << std::endl
+			  << "    -n: Number of times to loop over the file (Default: 1, 0 for forever)." << std::endl
+			  << "    -u: Unlink the shared-memory segment and exit." << std::endl;
+	exit(0);
+}
+
+int main(int argc, char* argv[])
+{
+	int dtc = -1;
+	int chn = 0;
+	unsigned loops = 1;
+	bool unlinkOnly = false;
+	std::string file = "";
+
+	for (auto optind = 1; optind < argc; ++optind)
+	{
+		if (argv[optind][0] == '-')
+		{
+			switch (argv[optind][1])
+			{
+				case 'd':
+					dtc = DTCLib::Utilities::getOptionValue(&optind, &argv);
+					break;
+				case 'c':
+					chn = DTCLib::Utilities::getOptionValue(&optind, &argv);
+					break;
+				case 'n':
+					loops = DTCLib::Utilities::getOptionValue(&optind, &argv);
+					break;
+				case 'u':
+					unlinkOnly = true;
+					break;
+				default:
+					TLOG(TLVL_ERROR) << "Unknown option: " << argv[optind];
+					printHelpMsg();
+					break;
+				case 'h':
+					printHelpMsg();
+					break;
+			}
+		}
+		else
+		{
+			file = std::string(argv[optind]);
+		}
+	}
+
+	if (dtc == -1)
+	{
+		auto dtcE = getenv("DTCLIB_DTC");
+		dtc = dtcE != nullptr ? strtol(dtcE, nullptr, 0) : 0;
+	}
+
+	if (unlinkOnly)
+	{
+		mu2eshm_ring::unlink(dtc);
+		return 0;
+	}
+	if (file == "" || chn < 0 || chn >= MU2E_MAX_CHANNELS) printHelpMsg();
+
+	std::ifstream is(file, std::ios::binary);
+	if (!is)
+	{
+		TLOG(TLVL_ERROR) << "Cannot read file " << file;
+		return 1;
+	}
+
+	mu2eshm_ring ring(dtc);
+	mu2e_databuff_t buf;
+	size_t records = 0;
+	size_t bytes = 0;
+
+	for (unsigned loop = 0; loops == 0 || loop < loops; ++loop)
+	{
+		is.clear();
+		is.seekg(0, std::ios::beg);
+		uint64_t size;
+		while (is.read(reinterpret_cast<char*>(&size), sizeof(uint64_t)) && size > 0)
+		{
+			if (size > sizeof(mu2e_databuff_t) || size < sizeof(uint64_t))
+			{
+				TLOG(TLVL_ERROR) << "Record of " << size << " bytes does not fit in a DMA buffer or is shorter than its size word, aborting";
+				return 1;
+			}
+			memcpy(buf, &size, sizeof(uint64_t));
+			is.read(reinterpret_cast<char*>(buf) + sizeof(uint64_t), size - sizeof(uint64_t));
+
+			// Wait for the reader to release a buffer, like the DTC waiting for a descriptor
+			while (ring.write_c2s(chn, buf, size) != 0) usleep(10);
+			++records;
+			bytes += size;
+		}
+	}
+
+	TLOG(TLVL_INFO) << "Wrote " << records << " DMA records (" << bytes << " bytes) to channel " << chn << " of DTC " << dtc;
+	return 0;
+}
@@ -0,0 +1,119 @@
+// Checks the NUMA node lookup, CPU pinning and node-local allocation of mu2eaffinity against a fake sysfs tree.
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "dtcInterfaceLib/DTC_Packets.h"
+#include "dtcInterfaceLib/mu2eaffinity.h"
+
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "affinityTest"
+
+namespace {
+unsigned failures = 0;
+
+void check(bool condition, std::string const& what)
+{
+	std::cout << (condition ? "ok:     " : "FAILED: ") << what << std::endl;
+	if (!condition) ++failures;
+}
+
+void makeDirs(std::string const& path)
+{
+	for (size_t pos = 1; pos != std::string::npos; pos = path.find('/', pos + 1)) mkdir(path.substr(0, pos).c_str(), 0755);
+	mkdir(path.c_str(), 0755);
+}
+
+void writeAttribute(std::string const& dir, std::string const& name, std::string const& value)
+{
+	makeDirs(dir);
+	std::ofstream(dir + "/" + name) << value << std::endl;
+}
+
+void addPCIFunction(std::string const& root, std::string const& address, std::string const& vendor, std::string const& device, int node)
+{
+	auto dir = root + "/bus/pci/devices/" + address;
+	writeAttribute(dir, "vendor", vendor);
+	writeAttribute(dir, "device", device);
+	writeAttribute(dir, "numa_node", std::to_string(node));
+}
+}  // namespace
+
+int main()
+{
+	char rootTemplate[] = "/tmp/mu2e_sysfs_XXXXXX";
+	std::string root = mkdtemp(rootTemplate);
+	setenv("DTCLIB_SYSFS_ROOT", root.c_str(), 1);
+	unsetenv("DTCLIB_NUMA_NODE");
+	unsetenv("DTCLIB_READER_CPUS");
+
+	// No sysfs information at all: everything falls back
+	check(mu2eaffinity::dtc_numa_node(0) == -1, "DTC node is unknown without sysfs");
+	check(mu2eaffinity::pin_reader_thread(0, "numa") == 0, "numa pinning is skipped when the node is unknown");
+
+	// Driver without the PCI link: DTCs are numbered in PCI address order, other devices are ignored
+	addPCIFunction(root, "0000:81:00.0", "0x10ee", "0x7042", 1);
+	addPCIFunction(root, "0000:03:00.0", "0x10ee", "0x7043", 0);
+	addPCIFunction(root, "0000:02:00.0", "0x8086", "0x7042", 0);
+	addPCIFunction(root, "0000:82:00.0", "0x10ee", "0x7042", -1);
+	check(mu2eaffinity::dtc_numa_node(0) == 0, "DTC 0 is the first mu2e PCI function, on node 0");
+	check(mu2eaffinity::dtc_numa_node(1) == 1, "DTC 1 is the second mu2e PCI function, on node 1");
+	check(mu2eaffinity::dtc_numa_node(2) == -1, "A numa_node of -1 means no node");
+	check(mu2eaffinity::dtc_numa_node(3) == -1, "DTC 3 does not exist");
+
+	// Driver linking mu2eX to its PCI function takes precedence
+	writeAttribute(root + "/class/mu2e_dev/mu2e0/device", "numa_node", "3");
+	check(mu2eaffinity::dtc_numa_node(0) == 3, "DTC 0 node is read from /sys/class/mu2e_dev/mu2e0/device");
+
+	// DTCLIB_NUMA_NODE
+	check(mu2eaffinity::buffer_numa_node(1) == 1, "Buffer node defaults to the DTC's node");
+	setenv("DTCLIB_NUMA_NODE", "none", 1);
+	check(mu2eaffinity::buffer_numa_node(1) == -1, "DTCLIB_NUMA_NODE=none disables placement");
+	setenv("DTCLIB_NUMA_NODE", "2", 1);
+	check(mu2eaffinity::buffer_numa_node(1) == 2, "DTCLIB_NUMA_NODE=2 forces node 2");
+	setenv("DTCLIB_NUMA_NODE", "auto", 1);
+	check(mu2eaffinity::buffer_numa_node(1) == 1, "DTCLIB_NUMA_NODE=auto uses the DTC's node");
+	unsetenv("DTCLIB_NUMA_NODE");
+
+	// CPU lists
+	cpu_set_t cpus;
+	check(mu2eaffinity::parse_cpulist("0-3,8,10-11", &cpus) == 7 && CPU_ISSET(2, &cpus) && CPU_ISSET(8, &cpus) && !CPU_ISSET(9, &cpus),
+		  "parse_cpulist(\"0-3,8,10-11\")");
+	check(mu2eaffinity::parse_cpulist("3-1", &cpus) == -1 && mu2eaffinity::parse_cpulist("a", &cpus) == -1, "Invalid CPU lists are refused");
+
+	// Pin to the CPUs of the DTC's (fake) node: use a CPU this process may run on
+	cpu_set_t allowed;
+	sched_getaffinity(0, sizeof(allowed), &allowed);
+	int cpu = 0;
+	while (!CPU_ISSET(cpu, &allowed)) ++cpu;
+	writeAttribute(root + "/devices/system/node/node1", "cpulist", std::to_string(cpu));
+	check(mu2eaffinity::node_cpulist(1) == std::to_string(cpu), "node_cpulist reads the node's cpulist");
+	setenv("DTCLIB_READER_CPUS", "numa", 1);
+	auto sts = mu2eaffinity::pin_reader_thread(1);
+	cpu_set_t pinned;
+	sched_getaffinity(0, sizeof(pinned), &pinned);
+	check(sts == 0 && CPU_COUNT(&pinned) == 1 && CPU_ISSET(cpu, &pinned), "DTCLIB_READER_CPUS=numa pins to the node's CPUs");
+	unsetenv("DTCLIB_READER_CPUS");
+	sched_setaffinity(0, sizeof(allowed), &allowed);
+
+	// Allocations fall back gracefully when the node does not exist on this machine
+	for (int node : {-1, 0, 1, 63})
+	{
+		DTCLib::DTC_Event event(0x10000, node);
+		auto data = static_cast<const uint8_t*>(event.GetRawBufferPointer());
+		bool zeroed = data != nullptr;
+		for (size_t ii = 0; zeroed && ii < 0x10000; ++ii) zeroed = data[ii] == 0;
+		check(zeroed, "DTC_Event buffer allocated for node " + std::to_string(node));
+	}
+
+	std::string cleanup = "rm -rf " + root;
+	if (system(cleanup.c_str()) != 0) std::cout << "Could not remove " << root << std::endl;
+
+	std::cout << (failures == 0 ? "Affinity test passed." : "Affinity test FAILED.") << std::endl;
+	return failures == 0 ? 0 : 1;
+}
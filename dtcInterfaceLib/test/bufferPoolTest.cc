@@ -0,0 +1,153 @@
+// Checks the size classes, recycling, sharing, cache limit and thread safety of DTC_BufferPool, and that DTC_Event
+// buffers come from the shared pool.
+
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dtcInterfaceLib/DTC_BufferPool.h"
+#include "dtcInterfaceLib/DTC_Packets.h"
+
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "bufferPoolTest"
+
+namespace {
+unsigned failures = 0;
+
+void check(bool condition, std::string const& what)
+{
+	std::cout << (condition ? "ok:     " : "FAILED: ") << what << std::endl;
+	if (!condition) ++failures;
+}
+}  // namespace
+
+int main()
+{
+	using DTCLib::DTC_BufferPool;
+
+	check(DTC_BufferPool::SizeClass(0) == 0 && DTC_BufferPool::SizeClass(256) == 0 && DTC_BufferPool::SizeClass(257) == 1 &&
+			  DTC_BufferPool::SizeClass(0x8000) == 7 && DTC_BufferPool::SizeClass(1 << 24) == 16 && DTC_BufferPool::SizeClass((1 << 24) + 1) == -1,
+		  "Size classes are powers of two from 256 bytes to 16 MB");
+
+	{
+		DTC_BufferPool pool(1 << 20);
+		uint8_t* first;
+		{
+			auto buffer = pool.Get(1000);
+			first = buffer.data();
+			check(buffer.size() == 1000 && (reinterpret_cast<uintptr_t>(first) & 0xF) == 0, "Buffer has the requested size, aligned");
+			memset(buffer.data(), 0xAB, buffer.size());
+		}
+		auto stats = pool.GetStats();
+		check(stats.misses == 1 && stats.hits == 0 && stats.cachedBytes == 1024, "Released buffer is cached in its size class");
+
+		auto again = pool.Get(900);
+		check(again.data() == first && pool.GetStats().hits == 1 && pool.GetStats().cachedBytes == 0, "Buffer of the same class is recycled");
+		check(pool.Get(2000).data() != first && pool.GetStats().misses == 2, "Buffer of another class is allocated");
+
+		auto copy = again;
+		again = DTCLib::DTC_PooledBuffer();
+		check(copy.data() == first && pool.GetStats().cachedBytes == 2048, "Copies keep the buffer until the last one is gone");
+		copy = DTCLib::DTC_PooledBuffer();
+		check(pool.GetStats().cachedBytes == 2048 + 1024, "Last copy gives the buffer back");
+
+		{
+			std::vector<DTCLib::DTC_PooledBuffer> big;
+			for (int ii = 0; ii < 3; ++ii) big.push_back(pool.Get(400 << 10));
+		}
+		stats = pool.GetStats();
+		check(stats.trimmed == 2 && stats.cachedBytes <= stats.maxCachedBytes, "Cache limit frees buffers beyond it");
+
+		{
+			auto huge = pool.Get((1 << 24) + 1);
+			check(huge.size() == (1 << 24) + 1 && pool.GetStats().unpooled == 1, "Buffers above 16 MB are not pooled");
+		}
+		stats = pool.GetStats();
+		check(stats.peakFootprint > (1 << 24) && stats.footprint < (1 << 24), "Peak footprint includes the freed unpooled buffer");
+
+		pool.Trim();
+		check(pool.GetStats().footprint == 0 && pool.GetStats().cachedBytes == 0, "Trim frees all cached buffers");
+	}
+
+	{
+		// Buffers taken in one thread and released in another, in random size classes
+		DTC_BufferPool pool(64 << 20);
+		const int threads = 4;
+		const int rounds = 20000;
+		std::vector<std::vector<DTCLib::DTC_PooledBuffer>> handoff(threads);
+		std::vector<std::thread> workers;
+		std::vector<int> corrupted(threads, 0);
+		for (int tt = 0; tt < threads; ++tt)
+		{
+			workers.emplace_back([&, tt] {
+				std::mt19937 rng(tt);
+				std::vector<DTCLib::DTC_PooledBuffer> held;
+				for (int ii = 0; ii < rounds; ++ii)
+				{
+					auto buffer = pool.Get(64 + rng() % 100000);
+					memset(buffer.data(), tt + 1, buffer.size());
+					held.push_back(buffer);
+					if (held.size() > 16)
+					{
+						for (auto& b : held)
+							if (b.data()[0] != tt + 1 || b.data()[b.size() - 1] != tt + 1) ++corrupted[tt];
+						held.clear();
+					}
+				}
+				handoff[(tt + 1) % threads] = held;
+			});
+		}
+		for (auto& worker : workers) worker.join();
+		handoff.clear();
+
+		auto stats = pool.GetStats();
+		int errors = 0;
+		for (auto count : corrupted) errors += count;
+		check(errors == 0, "Buffers are never handed to two users at once");
+		check(stats.hits + stats.misses == static_cast<uint64_t>(threads) * rounds && stats.hits > stats.misses,
+			  "Most buffers are recycled (" + std::to_string(stats.hits) + " hits, " + std::to_string(stats.misses) + " misses)");
+		check(stats.footprint == stats.cachedBytes + 64 * (stats.misses - stats.trimmed), "Every buffer is back in the pool");
+	}
+
+	{
+		// Threads giving back more than the cache holds at the same time
+		DTC_BufferPool pool(1 << 20);
+		const int threads = 4;
+		std::vector<std::thread> workers;
+		for (int tt = 0; tt < threads; ++tt)
+		{
+			workers.emplace_back([&] {
+				for (int ii = 0; ii < 2000; ++ii)
+				{
+					std::vector<DTCLib::DTC_PooledBuffer> held;
+					for (int jj = 0; jj < 20; ++jj) held.push_back(pool.Get(60 << 10));
+				}
+			});
+		}
+		for (auto& worker : workers) worker.join();
+
+		auto stats = pool.GetStats();
+		check(stats.cachedBytes <= stats.maxCachedBytes && stats.trimmed > 0, "Concurrent returns stay within the cache limit");
+	}
+
+	{
+		auto& pool = DTC_BufferPool::Instance();
+		{
+			DTCLib::DTC_Event evt(5000, -1, false);
+			memset(const_cast<void*>(evt.GetRawBufferPointer()), 0xFF, 5000);
+		}
+		auto before = pool.GetStats();
+		DTCLib::DTC_Event evt(5000);
+		auto data = static_cast<const uint8_t*>(evt.GetRawBufferPointer());
+		bool zeroed = true;
+		for (size_t ii = 0; ii < 5000; ++ii) zeroed = zeroed && data[ii] == 0;
+		check(pool.GetStats().hits == before.hits + 1, "DTC_Event buffers come from DTC_BufferPool::Instance()");
+		check(zeroed, "DTC_Event(size) clears a recycled buffer");
+	}
+
+	std::cout << (failures == 0 ? "Buffer pool test passed." : "Buffer pool test FAILED.") << std::endl;
+	return failures == 0 ? 0 : 1;
+}
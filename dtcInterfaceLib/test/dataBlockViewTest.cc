@@ -0,0 +1,190 @@
+// Decodes the Data Blocks of events through DTC_DataBlockView and checks every header field against
+// DTC_DataHeaderPacket, checks that malformed Data Header packets are rejected, and counts the heap allocations of
+// walking the Data Blocks of a decoded event through the views and through DTC_DataBlock::GetHeader.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <vector>
+
+#include "dtcInterfaceLib/DTC_Packets.h"
+#include "simEventWriter.h"
+
+namespace {
+size_t allocations = 0;
+}
+
+void* operator new(size_t size)
+{
+	++allocations;
+	auto ptr = malloc(size ? size : 1);
+	if (ptr == nullptr) throw std::bad_alloc();
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+void usage()
+{
+	std::cout << "This program compares DTC_DataBlockView with DTC_DataHeaderPacket decoding." << std::endl
+			  << "Options are:" << std::endl
+			  << "    -h: This message." << std::endl
+			  << "    -n: Number of event decodings in the allocation and timing loops (Default: 100000)." << std::endl;
+}
+
+namespace {
+// Tracker Sub-Events from up to four DTCs, with every header field varied
+std::vector<uint8_t> makeEvent(unsigned event)
+{
+	DTCLib::DTC_Event evt;
+	DTCLib::DTC_EventWindowTag tag((static_cast<uint64_t>(event) * 0x9E3779B97F4A7C15ULL) & 0xFFFFFFFFFFFFULL);
+	evt.SetEventWindowTag(tag);
+	for (unsigned sub = 0; sub < 1 + event % 4; ++sub)
+	{
+		DTCLib::DTC_SubEvent subEvt;
+		subEvt.SetEventWindowTag(tag);
+		subEvt.SetSourceDTC(sub, DTCLib::DTC_Subsystem_Tracker);
+		for (unsigned roc = 0; roc < 1 + (event + sub) % 6; ++roc)
+		{
+			uint16_t packets = (event * 13 + roc * 5) % 40;
+			DTCLib::DTC_DataBlock blk((packets + 1) * 16);
+			DTCLib::DTC_DataHeaderPacket hdr(static_cast<DTCLib::DTC_Link_ID>(roc), packets, static_cast<DTCLib::DTC_DataStatus>(roc % 3), sub,
+											 static_cast<DTCLib::DTC_Subsystem>((event + roc) % 8), static_cast<uint8_t>(event + roc), tag,
+											 static_cast<uint8_t>(event * 3));
+			memcpy(blk.allocBytes->data(), hdr.ConvertToDataPacket().GetData(), 16);
+			for (size_t ii = 16; ii < blk.byteSize; ++ii) (*blk.allocBytes)[ii] = static_cast<uint8_t>(event + ii);
+			subEvt.AddDataBlock(blk);
+		}
+		evt.AddSubEvent(subEvt);
+	}
+	return eventBytes(evt);
+}
+
+bool sameBlock(DTCLib::DTC_DataBlockView const& view, DTCLib::DTC_DataBlock const& blk)
+{
+	auto hdr = blk.GetHeader();
+	return view.GetPointer() == blk.blockPointer && view.byteSize == blk.byteSize && view.GetByteCount() == hdr->GetByteCount() &&
+		   view.GetPacketType() == hdr->GetPacketType() && view.GetLinkID() == hdr->GetLinkID() && view.GetSubsystem() == hdr->GetSubsystem() &&
+		   view.IsValid() && view.GetPacketCount() == hdr->GetPacketCount() && view.GetEventWindowTag() == hdr->GetEventWindowTag() &&
+		   view.GetStatus() == hdr->GetStatus() && view.GetVersion() == hdr->GetVersion() && view.GetID() == hdr->GetID() &&
+		   view.GetEVBMode() == hdr->GetEVBMode() && (view.byteSize == 16 || view.GetData() == blk.GetData());
+}
+
+// Walk every Data Block of a decoded event, reading its link and event window tag
+template<typename Walk>
+double measure(std::string const& name, unsigned count, std::vector<std::vector<uint8_t>> const& events, Walk walk)
+{
+	uint64_t sink = 0;
+	auto before = allocations;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned ii = 0; ii < count; ++ii)
+	{
+		DTCLib::DTC_Event evt(events[ii % events.size()].data());
+		evt.SetupEvent();
+		for (size_t sub = 0; sub < evt.GetSubEventCount(); ++sub) sink += walk(*evt.GetSubEvent(sub));
+	}
+	auto ns = std::chrono::duration_cast<std::chrono::duration<double, std::nano>>(std::chrono::steady_clock::now() - start).count();
+	auto perEvent = static_cast<double>(allocations - before) / count;
+	std::cout << name << ": " << perEvent << " allocations, " << ns / count << " ns per event (" << sink << ")" << std::endl;
+	return perEvent;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	unsigned count = 100000;
+	for (auto ii = 1; ii < argc; ++ii)
+	{
+		if (argv[ii][0] != '-' || argv[ii][1] != 'n' || ii + 1 >= argc)
+		{
+			usage();
+			exit(0);
+		}
+		count = strtoul(argv[++ii], nullptr, 0);
+	}
+
+	auto passed = true;
+	std::vector<std::vector<uint8_t>> events;
+	for (unsigned event = 0; event < 24; ++event) events.push_back(makeEvent(event));
+
+	// Every view decodes the same header fields as DTC_DataHeaderPacket, and the Data Blocks made from the views match
+	size_t blocks = 0;
+	unsigned errors = 0;
+	for (auto& bytes : events)
+	{
+		DTCLib::DTC_Event evt(bytes.data());
+		evt.SetupEvent();
+		for (size_t sub = 0; sub < evt.GetSubEventCount(); ++sub)
+		{
+			auto subEvt = evt.GetSubEvent(sub);
+			auto& views = subEvt->GetDataBlockViews();
+			if (views.size() != subEvt->GetHeader()->num_rocs || subEvt->GetDataBlockCount() != views.size()) ++errors;
+			auto& dataBlocks = subEvt->GetDataBlocks();
+			if (dataBlocks.size() != views.size()) ++errors;
+			for (size_t blk = 0; blk < views.size() && blk < dataBlocks.size(); ++blk)
+			{
+				++blocks;
+				if (!sameBlock(views[blk], dataBlocks[blk]) || !sameBlock(DTCLib::DTC_DataBlockView(views[blk].GetPointer()), dataBlocks[blk])) ++errors;
+			}
+		}
+	}
+	std::cout << blocks << " Data Blocks compared with DTC_DataHeaderPacket: " << errors << " mismatches" << std::endl;
+	if (errors != 0 || blocks == 0) passed = false;
+
+	// Malformed Data Header packets are rejected with the same exceptions as DTC_DataHeaderPacket
+	std::vector<uint8_t> block(events[1].begin() + sizeof(DTCLib::DTC_EventHeader) + sizeof(DTCLib::DTC_SubEventHeader), events[1].end());
+	auto wrongType = block;
+	wrongType[2] = DTCLib::DTC_PacketType_DCSReply << 4;
+	auto wrongSize = block;
+	wrongSize[4] += 1;
+	unsigned rejected = 0;
+	try
+	{
+		DTCLib::DTC_DataBlockView view(wrongType.data());
+	}
+	catch (DTCLib::DTC_WrongPacketTypeException const&)
+	{
+		++rejected;
+	}
+	try
+	{
+		DTCLib::DTC_DataBlockView view(wrongSize.data());
+	}
+	catch (DTCLib::DTC_WrongPacketSizeException const&)
+	{
+		++rejected;
+	}
+	std::cout << "Malformed Data Header packets rejected: " << rejected << " of 2" << std::endl;
+	if (rejected != 2) passed = false;
+
+	// A Sub-Event can be built from views of memory it does not own
+	DTCLib::DTC_SubEvent subEvt;
+	DTCLib::DTC_DataBlockView first(block.data());
+	subEvt.AddDataBlock(first);
+	subEvt.AddDataBlock(first);
+	if (subEvt.GetHeader()->inclusive_subevent_byte_count != sizeof(DTCLib::DTC_SubEventHeader) + 2 * first.byteSize ||
+		subEvt.GetDataBlocks().size() != 2 || subEvt.GetDataBlock(1)->blockPointer != block.data())
+	{
+		std::cout << "Sub-Event built from views is wrong" << std::endl;
+		passed = false;
+	}
+
+	// Decoding through the views allocates only the Sub-Event and view vectors, not a DataHeaderPacket per block
+	auto viewAllocations = measure("Data Block views", count, events, [](DTCLib::DTC_SubEvent const& sub) {
+		uint64_t sum = 0;
+		for (auto& blk : sub.GetDataBlockViews()) sum += blk.GetLinkID() + blk.GetEventWindowTag().GetEventWindowTag(true);
+		return sum;
+	});
+	auto headerAllocations = measure("DTC_DataBlock::GetHeader", count, events, [](DTCLib::DTC_SubEvent const& sub) {
+		uint64_t sum = 0;
+		for (auto& blk : sub.GetDataBlocks()) sum += blk.GetHeader()->GetLinkID() + blk.GetHeader()->GetEventWindowTag().GetEventWindowTag(true);
+		return sum;
+	});
+	if (viewAllocations >= headerAllocations) passed = false;
+
+	std::cout << (passed ? "Data Block view test passed." : "Data Block view test FAILED.") << std::endl;
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+// Writes event windows with some of their contributors missing to the mu2esim DTC emulator, and checks that
+// DTC::GetDataUntil returns complete windows without waiting, and incomplete ones at the deadline with the missing
+// DTC links reported.
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "dtcInterfaceLib/DTC.h"
+#include "simEventWriter.h"
+
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "deadlineTest"
+
+void usage()
+{
+	std::cout << "This program writes complete and incomplete event windows to the mu2esim DTC emulator, and reads them" << std::endl
+			  << "with DTC::GetDataUntil." << std::endl
+			  << "Options are:" << std::endl
+			  << "    -h: This message." << std::endl
+			  << "    -d: Deadline for the incomplete window, in milliseconds (Default: 50)." << std::endl;
+}
+
+namespace {
+// One Sub-Event from a DTC, with a Data Block from each of the given links
+std::vector<uint8_t> makeEvent(uint64_t tagValue, uint8_t dtc, std::vector<DTCLib::DTC_Link_ID> links)
+{
+	DTCLib::DTC_Event evt;
+	DTCLib::DTC_EventWindowTag tag(tagValue);
+	evt.SetEventWindowTag(tag);
+	DTCLib::DTC_SubEvent subEvt;
+	subEvt.SetEventWindowTag(tag);
+	subEvt.SetSourceDTC(dtc, DTCLib::DTC_Subsystem_Tracker);
+	for (auto link : links) addDataBlock(subEvt, link, 1, dtc, DTCLib::DTC_Subsystem_Tracker, tag);
+	evt.AddSubEvent(subEvt);
+	return eventBytes(evt);
+}
+
+double msSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(std::chrono::steady_clock::now() - start).count();
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	unsigned deadlineMs = 50;
+	for (auto ii = 1; ii < argc; ++ii)
+	{
+		if (argv[ii][0] != '-' || argv[ii][1] != 'd' || ii + 1 >= argc)
+		{
+			usage();
+			exit(0);
+		}
+		deadlineMs = strtoul(argv[++ii], nullptr, 0);
+	}
+
+	DTCLib::DTC dtc(DTCLib::DTC_SimMode_Performance, 0, 0x1, "", false, "mu2esim_deadline.bin");
+	auto device = dtc.GetDevice();
+	device->write_register(DTCLib::DTC_Register_DetEmulation_Control0, 0, 0);
+
+	// Window 1 has data from links 0 and 1 of DTC 0 and link 0 of DTC 1; window 2 only from DTC 0
+	if (writeEvent(device, makeEvent(1, 0, {DTCLib::DTC_Link_0, DTCLib::DTC_Link_1})) != 0 ||
+		writeEvent(device, makeEvent(1, 1, {DTCLib::DTC_Link_0})) != 0 ||
+		writeEvent(device, makeEvent(2, 0, {DTCLib::DTC_Link_0, DTCLib::DTC_Link_1})) != 0)
+	{
+		std::cout << "Failed to fill simulated DDR memory" << std::endl;
+		return 1;
+	}
+
+	DTCLib::DTC_Contributors expected;
+	expected.Add(0, (1 << DTCLib::DTC_Link_0) | (1 << DTCLib::DTC_Link_1));
+	expected.Add(1, 1 << DTCLib::DTC_Link_0);
+
+	// Complete: returns as soon as the last contributor is read
+	auto passed = true;
+	std::vector<std::unique_ptr<DTCLib::DTC_Event>> events;
+	DTCLib::DTC_Contributors missing;
+	auto start = std::chrono::steady_clock::now();
+	auto sts = dtc.GetDataUntil(events, DTCLib::DTC_EventWindowTag(static_cast<uint64_t>(1)), expected, start + std::chrono::seconds(1), missing);
+	auto elapsed = msSince(start);
+	std::cout << "Window 1: " << DTCLib::DTC_ReadStatusConverter(sts).toString() << " with " << events.size() << " events after "
+			  << elapsed << " ms, " << missing.Count() << " links missing" << std::endl;
+	if (sts != DTCLib::DTC_ReadStatus_OK || events.size() != 2 || !missing.Empty() || elapsed > 500) passed = false;
+
+	// Incomplete: returns at the deadline, with DTC 1 missing
+	start = std::chrono::steady_clock::now();
+	sts = dtc.GetDataUntil(events, DTCLib::DTC_EventWindowTag(static_cast<uint64_t>(2)), expected, start + std::chrono::milliseconds(deadlineMs), missing);
+	elapsed = msSince(start);
+	std::cout << "Window 2: " << DTCLib::DTC_ReadStatusConverter(sts).toString() << " with " << events.size() << " events after "
+			  << elapsed << " ms, " << missing.Count() << " links missing" << std::endl;
+	if (sts != DTCLib::DTC_ReadStatus_Incomplete || events.empty() || events[0]->GetEventWindowTag().GetEventWindowTag(true) != 2 ||
+		missing.Count() != 1 || !missing.Contains(1, DTCLib::DTC_Link_0) || elapsed < deadlineMs || elapsed > deadlineMs + 500 ||
+		dtc.GetReadStats(DTC_DMA_Engine_DAQ).incomplete != 1)
+	{
+		passed = false;
+	}
+
+	// The windows read on the way were stored; with nothing expected, the first event completes a window
+	sts = dtc.GetDataUntil(events, DTCLib::DTC_EventWindowTag(), DTCLib::DTC_Contributors(), std::chrono::steady_clock::now(), missing);
+	std::cout << "Next window: " << DTCLib::DTC_ReadStatusConverter(sts).toString() << " with " << events.size() << " events" << std::endl;
+	if (sts != DTCLib::DTC_ReadStatus_OK || events.empty() || dtc.GetLookaheadStats().hits == 0) passed = false;
+
+	// Without the lookahead store, another window ends the read at once
+	dtc.SetLookaheadLimits(0, std::chrono::seconds(1));
+	start = std::chrono::steady_clock::now();
+	sts = dtc.GetDataUntil(events, DTCLib::DTC_EventWindowTag(static_cast<uint64_t>(99)), expected, start + std::chrono::seconds(1), missing);
+	elapsed = msSince(start);
+	std::cout << "Window 99: " << DTCLib::DTC_ReadStatusConverter(sts).toString() << " after " << elapsed << " ms" << std::endl;
+	if (sts != DTCLib::DTC_ReadStatus_Timeout || !events.empty() || missing.Count() != expected.Count() || elapsed > 500) passed = false;
+
+	std::cout << (passed ? "Deadline test passed." : "Deadline test FAILED.") << std::endl;
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+// Reads events, some of them continued over several DMA buffers, from the mu2esim DTC emulator straight into
+// pseudo-Fragment memory with DTC::ReadNextDAQEventInto, and checks the bytes and the reported layout, with and without
+// a readout filter. Then compares the cost with reading a DTC_Event and copying it into the pseudo-Fragment.
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "dtcInterfaceLib/DTC.h"
+#include "simEventWriter.h"
+#include "fragmentTester.h"
+
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "directReadoutTest"
+
+void usage()
+{
+	std::cout << "This program writes events to the mu2esim DTC emulator and reads them into caller-supplied memory." << std::endl
+			  << "Options are:" << std::endl
+			  << "    -h: This message." << std::endl
+			  << "    -n: Number of events to read in the timing loops (Default: 20000)." << std::endl;
+}
+
+namespace {
+const unsigned eventCount = 17;  // Distinct events written to the emulator, which then loops over them
+const size_t chunk = 0x1000;     // DMA buffer payload size
+
+// Calorimeter Sub-Events from up to three DTCs; later events span several DMA buffers
+std::vector<uint8_t> makeEvent(unsigned event)
+{
+	DTCLib::DTC_Event evt;
+	DTCLib::DTC_EventWindowTag tag(static_cast<uint64_t>(event + 1));
+	evt.SetEventWindowTag(tag);
+	for (unsigned sub = 0; sub < 1 + event % 3; ++sub)
+	{
+		DTCLib::DTC_SubEvent subEvt;
+		subEvt.SetEventWindowTag(tag);
+		subEvt.SetSourceDTC(sub, DTCLib::DTC_Subsystem_Calorimeter);
+		for (unsigned roc = 0; roc < 2 + event % 4; ++roc)
+		{
+			uint16_t packets = 1 + (event * 37 + roc * 11) % 90;
+			addDataBlock(subEvt, static_cast<DTCLib::DTC_Link_ID>(roc % 6), packets, sub, DTCLib::DTC_Subsystem_Calorimeter, tag,
+						 [&](size_t ii) { return event * 31 + roc * 7 + ii; });
+		}
+		evt.AddSubEvent(subEvt);
+	}
+	return eventBytes(evt);
+}
+
+// Room for the event at the end of the pseudo-Fragment
+void* allocate(fragmentTester& frag, size_t byteCount)
+{
+	if (frag.fragSize() < frag.dataSize() + byteCount) frag.addSpace(frag.dataSize() + byteCount - frag.fragSize());
+	return frag.dataBegin() + frag.dataSize();
+}
+
+// Compare an event written into memory with the expected bytes, and its layout with a view of the expected event
+bool checkEvent(DTCLib::DTC_EventLayout const& layout, std::vector<uint8_t>& expected)
+{
+	if (layout.byteCount != expected.size() || memcmp(layout.data, expected.data(), expected.size()) != 0) return false;
+	if (layout.header.inclusive_event_byte_count != expected.size()) return false;
+	DTCLib::DTC_EventView view({{expected.data(), expected.size()}});
+	auto& subEvents = view.GetSubEvents();
+	if (layout.subEvents.size() != subEvents.size()) return false;
+	for (size_t sub = 0; sub < subEvents.size(); ++sub)
+	{
+		auto& got = layout.subEvents[sub];
+		if (got.offset != subEvents[sub].offset || got.blocks.size() != subEvents[sub].blocks.size()) return false;
+		for (size_t blk = 0; blk < got.blocks.size(); ++blk)
+		{
+			if (got.blocks[blk].offset != subEvents[sub].blocks[blk].offset || got.blocks[blk].byteSize != subEvents[sub].blocks[blk].byteSize) return false;
+		}
+	}
+	return true;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	unsigned count = 20000;
+	for (auto ii = 1; ii < argc; ++ii)
+	{
+		if (argv[ii][0] != '-' || argv[ii][1] != 'n' || ii + 1 >= argc)
+		{
+			usage();
+			exit(0);
+		}
+		count = strtoul(argv[++ii], nullptr, 0);
+	}
+
+	DTCLib::DTC dtc(DTCLib::DTC_SimMode_Performance, 0, 0x1, "", false, "mu2esim_direct.bin");
+	auto device = dtc.GetDevice();
+	device->write_register(DTCLib::DTC_Register_DetEmulation_Control0, 0, 0);
+	std::vector<std::vector<uint8_t>> events;
+	for (unsigned event = 0; event < eventCount; ++event)
+	{
+		events.push_back(makeEvent(event));
+		if (writeEvent(device, events.back(), chunk) != 0)
+		{
+			std::cout << "Failed to fill simulated DDR memory" << std::endl;
+			return 1;
+		}
+	}
+
+	// Every event appended to one pseudo-Fragment, as a downstream fragment generator would
+	auto passed = true;
+	fragmentTester frag(0);
+	DTCLib::DTC_EventLayout layout;
+	auto allocator = [&frag](DTCLib::DTC_EventHeader const&, size_t byteCount) { return allocate(frag, byteCount); };
+	unsigned errors = 0;
+	size_t continued = 0;
+	for (auto& expected : events)
+	{
+		auto sts = dtc.ReadNextDAQEventInto(allocator, layout, 100);
+		if (sts != DTCLib::DTC_ReadStatus_OK || layout.data != frag.dataBegin() + frag.dataSize() || !checkEvent(layout, expected))
+		{
+			TLOG(TLVL_ERROR) << "Wrong event for event window tag " << static_cast<unsigned>(expected[4]) << ": " << DTCLib::DTC_ReadStatusConverter(sts).toString();
+			++errors;
+			continue;
+		}
+		if (layout.dmaBufferCount > 1) ++continued;
+		frag.endSubEvt(layout.byteCount);
+	}
+	std::cout << events.size() << " events read into one pseudo-Fragment of " << frag.dataSize() << " bytes, " << continued
+			  << " of them continued, " << errors << " errors" << std::endl;
+	if (errors != 0 || continued == 0 || frag.hdr_block_count() != events.size()) passed = false;
+
+	// No memory: the event is read again by the next call
+	auto sts = dtc.ReadNextDAQEventInto([](DTCLib::DTC_EventHeader const&, size_t) { return nullptr; }, layout, 100);
+	fragmentTester retry(0);
+	auto sts2 = dtc.ReadNextDAQEventInto([&retry](DTCLib::DTC_EventHeader const&, size_t byteCount) { return allocate(retry, byteCount); }, layout, 100);
+	std::cout << "Without memory: " << DTCLib::DTC_ReadStatusConverter(sts).toString() << ", then " << DTCLib::DTC_ReadStatusConverter(sts2).toString() << std::endl;
+	if (sts != DTCLib::DTC_ReadStatus_NoMemory || sts2 != DTCLib::DTC_ReadStatus_OK || !checkEvent(layout, events[0]) ||
+		dtc.GetReadStats(DTC_DMA_Engine_DAQ).noMemory != 1)
+	{
+		passed = false;
+	}
+
+	// With a filter, only the selected part is written
+	DTCLib::DTC_ReadoutFilter filter;
+	filter.dtcMask = 1 << 1;
+	filter.linkMask = (1 << DTCLib::DTC_Link_0) | (1 << DTCLib::DTC_Link_2);
+	filter.dropEmptyEvents = true;
+	dtc.SetReadoutFilter(filter);
+	DTCLib::DTC_FilterStats stats;
+	errors = 0;
+	for (unsigned event = 1; event < eventCount; ++event)
+	{
+		if (event % 3 == 0) continue;  // Only DTC 0 contributes to these; they are dropped
+		sts = dtc.ReadNextDAQEventInto(allocator, layout, 100);
+		auto expected = DTCLib::DTC_EventView({{events[event].data(), events[event].size()}}).ToFilteredEvent(filter, stats);
+		std::vector<uint8_t> bytes(static_cast<const uint8_t*>(expected->GetRawBufferPointer()),
+								   static_cast<const uint8_t*>(expected->GetRawBufferPointer()) + expected->GetEventByteCount());
+		if (sts != DTCLib::DTC_ReadStatus_OK || !checkEvent(layout, bytes) || layout.header.num_dtcs != 1 ||
+			layout.subEvents[0].blocks.size() != layout.subEvents[0].header.num_rocs)
+		{
+			TLOG(TLVL_ERROR) << "Wrong filtered event for event window tag " << event + 1;
+			++errors;
+		}
+	}
+	std::cout << "DTC 1, links 0 and 2: " << errors << " errors, " << dtc.GetFilterStats().eventsDropped << " events dropped" << std::endl;
+	if (errors != 0 || dtc.GetFilterStats().eventsDropped != 5) passed = false;
+	dtc.SetReadoutFilter(DTCLib::DTC_ReadoutFilter());
+
+	// Reading a DTC_Event and copying it into fragment memory, against reading into the fragment memory
+	double seconds[2];
+	std::vector<uint8_t> fragment;
+	auto fragmentAllocator = [&fragment](DTCLib::DTC_EventHeader const&, size_t byteCount) {
+		if (fragment.size() < byteCount) fragment.resize(byteCount);
+		return fragment.data();
+	};
+	for (auto direct : {false, true})
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned ii = 0; ii < count; ++ii)
+		{
+			if (direct)
+			{
+				if (dtc.ReadNextDAQEventInto(fragmentAllocator, layout, 100) != DTCLib::DTC_ReadStatus_OK) passed = false;
+				continue;
+			}
+			dtc.ReleaseDAQBuffers();
+			auto event = dtc.ReadNextDAQDMA(100);
+			if (event == nullptr)
+			{
+				passed = false;
+				continue;
+			}
+			memcpy(fragmentAllocator(*event->GetHeader(), event->GetEventByteCount()), event->GetRawBufferPointer(), event->GetEventByteCount());
+		}
+		seconds[direct] = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - start).count();
+	}
+	std::cout << "Reading " << count << " events took " << seconds[0] << " s through DTC_Event, " << seconds[1] << " s direct" << std::endl;
+
+	std::cout << (passed ? "Direct readout test passed." : "Direct readout test FAILED.") << std::endl;
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,187 @@
+// Runs DAQ readout and DCS request/reply traffic on the same mu2edev from two threads, against mu2esim,
+// and checks that neither channel's data is lost, duplicated or reordered.
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "dtcInterfaceLib/DTC_Packets.h"
+#include "dtcInterfaceLib/DTC_Registers.h"
+#include "dtcInterfaceLib/mu2edev.h"
+
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "dmaStressTest"
+
+void usage()
+{
+	std::cout << "This program reads DAQ data and exchanges DCS packets on the same device from two threads," << std::endl
+			  << "using the mu2esim DTC emulator, and checks the data on both channels." << std::endl
+			  << "Options are:" << std::endl
+			  << "    -h: This message." << std::endl
+			  << "    -n: Number of DAQ buffers and DCS requests per thread (Default: 100000)." << std::endl
+			  << "    -r: Number of distinct DAQ records in the simulated DDR memory (Default: 37)." << std::endl
+			  << "    -f: Simulated DDR memory file (Default: mu2esim_stress.bin)." << std::endl;
+}
+
+namespace {
+const uint64_t daqMagic = 0x5354524553530000ULL;
+
+// Record layout in a DAQ buffer: 64-bit byte count, then the record index, then fill words
+size_t daqRecordSize(unsigned record) { return sizeof(uint64_t) * (2 + record % 13); }
+
+int fillDDR(mu2edev& device, unsigned records)
+{
+	mu2e_databuff_t buf;
+	for (unsigned record = 0; record < records; ++record)
+	{
+		uint64_t size = daqRecordSize(record);
+		uint64_t transferSize = size + sizeof(uint64_t);
+		memcpy(&buf[0], &transferSize, sizeof(uint64_t));
+		memcpy(&buf[8], &size, sizeof(uint64_t));
+		for (size_t word = 1; word < size / sizeof(uint64_t); ++word)
+		{
+			uint64_t value = daqMagic | record;
+			memcpy(&buf[8 + word * sizeof(uint64_t)], &value, sizeof(uint64_t));
+		}
+		if (device.write_data(DTC_DMA_Engine_DAQ, &buf, transferSize) != 0) return -1;
+	}
+	return 0;
+}
+
+void daqThread(mu2edev* device, unsigned count, unsigned records, std::atomic<unsigned>* errors)
+{
+	void* buffers[16];
+	int byteCounts[16];
+	unsigned expected = 0;
+	unsigned read = 0;
+	while (read < count)
+	{
+		auto n = device->read_data_batch(DTC_DMA_Engine_DAQ, buffers, byteCounts, 16, 10);
+		if (n <= 0)
+		{
+			TLOG(TLVL_ERROR) << "DAQ read returned " << n << " after " << read << " buffers";
+			++*errors;
+			return;
+		}
+		for (int ii = 0; ii < n; ++ii)
+		{
+			uint64_t size, value;
+			memcpy(&size, buffers[ii], sizeof(uint64_t));
+			memcpy(&value, reinterpret_cast<uint8_t*>(buffers[ii]) + sizeof(uint64_t), sizeof(uint64_t));
+			if (size != daqRecordSize(expected) || static_cast<uint64_t>(byteCounts[ii]) != size || value != (daqMagic | expected))
+			{
+				TLOG(TLVL_ERROR) << "DAQ buffer " << read << ": expected record " << expected << " of " << daqRecordSize(expected)
+								 << " bytes, got byte count " << byteCounts[ii] << ", size " << size << ", value 0x" << std::hex << value;
+				++*errors;
+			}
+			expected = (expected + 1) % records;
+			++read;
+		}
+		device->read_release(DTC_DMA_Engine_DAQ, n);
+	}
+}
+
+void dcsThread(mu2edev* device, unsigned count, std::atomic<unsigned>* errors)
+{
+	mu2e_databuff_t buf;
+	for (unsigned request = 0; request < count; ++request)
+	{
+		DTCLib::DTC_DCSRequestPacket req(DTCLib::DTC_Link_0, DTCLib::DTC_DCSOperationType_Read, false, false,
+										 static_cast<uint16_t>(request));
+		auto packet = req.ConvertToDataPacket();
+		uint64_t size = packet.GetSize() + sizeof(uint64_t);
+		memcpy(&buf[0], &size, sizeof(uint64_t));
+		memcpy(&buf[8], packet.GetData(), packet.GetSize());
+		if (device->write_data(DTC_DMA_Engine_DCS, &buf, size) != 0)
+		{
+			TLOG(TLVL_ERROR) << "DCS write failed for request " << request;
+			++*errors;
+			return;
+		}
+
+		void* reply;
+		auto bytes = device->read_data(DTC_DMA_Engine_DCS, &reply, 10);
+		if (bytes <= static_cast<int>(sizeof(uint64_t)))
+		{
+			TLOG(TLVL_ERROR) << "No DCS reply for request " << request << " (read_data returned " << bytes << ")";
+			++*errors;
+			return;
+		}
+		uint64_t replySize;
+		memcpy(&replySize, reply, sizeof(uint64_t));
+		DTCLib::DTC_DataPacket replyPacket(reinterpret_cast<uint8_t*>(reply) + sizeof(uint64_t));
+		DTCLib::DTC_DMAPacket replyHeader(replyPacket);
+		if (replySize + sizeof(uint64_t) != static_cast<uint64_t>(bytes) || replyHeader.GetPacketType() != DTCLib::DTC_PacketType_DCSReply)
+		{
+			TLOG(TLVL_ERROR) << "Bad DCS reply for request " << request << ": " << bytes << " bytes, packet size " << replySize;
+			++*errors;
+		}
+		device->read_release(DTC_DMA_Engine_DCS, 1);
+
+		// The reply ring holds exactly one reply per request
+		if (device->read_data(DTC_DMA_Engine_DCS, &reply, 0) > 0)
+		{
+			TLOG(TLVL_ERROR) << "Extra DCS reply after request " << request;
+			++*errors;
+			device->read_release(DTC_DMA_Engine_DCS, 1);
+		}
+	}
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	unsigned count = 100000;
+	unsigned records = 37;
+	std::string file = "mu2esim_stress.bin";
+	for (auto ii = 1; ii < argc; ++ii)
+	{
+		if (argv[ii][0] != '-' || argv[ii][1] == 'h' || ii + 1 >= argc)
+		{
+			usage();
+			exit(0);
+		}
+		switch (argv[ii][1])
+		{
+			case 'n':
+				count = strtoul(argv[++ii], nullptr, 0);
+				break;
+			case 'r':
+				records = strtoul(argv[++ii], nullptr, 0);
+				break;
+			case 'f':
+				file = argv[++ii];
+				break;
+			default:
+				usage();
+				exit(0);
+		}
+	}
+
+	mu2edev device;
+	device.init(DTCLib::DTC_SimMode_Performance, 0, file);
+	// Start from an empty simulated DDR memory
+	device.write_register(DTCLib::DTC_Register_DetEmulation_Control0, 0, 0);
+	if (fillDDR(device, records) != 0)
+	{
+		std::cout << "Failed to fill simulated DDR memory" << std::endl;
+		return 1;
+	}
+
+	std::atomic<unsigned> daqErrors(0), dcsErrors(0);
+	auto start = std::chrono::steady_clock::now();
+	std::thread daq(daqThread, &device, count, records, &daqErrors);
+	std::thread dcs(dcsThread, &device, count, &dcsErrors);
+	daq.join();
+	dcs.join();
+	auto seconds = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - start).count();
+
+	std::cout << "DAQ: " << count << " buffers, " << daqErrors << " errors" << std::endl
+			  << "DCS: " << count << " request/reply cycles, " << dcsErrors << " errors" << std::endl
+			  << "Took " << seconds << " s" << std::endl;
+	auto passed = daqErrors == 0 && dcsErrors == 0;
+	std::cout << (passed ? "DMA stress test passed." : "DMA stress test FAILED.") << std::endl;
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,259 @@
+// Reads events larger than one DMA buffer from the mu2esim DTC emulator with DTC::GetDataViews, DTC::GetData and
+// DTC::ReadEvents, and checks that they all see the data that was written, that data blocks split between buffers are
+// reassembled, and that the buffers of a view are not given back to the DTC while the view exists.
+
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "dtcInterfaceLib/DTC.h"
+#include "simEventWriter.h"
+
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "eventViewTest"
+
+void usage()
+{
+	std::cout << "This program writes events of various sizes to the mu2esim DTC emulator, in DMA buffers of a given size," << std::endl
+			  << "and reads them back with GetDataViews, GetData and ReadEvents." << std::endl
+			  << "Options are:" << std::endl
+			  << "    -h: This message." << std::endl
+			  << "    -n: Number of events to read (Default: 1000)." << std::endl
+			  << "    -c: DMA buffer payload size, in bytes (Default: 0x1000)." << std::endl
+			  << "    -k: Number of views to keep alive while reading (Default: 3)." << std::endl;
+}
+
+namespace {
+const unsigned eventCount = 17;  // Distinct events written to the emulator, which then loops over them
+
+uint8_t payloadByte(unsigned event, unsigned block, size_t index) { return static_cast<uint8_t>(event * 31 + block * 7 + index); }
+
+// Blocks per sub-event and packets per block grow with the event number, so later events span several buffers
+DTCLib::DTC_Event makeEvent(unsigned event)
+{
+	DTCLib::DTC_Event evt;
+	evt.SetEventWindowTag(DTCLib::DTC_EventWindowTag(static_cast<uint64_t>(event + 1)));
+	unsigned block = 0;
+	for (unsigned sub = 0; sub < 1 + event % 3; ++sub)
+	{
+		DTCLib::DTC_SubEvent subEvt;
+		subEvt.SetEventWindowTag(DTCLib::DTC_EventWindowTag(static_cast<uint64_t>(event + 1)));
+		subEvt.SetSourceDTC(sub, DTCLib::DTC_Subsystem_Calorimeter);
+		for (unsigned roc = 0; roc < 2 + event % 4; ++roc, ++block)
+		{
+			uint16_t packets = 1 + (event * 37 + block * 11) % 90;
+			addDataBlock(subEvt, static_cast<DTCLib::DTC_Link_ID>(roc % 6), packets, sub, DTCLib::DTC_Subsystem_Calorimeter,
+						 DTCLib::DTC_EventWindowTag(static_cast<uint64_t>(event + 1)), [&](size_t ii) { return payloadByte(event, block, ii); });
+		}
+		evt.AddSubEvent(subEvt);
+	}
+	evt.UpdateHeader();
+	return evt;
+}
+
+// Compare one event read back with what was written, returns the number of differences
+unsigned checkEvent(DTCLib::DTC_EventView const& view, DTCLib::DTC_Event& expected, std::vector<uint8_t>& scratch)
+{
+	unsigned errors = 0;
+	auto event = static_cast<unsigned>(expected.GetEventWindowTag().GetEventWindowTag(true) - 1);
+	if (view.GetEventByteCount() != expected.GetEventByteCount() || view.GetSubEventCount() != expected.GetSubEventCount())
+	{
+		TLOG(TLVL_ERROR) << "Event " << event << ": byte count " << view.GetEventByteCount() << " (expected " << expected.GetEventByteCount()
+						 << "), " << view.GetSubEventCount() << " sub events (expected " << expected.GetSubEventCount() << ")";
+		return 1;
+	}
+
+	unsigned block = 0;
+	for (size_t sub = 0; sub < view.GetSubEventCount(); ++sub)
+	{
+		auto& ref = view.GetSubEvents()[sub];
+		auto& blocks = expected.GetSubEvent(sub)->GetDataBlocks();
+		if (ref.blocks.size() != blocks.size() || ref.header.source_dtc_id != expected.GetSubEvent(sub)->GetHeader()->source_dtc_id)
+		{
+			TLOG(TLVL_ERROR) << "Event " << event << " sub event " << sub << ": " << ref.blocks.size() << " blocks (expected " << blocks.size() << ")";
+			++errors;
+			continue;
+		}
+		for (size_t ii = 0; ii < blocks.size(); ++ii, ++block)
+		{
+			auto blk = view.GetDataBlock(ref.blocks[ii]);
+			scratch.resize(blk.byteSize);
+			view.CopyBytes(ref.blocks[ii].offset, scratch.data(), blk.byteSize);
+			if (blk.byteSize != blocks[ii].byteSize || memcmp(blk.blockPointer, blocks[ii].blockPointer, blk.byteSize) != 0 ||
+				memcmp(scratch.data(), blocks[ii].blockPointer, blk.byteSize) != 0 ||
+				view.GetDataBlockHeader(ref.blocks[ii]).GetPacketCount() != blk.byteSize / 16 - 1)
+			{
+				TLOG(TLVL_ERROR) << "Event " << event << " block " << block << " differs";
+				++errors;
+			}
+		}
+	}
+	return errors;
+}
+
+unsigned checkEvent(DTCLib::DTC_Event& evt, DTCLib::DTC_Event& expected)
+{
+	unsigned errors = 0;
+	if (evt.GetEventByteCount() != expected.GetEventByteCount() || evt.GetSubEventCount() != expected.GetSubEventCount()) return 1;
+	for (size_t sub = 0; sub < evt.GetSubEventCount(); ++sub)
+	{
+		auto& blocks = evt.GetSubEvent(sub)->GetDataBlocks();
+		auto& expectedBlocks = expected.GetSubEvent(sub)->GetDataBlocks();
+		if (blocks.size() != expectedBlocks.size()) return errors + 1;
+		for (size_t ii = 0; ii < blocks.size(); ++ii)
+		{
+			if (blocks[ii].byteSize != expectedBlocks[ii].byteSize || memcmp(blocks[ii].blockPointer, expectedBlocks[ii].blockPointer, blocks[ii].byteSize) != 0) ++errors;
+		}
+	}
+	return errors;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	unsigned count = 1000;
+	size_t chunk = 0x1000;
+	size_t keep = 3;
+	for (auto ii = 1; ii < argc; ++ii)
+	{
+		if (argv[ii][0] != '-' || argv[ii][1] == 'h' || ii + 1 >= argc)
+		{
+			usage();
+			exit(0);
+		}
+		switch (argv[ii][1])
+		{
+			case 'n':
+				count = strtoul(argv[++ii], nullptr, 0);
+				break;
+			case 'c':
+				chunk = strtoul(argv[++ii], nullptr, 0);
+				break;
+			case 'k':
+				keep = strtoul(argv[++ii], nullptr, 0);
+				break;
+			default:
+				usage();
+				exit(0);
+		}
+	}
+	if (chunk < 64 || chunk > 0x8000)
+	{
+		usage();
+		exit(0);
+	}
+
+	DTCLib::DTC dtc(DTCLib::DTC_SimMode_Performance, 0, 0x1, "", false, "mu2esim_eventview.bin");
+	auto device = dtc.GetDevice();
+	device->write_register(DTCLib::DTC_Register_DetEmulation_Control0, 0, 0);
+	std::vector<DTCLib::DTC_Event> events;
+	size_t spanning = 0;
+	for (unsigned event = 0; event < eventCount; ++event)
+	{
+		events.push_back(makeEvent(event));
+		if (events.back().GetEventByteCount() > chunk) ++spanning;
+		if (writeEvent(device, eventBytes(events.back()), chunk) != 0)
+		{
+			std::cout << "Failed to fill simulated DDR memory" << std::endl;
+			return 1;
+		}
+	}
+	std::cout << spanning << " of " << eventCount << " events span more than one " << chunk << " byte buffer" << std::endl;
+
+	unsigned errors = 0, multiSegment = 0, splitBlocks = 0, timeouts = 0;
+	std::vector<uint8_t> scratch;
+
+	// Views, some of them kept alive while later events are read: they must not be overwritten
+	std::deque<std::pair<std::unique_ptr<DTCLib::DTC_EventView>, unsigned>> kept;
+	unsigned next = 0;
+	for (unsigned ii = 0; ii < count && timeouts < 10;)
+	{
+		auto views = dtc.GetDataViews();
+		if (views.empty())
+		{
+			++timeouts;
+			continue;
+		}
+		for (auto& view : views)
+		{
+			auto event = static_cast<unsigned>(view->GetEventWindowTag().GetEventWindowTag(true) - 1);
+			if (event != next % eventCount)
+			{
+				TLOG(TLVL_ERROR) << "Read event " << event << ", expected " << next % eventCount;
+				++errors;
+				next = event;
+			}
+			++next;
+			++ii;
+			errors += checkEvent(*view, events[event % eventCount], scratch);
+			if (!view->IsContiguous()) ++multiSegment;
+			for (auto& sub : view->GetSubEvents())
+				for (auto& blk : sub.blocks)
+					if (view->GetSegments(blk.offset, blk.byteSize).size() > 1) ++splitBlocks;
+
+			auto copy = view->ToEvent();
+			errors += checkEvent(*copy, events[event % eventCount]);
+
+			kept.emplace_back(std::move(view), event);
+			while (kept.size() > keep)
+			{
+				errors += checkEvent(*kept.front().first, events[kept.front().second], scratch);
+				kept.pop_front();
+			}
+		}
+	}
+	kept.clear();
+	auto stats = dtc.GetReleaseStats(DTC_DMA_Engine_DAQ);
+	std::cout << "GetDataViews: " << next << " events, " << multiSegment << " in several buffers, " << splitBlocks
+			  << " data blocks split between buffers, max " << stats.maxHeld << " buffers held" << std::endl;
+
+	// GetData copies events spanning several buffers, and must see the same data
+	unsigned copies = 0;
+	for (unsigned ii = 0; ii < eventCount * 2 && timeouts < 10; ++ii)
+	{
+		auto data = dtc.GetData();
+		if (data.empty())
+		{
+			++timeouts;
+			continue;
+		}
+		for (auto& evt : data)
+		{
+			auto event = static_cast<unsigned>(evt->GetEventWindowTag().GetEventWindowTag(true) - 1);
+			errors += checkEvent(*evt, events[event % eventCount]);
+			++copies;
+		}
+	}
+	std::cout << "GetData: " << copies << " events" << std::endl;
+
+	// ReadEvents passes the events, in order, through one reused view
+	unsigned streamed = 0;
+	bool first = true;
+	while (streamed < count && timeouts < 10)
+	{
+		auto n = dtc.ReadEvents(
+			[&](DTCLib::DTC_EventView const& view) {
+				auto event = static_cast<unsigned>(view.GetEventWindowTag().GetEventWindowTag(true) - 1);
+				if (!first && event != next % eventCount)
+				{
+					TLOG(TLVL_ERROR) << "ReadEvents: Read event " << event << ", expected " << next % eventCount;
+					++errors;
+				}
+				first = false;
+				next = event + 1;
+				errors += checkEvent(view, events[event % eventCount], scratch);
+				return true;
+			},
+			16, 100);
+		if (n == 0) ++timeouts;
+		streamed += n;
+	}
+	std::cout << "ReadEvents: " << streamed << " events" << std::endl;
+
+	auto passed = errors == 0 && timeouts < 10 && streamed >= count && (spanning == 0 || (multiSegment > 0 && splitBlocks > 0));
+	std::cout << errors << " errors, " << timeouts << " timeouts" << std::endl;
+	std::cout << (passed ? "Event view test passed." : "Event view test FAILED.") << std::endl;
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+// Writes events with Sub-Events from several subsystems, DTCs and links to the mu2esim DTC emulator, reads them with
+// a readout filter, and checks that exactly the selected Sub-Events and Data Blocks are returned, with consistent
+// headers and counters. Then compares the cost of reading with and without the filter.
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "dtcInterfaceLib/DTC.h"
+#include "simEventWriter.h"
+
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "filterTest"
+
+void usage()
+{
+	std::cout << "This program writes events to the mu2esim DTC emulator and reads them back through a readout filter." << std::endl
+			  << "Options are:" << std::endl
+			  << "    -h: This message." << std::endl
+			  << "    -n: Number of events to read in the timing loops (Default: 20000)." << std::endl;
+}
+
+namespace {
+// Tracker and calorimeter Sub-Events from six DTCs with up to six links each; every fourth event also has a CRV one
+std::vector<uint8_t> makeEvent(unsigned event)
+{
+	DTCLib::DTC_Event evt;
+	DTCLib::DTC_EventWindowTag tag(static_cast<uint64_t>(event + 1));
+	evt.SetEventWindowTag(tag);
+	for (unsigned sub = 0; sub < (event % 4 == 0 ? 7u : 6u); ++sub)
+	{
+		auto subsystem = sub == 6 ? DTCLib::DTC_Subsystem_CRV : sub % 2 == 0 ? DTCLib::DTC_Subsystem_Tracker : DTCLib::DTC_Subsystem_Calorimeter;
+		DTCLib::DTC_SubEvent subEvt;
+		subEvt.SetEventWindowTag(tag);
+		subEvt.SetSourceDTC(sub, subsystem);
+		for (unsigned roc = 0; roc < 1 + (event + sub) % 6; ++roc)
+		{
+			uint16_t packets = 1 + (event * 7 + roc) % 10;
+			addDataBlock(subEvt, static_cast<DTCLib::DTC_Link_ID>(roc), packets, sub, subsystem, tag, [&](size_t ii) { return event + sub + roc + ii; });
+		}
+		evt.AddSubEvent(subEvt);
+	}
+	return eventBytes(evt);
+}
+
+// Compare a filtered event with the original, filtered here from the fully parsed event
+bool checkFiltered(DTCLib::DTC_Event& filtered, std::vector<uint8_t>& original, DTCLib::DTC_ReadoutFilter const& filter)
+{
+	DTCLib::DTC_Event full(original.data());
+	full.SetupEvent();
+	if (filtered.GetEventWindowTag() != full.GetEventWindowTag()) return false;
+
+	size_t kept = 0;
+	size_t byteCount = sizeof(DTCLib::DTC_EventHeader);
+	for (auto& subEvt : full.GetSubEvents())
+	{
+		if (!filter.AcceptSubEvent(*const_cast<DTCLib::DTC_SubEvent&>(subEvt).GetHeader())) continue;
+		auto out = filtered.GetSubEvent(kept++);
+		if (out == nullptr || out->GetDTCID() != subEvt.GetDTCID()) return false;
+		size_t block = 0;
+		size_t subEventByteCount = sizeof(DTCLib::DTC_SubEventHeader);
+		for (auto& blk : subEvt.GetDataBlocks())
+		{
+			if (!filter.AcceptLink(blk.GetHeader()->GetLinkID())) continue;
+			if (block >= out->GetDataBlockCount()) return false;
+			auto outBlk = out->GetDataBlock(block++);
+			if (outBlk->byteSize != blk.byteSize || memcmp(outBlk->blockPointer, blk.blockPointer, blk.byteSize) != 0) return false;
+			subEventByteCount += blk.byteSize;
+		}
+		if (block != out->GetDataBlockCount() || out->GetHeader()->num_rocs != block || out->GetSubEventByteCount() != subEventByteCount) return false;
+		byteCount += subEventByteCount;
+	}
+	return kept == filtered.GetSubEventCount() && filtered.GetHeader()->num_dtcs == kept && filtered.GetEventByteCount() == byteCount;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	unsigned count = 20000;
+	for (auto ii = 1; ii < argc; ++ii)
+	{
+		if (argv[ii][0] != '-' || argv[ii][1] != 'n' || ii + 1 >= argc)
+		{
+			usage();
+			exit(0);
+		}
+		count = strtoul(argv[++ii], nullptr, 0);
+	}
+
+	DTCLib::DTC dtc(DTCLib::DTC_SimMode_Performance, 0, 0x1, "", false, "mu2esim_filter.bin");
+	auto device = dtc.GetDevice();
+	device->write_register(DTCLib::DTC_Register_DetEmulation_Control0, 0, 0);
+	dtc.SetLookaheadLimits(0, std::chrono::seconds(1));
+
+	std::vector<std::vector<uint8_t>> events;
+	size_t totalBytes = 0;
+	for (unsigned event = 0; event < 16; ++event)
+	{
+		events.push_back(makeEvent(event));
+		totalBytes += events.back().size();
+		if (writeEvent(device, events.back()) != 0)
+		{
+			std::cout << "Failed to fill simulated DDR memory" << std::endl;
+			return 1;
+		}
+	}
+
+	// Calorimeter Sub-Events, Data Blocks from links 0 and 1
+	auto passed = true;
+	DTCLib::DTC_ReadoutFilter filter;
+	filter.subsystemMask = 1 << DTCLib::DTC_Subsystem_Calorimeter;
+	filter.linkMask = (1 << DTCLib::DTC_Link_0) | (1 << DTCLib::DTC_Link_1);
+	dtc.SetReadoutFilter(filter);
+	unsigned errors = 0;
+	for (auto& original : events)
+	{
+		dtc.ReleaseDAQBuffers();
+		auto event = dtc.ReadNextDAQDMA(100);
+		if (event == nullptr || !checkFiltered(*event, original, filter))
+		{
+			TLOG(TLVL_ERROR) << "Wrong filtered event for event window tag " << original[4];
+			++errors;
+		}
+	}
+	auto stats = dtc.GetFilterStats();
+	std::cout << "Calorimeter, links 0-1: " << errors << " errors, " << stats.subEventsAccepted << " Sub-Events and " << stats.blocksAccepted
+			  << " Data Blocks kept, " << stats.subEventsRejected << " and " << stats.blocksRejected << " skipped, " << stats.bytesAccepted
+			  << " of " << stats.bytesAccepted + stats.bytesRejected << " bytes copied" << std::endl;
+	if (errors != 0 || stats.events != events.size() || stats.subEventsAccepted != 3 * events.size() ||
+		stats.subEventsRejected != 3 * events.size() + events.size() / 4 || stats.bytesAccepted + stats.bytesRejected != totalBytes)
+	{
+		passed = false;
+	}
+
+	// CRV only, skipping the events without it
+	filter = DTCLib::DTC_ReadoutFilter();
+	filter.subsystemMask = 1 << DTCLib::DTC_Subsystem_CRV;
+	filter.dropEmptyEvents = true;
+	dtc.SetReadoutFilter(filter);
+	dtc.ResetFilterStats();
+	for (int ii = 0; ii < 4; ++ii)
+	{
+		dtc.ReleaseDAQBuffers();
+		auto event = dtc.ReadNextDAQDMA(100);
+		if (event == nullptr || event->GetEventWindowTag().GetEventWindowTag(true) % 4 != 1 || event->GetSubEventCount() != 1 ||
+			event->GetSubEvent(0)->GetSubsystem() != DTCLib::DTC_Subsystem_CRV)
+		{
+			std::cout << "Expected an event with only its CRV Sub-Event" << std::endl;
+			passed = false;
+		}
+	}
+	stats = dtc.GetFilterStats();
+	std::cout << "CRV: " << stats.events << " events filtered, " << stats.eventsDropped << " dropped" << std::endl;
+	// The four events with CRV data are 1, 5, 9 and 13, with three events dropped before each but the first
+	if (stats.eventsDropped != 9 || stats.events != 13) passed = false;
+
+	// Reading everything and keeping the calorimeter data, against filtering in the readout. Each GetData call also
+	// reads the following event to check its tag.
+	double seconds[2];
+	filter = DTCLib::DTC_ReadoutFilter();
+	filter.subsystemMask = 1 << DTCLib::DTC_Subsystem_Calorimeter;
+	for (auto filtered : {false, true})
+	{
+		dtc.SetReadoutFilter(filtered ? filter : DTCLib::DTC_ReadoutFilter());
+		size_t kept = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned ii = 0; ii < count; ++ii)
+		{
+			auto data = dtc.GetData();
+			if (data.empty()) break;
+			for (auto& evt : data) kept += evt->GetSubEventCount(DTCLib::DTC_Subsystem_Calorimeter);
+		}
+		seconds[filtered] = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - start).count();
+		if (kept < 3 * count) passed = false;
+	}
+	std::cout << "Reading " << count << " events took " << seconds[0] << " s unfiltered, " << seconds[1] << " s filtered" << std::endl;
+
+	std::cout << (passed ? "Filter test passed." : "Filter test FAILED.") << std::endl;
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,135 @@
+// Checks the mu2ehistogram bucket boundaries, and that the mu2edev latency histograms count every read and write
+// made through the mu2esim DTC emulator, in the right operation and channel, and reject out-of-range ones.
+
+#include <unistd.h>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "dtcInterfaceLib/mu2edev.h"
+
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "latencyHistogramTest"
+
+void usage()
+{
+	std::cout << "This program makes a known number of reads and writes through the mu2esim DTC emulator, and checks" << std::endl
+			  << "the mu2edev latency histograms against them." << std::endl
+			  << "Options are:" << std::endl
+			  << "    -h: This message." << std::endl
+			  << "    -n: Number of calls of each operation (Default: 100)." << std::endl;
+}
+
+namespace {
+uint64_t bucketSum(mu2ehistogram_snapshot const& snap)
+{
+	uint64_t sum = 0;
+	for (auto bucket : snap.buckets) sum += bucket;
+	return sum;
+}
+
+// Returns the number of errors
+unsigned check(std::string const& name, mu2ehistogram_snapshot const& snap, uint64_t count)
+{
+	if (snap.count == count && bucketSum(snap) == count && (count == 0 || snap.max_ns >= snap.mean())) return 0;
+	TLOG(TLVL_ERROR) << name << ": expected " << count << " samples, got " << snap.count << " (" << bucketSum(snap)
+					 << " in the buckets, max " << snap.max_ns << " ns, mean " << snap.mean() << " ns)";
+	return 1;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	unsigned count = 100;
+	for (auto ii = 1; ii < argc; ++ii)
+	{
+		if (argv[ii][0] != '-' || argv[ii][1] != 'n' || ii + 1 >= argc)
+		{
+			usage();
+			exit(0);
+		}
+		count = strtoul(argv[++ii], nullptr, 0);
+	}
+
+	unsigned errors = 0;
+
+	// Bucket 0 holds 0 ns, bucket i holds [2^(i-1), 2^i) ns
+	mu2ehistogram histogram;
+	for (uint64_t ns : {0ULL, 1ULL, 2ULL, 3ULL, 4ULL, 1023ULL, 1024ULL, 1000000ULL}) histogram.record(ns);
+	auto snap = histogram.snapshot();
+	uint64_t expected[MU2EHISTOGRAM_BUCKETS] = {};
+	expected[0] = 1;
+	expected[1] = 1;
+	expected[2] = 2;
+	expected[3] = 1;
+	expected[10] = 1;
+	expected[11] = 1;
+	expected[20] = 1;
+	for (unsigned bucket = 0; bucket < MU2EHISTOGRAM_BUCKETS; ++bucket)
+	{
+		if (snap.buckets[bucket] != expected[bucket])
+		{
+			TLOG(TLVL_ERROR) << "Bucket " << bucket << ": expected " << expected[bucket] << ", got " << snap.buckets[bucket];
+			++errors;
+		}
+	}
+	if (snap.count != 8 || snap.sum_ns != 1002057 || snap.max_ns != 1000000 || snap.percentile(0.5) != 7 || snap.percentile(1.0) != 1000000)
+	{
+		TLOG(TLVL_ERROR) << "Histogram summary: count " << snap.count << ", sum " << snap.sum_ns << " ns, max " << snap.max_ns << " ns, p50 "
+						 << snap.percentile(0.5) << " ns";
+		++errors;
+	}
+	histogram.reset();
+	errors += check("Reset histogram", histogram.snapshot(), 0);
+
+	auto simFile = "mu2esim_latency_" + std::to_string(getpid()) + ".bin";
+	{
+		mu2edev device;
+		device.init(DTCLib::DTC_SimMode_Performance, 0, simFile);
+		device.ResetLatencyHistograms();
+
+		// Register reads and writes go to channel 0, data reads and writes to the channel they use
+		uint32_t value;
+		for (unsigned ii = 0; ii < count; ++ii) device.read_register(0x9004, 0, &value);
+		for (unsigned ii = 0; ii < 2 * count; ++ii) device.write_register(0x9100, 0, 0);
+
+		mu2e_databuff_t buf;
+		uint64_t transferSize = 32;
+		for (unsigned ii = 0; ii < count; ++ii)
+		{
+			uint64_t header[2] = {transferSize, transferSize - sizeof(uint64_t)};
+			memcpy(&buf[0], header, sizeof(header));
+			device.write_data(DTC_DMA_Engine_DCS, &buf, transferSize);
+		}
+		for (unsigned ii = 0; ii < count; ++ii)
+		{
+			auto reservation = device.write_acquire(DTC_DMA_Engine_DCS, 10);
+			if (reservation.data() != nullptr) memcpy(reservation.data(), &buf[0], transferSize);
+			reservation.commit(transferSize);
+		}
+		void* buffer;
+		for (unsigned ii = 0; ii < 3 * count; ++ii) device.read_data(DTC_DMA_Engine_DAQ, &buffer, 0);
+		device.release_all(DTC_DMA_Engine_DAQ);
+
+		errors += check("read_register", device.GetLatencyHistogram(MU2E_OP_READ_REGISTER, 0), count);
+		errors += check("write_register", device.GetLatencyHistogram(MU2E_OP_WRITE_REGISTER, 0), 2 * count);
+		errors += check("write_data (DCS)", device.GetLatencyHistogram(MU2E_OP_WRITE_DATA, DTC_DMA_Engine_DCS), 2 * count);
+		errors += check("write_data (DAQ)", device.GetLatencyHistogram(MU2E_OP_WRITE_DATA, DTC_DMA_Engine_DAQ), 0);
+		errors += check("read_data (DAQ)", device.GetLatencyHistogram(MU2E_OP_READ_DATA, DTC_DMA_Engine_DAQ), 3 * count);
+		errors += check("read_release (DAQ)", device.GetLatencyHistogram(MU2E_OP_READ_RELEASE, DTC_DMA_Engine_DAQ), 1);
+		errors += check("read_data (DCS)", device.GetLatencyHistogram(MU2E_OP_READ_DATA, DTC_DMA_Engine_DCS), 0);
+
+		// Out-of-range operations and channels give an empty histogram instead of reading past the table
+		errors += check("Operation MU2E_OP_COUNT", device.GetLatencyHistogram(MU2E_OP_COUNT, 0), 0);
+		errors += check("Operation -1", device.GetLatencyHistogram(static_cast<mu2e_dev_operation>(-1), 0), 0);
+		errors += check("Channel MU2E_MAX_CHANNELS", device.GetLatencyHistogram(MU2E_OP_READ_REGISTER, MU2E_MAX_CHANNELS), 0);
+		errors += check("Channel -1", device.GetLatencyHistogram(MU2E_OP_READ_REGISTER, -1), 0);
+
+		device.ResetLatencyHistograms();
+		errors += check("read_register after reset", device.GetLatencyHistogram(MU2E_OP_READ_REGISTER, 0), 0);
+	}
+	unlink(simFile.c_str());
+
+	std::cout << (errors == 0 ? "Latency histogram test passed." : "Latency histogram test FAILED.") << std::endl;
+	return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+// Sets up events in eager and lazy mode, and checks that both give the same Sub-Events and Data Blocks, that lazy
+// events only decode what is used, and how much setting up an event costs in each mode.
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "dtcInterfaceLib/DTC_Packets.h"
+#include "simEventWriter.h"
+
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "lazyEventTest"
+
+void usage()
+{
+	std::cout << "This program sets up events in eager and lazy mode, compares them, and times both modes." << std::endl
+			  << "Options are:" << std::endl
+			  << "    -h: This message." << std::endl
+			  << "    -n: Number of events to set up in the timing loops (Default: 20000)." << std::endl;
+}
+
+namespace {
+// Sub-Events from several DTCs and subsystems, each with a few Data Blocks
+std::vector<uint8_t> makeEvent(unsigned event)
+{
+	DTCLib::DTC_Event evt;
+	DTCLib::DTC_EventWindowTag tag(static_cast<uint64_t>(event + 1));
+	evt.SetEventWindowTag(tag);
+	for (unsigned sub = 0; sub < 6; ++sub)
+	{
+		auto subsystem = sub % 2 == 0 ? DTCLib::DTC_Subsystem_Tracker : DTCLib::DTC_Subsystem_Calorimeter;
+		DTCLib::DTC_SubEvent subEvt;
+		subEvt.SetEventWindowTag(tag);
+		subEvt.SetSourceDTC(sub, subsystem);
+		for (unsigned roc = 0; roc < 1 + (event + sub) % 6; ++roc)
+		{
+			uint16_t packets = 1 + (event * 7 + roc) % 10;
+			addDataBlock(subEvt, static_cast<DTCLib::DTC_Link_ID>(roc), packets, sub, subsystem, tag, [&](size_t ii) { return event + sub + roc + ii; });
+		}
+		evt.AddSubEvent(subEvt);
+	}
+	return eventBytes(evt);
+}
+
+bool sameSubEvent(DTCLib::DTC_SubEvent* a, DTCLib::DTC_SubEvent* b)
+{
+	if (a == nullptr || b == nullptr) return a == b;
+	if (memcmp(a->GetHeader(), b->GetHeader(), sizeof(DTCLib::DTC_SubEventHeader)) != 0) return false;
+	if (a->GetDataBlockCount() != b->GetDataBlockCount()) return false;
+	for (size_t ii = 0; ii < a->GetDataBlockCount(); ++ii)
+	{
+		if (a->GetDataBlock(ii)->byteSize != b->GetDataBlock(ii)->byteSize ||
+			memcmp(a->GetDataBlock(ii)->blockPointer, b->GetDataBlock(ii)->blockPointer, a->GetDataBlock(ii)->byteSize) != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	unsigned count = 20000;
+	for (auto ii = 1; ii < argc; ++ii)
+	{
+		if (argv[ii][0] != '-' || argv[ii][1] != 'n' || ii + 1 >= argc)
+		{
+			usage();
+			exit(0);
+		}
+		count = strtoul(argv[++ii], nullptr, 0);
+	}
+
+	auto passed = true;
+	std::vector<std::vector<uint8_t>> events;
+	for (unsigned event = 0; event < 16; ++event) events.push_back(makeEvent(event));
+
+	for (auto& bytes : events)
+	{
+		DTCLib::DTC_Event eager(bytes.data());
+		eager.SetupEvent();
+		DTCLib::DTC_Event lazy(bytes.data());
+		lazy.SetupEvent(true);
+
+		// The header is there, nothing else has been looked at
+		auto ok = lazy.IsLazy() && !eager.IsLazy() && lazy.GetEventWindowTag() == eager.GetEventWindowTag() &&
+				  lazy.GetEventByteCount() == eager.GetEventByteCount();
+		// Counting and finding Sub-Events only reads their headers
+		ok = ok && lazy.GetSubEventCount() == eager.GetSubEventCount() && lazy.IsLazy();
+		ok = ok && lazy.GetSubEventCount(DTCLib::DTC_Subsystem_Calorimeter) == eager.GetSubEventCount(DTCLib::DTC_Subsystem_Calorimeter);
+		ok = ok && sameSubEvent(lazy.GetSubEventByDTCID(3, DTCLib::DTC_Subsystem_Calorimeter), eager.GetSubEventByDTCID(3, DTCLib::DTC_Subsystem_Calorimeter));
+		ok = ok && lazy.GetSubEventByDTCID(3, DTCLib::DTC_Subsystem_Tracker) == nullptr && lazy.IsLazy();
+		ok = ok && lazy.GetBlockCount(DTCLib::DTC_Subsystem_Tracker) == eager.GetBlockCount(DTCLib::DTC_Subsystem_Tracker);
+		for (size_t ii = 0; ii < eager.GetSubEventCount(); ++ii) ok = ok && sameSubEvent(lazy.GetSubEvent(ii), eager.GetSubEvent(ii));
+		ok = ok && !lazy.IsLazy() && lazy.GetSubEvents().size() == eager.GetSubEvents().size();
+		if (!ok)
+		{
+			std::cout << "Lazy event 0x" << std::hex << eager.GetEventWindowTag().GetEventWindowTag(true) << std::dec << " differs from the eager one" << std::endl;
+			passed = false;
+		}
+	}
+
+	// A Sub-Event that claims to be longer than the event ends it in both modes
+	auto truncated = events[5];
+	DTCLib::DTC_SubEventHeader subHeader;
+	memcpy(&subHeader, &truncated[sizeof(DTCLib::DTC_EventHeader)], sizeof(subHeader));
+	size_t second = sizeof(DTCLib::DTC_EventHeader) + subHeader.inclusive_subevent_byte_count;
+	memcpy(&subHeader, &truncated[second], sizeof(subHeader));
+	subHeader.inclusive_subevent_byte_count = truncated.size();
+	memcpy(&truncated[second], &subHeader, sizeof(subHeader));
+	DTCLib::DTC_Event lazyTruncated(truncated.data());
+	lazyTruncated.SetupEvent(true);
+	if (lazyTruncated.GetSubEventCount() != 1 || lazyTruncated.GetSubEvent(0)->GetDataBlockCount() == 0)
+	{
+		std::cout << "Truncated event has " << lazyTruncated.GetSubEventCount() << " Sub-Events, expected 1" << std::endl;
+		passed = false;
+	}
+
+	// Setting up events and only looking at their headers
+	double seconds[2];
+	for (auto lazy : {false, true})
+	{
+		uint64_t tags = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned ii = 0; ii < count; ++ii)
+		{
+			DTCLib::DTC_Event evt(events[ii % events.size()].data());
+			evt.SetupEvent(lazy);
+			tags += evt.GetEventWindowTag().GetEventWindowTag(true);
+		}
+		seconds[lazy] = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - start).count();
+		if (tags == 0) passed = false;
+	}
+	std::cout << "Setting up " << count << " events took " << seconds[0] << " s eagerly, " << seconds[1] << " s lazily" << std::endl;
+
+	std::cout << (passed ? "Lazy event test passed." : "Lazy event test FAILED.") << std::endl;
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+// Writes events to the mu2esim DTC emulator with their event window tags swapped in pairs, asks DTC::GetData for the
+// tags in order, and checks that every event is returned, the early ones from the lookahead store. Then checks the
+// memory and age limits of the store.
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "dtcInterfaceLib/DTC.h"
+#include "simEventWriter.h"
+
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "lookaheadTest"
+
+void usage()
+{
+	std::cout << "This program writes events to the mu2esim DTC emulator with pairs of event window tags swapped, and reads" << std::endl
+			  << "them back in tag order with DTC::GetData, using the lookahead store." << std::endl
+			  << "Options are:" << std::endl
+			  << "    -h: This message." << std::endl
+			  << "    -n: Number of events (Default: 200)." << std::endl;
+}
+
+namespace {
+std::vector<uint8_t> makeEvent(uint64_t tagValue)
+{
+	DTCLib::DTC_Event evt;
+	DTCLib::DTC_EventWindowTag tag(tagValue);
+	evt.SetEventWindowTag(tag);
+	DTCLib::DTC_SubEvent subEvt;
+	subEvt.SetEventWindowTag(tag);
+	subEvt.SetSourceDTC(0, DTCLib::DTC_Subsystem_Tracker);
+	uint16_t packets = 1 + tagValue % 7;
+	addDataBlock(subEvt, DTCLib::DTC_Link_0, packets, 0, DTCLib::DTC_Subsystem_Tracker, tag, [&](size_t ii) { return tagValue + ii; });
+	evt.AddSubEvent(subEvt);
+	return eventBytes(evt);
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	unsigned count = 200;
+	for (auto ii = 1; ii < argc; ++ii)
+	{
+		if (argv[ii][0] != '-' || argv[ii][1] != 'n' || ii + 1 >= argc)
+		{
+			usage();
+			exit(0);
+		}
+		count = strtoul(argv[++ii], nullptr, 0);
+	}
+	count &= ~1u;
+
+	DTCLib::DTC dtc(DTCLib::DTC_SimMode_Performance, 0, 0x1, "", false, "mu2esim_lookahead.bin");
+	auto device = dtc.GetDevice();
+	device->write_register(DTCLib::DTC_Register_DetEmulation_Control0, 0, 0);
+	std::vector<std::vector<uint8_t>> events(count + 1);
+	for (uint64_t tag = 1; tag <= count; ++tag) events[tag] = makeEvent(tag);
+	for (uint64_t tag = 1; tag <= count; ++tag)
+	{
+		// 2, 1, 4, 3, ...
+		auto written = tag % 2 == 1 ? tag + 1 : tag - 1;
+		if (writeEvent(device, events[written]) != 0)
+		{
+			std::cout << "Failed to fill simulated DDR memory" << std::endl;
+			return 1;
+		}
+	}
+
+	auto passed = true;
+	unsigned errors = 0;
+	for (uint64_t tag = 1; tag <= count; ++tag)
+	{
+		auto data = dtc.GetData(DTCLib::DTC_EventWindowTag(tag));
+		if (data.size() != 1 || data[0]->GetEventWindowTag().GetEventWindowTag(true) != tag ||
+			data[0]->GetEventByteCount() != events[tag].size() ||
+			memcmp(data[0]->GetRawBufferPointer(), events[tag].data(), events[tag].size()) != 0)
+		{
+			TLOG(TLVL_ERROR) << "Wrong data for event window tag " << tag << ", got " << data.size() << " events";
+			++errors;
+		}
+	}
+	auto stats = dtc.GetLookaheadStats();
+	std::cout << count << " tags requested, " << errors << " errors, " << stats.stored << " events stored ahead, " << stats.hits
+			  << " served from the store, " << stats.maxBytesHeld << " bytes held at most" << std::endl;
+	if (errors != 0 || stats.hits != count / 2 || stats.stored != count / 2 || stats.tags != 0 || stats.eventsEvicted != 0) passed = false;
+
+	// A tag that never comes: reading ahead stops as soon as the store has to drop events
+	dtc.SetLookaheadLimits(8 * events[1].size(), std::chrono::seconds(1));
+	auto missing = dtc.GetData(DTCLib::DTC_EventWindowTag(static_cast<uint64_t>(count + 1000)));
+	stats = dtc.GetLookaheadStats();
+	std::cout << "Missing tag: " << missing.size() << " events returned, " << stats.tags << " tags stored, " << stats.evictedForSize
+			  << " evicted for size" << std::endl;
+	if (!missing.empty() || stats.evictedForSize == 0 || stats.bytes > 8 * events[1].size()) passed = false;
+
+	// Whatever is next comes from the store first, oldest first
+	auto next = dtc.GetData();
+	if (next.empty() || stats.tags == 0 || dtc.GetLookaheadStats().tags != stats.tags - 1) passed = false;
+
+	// Stored events expire
+	dtc.SetLookaheadLimits(1 << 20, std::chrono::milliseconds(1));
+	std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	dtc.SetLookaheadLimits(1 << 20, std::chrono::milliseconds(1));
+	stats = dtc.GetLookaheadStats();
+	std::cout << "After expiry: " << stats.tags << " tags stored, " << stats.evictedForAge << " evicted for age" << std::endl;
+	if (stats.tags != 0 || stats.evictedForAge == 0) passed = false;
+
+	std::cout << (passed ? "Lookahead test passed." : "Lookahead test FAILED.") << std::endl;
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+// Counts the heap allocations and measures the time of building, copying and parsing DTC_DataPackets on the DCS and
+// request paths. Packets of up to DTC_DataPacket::InlineSize bytes should not allocate.
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+#include "dtcInterfaceLib/DTC_Packets.h"
+
+namespace {
+size_t allocations = 0;
+}
+
+void* operator new(size_t size)
+{
+	++allocations;
+	auto ptr = malloc(size ? size : 1);
+	if (ptr == nullptr) throw std::bad_alloc();
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+void usage()
+{
+	std::cout << "This program counts the heap allocations of DTC_DataPacket operations." << std::endl
+			  << "Options are:" << std::endl
+			  << "    -h: This message." << std::endl
+			  << "    -n: Number of iterations per operation (Default: 1000000)." << std::endl;
+}
+
+namespace {
+// Run an operation, and report its allocations and time per call
+template<typename Operation>
+double measure(std::string const& name, unsigned count, Operation operation)
+{
+	operation();  // Warm-up, e.g. for a vector reaching its capacity
+	auto before = allocations;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned ii = 0; ii < count; ++ii) operation();
+	auto ns = std::chrono::duration_cast<std::chrono::duration<double, std::nano>>(std::chrono::steady_clock::now() - start).count();
+	auto perCall = static_cast<double>(allocations - before) / count;
+	std::cout << name << ": " << perCall << " allocations, " << ns / count << " ns per call" << std::endl;
+	return perCall;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	unsigned count = 1000000;
+	for (auto ii = 1; ii < argc; ++ii)
+	{
+		if (argv[ii][0] != '-' || argv[ii][1] != 'n' || ii + 1 >= argc)
+		{
+			usage();
+			exit(0);
+		}
+		count = strtoul(argv[++ii], nullptr, 0);
+	}
+
+	DTCLib::DTC_DCSRequestPacket read(DTCLib::DTC_Link_0, DTCLib::DTC_DCSOperationType_Read, false, false, 0x10);
+	DTCLib::DTC_DCSRequestPacket doubleWrite(DTCLib::DTC_Link_1, DTCLib::DTC_DCSOperationType_DoubleWrite, true, false, 0x10, 0x1234, 0x11, 0x5678);
+	DTCLib::DTC_DCSRequestPacket shortBlock(DTCLib::DTC_Link_2, DTCLib::DTC_DCSOperationType_BlockWrite, false, true, 0x20);
+	shortBlock.SetBlockWriteData(std::vector<uint16_t>(12, 0xABCD));
+	DTCLib::DTC_DCSRequestPacket longBlock(DTCLib::DTC_Link_2, DTCLib::DTC_DCSOperationType_BlockWrite, false, true, 0x20);
+	longBlock.SetBlockWriteData(std::vector<uint16_t>(100, 0xABCD));
+	DTCLib::DTC_HeartbeatPacket heartbeat(DTCLib::DTC_Link_0, DTCLib::DTC_EventWindowTag(static_cast<uint64_t>(0x123456)));
+	auto reply = read.ConvertToDataPacket();
+	reply.SetWord(2, DTCLib::DTC_PacketType_DCSReply << 4);
+
+	std::vector<DTCLib::DTC_DataPacket> queue;
+	queue.reserve(16);
+	size_t sink = 0;
+
+	auto passed = true;
+	passed &= measure("DCS read request", count, [&] { sink += read.ConvertToDataPacket().GetSize(); }) == 0;
+	passed &= measure("DCS double write request", count, [&] { sink += doubleWrite.ConvertToDataPacket().GetSize(); }) == 0;
+	passed &= measure("DCS block write request, " + std::to_string(shortBlock.ConvertToDataPacket().GetSize()) + " bytes", count,
+					  [&] { sink += shortBlock.ConvertToDataPacket().GetSize(); }) == 0;
+	auto longAllocations = measure("DCS block write request, " + std::to_string(longBlock.ConvertToDataPacket().GetSize()) + " bytes", count,
+								   [&] { sink += longBlock.ConvertToDataPacket().GetSize(); });
+	passed &= longAllocations > 0;
+	passed &= measure("Heartbeat request", count, [&] { sink += heartbeat.ConvertToDataPacket().GetSize(); }) == 0;
+	passed &= measure("DCS reply parsing", count, [&] { sink += DTCLib::DTC_DCSReplyPacket(reply).GetType(); }) == 0;
+	passed &= measure("Queueing request copies", count, [&] {
+				  if (queue.size() == 16) queue.clear();
+				  queue.push_back(read.ConvertToDataPacket());
+				  auto copy = queue.back();
+				  sink += copy.GetSize();
+			  }) == 0;
+
+	// Packets larger than the inline storage keep their contents through copies, moves and resizes
+	DTCLib::DTC_DataPacket packet;
+	for (uint16_t ii = 0; ii < 16; ++ii) packet.SetWord(ii, static_cast<uint8_t>(ii));
+	packet.Resize(48);
+	auto inlineCopy = packet;
+	packet.Resize(256);
+	packet.SetWord(200, 0xAA);
+	auto heapCopy = packet;
+	auto moved = std::move(heapCopy);
+	inlineCopy = moved;
+	for (uint16_t ii = 0; ii < 256; ++ii)
+	{
+		uint8_t expected = ii < 16 ? ii : ii == 200 ? 0xAA : 0;
+		if (moved.GetWord(ii) != expected || inlineCopy.GetWord(ii) != expected) passed = false;
+	}
+	if (inlineCopy.GetSize() != 256 || !(inlineCopy == moved)) passed = false;
+
+	std::cout << "(" << sink << ")" << std::endl;
+	std::cout << (passed ? "Packet allocation test passed." : "Packet allocation test FAILED.") << std::endl;
+	return passed ? 0 : 1;
+}
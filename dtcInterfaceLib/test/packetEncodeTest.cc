@@ -0,0 +1,177 @@
+// Encodes DCS Request, Heartbeat and Data Request packets with both ConvertToDataPacket and EncodeTo, checks that the
+// bytes are identical and that the existing decoders read back what was encoded, then sends DCS requests through the
+// mu2esim DTC emulator on the EncodeTo path.
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "dtcInterfaceLib/DTC.h"
+
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "packetEncodeTest"
+
+void usage()
+{
+	std::cout << "This program checks that the allocation-free packet encoders match ConvertToDataPacket and the decoders." << std::endl
+			  << "Options are:" << std::endl
+			  << "    -h: This message." << std::endl
+			  << "    -n: Number of packets of each type (Default: 10000)." << std::endl;
+}
+
+namespace {
+const uint8_t canary = 0xA5;
+
+// Encode a packet both ways, and compare. EncodeTo must not write past the packet, nor into a buffer too small for it.
+template<typename Packet>
+bool encodesIdentically(Packet const& packet, std::vector<uint8_t>& encoded)
+{
+	auto converted = packet.ConvertToDataPacket();
+	auto size = packet.GetEncodedSize();
+	encoded.assign(size + 16, canary);
+	if (packet.EncodeTo(encoded.data(), size - 1) != 0 || encoded[0] != canary) return false;
+	if (packet.EncodeTo(encoded.data(), encoded.size()) != size || converted.GetSize() != size) return false;
+	for (size_t ii = size; ii < encoded.size(); ++ii)
+	{
+		if (encoded[ii] != canary) return false;
+	}
+	encoded.resize(size);
+	return memcmp(encoded.data(), converted.GetData(), size) == 0;
+}
+
+bool sameHeader(DTCLib::DTC_DMAPacket const& a, DTCLib::DTC_DMAPacket const& b)
+{
+	return a.GetPacketType() == b.GetPacketType() && a.GetLinkID() == b.GetLinkID() && a.GetByteCount() == b.GetByteCount() &&
+		   a.GetHopCount() == b.GetHopCount();
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	unsigned count = 10000;
+	for (auto ii = 1; ii < argc; ++ii)
+	{
+		if (argv[ii][0] != '-' || argv[ii][1] != 'n' || ii + 1 >= argc)
+		{
+			usage();
+			exit(0);
+		}
+		count = strtoul(argv[++ii], nullptr, 0);
+	}
+
+	std::vector<uint8_t> encoded;
+	unsigned errors[3] = {0, 0, 0};
+	const DTCLib::DTC_DCSOperationType types[] = {DTCLib::DTC_DCSOperationType_Read, DTCLib::DTC_DCSOperationType_Write,
+												  DTCLib::DTC_DCSOperationType_BlockRead, DTCLib::DTC_DCSOperationType_BlockWrite,
+												  DTCLib::DTC_DCSOperationType_DoubleRead, DTCLib::DTC_DCSOperationType_DoubleWrite};
+	for (unsigned ii = 0; ii < count; ++ii)
+	{
+		auto link = static_cast<DTCLib::DTC_Link_ID>(ii % 6);
+		uint64_t tagValue = (static_cast<uint64_t>(ii) * 0x9E3779B97F4A7C15ULL) & 0xFFFFFFFFFFFFULL;
+		DTCLib::DTC_EventWindowTag tag(tagValue);
+
+		// DCS Request: every operation, with and without a second request, and block writes of 0 to 40 words
+		auto type = types[ii % 6];
+		uint16_t address = static_cast<uint16_t>(ii * 7919);
+		uint16_t data = static_cast<uint16_t>(ii * 104729);
+		uint16_t address2 = ii % 5 == 0 ? 0 : static_cast<uint16_t>(address + 1);
+		uint16_t data2 = ii % 5 == 0 ? 0 : static_cast<uint16_t>(~data);
+		DTCLib::DTC_DCSRequestPacket dcs(link, type, ii % 2 == 0, ii % 3 == 0, address, data, address2, data2);
+		std::vector<uint16_t> block;
+		if (type == DTCLib::DTC_DCSOperationType_BlockWrite)
+		{
+			for (unsigned word = 0; word < ii % 41; ++word) block.push_back(static_cast<uint16_t>(ii + word * 257));
+			dcs.SetBlockWriteData(block);
+		}
+		if (!encodesIdentically(dcs, encoded))
+		{
+			++errors[0];
+		}
+		else
+		{
+			DTCLib::DTC_DCSRequestPacket decoded{DTCLib::DTC_DataPacket(encoded.data())};
+			auto expectedType = (type == DTCLib::DTC_DCSOperationType_DoubleRead || type == DTCLib::DTC_DCSOperationType_DoubleWrite) && address2 == 0 && data2 == 0
+									? static_cast<DTCLib::DTC_DCSOperationType>(type & 0x1)
+									: type;
+			auto ok = sameHeader(dcs, decoded) && decoded.GetType() == expectedType && decoded.RequestsAck() == dcs.RequestsAck() &&
+					  decoded.IncrementsAddress() == dcs.IncrementsAddress() && decoded.GetRequest() == dcs.GetRequest();
+			if (type == DTCLib::DTC_DCSOperationType_BlockWrite)
+			{
+				// The decoder reads the first packet, with the word count and up to three words
+				ok = ok && decoded.GetRequest().second == block.size();
+				for (size_t word = 0; word < 3 && word < block.size(); ++word) ok = ok && encoded[10 + 2 * word] + (encoded[11 + 2 * word] << 8) == block[word];
+				ok = ok && encoded.size() == (1 + (block.size() > 3 ? (block.size() - 3 + 7) / 8 : 0)) * 16;
+			}
+			else
+			{
+				ok = ok && decoded.GetRequest(true) == dcs.GetRequest(true);
+			}
+			if (!ok) ++errors[0];
+		}
+
+		// Heartbeat
+		DTCLib::DTC_EventMode mode;
+		mode.mode0 = static_cast<uint8_t>(ii);
+		mode.mode1 = static_cast<uint8_t>(ii >> 8);
+		mode.mode2 = static_cast<uint8_t>(ii * 3);
+		mode.mode3 = static_cast<uint8_t>(ii * 5);
+		mode.mode4 = static_cast<uint8_t>(ii * 7);
+		DTCLib::DTC_HeartbeatPacket heartbeat(link, tag, mode, static_cast<uint8_t>(ii * 11));
+		if (!encodesIdentically(heartbeat, encoded))
+		{
+			++errors[1];
+		}
+		else
+		{
+			DTCLib::DTC_HeartbeatPacket decoded{DTCLib::DTC_DataPacket(encoded.data())};
+			auto decodedMode = decoded.GetData();
+			if (!sameHeader(heartbeat, decoded) || decoded.GetEventWindowTag() != tag || decodedMode.mode0 != mode.mode0 ||
+				decodedMode.mode1 != mode.mode1 || decodedMode.mode2 != mode.mode2 || decodedMode.mode3 != mode.mode3 ||
+				decodedMode.mode4 != mode.mode4 || encoded[15] != static_cast<uint8_t>(ii * 11))
+			{
+				++errors[1];
+			}
+		}
+
+		// Data Request
+		DTCLib::DTC_DataRequestPacket request(link, tag, ii % 2 == 0, static_cast<uint16_t>(ii * 31), static_cast<DTCLib::DTC_DebugType>(ii % 3));
+		if (!encodesIdentically(request, encoded))
+		{
+			++errors[2];
+		}
+		else
+		{
+			DTCLib::DTC_DataRequestPacket decoded{DTCLib::DTC_DataPacket(encoded.data())};
+			if (!sameHeader(request, decoded) || decoded.GetEventWindowTag() != tag || decoded.GetDebug() != request.GetDebug() ||
+				decoded.GetDebugType() != request.GetDebugType() || decoded.GetDebugPacketCount() != request.GetDebugPacketCount())
+			{
+				++errors[2];
+			}
+		}
+	}
+	std::cout << count << " packets of each type: " << errors[0] << " DCS Request, " << errors[1] << " Heartbeat, " << errors[2]
+			  << " Data Request mismatches" << std::endl;
+	auto passed = errors[0] == 0 && errors[1] == 0 && errors[2] == 0;
+
+	// The emulator decodes the requests written by DTC::WriteDMAPacket, and echoes the address of a read
+	DTCLib::DTC dtc(DTCLib::DTC_SimMode_Performance, 0, 0x1, "", false, "mu2esim_encode.bin");
+	unsigned dcsErrors = 0;
+	for (uint16_t address = 1; address < 100; ++address)
+	{
+		try
+		{
+			dtc.ReadROCRegister(DTCLib::DTC_Link_0, address, 100);
+		}
+		catch (std::exception const& ex)
+		{
+			TLOG(TLVL_ERROR) << "ReadROCRegister of address " << address << " failed: " << ex.what();
+			++dcsErrors;
+		}
+	}
+	dtc.SendReadoutRequestPacket(DTCLib::DTC_Link_0, DTCLib::DTC_EventWindowTag(static_cast<uint64_t>(1)));
+	std::cout << "DCS reads through the emulator: " << dcsErrors << " errors" << std::endl;
+	if (dcsErrors != 0) passed = false;
+
+	std::cout << (passed ? "Packet encoding test passed." : "Packet encoding test FAILED.") << std::endl;
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+// Reads events from the mu2esim DTC emulator through a DTC_Pipeline, with workers that take a random time per event,
+// and checks that every event arrives intact and in order, with events in the DMA buffers and with copies.
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "dtcInterfaceLib/DTC_Pipeline.h"
+#include "simEventWriter.h"
+
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "pipelineTest"
+
+void usage()
+{
+	std::cout << "This program writes events of various sizes to the mu2esim DTC emulator, and reads them back through" << std::endl
+			  << "a DTC_Pipeline, once leaving the events in the DMA buffers and once copying them." << std::endl
+			  << "Options are:" << std::endl
+			  << "    -h: This message." << std::endl
+			  << "    -n: Number of events to read in each mode (Default: 5000)." << std::endl
+			  << "    -w: Number of worker threads (Default: 4)." << std::endl
+			  << "    -q: Depth of each queue (Default: 16)." << std::endl
+			  << "    -j: Maximum time a worker spends on an event, in microseconds (Default: 50)." << std::endl;
+}
+
+namespace {
+const unsigned eventCount = 23;  // Distinct events written to the emulator, which then loops over them
+const size_t chunk = 0x1000;     // DMA buffer payload size
+
+// Sub-events and blocks grow with the event number, so some events span several buffers
+std::vector<uint8_t> makeEvent(unsigned event)
+{
+	DTCLib::DTC_Event evt;
+	DTCLib::DTC_EventWindowTag tag(static_cast<uint64_t>(event + 1));
+	evt.SetEventWindowTag(tag);
+	for (unsigned sub = 0; sub < 1 + event % 3; ++sub)
+	{
+		DTCLib::DTC_SubEvent subEvt;
+		subEvt.SetEventWindowTag(tag);
+		subEvt.SetSourceDTC(sub, DTCLib::DTC_Subsystem_Tracker);
+		for (unsigned roc = 0; roc < 1 + event % 5; ++roc)
+		{
+			uint16_t packets = 1 + (event * 13 + roc * 7) % 60;
+			addDataBlock(subEvt, static_cast<DTCLib::DTC_Link_ID>(roc), packets, sub, DTCLib::DTC_Subsystem_Tracker, tag,
+						 [&](size_t ii) { return event * 29 + roc + ii; });
+		}
+		evt.AddSubEvent(subEvt);
+	}
+	return eventBytes(evt);
+}
+
+unsigned eventNumber(DTCLib::DTC_PipelineEvent const& event)
+{
+	auto tag = event.view ? event.view->GetEventWindowTag() : event.event->GetEventWindowTag();
+	return static_cast<unsigned>(tag.GetEventWindowTag(true) - 1) % eventCount;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	unsigned count = 5000;
+	DTCLib::DTC_PipelineConfig config;
+	config.workers = 4;
+	config.inputDepth = 16;
+	config.outputDepth = 16;
+	unsigned jitter = 50;
+	for (auto ii = 1; ii < argc; ++ii)
+	{
+		if (argv[ii][0] != '-' || argv[ii][1] == 'h' || ii + 1 >= argc)
+		{
+			usage();
+			exit(0);
+		}
+		switch (argv[ii][1])
+		{
+			case 'n':
+				count = strtoul(argv[++ii], nullptr, 0);
+				break;
+			case 'w':
+				config.workers = strtoul(argv[++ii], nullptr, 0);
+				break;
+			case 'q':
+				config.inputDepth = config.outputDepth = strtoul(argv[++ii], nullptr, 0);
+				break;
+			case 'j':
+				jitter = strtoul(argv[++ii], nullptr, 0);
+				break;
+			default:
+				usage();
+				exit(0);
+		}
+	}
+
+	DTCLib::DTC dtc(DTCLib::DTC_SimMode_Performance, 0, 0x1, "", false, "mu2esim_pipeline.bin");
+	auto device = dtc.GetDevice();
+	device->write_register(DTCLib::DTC_Register_DetEmulation_Control0, 0, 0);
+	std::vector<std::vector<uint8_t>> events;
+	for (unsigned event = 0; event < eventCount; ++event)
+	{
+		events.push_back(makeEvent(event));
+		if (writeEvent(device, events.back(), chunk) != 0)
+		{
+			std::cout << "Failed to fill simulated DDR memory" << std::endl;
+			return 1;
+		}
+	}
+
+	auto passed = true;
+	for (auto copyEvents : {false, true})
+	{
+		config.copyEvents = copyEvents;
+		std::atomic<unsigned> workerErrors(0);
+		unsigned orderErrors = 0, badEvents = 0, delivered = 0, next = 0;
+
+		// Workers compare the event with what was written, and take a random time so that they finish out of order
+		auto worker = [&](DTCLib::DTC_PipelineEvent& event, unsigned index) {
+			thread_local std::mt19937 rng(index);
+			auto& expected = events[eventNumber(event)];
+			std::vector<uint8_t> bytes(expected.size());
+			if (event.view)
+			{
+				if (event.view->GetEventByteCount() != expected.size()) return false;
+				event.view->CopyBytes(0, bytes.data(), bytes.size());
+			}
+			else
+			{
+				if (event.event->GetEventByteCount() != expected.size()) return false;
+				memcpy(bytes.data(), event.event->GetRawBufferPointer(), bytes.size());
+			}
+			if (jitter > 0) std::this_thread::sleep_for(std::chrono::microseconds(rng() % jitter));
+			if (bytes != expected)
+			{
+				workerErrors++;
+				return false;
+			}
+			return true;
+		};
+
+		DTCLib::DTC_Pipeline* pipelinePtr = nullptr;
+		auto output = [&](DTCLib::DTC_PipelineEvent& event) {
+			auto number = eventNumber(event);
+			if (delivered > 0 && number != next)
+			{
+				TLOG(TLVL_ERROR) << "Event " << event.sequence << " is event " << number << ", expected " << next;
+				++orderErrors;
+			}
+			if (!event.good) ++badEvents;
+			if (copyEvents == static_cast<bool>(event.view)) ++orderErrors;
+			next = (number + 1) % eventCount;
+			if (++delivered == count) pipelinePtr->Stop();
+			return true;
+		};
+
+		DTCLib::DTC_Pipeline pipeline(&dtc, worker, output, config);
+		pipelinePtr = &pipeline;
+		auto start = std::chrono::steady_clock::now();
+		pipeline.Start();
+		pipeline.Wait();
+		auto seconds = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - start).count();
+
+		auto stats = pipeline.GetStats();
+		std::cout << (copyEvents ? "Copied events: " : "Events in DMA buffers: ") << stats.read << " read, " << stats.delivered
+				  << " delivered, " << stats.bad << " bad, " << stats.outOfOrder << " out of order (max " << stats.maxReordered
+				  << " held back), reader waited " << stats.readerWaits << " times, took " << seconds << " s" << std::endl;
+
+		// Stop() lets the events already read through, so all of them are delivered
+		auto ok = orderErrors == 0 && badEvents == 0 && workerErrors == 0 && stats.readErrors == 0 && delivered >= count &&
+				  stats.delivered == stats.read && !pipeline.IsRunning();
+		// With several workers taking random times, some events must have overtaken others
+		if (config.workers > 1 && jitter > 0 && stats.outOfOrder == 0) ok = false;
+		if (!ok) std::cout << orderErrors << " order errors, " << badEvents << " bad events, " << workerErrors << " data errors" << std::endl;
+		passed = passed && ok;
+	}
+
+	std::cout << (passed ? "Pipeline test passed." : "Pipeline test FAILED.") << std::endl;
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,166 @@
+// Reads the DAQ channels of several simulated DTCs from one thread with mu2ereactor, and checks that every DTC's
+// data arrives complete and in order, that the DTCs are serviced fairly, and that maxHeld is respected.
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "dtcInterfaceLib/DTC_Registers.h"
+#include "dtcInterfaceLib/mu2ereactor.h"
+
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "reactorTest"
+
+void usage()
+{
+	std::cout << "This program reads DAQ data from several mu2esim DTC emulators with one mu2ereactor thread," << std::endl
+			  << "and checks the data, the fairness of the schedule and the per-DTC buffer limits." << std::endl
+			  << "Options are:" << std::endl
+			  << "    -h: This message." << std::endl
+			  << "    -n: Number of DAQ buffers to read per DTC (Default: 100000)." << std::endl
+			  << "    -d: Number of simulated DTCs (Default: 4, maximum 4)." << std::endl
+			  << "    -b: Reactor batch size (Default: 16)." << std::endl;
+}
+
+namespace {
+const uint64_t daqMagic = 0x5245414354000000ULL;
+const unsigned records = 29;
+// Buffer limit of device 0
+const unsigned heldLimit = 8;
+
+size_t daqRecordSize(unsigned record) { return sizeof(uint64_t) * (2 + record % 11); }
+uint64_t daqValue(int dtc, unsigned record) { return daqMagic | (static_cast<uint64_t>(dtc) << 16) | record; }
+
+int fillDDR(mu2edev& device, int dtc)
+{
+	mu2e_databuff_t buf;
+	for (unsigned record = 0; record < records; ++record)
+	{
+		uint64_t size = daqRecordSize(record);
+		uint64_t transferSize = size + sizeof(uint64_t);
+		memcpy(&buf[0], &transferSize, sizeof(uint64_t));
+		memcpy(&buf[8], &size, sizeof(uint64_t));
+		for (size_t word = 1; word < size / sizeof(uint64_t); ++word)
+		{
+			uint64_t value = daqValue(dtc, record);
+			memcpy(&buf[8 + word * sizeof(uint64_t)], &value, sizeof(uint64_t));
+		}
+		if (device.write_data(DTC_DMA_Engine_DAQ, &buf, transferSize) != 0) return -1;
+	}
+	return 0;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	unsigned count = 100000;
+	int dtcs = MU2E_MAX_NUM_DTCS;
+	unsigned batchSize = 16;
+	for (auto ii = 1; ii < argc; ++ii)
+	{
+		if (argv[ii][0] != '-' || argv[ii][1] == 'h' || ii + 1 >= argc)
+		{
+			usage();
+			exit(0);
+		}
+		switch (argv[ii][1])
+		{
+			case 'n':
+				count = strtoul(argv[++ii], nullptr, 0);
+				break;
+			case 'd':
+				dtcs = strtol(argv[++ii], nullptr, 0);
+				break;
+			case 'b':
+				batchSize = strtoul(argv[++ii], nullptr, 0);
+				break;
+			default:
+				usage();
+				exit(0);
+		}
+	}
+	if (dtcs < 2 || dtcs > MU2E_MAX_NUM_DTCS)
+	{
+		usage();
+		exit(0);
+	}
+
+	std::vector<std::unique_ptr<mu2edev>> devices;
+	for (int dtc = 0; dtc < dtcs; ++dtc)
+	{
+		devices.emplace_back(new mu2edev());
+		devices[dtc]->init(DTCLib::DTC_SimMode_Performance, dtc, "mu2esim_reactor" + std::to_string(dtc) + ".bin");
+		devices[dtc]->write_register(DTCLib::DTC_Register_DetEmulation_Control0, 0, 0);
+		if (fillDDR(*devices[dtc], dtc) != 0)
+		{
+			std::cout << "Failed to fill simulated DDR memory of DTC " << dtc << std::endl;
+			return 1;
+		}
+	}
+
+	std::vector<unsigned> expected(dtcs, 0);
+	std::vector<unsigned> read(dtcs, 0);
+	unsigned errors = 0;
+	int done = 0;
+	mu2ereactor* reactorPtr = nullptr;
+	mu2ereactor reactor(
+		[&](int index, void** buffers, int* byteCounts, unsigned n) -> unsigned {
+			for (unsigned ii = 0; ii < n; ++ii)
+			{
+				uint64_t size, value;
+				memcpy(&size, buffers[ii], sizeof(uint64_t));
+				memcpy(&value, reinterpret_cast<uint8_t*>(buffers[ii]) + sizeof(uint64_t), sizeof(uint64_t));
+				auto record = expected[index];
+				if (size != daqRecordSize(record) || static_cast<uint64_t>(byteCounts[ii]) != size || value != daqValue(index, record))
+				{
+					TLOG(TLVL_ERROR) << "DTC " << index << " buffer " << read[index] << ": expected record " << record << ", got byte count "
+									 << byteCounts[ii] << ", size " << size << ", value 0x" << std::hex << value;
+					++errors;
+				}
+				expected[index] = (record + 1) % records;
+				if (++read[index] == count && ++done == dtcs) reactorPtr->stop();
+			}
+			// Device 0's buffers are held, and only given back every 2 * heldLimit turns of device 1, so it gets throttled
+			if (index == 0) return 0;
+			if (index == 1 && reactorPtr->get_stats(1).turns % (2 * heldLimit) == 0) reactorPtr->release(0, reactorPtr->get_stats(0).held);
+			return n;
+		},
+		batchSize);
+	reactorPtr = &reactor;
+	for (int dtc = 0; dtc < dtcs; ++dtc) reactor.add_device(devices[dtc].get(), dtc == 0 ? heldLimit : 0);
+
+	auto start = std::chrono::steady_clock::now();
+	auto sts = reactor.run();
+	auto seconds = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - start).count();
+
+	auto passed = sts == 0 && errors == 0;
+	uint64_t minBuffers = UINT64_MAX, maxBuffers = 0;
+	for (int dtc = 0; dtc < dtcs; ++dtc)
+	{
+		auto stats = reactor.get_stats(dtc);
+		std::cout << "DTC " << dtc << ": " << stats.buffers << " buffers, " << stats.bytes << " bytes, " << stats.turns << " turns, "
+				  << stats.empty_polls << " empty polls, " << stats.throttled << " throttled, max held " << stats.max_held << std::endl;
+		if (dtc == 0)
+		{
+			if (stats.max_held > heldLimit || stats.throttled == 0 || stats.buffers < count)
+			{
+				std::cout << "DTC 0 should have been throttled at " << heldLimit << " held buffers" << std::endl;
+				passed = false;
+			}
+			continue;
+		}
+		if (stats.buffers < minBuffers) minBuffers = stats.buffers;
+		if (stats.buffers > maxBuffers) maxBuffers = stats.buffers;
+	}
+	// The unthrottled DTCs always have data, so round-robin keeps them within one batch of each other
+	if (maxBuffers - minBuffers > batchSize)
+	{
+		std::cout << "Unfair schedule: unthrottled DTCs read between " << minBuffers << " and " << maxBuffers << " buffers" << std::endl;
+		passed = false;
+	}
+	std::cout << errors << " data errors, took " << seconds << " s" << std::endl;
+	std::cout << (passed ? "Reactor test passed." : "Reactor test FAILED.") << std::endl;
+	return passed ? 0 : 1;
+}
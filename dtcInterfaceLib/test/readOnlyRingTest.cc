@@ -0,0 +1,143 @@
+// Writes events to the mu2esim DTC emulator, reads them back with the copying and the in-place readout functions,
+// and checks that the received DMA buffers, including their DMA headers, are left exactly as the device wrote them.
+// Then checks that with DTCLIB_C2S_READONLY=1 the received buffers of the mu2eshm loopback are mapped read-only.
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "dtcInterfaceLib/DTC.h"
+#include "dtcInterfaceLib/mu2eshm.h"
+#include "simEventWriter.h"
+
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "readOnlyRingTest"
+
+void usage()
+{
+	std::cout << "This program writes events to the mu2esim DTC emulator, reads them back, and checks that the receive" << std::endl
+			  << "buffers were not modified by the readout, and that DTCLIB_C2S_READONLY maps them read-only." << std::endl
+			  << "Options are:" << std::endl
+			  << "    -h: This message." << std::endl
+			  << "    -n: Number of events (Default: 100)." << std::endl;
+}
+
+namespace {
+std::vector<uint8_t> makeEvent(uint64_t tagValue)
+{
+	DTCLib::DTC_Event evt;
+	DTCLib::DTC_EventWindowTag tag(tagValue);
+	evt.SetEventWindowTag(tag);
+	DTCLib::DTC_SubEvent subEvt;
+	subEvt.SetEventWindowTag(tag);
+	uint16_t packets = 1 + tagValue % 5;
+	addDataBlock(subEvt, DTCLib::DTC_Link_0, packets, 0, DTCLib::DTC_Subsystem_Tracker, tag, [&](size_t ii) { return tagValue * 3 + ii; });
+	evt.AddSubEvent(subEvt);
+	return eventBytes(evt);
+}
+
+// The event starts right after the 8-byte DMA header of its buffer
+bool unmodified(const void* event, std::vector<uint8_t> const& bytes)
+{
+	auto start = static_cast<const uint8_t*>(event) - sizeof(uint64_t);
+	uint64_t dmaSize;
+	memcpy(&dmaSize, start, sizeof(uint64_t));
+	return dmaSize == bytes.size() + sizeof(uint64_t) && memcmp(start + sizeof(uint64_t), bytes.data(), bytes.size()) == 0;
+}
+
+// Writes to the buffer from a child process, which a read-only mapping kills with SIGSEGV
+bool writeFaults(void* buffer)
+{
+	auto pid = fork();
+	if (pid == 0)
+	{
+		*static_cast<volatile uint8_t*>(buffer) = 0;
+		_exit(0);
+	}
+	int status;
+	return pid > 0 && waitpid(pid, &status, 0) == pid && WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	unsigned count = 100;
+	for (auto ii = 1; ii < argc; ++ii)
+	{
+		if (argv[ii][0] != '-' || argv[ii][1] != 'n' || ii + 1 >= argc)
+		{
+			usage();
+			exit(0);
+		}
+		count = strtoul(argv[++ii], nullptr, 0);
+	}
+
+	DTCLib::DTC dtc(DTCLib::DTC_SimMode_Performance, 0, 0x1, "", false, "mu2esim_readonly.bin");
+	auto device = dtc.GetDevice();
+	device->write_register(DTCLib::DTC_Register_DetEmulation_Control0, 0, 0);
+	std::vector<std::vector<uint8_t>> events(count + 1);
+	for (uint64_t tag = 1; tag <= count; ++tag)
+	{
+		events[tag] = makeEvent(tag);
+		if (writeEvent(device, events[tag]) != 0)
+		{
+			std::cout << "Failed to fill simulated DDR memory" << std::endl;
+			return 1;
+		}
+	}
+
+	// Each event is read once in place, and its buffer checked while it is still held
+	unsigned errors = 0;
+	for (uint64_t tag = 1; tag <= count; ++tag)
+	{
+		dtc.ReleaseDAQBuffers();
+		auto event = dtc.ReadNextDAQDMA(100);
+		if (event == nullptr || event->GetEventWindowTag().GetEventWindowTag(true) != tag || !unmodified(event->GetRawBufferPointer(), events[tag]))
+		{
+			TLOG(TLVL_ERROR) << "DMA buffer of event window tag " << tag << " was modified, or the wrong event was read";
+			++errors;
+		}
+	}
+	for (uint64_t tag = 1; tag <= count; ++tag)
+	{
+		auto views = dtc.GetDataViews();
+		if (views.size() != 1 || views[0]->GetEventWindowTag().GetEventWindowTag(true) != tag ||
+			!unmodified(views[0]->GetSegments()[0].data, events[tag]))
+		{
+			TLOG(TLVL_ERROR) << "DMA buffer of event view " << tag << " was modified, or the wrong event was read";
+			++errors;
+		}
+	}
+	auto stats = dtc.GetReadStats(DTC_DMA_Engine_DAQ);
+	std::cout << 2 * count << " events read, " << errors << " modified buffers, " << stats.repeatedBuffers << " buffers handed out twice" << std::endl;
+
+	// Private segment, so that the test does not disturb (or get disturbed by) a real producer
+	auto name = "/mu2eshm_readonly_" + std::to_string(getpid()) + "_dtc";
+	setenv("DTCLIB_SHM_NAME", name.c_str(), 1);
+	setenv("DTCLIB_C2S_READONLY", "1", 1);
+	{
+		mu2edev shm;
+		shm.init(DTCLib::DTC_SimMode_SharedMemory, 0);
+		void* buffer = nullptr;
+		if (writeEvent(&shm, events[1]) != 0 || shm.read_data(DTC_DMA_Engine_DAQ, &buffer, 1000) <= 0)
+		{
+			TLOG(TLVL_ERROR) << "The mu2eshm loopback did not deliver the event written to it";
+			++errors;
+		}
+		else if (!writeFaults(buffer))
+		{
+			TLOG(TLVL_ERROR) << "A write to a received mu2eshm buffer did not fault with DTCLIB_C2S_READONLY=1";
+			++errors;
+		}
+		shm.read_release(DTC_DMA_Engine_DAQ, 1);
+	}
+	mu2eshm_ring::unlink(0);
+	unsetenv("DTCLIB_C2S_READONLY");
+
+	auto passed = errors == 0 && stats.repeatedBuffers == 0;
+	std::cout << (passed ? "Read-only ring test passed." : "Read-only ring test FAILED.") << std::endl;
+	return passed ? 0 : 1;
+}
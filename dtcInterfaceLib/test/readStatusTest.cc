@@ -0,0 +1,157 @@
+// Writes good events and events with a corrupt byte count to the mu2esim DTC emulator, and checks that the
+// status-returning readout functions skip the bad ones and count them, while the throwing ones still throw.
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "dtcInterfaceLib/DTC.h"
+#include "simEventWriter.h"
+
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "readStatusTest"
+
+void usage()
+{
+	std::cout << "This program writes good and corrupt events to the mu2esim DTC emulator, and reads them with the" << std::endl
+			  << "status-returning and the exception-throwing DTC readout functions." << std::endl
+			  << "Options are:" << std::endl
+			  << "    -h: This message." << std::endl
+			  << "    -n: Number of corrupt events to skip in the timing loops (Default: 20000)." << std::endl;
+}
+
+namespace {
+std::vector<uint8_t> makeEvent(uint64_t tagValue)
+{
+	DTCLib::DTC_Event evt;
+	DTCLib::DTC_EventWindowTag tag(tagValue);
+	evt.SetEventWindowTag(tag);
+	DTCLib::DTC_SubEvent subEvt;
+	subEvt.SetEventWindowTag(tag);
+	addDataBlock(subEvt, DTCLib::DTC_Link_0, 1, 0, DTCLib::DTC_Subsystem_Tracker, tag);
+	evt.AddSubEvent(subEvt);
+	return eventBytes(evt);
+}
+
+uint64_t tagOf(std::unique_ptr<DTCLib::DTC_EventView> const& view)
+{
+	return view ? view->GetEventWindowTag().GetEventWindowTag(true) : 0;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	unsigned count = 20000;
+	for (auto ii = 1; ii < argc; ++ii)
+	{
+		if (argv[ii][0] != '-' || argv[ii][1] != 'n' || ii + 1 >= argc)
+		{
+			usage();
+			exit(0);
+		}
+		count = strtoul(argv[++ii], nullptr, 0);
+	}
+
+	DTCLib::DTC dtc(DTCLib::DTC_SimMode_Performance, 0, 0x1, "", false, "mu2esim_readstatus.bin");
+	auto device = dtc.GetDevice();
+	device->write_register(DTCLib::DTC_Register_DetEmulation_Control0, 0, 0);
+
+	// Event 1, a buffer whose event claims to be empty, events 2 and 3
+	auto corrupt = makeEvent(99);
+	memset(corrupt.data(), 0, sizeof(uint64_t));
+	if (writeEvent(device, makeEvent(1)) != 0 || writeEvent(device, corrupt) != 0 || writeEvent(device, makeEvent(2)) != 0 ||
+		writeEvent(device, makeEvent(3)) != 0)
+	{
+		std::cout << "Failed to fill simulated DDR memory" << std::endl;
+		return 1;
+	}
+
+	auto passed = true;
+	std::unique_ptr<DTCLib::DTC_EventView> view;
+	std::vector<DTCLib::DTC_ReadStatus> statuses;
+	std::vector<uint64_t> tags;
+	for (int ii = 0; ii < 4; ++ii)
+	{
+		dtc.ReleaseDAQBuffers();
+		statuses.push_back(dtc.TryReadNextDAQEventView(view, 100));
+		tags.push_back(tagOf(view));
+		view.reset();
+	}
+	auto stats = dtc.GetReadStats(DTC_DMA_Engine_DAQ);
+	std::cout << "Statuses:";
+	for (auto sts : statuses) std::cout << " " << DTCLib::DTC_ReadStatusConverter(sts).toString();
+	std::cout << ", " << stats.ok << " OK, " << stats.badByteCounts << " bad byte counts" << std::endl;
+	if (statuses != std::vector<DTCLib::DTC_ReadStatus>{DTCLib::DTC_ReadStatus_OK, DTCLib::DTC_ReadStatus_BadByteCount, DTCLib::DTC_ReadStatus_OK, DTCLib::DTC_ReadStatus_OK} ||
+		tags != std::vector<uint64_t>{1, 0, 2, 3} || stats.ok != 3 || stats.badByteCounts != 1 || stats.Errors() != 1)
+	{
+		passed = false;
+	}
+
+	// The emulator starts over: event 1, then the corrupt buffer makes the throwing function throw
+	dtc.ReleaseDAQBuffers();
+	view = dtc.ReadNextDAQEventView(100);
+	if (tagOf(view) != 1) passed = false;
+	view.reset();
+	dtc.ReleaseDAQBuffers();
+	auto threw = false;
+	try
+	{
+		dtc.ReadNextDAQEventView(100);
+	}
+	catch (DTCLib::DTC_DataCorruptionException const&)
+	{
+		threw = true;
+	}
+	if (!threw)
+	{
+		std::cout << "ReadNextDAQEventView did not throw on the corrupt event" << std::endl;
+		passed = false;
+	}
+
+	// GetData does not throw, and asks for what is not there
+	dtc.SetLookaheadLimits(0, std::chrono::seconds(1));
+	std::vector<std::unique_ptr<DTCLib::DTC_Event>> events;
+	auto sts = dtc.TryGetData(events, DTCLib::DTC_EventWindowTag(static_cast<uint64_t>(42)));
+	if (sts != DTCLib::DTC_ReadStatus_NotFound || !events.empty() || dtc.GetReadStats(DTC_DMA_Engine_DAQ).notFound != 1) passed = false;
+
+	// No DCS request was sent, so there is no reply
+	std::unique_ptr<DTCLib::DTC_DCSReplyPacket> reply;
+	sts = dtc.TryReadNextDCSPacket(reply, 0);
+	if (sts != DTCLib::DTC_ReadStatus_Timeout || reply != nullptr || dtc.GetReadStats(DTC_DMA_Engine_DCS).timeouts != 1) passed = false;
+
+	// Compare the cost of skipping corrupt events with both kinds of function. Every fourth read is a corrupt event.
+	dtc.ResetReadStats(DTC_DMA_Engine_DAQ);
+	auto start = std::chrono::steady_clock::now();
+	while (dtc.GetReadStats(DTC_DMA_Engine_DAQ).badByteCounts < count)
+	{
+		dtc.ReleaseDAQBuffers();
+		if (dtc.TryReadNextDAQEventView(view, 100) == DTCLib::DTC_ReadStatus_Timeout) break;
+		view.reset();
+	}
+	auto statusSeconds = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - start).count();
+
+	unsigned caught = 0;
+	start = std::chrono::steady_clock::now();
+	while (caught < count)
+	{
+		dtc.ReleaseDAQBuffers();
+		try
+		{
+			view = dtc.ReadNextDAQEventView(100);
+			if (view == nullptr) break;
+			view.reset();
+		}
+		catch (DTCLib::DTC_DataCorruptionException const&)
+		{
+			++caught;
+		}
+	}
+	auto throwSeconds = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Skipping " << count << " corrupt events took " << statusSeconds << " s with status codes, " << throwSeconds
+			  << " s with exceptions" << std::endl;
+	if (dtc.GetReadStats(DTC_DMA_Engine_DAQ).badByteCounts < count || caught < count) passed = false;
+
+	std::cout << (passed ? "Read status test passed." : "Read status test FAILED.") << std::endl;
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+// Reads events from the mu2esim DTC emulator under each DAQ buffer release policy, and checks when DTC releases
+// the finished buffers, that it always releases once three quarters of the ring is held, and the release counters.
+
+#include <unistd.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "dtcInterfaceLib/DTC.h"
+#include "simEventWriter.h"
+
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "releasePolicyTest"
+
+void usage()
+{
+	std::cout << "This program reads events from the mu2esim DTC emulator with each DAQ buffer release policy, and" << std::endl
+			  << "checks when the buffers are released." << std::endl
+			  << "Options are:" << std::endl
+			  << "    -h: This message." << std::endl;
+}
+
+namespace {
+std::vector<uint8_t> makeEvent(uint64_t tagValue)
+{
+	DTCLib::DTC_Event evt;
+	DTCLib::DTC_EventWindowTag tag(tagValue);
+	evt.SetEventWindowTag(tag);
+	DTCLib::DTC_SubEvent subEvt;
+	subEvt.SetEventWindowTag(tag);
+	addDataBlock(subEvt, DTCLib::DTC_Link_0, 1, 0, DTCLib::DTC_Subsystem_Tracker, tag);
+	evt.AddSubEvent(subEvt);
+	return eventBytes(evt);
+}
+
+// What each GetData call released, and the number of buffers held when it decided
+struct Call
+{
+	uint64_t released;
+	size_t heldBefore;
+	bool forced;  // Three quarters of the ring was held, so the policy did not matter
+	std::chrono::steady_clock::time_point end;
+};
+
+struct Trace
+{
+	std::vector<Call> calls;
+	DTCLib::DTC_ReleaseStats stats;
+	unsigned events{0};
+	uint64_t heldSum{0};
+	size_t heldMax{0};
+};
+
+// Write the given number of events, one per DMA buffer, and read them back one GetData call at a time. Each call first
+// decides whether to release the buffers finished by the previous one.
+Trace readEvents(DTCLib::DTC& dtc, unsigned count, unsigned pause_us)
+{
+	Trace trace;
+	auto device = dtc.GetDevice();
+	for (unsigned ii = 0; ii < count; ++ii)
+		if (writeEvent(device, makeEvent(ii + 1)) != 0) TLOG(TLVL_ERROR) << "Failed to write event " << ii + 1;
+
+	auto ringSize = device->get_ring_size(DTC_DMA_Engine_DAQ);
+	auto before = dtc.GetReleaseStats(DTC_DMA_Engine_DAQ);
+	for (unsigned ii = 0; ii < count; ++ii)
+	{
+		auto data = dtc.GetData();
+		if (data.size() == 1 && data[0]->GetEventWindowTag().GetEventWindowTag(true) == ii + 1) ++trace.events;
+		auto stats = dtc.GetReleaseStats(DTC_DMA_Engine_DAQ);
+		trace.calls.push_back({stats.buffersReleased - before.buffersReleased, before.held, before.held * 4 >= ringSize * 3,
+							   std::chrono::steady_clock::now()});
+		trace.heldSum += before.held;
+		if (stats.held > trace.heldMax) trace.heldMax = stats.held;
+		before = stats;
+		if (pause_us > 0) usleep(pause_us);
+	}
+	trace.stats = before;
+	TLOG(TLVL_INFO) << trace.events << " events, " << trace.stats.releaseCalls << " releases of " << trace.stats.buffersReleased << " buffers, "
+					<< trace.stats.deferred << " deferred, held " << trace.stats.held << " (max " << trace.stats.maxHeld << ", mean "
+					<< trace.stats.MeanHeld() << ")";
+	return trace;
+}
+
+// Returns the number of errors
+unsigned check(std::string const& name, bool ok)
+{
+	if (ok) return 0;
+	std::cout << name << " FAILED" << std::endl;
+	return 1;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1)
+	{
+		usage();
+		exit(0);
+	}
+
+	auto simFile = "mu2esim_release_" + std::to_string(getpid()) + ".bin";
+	unsigned errors = 0;
+	auto run = [&](DTCLib::DTC_ReleasePolicy policy, unsigned parameter, unsigned count, unsigned pause_us) {
+		unlink(simFile.c_str());
+		DTCLib::DTC dtc(DTCLib::DTC_SimMode_Performance, 0, 0x1, "", false, simFile);
+		dtc.GetDevice()->write_register(DTCLib::DTC_Register_DetEmulation_Control0, 0, 0);
+		dtc.SetReleasePolicy(policy, parameter);
+		auto trace = readEvents(dtc, count, pause_us);
+		errors += check(DTCLib::DTC_ReleasePolicyConverter(policy).toString() + " read all events", trace.events == count);
+		return trace;
+	};
+
+	// Eager: every call gives back the one buffer the previous call finished
+	auto trace = run(DTCLib::DTC_ReleasePolicy_Eager, 0, 20, 0);
+	auto ok = trace.stats.deferred == 0 && trace.stats.releaseCalls == 19;
+	for (size_t ii = 1; ii < trace.calls.size(); ++ii) ok = ok && trace.calls[ii].released == 1;
+	errors += check("Eager releases one buffer per call", ok);
+
+	// Count: unless the ring is short, buffers go back four at a time
+	trace = run(DTCLib::DTC_ReleasePolicy_Count, 4, 40, 0);
+	ok = trace.stats.deferred > 0;
+	unsigned batches = 0;
+	for (auto& call : trace.calls)
+	{
+		if (call.released == 0 || call.forced) continue;
+		++batches;
+		if (call.released != 4) ok = false;
+	}
+	errors += check("Count releases four buffers at a time", ok && batches >= 3);
+
+	// Age: unless the ring is short, buffers go back once the oldest finished one is 20 ms old. The previous release
+	// was at least that long ago, and at 3 ms per call several buffers have finished since.
+	trace = run(DTCLib::DTC_ReleasePolicy_Age, 20000, 40, 3000);
+	ok = trace.stats.deferred > 0;
+	batches = 0;
+	auto lastRelease = trace.calls[0].end;
+	for (auto& call : trace.calls)
+	{
+		if (call.released == 0) continue;
+		if (!call.forced)
+		{
+			++batches;
+			if (call.released < 2 || call.end - lastRelease < std::chrono::milliseconds(20)) ok = false;
+		}
+		lastRelease = call.end;
+	}
+	errors += check("Age releases buffers once they are 20 ms old", ok && batches >= 2);
+
+	// Watermark: buffers go back while a quarter of the ring (10 buffers) or more is held, and are kept below that
+	trace = run(DTCLib::DTC_ReleasePolicy_Watermark, 25, 40, 0);
+	ok = trace.stats.deferred > 0;
+	for (auto& call : trace.calls)
+	{
+		if ((call.released > 0) != (call.heldBefore >= 10)) ok = false;
+	}
+	errors += check("Watermark releases buffers at 25% of the ring", ok);
+
+	// Whatever the policy, buffers go back once three quarters of the ring is held
+	trace = run(DTCLib::DTC_ReleasePolicy_Count, 1000, 40, 0);
+	ok = trace.stats.releaseCalls > 0;
+	for (auto& call : trace.calls)
+	{
+		if ((call.released > 0) != call.forced) ok = false;
+	}
+	errors += check("Buffers are released at three quarters of the ring", ok);
+
+	// The occupancy statistics sample the held buffers on every release decision
+	ok = trace.stats.occupancySamples == trace.calls.size() && trace.stats.occupancySum == trace.heldSum &&
+		 trace.stats.maxHeld >= trace.heldMax && trace.stats.maxHeld <= SIM_BUFFCOUNT;
+	errors += check("Held-buffer occupancy statistics", ok);
+	unlink(simFile.c_str());
+
+	std::cout << (errors == 0 ? "Release policy test passed." : "Release policy test FAILED.") << std::endl;
+	return errors == 0 ? 0 : 1;
+}
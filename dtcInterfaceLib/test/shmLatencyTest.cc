@@ -0,0 +1,139 @@
+// Measures the completion latency of mu2edev::read_data against the mu2eshm shared-memory rings, with the driver
+// wait (GET_INFO) and with metadata polling, and checks that every buffer is delivered intact and in order.
+
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "dtcInterfaceLib/mu2edev.h"
+#include "dtcInterfaceLib/mu2eshm.h"
+
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "shmLatencyTest"
+
+void usage()
+{
+	std::cout << "This program sends buffers one at a time through the mu2eshm rings and measures how long" << std::endl
+			  << "mu2edev::read_data takes to see each one, with and without metadata polling." << std::endl
+			  << "Options are:" << std::endl
+			  << "    -h: This message." << std::endl
+			  << "    -n: Number of buffers per measurement (Default: 10000)." << std::endl
+			  << "    -s: Poll spin budget, in microseconds (Default: 1000)." << std::endl;
+}
+
+namespace {
+long long nowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Returns the number of errors; fills latencies (ns)
+unsigned measure(mu2edev& device, mu2eshm_ring& ring, unsigned count, std::vector<long long>& latencies)
+{
+	std::atomic<unsigned> consumed(0);
+	std::thread producer([&]() {
+		uint64_t buf[3];
+		for (unsigned ii = 0; ii < count; ++ii)
+		{
+			// One buffer in flight at a time, with a short gap so that the reader is already waiting
+			while (consumed.load() < ii) std::this_thread::yield();
+			usleep(20);
+			buf[0] = sizeof(buf);
+			buf[1] = ii;
+			buf[2] = static_cast<uint64_t>(nowNs());
+			while (ring.write_c2s(DTC_DMA_Engine_DAQ, buf, sizeof(buf)) != 0) std::this_thread::yield();
+		}
+	});
+
+	unsigned errors = 0;
+	latencies.clear();
+	for (unsigned ii = 0; ii < count; ++ii)
+	{
+		void* buffer;
+		auto bytes = device.read_data(DTC_DMA_Engine_DAQ, &buffer, 1000);
+		auto now = nowNs();
+		if (bytes != 3 * sizeof(uint64_t))
+		{
+			TLOG(TLVL_ERROR) << "Buffer " << ii << ": read_data returned " << bytes;
+			++errors;
+			break;
+		}
+		uint64_t data[3];
+		memcpy(data, buffer, sizeof(data));
+		if (data[0] != sizeof(data) || data[1] != ii)
+		{
+			TLOG(TLVL_ERROR) << "Buffer " << ii << ": got size " << data[0] << ", sequence " << data[1];
+			++errors;
+		}
+		latencies.push_back(now - static_cast<long long>(data[2]));
+		device.read_release(DTC_DMA_Engine_DAQ, 1);
+		++consumed;
+	}
+	consumed = count;
+	producer.join();
+	std::sort(latencies.begin(), latencies.end());
+	return errors;
+}
+
+void report(std::string name, std::vector<long long> const& latencies)
+{
+	if (latencies.empty()) return;
+	std::cout << name << ": median " << latencies[latencies.size() / 2] / 1000.0 << " us, 99% "
+			  << latencies[latencies.size() * 99 / 100] / 1000.0 << " us, max " << latencies.back() / 1000.0 << " us" << std::endl;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	unsigned count = 10000;
+	unsigned spin_us = 1000;
+	for (auto ii = 1; ii < argc; ++ii)
+	{
+		if (argv[ii][0] != '-' || argv[ii][1] == 'h' || ii + 1 >= argc)
+		{
+			usage();
+			exit(0);
+		}
+		switch (argv[ii][1])
+		{
+			case 'n':
+				count = strtoul(argv[++ii], nullptr, 0);
+				break;
+			case 's':
+				spin_us = strtoul(argv[++ii], nullptr, 0);
+				break;
+			default:
+				usage();
+				exit(0);
+		}
+	}
+
+	// Private segment, so that the test does not disturb (or get disturbed by) a real producer
+	auto name = "/mu2eshm_latency_" + std::to_string(getpid()) + "_dtc";
+	setenv("DTCLIB_SHM_NAME", name.c_str(), 1);
+
+	unsigned errors = 0;
+	{
+		mu2edev device;
+		device.init(DTCLib::DTC_SimMode_SharedMemory, 0);
+		mu2eshm_ring ring(0);
+		std::vector<long long> latencies;
+
+		device.set_poll_spin_us(0);
+		errors += measure(device, ring, count, latencies);
+		report("Driver wait", latencies);
+
+		device.set_poll_spin_us(spin_us);
+		errors += measure(device, ring, count, latencies);
+		report("Polling (" + std::to_string(spin_us) + " us)", latencies);
+	}
+	mu2eshm_ring::unlink(0);
+
+	std::cout << (errors == 0 ? "Shared-memory latency test passed." : "Shared-memory latency test FAILED.") << std::endl;
+	return errors == 0 ? 0 : 1;
+}
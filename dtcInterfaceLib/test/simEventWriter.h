@@ -0,0 +1,90 @@
+#pragma once
+#include <cstring>
+#include <vector>
+
+#include "dtcInterfaceLib/DTC_Packets.h"
+#include "dtcInterfaceLib/mu2edev.h"
+
+// Building test events and writing them to the mu2esim DTC emulator, shared by the readout tests
+
+/// <summary>
+/// Add a Data Block to a Sub-Event: a valid Data Header packet followed by the given number of data packets
+/// </summary>
+/// <param name="subEvt">Sub-Event to add the block to</param>
+/// <param name="link">Link ID of the block</param>
+/// <param name="packets">Number of data packets after the header</param>
+/// <param name="dtc">DTC ID in the header</param>
+/// <param name="subsystem">Subsystem in the header</param>
+/// <param name="tag">Event window tag in the header</param>
+/// <param name="payload">Function giving the byte at each index of the block, counted from the start of the header</param>
+template<typename Payload>
+void addDataBlock(DTCLib::DTC_SubEvent& subEvt, DTCLib::DTC_Link_ID link, uint16_t packets, uint8_t dtc, DTCLib::DTC_Subsystem subsystem,
+				  DTCLib::DTC_EventWindowTag const& tag, Payload payload)
+{
+	DTCLib::DTC_DataBlock blk((packets + 1) * 16);
+	DTCLib::DTC_DataHeaderPacket hdr(link, packets, DTCLib::DTC_DataStatus_Valid, dtc, subsystem, 0, tag);
+	memcpy(blk.allocBytes->data(), hdr.ConvertToDataPacket().GetData(), 16);
+	for (size_t ii = 16; ii < blk.byteSize; ++ii) (*blk.allocBytes)[ii] = static_cast<uint8_t>(payload(ii));
+	subEvt.AddDataBlock(blk);
+}
+
+/// <summary>
+/// Add a Data Block with an all-zero payload to a Sub-Event
+/// </summary>
+/// <param name="subEvt">Sub-Event to add the block to</param>
+/// <param name="link">Link ID of the block</param>
+/// <param name="packets">Number of data packets after the header</param>
+/// <param name="dtc">DTC ID in the header</param>
+/// <param name="subsystem">Subsystem in the header</param>
+/// <param name="tag">Event window tag in the header</param>
+inline void addDataBlock(DTCLib::DTC_SubEvent& subEvt, DTCLib::DTC_Link_ID link, uint16_t packets, uint8_t dtc, DTCLib::DTC_Subsystem subsystem,
+						 DTCLib::DTC_EventWindowTag const& tag)
+{
+	addDataBlock(subEvt, link, packets, dtc, subsystem, tag, [](size_t) { return 0; });
+}
+
+/// <summary>
+/// Get the bytes of an event as the DTC sends them: the event header, then each Sub-Event header and its Data Blocks
+/// </summary>
+/// <param name="evt">Event, its header is updated first</param>
+/// <returns>Event bytes</returns>
+inline std::vector<uint8_t> eventBytes(DTCLib::DTC_Event& evt)
+{
+	evt.UpdateHeader();
+	std::vector<uint8_t> bytes(reinterpret_cast<uint8_t*>(evt.GetHeader()), reinterpret_cast<uint8_t*>(evt.GetHeader()) + sizeof(DTCLib::DTC_EventHeader));
+	for (size_t sub = 0; sub < evt.GetSubEventCount(); ++sub)
+	{
+		auto subEvt = evt.GetSubEvent(sub);
+		auto hdr = reinterpret_cast<uint8_t*>(subEvt->GetHeader());
+		bytes.insert(bytes.end(), hdr, hdr + sizeof(DTCLib::DTC_SubEventHeader));
+		for (auto& blk : subEvt->GetDataBlockViews())
+		{
+			auto data = static_cast<const uint8_t*>(blk.GetPointer());
+			bytes.insert(bytes.end(), data, data + blk.byteSize);
+		}
+	}
+	return bytes;
+}
+
+/// <summary>
+/// Write an event to the emulator's DDR memory, cut into DMA buffers of at most chunk bytes wherever the cut falls
+/// </summary>
+/// <param name="device">Device of the emulated DTC</param>
+/// <param name="bytes">Event bytes</param>
+/// <param name="chunk">Largest DMA buffer payload (Default: as much as a buffer holds)</param>
+/// <returns>0 on success, -1 if a write failed</returns>
+inline int writeEvent(mu2edev* device, std::vector<uint8_t> const& bytes, size_t chunk = sizeof(mu2e_databuff_t) - 2 * sizeof(uint64_t))
+{
+	mu2e_databuff_t buf;
+	for (size_t pos = 0; pos < bytes.size(); pos += chunk)
+	{
+		uint64_t size = bytes.size() - pos < chunk ? bytes.size() - pos : chunk;
+		uint64_t dmaSize = size + sizeof(uint64_t);
+		uint64_t transferSize = dmaSize + sizeof(uint64_t);
+		memcpy(&buf[0], &transferSize, sizeof(uint64_t));
+		memcpy(&buf[8], &dmaSize, sizeof(uint64_t));
+		memcpy(&buf[16], &bytes[pos], size);
+		if (device->write_data(DTC_DMA_Engine_DAQ, &buf, transferSize) != 0) return -1;
+	}
+	return 0;
+}
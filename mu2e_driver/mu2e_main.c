@@ -405,6 +405,14 @@ IOCTL_RET_TYPE mu2e_ioctl(IOCTL_ARGS(struct inode *inode, struct file *filp, uns
 			dir = (arg >> 16) & 1;
 			num = arg & 0xffff;
 			TRACE(21, "mu2e_ioctl: BUF_GIVE chn:%u dir:%u num:%u", chn, dir, num);
+			if (dir == C2S)
+			{  // Clear the byte counts of the released buffers before the engine can reuse them,
+				// so that a non-zero byte count always marks a new completion
+				int *BC_p = (int *)mu2e_mmap_ptrs[dtc][chn][dir][MU2E_MAP_META];
+				for (jj = 1; jj <= (unsigned)num; ++jj)
+					BC_p[idx_add(mu2e_channel_info_[dtc][chn][dir].swIdx, (int)jj, dtc, chn, dir)] = 0;
+				wmb();
+			}
 			myIdx = idx_add(mu2e_channel_info_[dtc][chn][dir].swIdx, num, dtc, chn, dir);
 			Dma_mWriteChnReg(dtc, chn, dir, REG_SW_NEXT_BD, idx2descDmaAdr(myIdx, dtc, chn, dir));
 			checkDmaEngine(dtc, chn, dir);
@@ -109,7 +109,8 @@ int alloc_mem(int dtc)
 		}
 
 		mu2e_mmap_ptrs[dtc][chn][dir][MU2E_MAP_BUFF] = mu2e_pci_recver[dtc][chn].databuffs;
-		va = kmalloc(MU2E_NUM_RECV_BUFFS * sizeof(int), GFP_KERNEL);
+		// Zeroed: user space may poll the byte counts for new completions (see M_IOC_BUF_GIVE)
+		va = kzalloc(MU2E_NUM_RECV_BUFFS * sizeof(int), GFP_KERNEL);
 		if (va == NULL) goto out;
 		mu2e_pci_recver[dtc][chn].buffer_sizes = va;
 		mu2e_mmap_ptrs[dtc][chn][dir][MU2E_MAP_META] = va;
@@ -191,7 +191,8 @@ static int mu2e_pci_probe(struct pci_dev *pdev, const struct pci_device_id *ent)
 #endif
 
 	TRACE(1, "mu2e_pci_probe creating device");
-	devptr = device_create(mu2e_dev_class, NULL, pdev->dev.devt, NULL, MU2E_DEV_FILE, dtc);
+	// Parent is the PCI function, so that sysfs links mu2eX to it (numa_node, local_cpulist)
+	devptr = device_create(mu2e_dev_class, &pdev->dev, pdev->dev.devt, NULL, MU2E_DEV_FILE, dtc);
 	if ((void*)devptr == ERR_PTR) goto out2;
 
 	TRACE(1, "mu2e_pci_probe enabling events");